@@ -0,0 +1,152 @@
+#include "Precomp.h"
+#include "BatchRayCaster.h"
+#include "Broadphase.h"
+#include "PhysicsWorld.h"
+#include "Executor.h"
+#include "Trace.h"
+
+// Rays are sorted by direction first (into DirectionBuckets wedges), then by
+// where they start, along a Morton (Z order) curve over a 2^OriginBits grid
+// spanning the batch's start points
+static const int DirectionBits = 4;
+static const int OriginBits = 10;
+static const int KeyBits = DirectionBits + 2 * OriginBits;
+
+// Rays per chunk of work handed to a thread (a whole number of packets)
+static const size_t RaysPerChunk = 64 * RayPacket::Size;
+
+// Spreads the low 16 bits of value out to the even bits
+static uint32_t SpreadBits(uint32_t value)
+{
+    value &= 0xFFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+
+BatchRayCaster::BatchRayCaster(Executor* pool)
+    : _pool(pool)
+    , _sorting(true)
+{
+}
+
+size_t BatchRayCaster::Cast(const PhysicsWorld& world, const Vector2* starts, const Vector2* ends, size_t count, RayCastHit* hits)
+{
+    TRACE_SCOPE("BatchRayCaster::Cast");
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // Without sorting, cast straight from (and into) the caller's arrays
+    const Vector2* castStarts = starts;
+    const Vector2* castEnds = ends;
+    RayCastHit* castHits = hits;
+
+    if (_sorting)
+    {
+        TRACE_SCOPE("SortRays");
+
+        Vector2 lower = starts[0];
+        Vector2 upper = starts[0];
+        for (size_t i = 1; i < count; ++i)
+        {
+            lower = Vector2(min(lower.x, starts[i].x), min(lower.y, starts[i].y));
+            upper = Vector2(max(upper.x, starts[i].x), max(upper.y, starts[i].y));
+        }
+
+        static const float Cells = (float)((1 << OriginBits) - 1);
+        Vector2 scale((upper.x > lower.x) ? Cells / (upper.x - lower.x) : 0.0f, (upper.y > lower.y) ? Cells / (upper.y - lower.y) : 0.0f);
+
+        _keys.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t cellX = (uint32_t)((starts[i].x - lower.x) * scale.x);
+            uint32_t cellY = (uint32_t)((starts[i].y - lower.y) * scale.y);
+            uint32_t origin = SpreadBits(cellX) | (SpreadBits(cellY) << 1);
+
+            Vector2 delta = ends[i] - starts[i];
+            float angle = atan2f(delta.y, delta.x) + (float)M_PI;
+            uint32_t direction = min((uint32_t)(angle * ((1 << DirectionBits) / (2.0f * (float)M_PI))), (uint32_t)((1 << DirectionBits) - 1));
+
+            uint32_t key = (direction << (2 * OriginBits)) | origin;
+            _keys[i] = ((uint64_t)key << 32) | i;
+        }
+
+        SortKeys();
+
+        _sortedStarts.resize(count);
+        _sortedEnds.resize(count);
+        _sortedHits.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t index = (uint32_t)_keys[i];
+            _sortedStarts[i] = starts[index];
+            _sortedEnds[i] = ends[index];
+        }
+
+        castStarts = _sortedStarts.data();
+        castEnds = _sortedEnds.data();
+        castHits = _sortedHits.data();
+    }
+
+    std::atomic<size_t> hitCount(0);
+    auto castChunk = [&world, castStarts, castEnds, castHits, &hitCount](size_t begin, size_t end)
+    {
+        hitCount += world.RayCastBatch(castStarts + begin, castEnds + begin, end - begin, castHits + begin);
+    };
+
+    if (_pool)
+    {
+        _pool->ParallelFor(count, RaysPerChunk, castChunk);
+    }
+    else
+    {
+        castChunk(0, count);
+    }
+
+    if (_sorting)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            hits[(uint32_t)_keys[i]] = _sortedHits[i];
+        }
+    }
+
+    return hitCount;
+}
+
+void BatchRayCaster::SortKeys()
+{
+    // Least significant digit radix sort, on just the key bits in use.
+    // Each pass is stable, so equal keys stay in ray order.
+    static const int DigitBits = 8;
+    static const int Buckets = 1 << DigitBits;
+
+    _sortScratch.resize(_keys.size());
+    for (int shift = 32; shift < 32 + KeyBits; shift += DigitBits)
+    {
+        size_t offsets[Buckets] = {};
+        for (auto& key : _keys)
+        {
+            ++offsets[(key >> shift) & (Buckets - 1)];
+        }
+
+        size_t total = 0;
+        for (int i = 0; i < Buckets; ++i)
+        {
+            size_t bucketCount = offsets[i];
+            offsets[i] = total;
+            total += bucketCount;
+        }
+
+        for (auto& key : _keys)
+        {
+            _sortScratch[offsets[(key >> shift) & (Buckets - 1)]++] = key;
+        }
+        _keys.swap(_sortScratch);
+    }
+}
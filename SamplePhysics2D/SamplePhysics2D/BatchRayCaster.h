@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Collision.h"
+
+class PhysicsWorld;
+class Executor;
+
+// Casts large batches of rays (tens of thousands a frame, for AI sensors say)
+// against a world. Rays are sorted so that each packet holds rays that start
+// near each other and point the same way, which then visit mostly the same
+// tree nodes. The packets are spread across a thread pool (or any Executor).
+//
+// Each caster keeps its own scratch memory, so use one per calling thread.
+class BatchRayCaster
+{
+public:
+    // pool may be null, to cast on the calling thread only
+    BatchRayCaster(Executor* pool = nullptr);
+
+    // Sorting can be turned off, for rays that are already in a coherent order
+    void EnableSorting(bool enable) { _sorting = enable; }
+
+    // Same contract as PhysicsWorld::RayCastBatch. Hits are returned in the
+    // same order as the rays, however they were sorted internally.
+    size_t Cast(const PhysicsWorld& world, const Vector2* starts, const Vector2* ends, size_t count, RayCastHit* hits);
+
+private:
+    // Sorts _keys (sort key in the upper 32 bits, ray index in the lower)
+    void SortKeys();
+
+    Executor* _pool;
+    bool _sorting;
+
+    std::vector<uint64_t> _keys;
+    std::vector<uint64_t> _sortScratch;
+    std::vector<Vector2> _sortedStarts;
+    std::vector<Vector2> _sortedEnds;
+    std::vector<RayCastHit> _sortedHits;
+
+    // Prevent copy
+    BatchRayCaster(const BatchRayCaster&);
+    BatchRayCaster& operator= (const BatchRayCaster&);
+};
@@ -0,0 +1,150 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+struct Benchmark
+{
+    const char* name;
+    bool (*run)(FILE* output);
+};
+
+static const Benchmark AllBenchmarks[] =
+{
+    { "narrowphase", BenchNarrowphase },
+    { "snapshot", BenchSnapshot },
+    { "scene", BenchScene },
+    { "replication", BenchReplication },
+    { "statictree", BenchStaticTree },
+    { "kinematic", BenchKinematic },
+    { "query", BenchQuery },
+    { "raycast", BenchRayCast },
+    { "worldbatch", BenchWorldBatch },
+    { "jobs", BenchJobs },
+    { "coherence", BenchCoherence },
+    { "simd", BenchSimd },
+    { "vector2", BenchVector2 },
+    { "normalize", BenchNormalize },
+    { "scalar-float", BenchScalarFloat },
+    { "scalar-double", BenchScalarDouble },
+    { "scalar-fixed", BenchScalarFixed },
+    { "capture", BenchCapture },
+    { "debugdraw", BenchDebugDraw },
+    { "drawlist", BenchDrawList },
+    { "paralleldraw", BenchParallelDraw },
+    { "softrender", BenchSoftwareRender },
+    { "profiling", BenchProfiling },
+    { "trace", BenchTrace },
+};
+
+bool RunBenchmarks(const char* commandLine)
+{
+    // Anything following -bench is the list of benchmarks to run
+    const char* names = strstr(commandLine, "-bench");
+    names = names ? names + strlen("-bench") : "";
+    while (*names == ' ')
+    {
+        ++names;
+    }
+
+    FILE* output = fopen("bench_results.txt", "w");
+    if (!output)
+    {
+        return false;
+    }
+
+    bool succeeded = true;
+    for (int i = 0; i < _countof(AllBenchmarks); ++i)
+    {
+        if (*names != '\0' && !strstr(names, AllBenchmarks[i].name))
+        {
+            continue;
+        }
+
+        fprintf(output, "== %s ==\n", AllBenchmarks[i].name);
+        if (!AllBenchmarks[i].run(output))
+        {
+            fprintf(output, "FAILED\n");
+            succeeded = false;
+        }
+        fprintf(output, "\n");
+        fflush(output);
+    }
+
+    fclose(output);
+    return succeeded;
+}
+
+void CreateBenchScene(PhysicsWorld* world, std::vector<std::unique_ptr<RigidBody>>& bodies, int count, uint32_t seed)
+{
+    BenchRandom random(seed);
+
+    int columns = (int)sqrtf((float)count);
+    float width = (float)columns;
+
+    for (int i = 0; i < count; ++i)
+    {
+        Shape* shape;
+        if (random.Next() % 2 == 0)
+        {
+            shape = new CircleShape(random.Range(0.45f, 0.6f));
+        }
+        else
+        {
+            shape = new BoxShape(random.Range(0.9f, 1.1f), random.Range(0.9f, 1.1f));
+        }
+
+        RigidBody* body = new RigidBody(shape, 5.0f);
+        body->Position() = Vector2((i % columns) - 0.5f * width + 0.5f, (float)(i / columns) + 0.5f);
+        body->Rotation() = random.Range(-0.1f, 0.1f);
+        bodies.push_back(std::unique_ptr<RigidBody>(body));
+    }
+
+    // Container: floor & two walls
+    float height = (float)(count / columns + 1);
+
+    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(width + 2.0f, 1.0f), FLT_MAX)));
+    bodies.back()->Position() = Vector2(0.0f, -0.5f);
+    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(1.0f, height * 2.0f), FLT_MAX)));
+    bodies.back()->Position() = Vector2(-0.5f * width - 0.5f, height);
+    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(1.0f, height * 2.0f), FLT_MAX)));
+    bodies.back()->Position() = Vector2(0.5f * width + 0.5f, height);
+
+    for (size_t i = bodies.size() - count - 3; i < bodies.size(); ++i)
+    {
+        world->AddBody(bodies[i].get());
+    }
+}
+
+void CreateBenchScene(BenchPile& scene, int count, uint32_t seed, int settleSteps)
+{
+    scene.world.reset(new PhysicsWorld(Vector2(0.0f, -20.0f), 10));
+    scene.bodies.clear();
+    CreateBenchScene(scene.world.get(), scene.bodies, count, seed);
+    for (int i = 0; i < settleSteps; ++i)
+    {
+        scene.world->Update(1.0f / 60.0f);
+    }
+}
+
+void CreateBenchStacks(PhysicsWorld* world, std::vector<std::unique_ptr<RigidBody>>& bodies, int stackCount, int stackHeight, uint32_t seed)
+{
+    BenchRandom random(seed);
+    float width = stackCount * 3.0f;
+
+    for (int stack = 0; stack < stackCount; ++stack)
+    {
+        for (int i = 0; i < stackHeight; ++i)
+        {
+            RigidBody* body = new RigidBody(new BoxShape(random.Range(0.9f, 1.1f), 1.0f), 5.0f);
+            body->Position() = Vector2(stack * 3.0f - 0.5f * width, i + 0.5f);
+            bodies.push_back(std::unique_ptr<RigidBody>(body));
+            world->AddBody(body);
+        }
+    }
+
+    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(width + 2.0f, 1.0f), FLT_MAX)));
+    bodies.back()->Position() = Vector2(-1.5f, -0.5f);
+    world->AddBody(bodies.back().get());
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// Headless benchmarks. The sample runs these instead of opening its window
+// when the command line contains -bench, optionally followed by the names of
+// the benchmarks to run (all of them if none are given). For example:
+//
+//     SamplePhysics2D.exe -bench narrowphase
+//
+// Reports are written to bench_results.txt in the working directory.
+// Returns false if the report couldn't be written, or if any benchmark failed.
+bool RunBenchmarks(const char* commandLine);
+
+// Individual benchmarks. Each writes its report to output, and
+// returns false if it failed (for instance, a validation mismatch).
+bool BenchNarrowphase(FILE* output);
+bool BenchSnapshot(FILE* output);
+bool BenchScene(FILE* output);
+bool BenchReplication(FILE* output);
+bool BenchStaticTree(FILE* output);
+bool BenchKinematic(FILE* output);
+bool BenchQuery(FILE* output);
+bool BenchRayCast(FILE* output);
+bool BenchWorldBatch(FILE* output);
+bool BenchJobs(FILE* output);
+bool BenchCoherence(FILE* output);
+bool BenchSimd(FILE* output);
+bool BenchVector2(FILE* output);
+bool BenchNormalize(FILE* output);
+bool BenchScalarFloat(FILE* output);
+bool BenchScalarDouble(FILE* output);
+bool BenchScalarFixed(FILE* output);
+bool BenchCapture(FILE* output);
+bool BenchDebugDraw(FILE* output);
+bool BenchDrawList(FILE* output);
+bool BenchParallelDraw(FILE* output);
+bool BenchSoftwareRender(FILE* output);
+bool BenchProfiling(FILE* output);
+bool BenchTrace(FILE* output);
+
+// Small, fast & repeatable random number source for generating benchmark data
+class BenchRandom
+{
+public:
+    BenchRandom(uint32_t seed) : _state(seed ? seed : 1) {}
+
+    // xorshift32
+    uint32_t Next()
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return _state;
+    }
+
+    // Uniformly distributed in [lo, hi)
+    float Range(float lo, float hi)
+    {
+        return lo + (hi - lo) * (float)(Next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+private:
+    uint32_t _state;
+};
+
+class PhysicsWorld;
+
+// Fills world with count random boxes and circles, stacked in a grid inside
+// a static container and spaced so that neighbors start out touching. The
+// created bodies (including the container) are appended to bodies, which owns them.
+void CreateBenchScene(PhysicsWorld* world, std::vector<std::unique_ptr<RigidBody>>& bodies, int count, uint32_t seed);
+
+// A world and the bodies it owns, for the benchmarks that step & draw a scene
+struct BenchPile
+{
+    std::unique_ptr<PhysicsWorld> world;
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+};
+
+// Creates the world (with the usual gravity & 10 solver iterations), fills it
+// by CreateBenchScene, and steps it settleSteps times at 60 Hz, so that
+// drawing starts from a pile that's already in contact.
+void CreateBenchScene(BenchPile& scene, int count, uint32_t seed, int settleSteps);
+
+// Fills world with stackCount stacks of stackHeight boxes, 3 apart and centered
+// on a static floor. The boxes are 1 high, with random widths a little either
+// side of 1, so the stacks aren't perfectly even. Bodies are appended to
+// bodies, as for CreateBenchScene.
+void CreateBenchStacks(PhysicsWorld* world, std::vector<std::unique_ptr<RigidBody>>& bodies, int stackCount, int stackHeight, uint32_t seed);
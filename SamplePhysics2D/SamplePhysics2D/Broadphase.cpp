@@ -0,0 +1,372 @@
+#include "Precomp.h"
+#include "Broadphase.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+// Relative costs of visiting a node and of testing a body, for the SAH
+static const float TraversalCost = 1.0f;
+static const float IntersectCost = 1.0f;
+
+// Leaves hold at most this many bodies
+static const uint32_t MaxLeafSize = 4;
+
+AABB Union(const AABB& a, const AABB& b)
+{
+    return AABB(
+        Vector2(min(a.lower.x, b.lower.x), min(a.lower.y, b.lower.y)),
+        Vector2(max(a.upper.x, b.upper.x), max(a.upper.y, b.upper.y)));
+}
+
+// Exact values of the other scalar types (both fit in a double)
+static double ExactValue(double x) { return x; }
+static double ExactValue(Fixed x) { return x.ToDouble(); }
+
+// The nearest float at or below x, and at or above it
+static float FloatBelow(float x) { return x; }
+static float FloatAbove(float x) { return x; }
+
+template <class S>
+static float FloatBelow(S x)
+{
+    float f = ToFloat(x);
+    return (double)f > ExactValue(x) ? nextafterf(f, -FLT_MAX) : f;
+}
+
+template <class S>
+static float FloatAbove(S x)
+{
+    float f = ToFloat(x);
+    return (double)f < ExactValue(x) ? nextafterf(f, FLT_MAX) : f;
+}
+
+template <class S>
+AABB ComputeAABB(const RigidBodyT<S>* body, float margin)
+{
+    typedef Vector2T<S> Vector;
+    const ShapeT<S>* shape = body->GetShape();
+
+    Vector extents;
+    switch (shape->Type())
+    {
+    case ShapeType::Circle:
+        {
+            S radius = ((const CircleShapeT<S>*)shape)->Radius();
+            extents = Vector(radius, radius);
+        }
+        break;
+
+    case ShapeType::Box:
+        {
+            // Project the rotated half widths onto each axis
+            Vector halfWidths = S(0.5f) * ((const BoxShapeT<S>*)shape)->Size();
+            S c = Abs(Cos(body->Rotation()));
+            S s = Abs(Sin(body->Rotation()));
+            extents = Vector(c * halfWidths.x + s * halfWidths.y, s * halfWidths.x + c * halfWidths.y);
+        }
+        break;
+
+    default:
+        assert(false);
+        break;
+    }
+
+    extents += Vector(S(margin), S(margin));
+    Vector lower = body->Position() - extents;
+    Vector upper = body->Position() + extents;
+    return AABB(Vector2(FloatBelow(lower.x), FloatBelow(lower.y)), Vector2(FloatAbove(upper.x), FloatAbove(upper.y)));
+}
+
+template AABB ComputeAABB(const RigidBodyT<float>* body, float margin);
+template AABB ComputeAABB(const RigidBodyT<double>* body, float margin);
+template AABB ComputeAABB(const RigidBodyT<Fixed>* body, float margin);
+
+bool ClipSegment(const AABB& box, const Vector2& start, const Vector2& delta, float& enter, float& exit)
+{
+    // Slab test: clip [enter, exit] against the box's extent on each axis
+    const float starts[] = { start.x, start.y };
+    const float deltas[] = { delta.x, delta.y };
+    const float lowers[] = { box.lower.x, box.lower.y };
+    const float uppers[] = { box.upper.x, box.upper.y };
+
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (fabsf(deltas[axis]) < FLT_EPSILON)
+        {
+            // Parallel to this slab, so it has to start inside it
+            if (starts[axis] < lowers[axis] || starts[axis] > uppers[axis])
+            {
+                return false;
+            }
+        }
+        else
+        {
+            float invDelta = 1.0f / deltas[axis];
+            float t1 = (lowers[axis] - starts[axis]) * invDelta;
+            float t2 = (uppers[axis] - starts[axis]) * invDelta;
+            enter = max(enter, min(t1, t2));
+            exit = min(exit, max(t1, t2));
+            if (enter > exit)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Stands in for 1 / 0, large enough to push any slab crossing far outside
+// [0, 1], but finite so that 0 * it stays 0 rather than becoming NaN
+static const float HugeInverse = 1e30f;
+
+static float SafeInverse(float value)
+{
+    if (fabsf(value) < FLT_EPSILON)
+    {
+        return value >= 0.0f ? HugeInverse : -HugeInverse;
+    }
+    return 1.0f / value;
+}
+
+void RayPacket::Set(int i, const Vector2& start, const Vector2& end)
+{
+    startX[i] = start.x;
+    startY[i] = start.y;
+    deltaX[i] = end.x - start.x;
+    deltaY[i] = end.y - start.y;
+    invDeltaX[i] = SafeInverse(deltaX[i]);
+    invDeltaY[i] = SafeInverse(deltaY[i]);
+    maxFraction[i] = 1.0f;
+}
+
+void RayPacket::Clear(int i)
+{
+    startX[i] = 0.0f;
+    startY[i] = 0.0f;
+    deltaX[i] = 0.0f;
+    deltaY[i] = 0.0f;
+    invDeltaX[i] = HugeInverse;
+    invDeltaY[i] = HugeInverse;
+    maxFraction[i] = -1.0f;
+}
+
+template <class S>
+BodyTreeT<S>::BodyTreeT()
+    : _method(TreeBuild::SAH)
+{
+}
+
+template <class S>
+void BodyTreeT<S>::Clear()
+{
+    _nodes.clear();
+    _bodies.clear();
+    _bounds.clear();
+}
+
+template <class S>
+void BodyTreeT<S>::Build(const std::vector<Body*>& bodies, TreeBuild method)
+{
+    Clear();
+    _method = method;
+    if (bodies.empty())
+    {
+        return;
+    }
+
+    // A small margin covers rounding differences between these bounds and
+    // the exact tests run on the bodies they find
+    static const float Margin = 0.001f;
+
+    _inputBounds.resize(bodies.size());
+    _order.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i)
+    {
+        _inputBounds[i] = ComputeAABB(bodies[i], Margin);
+        _order[i] = (uint32_t)i;
+    }
+
+    _rightCosts.resize(bodies.size());
+
+    // A binary tree with n leaves has 2n - 1 nodes
+    _nodes.reserve(2 * bodies.size() - 1);
+    _nodes.push_back(Node());
+    BuildNode(0, 0, (uint32_t)bodies.size(), 0);
+
+    // Put bodies (and their bounds) in leaf order
+    _bodies.resize(bodies.size());
+    _bounds.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i)
+    {
+        _bodies[i] = bodies[_order[i]];
+        _bounds[i] = _inputBounds[_order[i]];
+    }
+}
+
+template <class S>
+void BodyTreeT<S>::BuildNode(uint32_t index, uint32_t first, uint32_t count, int depth)
+{
+    AABB bounds = _inputBounds[_order[first]];
+    for (uint32_t i = first + 1; i < first + count; ++i)
+    {
+        bounds = Union(bounds, _inputBounds[_order[i]]);
+    }
+
+    _nodes[index].bounds = bounds;
+    _nodes[index].first = first;
+    _nodes[index].count = count;
+
+    if (count == 1 || depth >= MaxDepth)
+    {
+        return;
+    }
+
+    uint32_t split = (_method == TreeBuild::SAH) ? SplitSAH(first, count, bounds) : SplitMedian(first, count, bounds);
+    if (split == 0)
+    {
+        return;
+    }
+
+    uint32_t child = (uint32_t)_nodes.size();
+    _nodes.push_back(Node());
+    _nodes.push_back(Node());
+    _nodes[index].first = child;
+    _nodes[index].count = 0;
+
+    BuildNode(child, first, split, depth + 1);
+    BuildNode(child + 1, first + split, count - split, depth + 1);
+}
+
+// Orders body indices by the center of their bounds along one axis. Ties are
+// broken by index, so the same bodies always produce the same tree.
+struct CenterLess
+{
+    CenterLess(const std::vector<AABB>& bounds, int axis) : bounds(bounds), axis(axis) {}
+
+    float Center(uint32_t i) const
+    {
+        return axis == 0 ? bounds[i].lower.x + bounds[i].upper.x : bounds[i].lower.y + bounds[i].upper.y;
+    }
+
+    bool operator() (uint32_t a, uint32_t b) const
+    {
+        float centerA = Center(a);
+        float centerB = Center(b);
+        return centerA < centerB || (centerA == centerB && a < b);
+    }
+
+    const std::vector<AABB>& bounds;
+    int axis;
+};
+
+template <class S>
+uint32_t BodyTreeT<S>::SplitSAH(uint32_t first, uint32_t count, const AABB& bounds)
+{
+    uint32_t* order = &_order[first];
+
+    // Try splitting at every position along each axis, and keep the cheapest split
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        std::sort(order, order + count, CenterLess(_inputBounds, axis));
+
+        // Sweep from the right, then from the left, so each split is costed in constant time
+        AABB right = _inputBounds[order[count - 1]];
+        for (uint32_t i = count - 1; i > 0; --i)
+        {
+            right = Union(right, _inputBounds[order[i]]);
+            _rightCosts[i] = right.HalfPerimeter() * (count - i);
+        }
+
+        AABB left = _inputBounds[order[0]];
+        for (uint32_t i = 1; i < count; ++i)
+        {
+            float cost = left.HalfPerimeter() * i + _rightCosts[i];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+            left = Union(left, _inputBounds[order[i]]);
+        }
+    }
+
+    // Compare against the cost of making this a leaf (scaled the same way)
+    float area = max(bounds.HalfPerimeter(), FLT_MIN);
+    float splitCost = TraversalCost + IntersectCost * bestCost / area;
+    float leafCost = IntersectCost * count;
+    if (count <= MaxLeafSize && leafCost <= splitCost)
+    {
+        return 0;
+    }
+
+    // The last sort was along the y axis
+    if (bestAxis == 0)
+    {
+        std::sort(order, order + count, CenterLess(_inputBounds, 0));
+    }
+
+    return bestSplit;
+}
+
+template <class S>
+uint32_t BodyTreeT<S>::SplitMedian(uint32_t first, uint32_t count, const AABB& bounds)
+{
+    if (count <= MaxLeafSize)
+    {
+        return 0;
+    }
+
+    uint32_t* order = &_order[first];
+    int axis = (bounds.upper.x - bounds.lower.x >= bounds.upper.y - bounds.lower.y) ? 0 : 1;
+    std::nth_element(order, order + count / 2, order + count, CenterLess(_inputBounds, axis));
+    return count / 2;
+}
+
+template <class S>
+void BodyTreeT<S>::Query(const AABB& box, std::vector<Body*>& results) const
+{
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    // Each visit pops one node and pushes at most two, so the stack never
+    // holds more than one node per level
+    uint32_t stack[MaxDepth + 1];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node& node = _nodes[stack[--top]];
+        if (!Overlaps(node.bounds, box))
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (Overlaps(_bounds[i], box))
+                {
+                    results.push_back(_bodies[i]);
+                }
+            }
+        }
+        else
+        {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+        }
+    }
+}
+
+template class BodyTreeT<float>;
+template class BodyTreeT<double>;
+template class BodyTreeT<Fixed>;
@@ -0,0 +1,312 @@
+#pragma once
+
+// Axis aligned bounding box
+struct AABB
+{
+    AABB() {}
+    AABB(const Vector2& lower, const Vector2& upper) : lower(lower), upper(upper) {}
+
+    // Half the perimeter. The 2D equivalent of surface area, used to estimate
+    // how likely a query is to hit the box.
+    float HalfPerimeter() const
+    {
+        return (upper.x - lower.x) + (upper.y - lower.y);
+    }
+
+    Vector2 lower;
+    Vector2 upper;
+};
+
+inline bool Overlaps(const AABB& a, const AABB& b)
+{
+    return a.lower.x <= b.upper.x && b.lower.x <= a.upper.x &&
+           a.lower.y <= b.upper.y && b.lower.y <= a.upper.y;
+}
+
+// True if inner lies entirely within outer
+inline bool Contains(const AABB& outer, const AABB& inner)
+{
+    return outer.lower.x <= inner.lower.x && inner.upper.x <= outer.upper.x &&
+           outer.lower.y <= inner.lower.y && inner.upper.y <= outer.upper.y;
+}
+
+// Smallest box containing both a and b
+AABB Union(const AABB& a, const AABB& b);
+
+// Bounds of a body's shape at its current position & rotation, grown by
+// margin. Bounds are always float: on other scalar types, they're rounded
+// outwards, so they still contain the shape.
+template <class S>
+AABB ComputeAABB(const RigidBodyT<S>* body, float margin = 0.0f);
+
+// Clips the segment from start to start + delta against box. On input, enter
+// & exit are the range of fractions along the segment to consider. Returns
+// false if that range misses the box, otherwise narrows them to the part inside it.
+bool ClipSegment(const AABB& box, const Vector2& start, const Vector2& delta, float& enter, float& exit);
+
+// True if the segment from start to start + delta, clipped to maxFraction
+// of its length, touches box
+inline bool SegmentOverlaps(const AABB& box, const Vector2& start, const Vector2& delta, float maxFraction)
+{
+    float enter = 0.0f;
+    float exit = maxFraction;
+    return ClipSegment(box, start, delta, enter, exit);
+}
+
+// A group of segments traversed through a BodyTree together, laid out one
+// array per component so that each test is the same few Floatx4 operations
+// across every lane. Segments in a packet should be close together and
+// pointing the same way, so that they visit mostly the same nodes.
+struct RayPacket
+{
+    static const int Size = Floatx4::Width;
+
+    // Fills lane i with the segment from start to end
+    void Set(int i, const Vector2& start, const Vector2& end);
+
+    // Makes lane i inactive (its maxFraction is negative, so it never hits anything)
+    void Clear(int i);
+
+    float startX[Size];
+    float startY[Size];
+    float deltaX[Size];     // end - start
+    float deltaY[Size];
+    float invDeltaX[Size];  // reciprocals of the segments' extents (huge for 0)
+    float invDeltaY[Size];
+    float maxFraction[Size];
+};
+
+// Bitmask of the lanes of a packet whose segments touch box, from the packet's
+// starts, invDeltas & maxFractions (loaded once for a whole traversal)
+inline int PacketOverlaps(const AABB& box, const Vec2x4& start, const Vec2x4& invDelta, const Floatx4& maxFraction)
+{
+    // The same slab test as ClipSegment, on every lane at once
+    Vec2x4 toLower = Vec2x4(box.lower) - start;
+    Vec2x4 toUpper = Vec2x4(box.upper) - start;
+    Floatx4 x1 = toLower.x * invDelta.x, x2 = toUpper.x * invDelta.x;
+    Floatx4 y1 = toLower.y * invDelta.y, y2 = toUpper.y * invDelta.y;
+
+    Floatx4 enter = Max(Max(Min(x1, x2), Min(y1, y2)), Floatx4(0.0f));
+    Floatx4 exit = Min(Min(Max(x1, x2), Max(y1, y2)), maxFraction);
+    return (enter <= exit).Bits();
+}
+
+// How a BodyTree is built
+enum class TreeBuild
+{
+    // Splits using the surface area heuristic. Slow to build, but gives tight,
+    // cheap to query trees. For bodies that never move.
+    SAH = 0,
+
+    // Splits at the median along the longest axis. Much faster to build, for
+    // trees that are rebuilt every step.
+    Median,
+};
+
+// Bounding volume hierarchy over a set of bodies. It's built in one go, and
+// never updated. Any change to the set of bodies (or their positions) means
+// building it again. Queries never modify the tree, so any number of them can
+// run concurrently (as long as nothing is rebuilding it).
+//
+// S is the bodies' scalar type (see ScalarWorld). The tree itself is always
+// on float bounds.
+template <class S>
+class BodyTreeT
+{
+public:
+    typedef RigidBodyT<S> Body;
+
+    BodyTreeT();
+
+    // Replaces the tree's contents with the given bodies
+    void Build(const std::vector<Body*>& bodies, TreeBuild method);
+
+    void Clear();
+
+    // Appends all bodies whose bounds overlap box to results
+    void Query(const AABB& box, std::vector<Body*>& results) const;
+
+    // Visits the bodies whose bounds the segment from start to end crosses,
+    // calling callback(body) for each. The callback returns the fraction of
+    // the segment's length to keep searching along: 1 to keep going, less to
+    // clip the search once something has been hit, or 0 to stop.
+    template <typename Callback>
+    void RayCast(const Vector2& start, const Vector2& end, Callback callback) const
+    {
+        SweepBox(start, end, Vector2(0.0f, 0.0f), callback);
+    }
+
+    // As RayCast, but sweeps a box with the given half extents (rather than a
+    // point) along the segment
+    template <typename Callback>
+    void SweepBox(const Vector2& start, const Vector2& end, const Vector2& extents, Callback callback) const;
+
+    // As RayCast, for a whole packet of segments at once. Segments that reach
+    // a node and agree on which of its children is nearer visit them
+    // together, and split up if they don't. For each body some of them reach,
+    // calls callback(lanes, body) with the bitmask of those lanes, so all of
+    // them can be tested against the body together. The callback clips the
+    // segments it hits by lowering their lanes' packet.maxFraction.
+    template <typename Callback>
+    void RayCastPacket(RayPacket& packet, Callback callback) const;
+
+    size_t BodyCount() const { return _bodies.size(); }
+    size_t NodeCount() const { return _nodes.size(); }
+
+    // Subtrees deeper than this are turned into leaves, which bounds the
+    // traversal stack needed by queries
+    static const int MaxDepth = 32;
+
+private:
+    struct Node
+    {
+        AABB bounds;
+        uint32_t first;     // first child (the second follows it), or first body of a leaf
+        uint32_t count;     // number of bodies in a leaf, 0 for an interior node
+    };
+
+    // Builds the subtree for _order[first, first + count) into _nodes[index]
+    void BuildNode(uint32_t index, uint32_t first, uint32_t count, int depth);
+
+    // Picks where to split _order[first, first + count), leaving it sorted so
+    // that the split is at the returned offset. Returns 0 to make a leaf instead.
+    uint32_t SplitSAH(uint32_t first, uint32_t count, const AABB& bounds);
+    uint32_t SplitMedian(uint32_t first, uint32_t count, const AABB& bounds);
+
+    TreeBuild _method;
+    std::vector<Node> _nodes;           // _nodes[0] is the root
+    std::vector<Body*> _bodies;         // reordered so each leaf's bodies are contiguous
+    std::vector<AABB> _bounds;          // bounds of each of _bodies
+
+    // Build scratch space. _order is the permutation of the input bodies
+    // into leaf order.
+    std::vector<uint32_t> _order;
+    std::vector<AABB> _inputBounds;
+    std::vector<float> _rightCosts;
+
+    // Prevent copy
+    BodyTreeT(const BodyTreeT&);
+    BodyTreeT& operator= (const BodyTreeT&);
+};
+
+typedef BodyTreeT<float> BodyTree;
+
+template <class S>
+template <typename Callback>
+void BodyTreeT<S>::SweepBox(const Vector2& start, const Vector2& end, const Vector2& extents, Callback callback) const
+{
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    Vector2 delta = end - start;
+    float maxFraction = 1.0f;
+
+    uint32_t stack[MaxDepth + 1];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node& node = _nodes[stack[--top]];
+        if (!SegmentOverlaps(AABB(node.bounds.lower - extents, node.bounds.upper + extents), start, delta, maxFraction))
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (SegmentOverlaps(AABB(_bounds[i].lower - extents, _bounds[i].upper + extents), start, delta, maxFraction))
+                {
+                    maxFraction = min(maxFraction, callback(_bodies[i]));
+                    if (maxFraction <= 0.0f)
+                    {
+                        return;
+                    }
+                }
+            }
+        }
+        else
+        {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+        }
+    }
+}
+
+template <class S>
+template <typename Callback>
+void BodyTreeT<S>::RayCastPacket(RayPacket& packet, Callback callback) const
+{
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    // Each entry is a node & the lanes to visit it with. Lanes only ever
+    // split up, into at most Size groups, each with its own path down.
+    struct Entry
+    {
+        uint32_t node;
+        int lanes;
+    };
+    Entry stack[RayPacket::Size * (MaxDepth + 1) + 2];
+    int top = 0;
+    stack[top++] = { 0, (1 << RayPacket::Size) - 1 };
+
+    Vec2x4 start = Vec2x4::Load(packet.startX, packet.startY);
+    Vec2x4 invDelta = Vec2x4::Load(packet.invDeltaX, packet.invDeltaY);
+    Floatx4 maxFraction = Floatx4::Load(packet.maxFraction);
+    Floatx4 zero(0.0f);
+    Maskx4 positiveX = invDelta.x >= zero;
+    Maskx4 positiveY = invDelta.y >= zero;
+
+    while (top > 0)
+    {
+        Entry entry = stack[--top];
+        const Node& node = _nodes[entry.node];
+        int lanes = PacketOverlaps(node.bounds, start, invDelta, maxFraction) & entry.lanes;
+        if (lanes == 0)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                int hitLanes = PacketOverlaps(_bounds[i], start, invDelta, maxFraction) & lanes;
+                if (hitLanes != 0)
+                {
+                    callback(hitLanes, _bodies[i]);
+                    maxFraction = Floatx4::Load(packet.maxFraction);
+                }
+            }
+        }
+        else
+        {
+            // Each segment visits the child nearer its start first (judged
+            // by its direction), so hits found there clip the search of the
+            // other. Segments that disagree split into two groups.
+            const AABB& a = _nodes[node.first].bounds;
+            const AABB& b = _nodes[node.first + 1].bounds;
+            Vector2 aToB = (b.lower + b.upper) - (a.lower + a.upper);
+            Floatx4 alongX = Select(positiveX, Floatx4(aToB.x), Floatx4(-aToB.x));
+            Floatx4 alongY = Select(positiveY, Floatx4(aToB.y), Floatx4(-aToB.y));
+            int aFirst = (alongX + alongY >= zero).Bits() & lanes;
+            int bFirst = lanes & ~aFirst;
+
+            // Written without branches, which lanes splitting up would make
+            // unpredictable. An empty group's entries are written but not kept.
+            stack[top] = { node.first + 1, aFirst };
+            stack[top + 1] = { node.first, aFirst };
+            top += (aFirst != 0) * 2;
+            stack[top] = { node.first, bFirst };
+            stack[top + 1] = { node.first + 1, bFirst };
+            top += (bFirst != 0) * 2;
+        }
+    }
+}
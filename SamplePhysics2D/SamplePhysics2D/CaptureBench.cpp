@@ -0,0 +1,445 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "FrameCapture.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+
+// Steps a pile, "renders" each frame (a dot per body, on the CPU, so this runs
+// headless) and captures it, and times the simulation thread's frames with:
+//
+//   - no capture
+//   - each frame encoded & written on the simulation thread
+//   - FrameCapture, with each of its policies, as PNG, and as a raw stream
+//
+// For FrameCapture it reports the frames written & dropped, how often & how
+// long the simulation thread was stalled, and how busy the writer was. Checks
+// that every frame is accounted for (written or dropped), that Block never
+// drops any, and that nothing failed to write, and that empty (0 wide or
+// high) frames are refused.
+//
+// Then forces the capture to saturate, with a single buffer and the writer
+// paused, and checks what each policy does: DropNewest keeps the first
+// frame, DropOldest the last, and both number the next frame after every
+// dropped one. Block waits (and counts the stalls) until the writer resumes,
+// and drops nothing. The files written are deleted again afterwards.
+
+static const int BodyCount = 1000;
+static const int Frames = 240;
+static const float Dt = 1.0f / 60.0f;
+static const uint32_t Width = 320;
+static const uint32_t Height = 240;
+static const int Buffers = 4;
+
+static const char ImagePattern[] = "bench_capture_%06u.png";
+static const char RawPath[] = "bench_capture.raw";
+
+static const int SaturationFrames = 8;
+static const uint32_t SaturationSize = 4;
+static const char SaturationPattern[] = "bench_saturation_%06u.ppm";
+
+struct CaptureScene
+{
+    BenchPile pile;
+    Vector2 origin;
+    float scale;        // pixels per meter
+};
+
+static void CreateScene(CaptureScene& scene)
+{
+    CreateBenchScene(scene.pile, BodyCount, 11, 0);
+
+    // Frame the whole pile as it starts out
+    Vector2 lo(FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX);
+    for (auto& body : scene.pile.bodies)
+    {
+        lo = Vector2(min(lo.x, body->Position().x), min(lo.y, body->Position().y));
+        hi = Vector2(max(hi.x, body->Position().x), max(hi.y, body->Position().y));
+    }
+    scene.origin = lo;
+    scene.scale = min((Width - 1) / (hi.x - lo.x), (Height - 1) / (hi.y - lo.y));
+}
+
+// Clears the frame & draws a 3x3 dot for each body, colored by its id
+static void RenderFrame(const CaptureScene& scene, uint8_t* pixels)
+{
+    size_t stride = Width * 4;
+    for (uint32_t y = 0; y < Height; ++y)
+    {
+        uint32_t* row = (uint32_t*)(pixels + y * stride);
+        std::fill(row, row + Width, 0xff201010u);
+    }
+
+    for (auto& body : scene.pile.bodies)
+    {
+        Vector2 p = (body->Position() - scene.origin) * scene.scale;
+        int cx = (int)p.x;
+        int cy = (int)(Height - 1) - (int)p.y;
+        uint32_t color = 0xff000000u | (body->Id() * 2654435761u >> 8);
+        for (int y = max(cy - 1, 0); y <= min(cy + 1, (int)Height - 1); ++y)
+        {
+            for (int x = max(cx - 1, 0); x <= min(cx + 1, (int)Width - 1); ++x)
+            {
+                ((uint32_t*)(pixels + y * stride))[x] = color;
+            }
+        }
+    }
+}
+
+struct FrameTimes
+{
+    FrameTimes() : totalMs(0), maxMs(0) {}
+
+    void Add(int64_t ticks)
+    {
+        double ms = TicksToMilliseconds(ticks);
+        totalMs += ms;
+        maxMs = max(maxMs, ms);
+    }
+
+    double totalMs;
+    double maxMs;
+};
+
+static void ReportTimes(FILE* output, const char* label, const FrameTimes& times, double referenceMs)
+{
+    fprintf(output, "%-24s %7.3f ms/frame (+%6.3f)  worst %7.3f ms\n", label, times.totalMs / Frames,
+        (times.totalMs - referenceMs) / Frames, times.maxMs);
+}
+
+static void DeleteFiles(uint32_t count)
+{
+    char name[64];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        snprintf(name, sizeof(name), ImagePattern, i);
+        remove(name);
+    }
+    remove(RawPath);
+}
+
+static FrameTimes RunWithoutCapture()
+{
+    CaptureScene scene;
+    CreateScene(scene);
+    std::vector<uint8_t> pixels(Width * Height * 4);
+
+    FrameTimes times;
+    for (int i = 0; i < Frames; ++i)
+    {
+        int64_t start = GetProfileTicks();
+        scene.pile.world->Update(Dt);
+        RenderFrame(scene, pixels.data());
+        times.Add(GetProfileTicks() - start);
+    }
+    return times;
+}
+
+static bool RunSynchronous(FILE* output, double referenceMs)
+{
+    CaptureScene scene;
+    CreateScene(scene);
+    std::vector<uint8_t> pixels(Width * Height * 4);
+
+    FrameTimes times;
+    bool written = true;
+    char name[64];
+    for (int i = 0; i < Frames; ++i)
+    {
+        int64_t start = GetProfileTicks();
+        scene.pile.world->Update(Dt);
+        RenderFrame(scene, pixels.data());
+        snprintf(name, sizeof(name), ImagePattern, (uint32_t)i);
+        written &= WriteImageFile(name, ImageFormat::Png, pixels.data(), Width, Height, Width * 4);
+        times.Add(GetProfileTicks() - start);
+    }
+    DeleteFiles(Frames);
+
+    ReportTimes(output, "synchronous PNG", times, referenceMs);
+    if (!written)
+    {
+        fprintf(output, "  frames failed to write\n");
+    }
+    return written;
+}
+
+static bool RunAsync(FILE* output, const char* label, ImageFormat format, CapturePolicy policy, double referenceMs)
+{
+    CaptureScene scene;
+    CreateScene(scene);
+
+    FrameCaptureSettings settings;
+    settings.path = format == ImageFormat::Raw ? RawPath : ImagePattern;
+    settings.format = format;
+    settings.policy = policy;
+    settings.bufferCount = Buffers;
+
+    FrameTimes times;
+    CaptureStats stats;
+    {
+        FrameCapture capture(settings);
+        for (int i = 0; i < Frames; ++i)
+        {
+            int64_t start = GetProfileTicks();
+            scene.pile.world->Update(Dt);
+
+            // Rendered straight into the capture's buffer, so there's no copy
+            FrameCapture::Frame* frame = capture.Acquire(Width, Height);
+            if (frame)
+            {
+                RenderFrame(scene, frame->pixels.data());
+                capture.Submit(frame);
+            }
+            times.Add(GetProfileTicks() - start);
+        }
+
+        capture.Flush();
+        stats = capture.GetStats();
+    }
+
+    // The raw stream must hold exactly the frames written
+    bool succeeded = true;
+    if (format == ImageFormat::Raw)
+    {
+        FILE* file = fopen(RawPath, "rb");
+        long size = -1;
+        if (file)
+        {
+            fseek(file, 0, SEEK_END);
+            size = ftell(file);
+            fclose(file);
+        }
+        if (size != (long)(stats.framesWritten * Width * Height * 4))
+        {
+            fprintf(output, "  raw stream is %ld bytes, expected %llu frames\n", size, (unsigned long long)stats.framesWritten);
+            succeeded = false;
+        }
+    }
+    DeleteFiles(Frames);
+
+    ReportTimes(output, label, times, referenceMs);
+    fprintf(output, "    written %3llu  dropped %3llu  stalls %3llu (%.2f ms, worst %.2f ms)  max queued %d\n",
+        (unsigned long long)stats.framesWritten, (unsigned long long)stats.framesDropped, (unsigned long long)stats.stalls, stats.stallMs, stats.maxStallMs, stats.maxQueued);
+    fprintf(output, "    writer: %.1f MB, encoding %.2f ms/frame, writing %.2f ms/frame\n", stats.bytesWritten / 1e6,
+        stats.encodeMs / max((double)stats.framesWritten, 1.0), stats.writeMs / max((double)stats.framesWritten, 1.0));
+
+    if (stats.framesCaptured != (uint64_t)Frames || stats.framesWritten + stats.framesDropped != stats.framesCaptured)
+    {
+        fprintf(output, "  frames unaccounted for\n");
+        succeeded = false;
+    }
+    if (policy == CapturePolicy::Block && stats.framesDropped != 0)
+    {
+        fprintf(output, "  Block dropped frames\n");
+        succeeded = false;
+    }
+    if (stats.writeErrors != 0)
+    {
+        fprintf(output, "  %llu write errors\n", (unsigned long long)stats.writeErrors);
+        succeeded = false;
+    }
+    return succeeded;
+}
+
+// Empty frames must be refused everywhere, without writing a file
+static bool CheckEmptyFrames(FILE* output)
+{
+    uint8_t pixel[4] = {};
+    char name[64];
+    snprintf(name, sizeof(name), ImagePattern, 0u);
+
+    bool refused = !WriteImageFile(name, ImageFormat::Png, pixel, 0, 1, 0);
+    refused &= !WriteImageFile(name, ImageFormat::Png, pixel, 1, 0, 4);
+
+    FrameCaptureSettings settings;
+    settings.path = ImagePattern;
+    settings.policy = CapturePolicy::Block;
+    CaptureStats stats;
+    {
+        FrameCapture capture(settings);
+        refused &= !capture.Capture(pixel, 0, 1, 0);
+        refused &= !capture.Acquire(1, 0);
+
+        // Emptied after it was acquired
+        FrameCapture::Frame* frame = capture.Acquire(1, 1);
+        frame->height = 0;
+        capture.Submit(frame);
+
+        capture.Flush();
+        stats = capture.GetStats();
+    }
+    refused &= stats.framesWritten == 0 && stats.framesDropped == 3 && stats.writeErrors == 0;
+
+    FILE* file = fopen(name, "rb");
+    if (file)
+    {
+        fclose(file);
+        refused = false;
+    }
+    DeleteFiles(1);
+
+    if (!refused)
+    {
+        fprintf(output, "empty frames weren't refused\n");
+    }
+    return refused;
+}
+
+// Captures a SaturationSize square frame, every byte of it set to mark
+static bool CaptureMarked(FrameCapture& capture, uint8_t mark)
+{
+    FrameCapture::Frame* frame = capture.Acquire(SaturationSize, SaturationSize);
+    if (!frame)
+    {
+        return false;
+    }
+    std::fill(frame->pixels.begin(), frame->pixels.end(), mark);
+    capture.Submit(frame);
+    return true;
+}
+
+// The mark of the saturation frame written with the given number, or -1 if
+// there isn't one
+static int ReadMark(uint32_t number)
+{
+    char name[64];
+    snprintf(name, sizeof(name), SaturationPattern, number);
+    FILE* file = fopen(name, "rb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    unsigned width, height, maxValue;
+    int mark = -1;
+    if (fscanf(file, "P6 %u %u %u", &width, &height, &maxValue) == 3 && fgetc(file) == '\n')
+    {
+        mark = fgetc(file);
+    }
+    fclose(file);
+    return mark;
+}
+
+static void DeleteSaturationFiles()
+{
+    char name[64];
+    for (uint32_t i = 0; i <= (uint32_t)SaturationFrames; ++i)
+    {
+        snprintf(name, sizeof(name), SaturationPattern, i);
+        remove(name);
+    }
+}
+
+// Fills the one buffer with the writer paused, so every frame after the first
+// finds no buffer free. Frame i is marked i + 1. Once the writer has caught
+// up, one more frame is captured, which must be numbered after all of those.
+static bool CheckDropping(FILE* output, const char* label, CapturePolicy policy)
+{
+    FrameCaptureSettings settings;
+    settings.path = SaturationPattern;
+    settings.format = ImageFormat::Ppm;
+    settings.policy = policy;
+    settings.bufferCount = 1;
+
+    CaptureStats stats;
+    int accepted = 0;
+    {
+        FrameCapture capture(settings);
+        capture.SetWriterPaused(true);
+        for (int i = 0; i < SaturationFrames; ++i)
+        {
+            accepted += CaptureMarked(capture, (uint8_t)(i + 1));
+        }
+        capture.SetWriterPaused(false);
+        capture.Flush();
+
+        accepted += CaptureMarked(capture, (uint8_t)(SaturationFrames + 1));
+        capture.Flush();
+        stats = capture.GetStats();
+    }
+
+    // DropNewest keeps what's queued, DropOldest replaces it with each new frame
+    int kept = (policy == CapturePolicy::DropNewest) ? 0 : SaturationFrames - 1;
+    bool succeeded = stats.framesWritten == 2 && stats.framesDropped == (uint64_t)SaturationFrames - 1;
+    for (int i = 0; i <= SaturationFrames; ++i)
+    {
+        int expected = (i == kept || i == SaturationFrames) ? i + 1 : -1;
+        succeeded &= ReadMark(i) == expected;
+    }
+    DeleteSaturationFiles();
+
+    fprintf(output, "%-24s written %llu  dropped %llu  of %d frames, %d accepted, kept frame %d\n", label,
+        (unsigned long long)stats.framesWritten, (unsigned long long)stats.framesDropped, SaturationFrames + 1, accepted, kept);
+    if (!succeeded)
+    {
+        fprintf(output, "  expected frames %d & %d written (as numbered), and the rest dropped\n", kept, SaturationFrames);
+    }
+    return succeeded;
+}
+
+// As CheckDropping, but the writer is resumed a little after the first frame,
+// from another thread, so the second frame's Acquire must wait for it
+static bool CheckBlocking(FILE* output)
+{
+    FrameCaptureSettings settings;
+    settings.path = SaturationPattern;
+    settings.format = ImageFormat::Ppm;
+    settings.policy = CapturePolicy::Block;
+    settings.bufferCount = 1;
+
+    CaptureStats stats;
+    {
+        FrameCapture capture(settings);
+        capture.SetWriterPaused(true);
+        std::thread resume([&capture]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            capture.SetWriterPaused(false);
+        });
+
+        for (int i = 0; i < SaturationFrames; ++i)
+        {
+            CaptureMarked(capture, (uint8_t)(i + 1));
+        }
+        capture.Flush();
+        resume.join();
+        stats = capture.GetStats();
+    }
+
+    bool succeeded = stats.framesWritten == (uint64_t)SaturationFrames && stats.framesDropped == 0 &&
+        stats.stalls > 0 && stats.stallMs > 0.0;
+    for (int i = 0; i < SaturationFrames; ++i)
+    {
+        succeeded &= ReadMark(i) == i + 1;
+    }
+    DeleteSaturationFiles();
+
+    fprintf(output, "%-24s written %llu  dropped %llu  of %d frames, stalls %llu (%.2f ms)\n", "saturated, Block",
+        (unsigned long long)stats.framesWritten, (unsigned long long)stats.framesDropped, SaturationFrames,
+        (unsigned long long)stats.stalls, stats.stallMs);
+    if (!succeeded)
+    {
+        fprintf(output, "  expected every frame written, and the capturing thread stalled\n");
+    }
+    return succeeded;
+}
+
+bool BenchCapture(FILE* output)
+{
+    fprintf(output, "%d bodies, %d frames of %ux%u, %d capture buffers\n", BodyCount, Frames, Width, Height, Buffers);
+
+    FrameTimes reference = RunWithoutCapture();
+    ReportTimes(output, "no capture", reference, reference.totalMs);
+
+    bool succeeded = RunSynchronous(output, reference.totalMs);
+    succeeded &= RunAsync(output, "async PNG, DropNewest", ImageFormat::Png, CapturePolicy::DropNewest, reference.totalMs);
+    succeeded &= RunAsync(output, "async PNG, DropOldest", ImageFormat::Png, CapturePolicy::DropOldest, reference.totalMs);
+    succeeded &= RunAsync(output, "async PNG, Block", ImageFormat::Png, CapturePolicy::Block, reference.totalMs);
+    succeeded &= RunAsync(output, "async raw, Block", ImageFormat::Raw, CapturePolicy::Block, reference.totalMs);
+    succeeded &= CheckEmptyFrames(output);
+
+    succeeded &= CheckDropping(output, "saturated, DropNewest", CapturePolicy::DropNewest);
+    succeeded &= CheckDropping(output, "saturated, DropOldest", CapturePolicy::DropOldest);
+    succeeded &= CheckBlocking(output);
+    return succeeded;
+}
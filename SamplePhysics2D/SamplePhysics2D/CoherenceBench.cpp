@@ -0,0 +1,149 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "RigidBodyPair.h"
+#include "Shape.h"
+
+// Lets a pile of bodies, and a row of short stacks, settle. Then carries on
+// stepping them with contact reuse turned off, and with increasing
+// tolerances. Reports how much of the narrowphase reuse skips, what that
+// saves, and how deep bodies end up sinking into each other. Also checks
+// that a snapshot taken with cached contacts in play still resumes bit
+// identically.
+//
+// Nothing here ever comes completely to rest (there's no friction yet, and
+// boxes rock back & forth on their single contact point), so how much is
+// reused depends a lot on the tolerance.
+
+static const int SettleSteps = 300;
+static const int Steps = 300;
+static const int ResumeSteps = 20;
+static const float Dt = 1.0f / 60.0f;
+
+struct CoherenceResult
+{
+    double narrowphaseMs;
+    int64_t pairsTested;
+    int64_t contactsReused;
+    int64_t contactsRecomputed;
+    float maxPenetration;
+    bool resumed;
+};
+
+// Deepest overlap between any two bodies, found by brute force
+static float MaxPenetration(const std::vector<std::unique_ptr<RigidBody>>& bodies)
+{
+    float maxPenetration = 0.0f;
+    for (size_t i = 0; i < bodies.size(); ++i)
+    {
+        for (size_t j = i + 1; j < bodies.size(); ++j)
+        {
+            if (bodies[i]->InvMass() == 0.0f && bodies[j]->InvMass() == 0.0f)
+            {
+                continue;
+            }
+
+            RigidBodyPair pair(bodies[i].get(), bodies[j].get());
+            if (pair.HasContact())
+            {
+                maxPenetration = max(maxPenetration, -pair.Contact().distance);
+            }
+        }
+    }
+    return maxPenetration;
+}
+
+static CoherenceResult RunScene(bool stacks, float tolerance)
+{
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 20);
+    world.SetContactReuseTolerances(tolerance, tolerance);
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    if (stacks)
+    {
+        CreateBenchStacks(&world, bodies, 100, 5, 5);
+    }
+    else
+    {
+        CreateBenchScene(&world, bodies, 300, 9);
+    }
+
+    for (int i = 0; i < SettleSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+
+    CoherenceResult result = {};
+    for (int i = 0; i < Steps; ++i)
+    {
+        world.Update(Dt);
+
+        const StepStats& stats = world.GetStepStats();
+        result.narrowphaseMs += stats.narrowphaseMs;
+        result.pairsTested += stats.pairsTested;
+        result.contactsReused += stats.contactsReused;
+        result.contactsRecomputed += stats.contactsRecomputed;
+    }
+    result.narrowphaseMs /= Steps;
+    result.maxPenetration = MaxPenetration(bodies);
+
+    // Cached contacts are part of the state, so resuming from a snapshot has
+    // to carry them over too
+    std::vector<uint8_t> snapshot;
+    world.SaveState(snapshot);
+    for (int i = 0; i < ResumeSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+    uint64_t expected = world.ComputeStateHash();
+
+    world.LoadState(snapshot.data(), snapshot.size());
+    for (int i = 0; i < ResumeSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+    result.resumed = world.ComputeStateHash() == expected;
+
+    return result;
+}
+
+bool BenchCoherence(FILE* output)
+{
+    static const float Tolerances[] = { 0.0f, 0.005f, 0.01f, 0.02f };
+
+    bool succeeded = true;
+    for (int scene = 0; scene < 2; ++scene)
+    {
+        bool stacks = (scene == 1);
+        fprintf(output, "-- %s, settled for %d steps, then %d steps measured --\n", stacks ? "100 stacks" : "300 body pile", SettleSteps, Steps);
+
+        CoherenceResult reference = {};
+        for (int i = 0; i < _countof(Tolerances); ++i)
+        {
+            CoherenceResult result = RunScene(stacks, Tolerances[i]);
+            if (i == 0)
+            {
+                reference = result;
+            }
+
+            int64_t tested = max(result.pairsTested, (int64_t)1);
+            fprintf(output, "tolerance %5.3f  narrowphase %6.3f ms/step (%.2fx)  reused %5.1f%%  recomputed %5.1f%%  max penetration %.4f\n",
+                Tolerances[i], result.narrowphaseMs, reference.narrowphaseMs / result.narrowphaseMs,
+                100.0 * result.contactsReused / tested, 100.0 * result.contactsRecomputed / tested, result.maxPenetration);
+
+            if (Tolerances[i] == 0.0f && result.contactsReused != 0)
+            {
+                fprintf(output, "  contacts were reused with reuse turned off\n");
+                succeeded = false;
+            }
+            if (!result.resumed)
+            {
+                fprintf(output, "  resuming from a snapshot diverged\n");
+                succeeded = false;
+            }
+        }
+    }
+
+    return succeeded;
+}
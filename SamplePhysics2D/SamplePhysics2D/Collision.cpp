@@ -2,15 +2,14 @@
 #include "RigidBody.h"
 #include "RigidBodyPair.h"
 #include "Shape.h"
+#include "Collision.h"
+#include "Broadphase.h"
 
-static bool CollideCircleCircle(RigidBody* body1, RigidBody* body2, ContactInfo& contact);
-static bool CollideCircleBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact);
-static bool CollideBoxBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact);
-
-bool Collide(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
+template <class S>
+bool Collide(RigidBodyT<S>* body1, RigidBodyT<S>* body2, ContactInfoT<S>& contact)
 {
-    const Shape* shape1 = body1->GetShape();
-    const Shape* shape2 = body2->GetShape();
+    const ShapeT<S>* shape1 = body1->GetShape();
+    const ShapeT<S>* shape2 = body2->GetShape();
 
     if (shape1->Type() == ShapeType::Circle && shape2->Type() == ShapeType::Circle)
     {
@@ -37,20 +36,21 @@ bool Collide(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
     return false;
 }
 
-bool CollideCircleCircle(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
+template <class S>
+bool CollideCircleCircle(RigidBodyT<S>* body1, RigidBodyT<S>* body2, ContactInfoT<S>& contact)
 {
-    const CircleShape* shape1 = (const CircleShape*)body1->GetShape();
-    const CircleShape* shape2 = (const CircleShape*)body2->GetShape();
+    const CircleShapeT<S>* shape1 = (const CircleShapeT<S>*)body1->GetShape();
+    const CircleShapeT<S>* shape2 = (const CircleShapeT<S>*)body2->GetShape();
 
-    float r = shape1->Radius() + shape2->Radius();
-    float r2 = r * r;
+    S r = shape1->Radius() + shape2->Radius();
+    S r2 = r * r;
 
-    Vector2 toBody1 = body1->Position() - body2->Position();
-    float d2 = toBody1.LengthSq();
+    Vector2T<S> toBody1 = body1->Position() - body2->Position();
+    S d2 = toBody1.LengthSq();
 
     if (d2 < r2)
     {
-        contact.distance = sqrtf(d2) - r;
+        contact.distance = Sqrt(d2) - r;
         contact.normal = toBody1.Normalized();
         contact.worldPosition = body1->Position() - contact.normal * shape1->Radius();
         return true;
@@ -59,38 +59,39 @@ bool CollideCircleCircle(RigidBody* body1, RigidBody* body2, ContactInfo& contac
     return false;
 }
 
-bool CollideCircleBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
+template <class S>
+bool CollideCircleBox(RigidBodyT<S>* body1, RigidBodyT<S>* body2, ContactInfoT<S>& contact)
 {
-    const CircleShape* shape1 = (const CircleShape*)body1->GetShape();
-    const BoxShape* shape2 = (const BoxShape*)body2->GetShape();
+    const CircleShapeT<S>* shape1 = (const CircleShapeT<S>*)body1->GetShape();
+    const BoxShapeT<S>* shape2 = (const BoxShapeT<S>*)body2->GetShape();
 
     // Transform the circle to local space of the box (box then becomes aabb)
-    Matrix2 rotB = Matrix2(body2->Rotation());
-    Matrix2 invRotB = rotB.Transposed();
+    Matrix2T<S> rotB = Matrix2T<S>(body2->Rotation());
+    Matrix2T<S> invRotB = rotB.Transposed();
 
-    Vector2 toCircle = body1->Position() - body2->Position();
-    Vector2 localToCircle = invRotB * toCircle;
+    Vector2T<S> toCircle = body1->Position() - body2->Position();
+    Vector2T<S> localToCircle = invRotB * toCircle;
 
-    Vector2 halfWidths = 0.5f * shape2->Size();
+    Vector2T<S> halfWidths = S(0.5f) * shape2->Size();
 
     // If the center of the sphere is outside of the aabb
     if (localToCircle.x < -halfWidths.x || localToCircle.x > halfWidths.x ||
         localToCircle.y < -halfWidths.y || localToCircle.y > halfWidths.y)
     {
         // Find closest point on box to the center of the circle.
-        Vector2 closestPt = Vector2(
-            localToCircle.x >= 0 ? min(halfWidths.x, localToCircle.x) : max(-halfWidths.x, localToCircle.x),
-            localToCircle.y >= 0 ? min(halfWidths.y, localToCircle.y) : max(-halfWidths.y, localToCircle.y));
+        Vector2T<S> closestPt = Vector2T<S>(
+            localToCircle.x >= S(0) ? min(halfWidths.x, localToCircle.x) : max(-halfWidths.x, localToCircle.x),
+            localToCircle.y >= S(0) ? min(halfWidths.y, localToCircle.y) : max(-halfWidths.y, localToCircle.y));
 
-        Vector2 toClosest = closestPt - localToCircle;
-        float d2 = toClosest.LengthSq();
-        float r2 = shape1->Radius() * shape1->Radius();
+        Vector2T<S> toClosest = closestPt - localToCircle;
+        S d2 = toClosest.LengthSq();
+        S r2 = shape1->Radius() * shape1->Radius();
         if (d2 > r2)
         {
             return false;
         }
 
-        contact.distance = sqrtf(d2) - shape1->Radius();
+        contact.distance = Sqrt(d2) - shape1->Radius();
         contact.normal = -(rotB * toClosest).Normalized();
         contact.worldPosition = body1->Position() - contact.normal * shape1->Radius();
         return true;
@@ -98,7 +99,7 @@ bool CollideCircleBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
     else
     {
         // Otherwise, find side we're closest to & use that
-        float dists[] =
+        S dists[] =
         {
             localToCircle.x - (-halfWidths.x),
             halfWidths.x - localToCircle.x,
@@ -118,10 +119,10 @@ bool CollideCircleBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
         contact.distance = -(dists[iMin] + shape1->Radius());
         switch (iMin)
         {
-        case 0: contact.normal = Vector2(-1, 0); break;
-        case 1: contact.normal = Vector2(1, 0); break;
-        case 2: contact.normal = Vector2(0, -1); break;
-        case 3: contact.normal = Vector2(0, 1); break;
+        case 0: contact.normal = Vector2T<S>(-1, 0); break;
+        case 1: contact.normal = Vector2T<S>(1, 0); break;
+        case 2: contact.normal = Vector2T<S>(0, -1); break;
+        case 3: contact.normal = Vector2T<S>(0, 1); break;
         default: assert(false); break;
         }
 
@@ -131,48 +132,50 @@ bool CollideCircleBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
     }
 }
 
-static Vector2 SupportMapping(const BoxShape* box, const Vector2& localDir)
+template <class S>
+static Vector2T<S> SupportMapping(const BoxShapeT<S>* box, const Vector2T<S>& localDir)
 {
-    Vector2 half = 0.5f * box->Size();
-    return Vector2(
-        localDir.x >= 0 ? half.x : -half.x,
-        localDir.y >= 0 ? half.y : -half.y
+    Vector2T<S> half = S(0.5f) * box->Size();
+    return Vector2T<S>(
+        localDir.x >= S(0) ? half.x : -half.x,
+        localDir.y >= S(0) ? half.y : -half.y
         );
 }
 
-bool CollideBoxBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
+template <class S>
+bool CollideBoxBox(RigidBodyT<S>* body1, RigidBodyT<S>* body2, ContactInfoT<S>& contact)
 {
-    const BoxShape* shape1 = (const BoxShape*)body1->GetShape();
-    const BoxShape* shape2 = (const BoxShape*)body2->GetShape();
+    const BoxShapeT<S>* shape1 = (const BoxShapeT<S>*)body1->GetShape();
+    const BoxShapeT<S>* shape2 = (const BoxShapeT<S>*)body2->GetShape();
 
-    Matrix2 rot1(body1->Rotation());
-    Matrix2 rot2(body2->Rotation());
-    Matrix2 invRot1(rot1.Transposed());
-    Matrix2 invRot2(rot2.Transposed());
-    Vector2 toBody2 = body2->Position() - body1->Position();
+    Matrix2T<S> rot1(body1->Rotation());
+    Matrix2T<S> rot2(body2->Rotation());
+    Matrix2T<S> invRot1(rot1.Transposed());
+    Matrix2T<S> invRot2(rot2.Transposed());
+    Vector2T<S> toBody2 = body2->Position() - body1->Position();
 
-    float minPen = FLT_MAX;
-    Vector2 normal, pointOn1;
+    S minPen = ScalarTraits<S>::Max();
+    Vector2T<S> normal, pointOn1;
 
-    Vector2 dirs1[] =
+    Vector2T<S> dirs1[] =
     {
         rot1.col1,
         rot1.col2,
     };
 
-    float bounds1[] =
+    S bounds1[] =
     {
-        shape1->Size().x * 0.5f,
-        shape1->Size().y * 0.5f,
+        shape1->Size().x * S(0.5f),
+        shape1->Size().y * S(0.5f),
     };
 
     for (int i = 0; i < _countof(dirs1); ++i)
     {
-        Vector2 v = dirs1[i].Normalized();
-        Vector2 pt = toBody2 + rot2 * SupportMapping(shape2, invRot2 * -v);
-        float d = Dot(pt, v);
-        float pen = bounds1[i] - d;
-        if (pen < 0)
+        Vector2T<S> v = dirs1[i].Normalized();
+        Vector2T<S> pt = toBody2 + rot2 * SupportMapping(shape2, invRot2 * -v);
+        S d = Dot(pt, v);
+        S pen = bounds1[i] - d;
+        if (pen < S(0))
         {
             return false;
         }
@@ -187,7 +190,7 @@ bool CollideBoxBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
         pt = toBody2 + rot2 * SupportMapping(shape2, invRot2 * v);
         d = Dot(pt, -v);
         pen = bounds1[i] - d;
-        if (pen < 0)
+        if (pen < S(0))
         {
             return false;
         }
@@ -199,25 +202,25 @@ bool CollideBoxBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
         }
     }
 
-    Vector2 dirs2[] =
+    Vector2T<S> dirs2[] =
     {
         rot2.col1,
         rot2.col2,
     };
 
-    float bounds2[] =
+    S bounds2[] =
     {
-        shape2->Size().x * 0.5f,
-        shape2->Size().y * 0.5f,
+        shape2->Size().x * S(0.5f),
+        shape2->Size().y * S(0.5f),
     };
 
     for (int i = 0; i < _countof(dirs2); ++i)
     {
-        Vector2 v = dirs2[i].Normalized();
-        Vector2 pt = -toBody2 + rot1 * SupportMapping(shape1, invRot1 * -v);
-        float d = Dot(pt, v);
-        float pen = bounds2[i] - d;
-        if (pen < 0)
+        Vector2T<S> v = dirs2[i].Normalized();
+        Vector2T<S> pt = -toBody2 + rot1 * SupportMapping(shape1, invRot1 * -v);
+        S d = Dot(pt, v);
+        S pen = bounds2[i] - d;
+        if (pen < S(0))
         {
             return false;
         }
@@ -232,7 +235,7 @@ bool CollideBoxBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
         pt = -toBody2 + rot1 * SupportMapping(shape1, invRot1 * v);
         d = Dot(pt, -v);
         pen = bounds2[i] - d;
-        if (pen < 0)
+        if (pen < S(0))
         {
             return false;
         }
@@ -249,3 +252,448 @@ bool CollideBoxBox(RigidBody* body1, RigidBody* body2, ContactInfo& contact)
     contact.worldPosition = body1->Position() + pointOn1;
     return true;
 }
+
+// Segment vs circle of the given radius. Segments starting inside miss.
+static bool RayCastCircle(const Vector2& center, float radius, const Vector2& start, const Vector2& delta,
+    float maxFraction, float& fraction, Vector2& normal)
+{
+    Vector2 fromCenter = start - center;
+    float c = Dot(fromCenter, fromCenter) - radius * radius;
+    if (c < 0.0f)
+    {
+        return false;
+    }
+
+    // Solve |fromCenter + t * delta|^2 = radius^2 for the smaller t
+    float a = Dot(delta, delta);
+    float b = Dot(fromCenter, delta);
+    float discriminant = b * b - a * c;
+    if (a < FLT_EPSILON || discriminant < 0.0f)
+    {
+        return false;
+    }
+
+    float t = (-b - sqrtf(discriminant)) / a;
+    if (t < 0.0f || t > maxFraction)
+    {
+        return false;
+    }
+
+    fraction = t;
+    normal = (fromCenter + t * delta).Normalized();
+    return true;
+}
+
+// Segment vs box with the given half widths, centered at the origin and
+// axis aligned (in other words, in the box's local space)
+static bool RayCastLocalBox(const Vector2& halfWidths, const Vector2& start, const Vector2& delta,
+    float maxFraction, float& fraction, Vector2& normal)
+{
+    if (fabsf(start.x) <= halfWidths.x && fabsf(start.y) <= halfWidths.y)
+    {
+        return false;
+    }
+
+    float enter = 0.0f;
+    float exit = maxFraction;
+    if (!ClipSegment(AABB(-1.0f * halfWidths, halfWidths), start, delta, enter, exit))
+    {
+        return false;
+    }
+
+    // The face we entered through is the one whose slab we entered last
+    Vector2 hit = start + enter * delta;
+    float dx = fabsf(fabsf(hit.x) - halfWidths.x);
+    float dy = fabsf(fabsf(hit.y) - halfWidths.y);
+    normal = (dx <= dy) ? Vector2(hit.x >= 0.0f ? 1.0f : -1.0f, 0.0f) : Vector2(0.0f, hit.y >= 0.0f ? 1.0f : -1.0f);
+    fraction = enter;
+    return true;
+}
+
+bool RayCastBody(RigidBody* body, const Vector2& start, const Vector2& end, float maxFraction, RayCastHit& hit)
+{
+    const Shape* shape = body->GetShape();
+    Vector2 delta = end - start;
+
+    float fraction;
+    Vector2 normal;
+    switch (shape->Type())
+    {
+    case ShapeType::Circle:
+        if (!RayCastCircle(body->Position(), ((const CircleShape*)shape)->Radius(), start, delta, maxFraction, fraction, normal))
+        {
+            return false;
+        }
+        break;
+
+    case ShapeType::Box:
+        {
+            // Do the test in the box's local space, where it's an aabb
+            Matrix2 rot(body->Rotation());
+            Matrix2 invRot = rot.Transposed();
+            Vector2 halfWidths = 0.5f * ((const BoxShape*)shape)->Size();
+            if (!RayCastLocalBox(halfWidths, invRot * (start - body->Position()), invRot * delta, maxFraction, fraction, normal))
+            {
+                return false;
+            }
+            normal = rot * normal;
+        }
+        break;
+
+    default:
+        assert(false);
+        return false;
+    }
+
+    hit.body = body;
+    hit.fraction = fraction;
+    hit.position = start + fraction * delta;
+    hit.normal = normal;
+    return true;
+}
+
+// RayCastCircle for a packet of segments at once. Returns the lanes that hit.
+static Maskx4 RayCastCircles(const Vec2x4& center, const Floatx4& radius, const Vec2x4& start, const Vec2x4& delta,
+    const Floatx4& maxFraction, Floatx4& fraction, Vec2x4& normal)
+{
+    Vec2x4 fromCenter = start - center;
+    Floatx4 c = Dot(fromCenter, fromCenter) - radius * radius;
+
+    Floatx4 a = Dot(delta, delta);
+    Floatx4 b = Dot(fromCenter, delta);
+    Floatx4 discriminant = b * b - a * c;
+    Maskx4 hit = (c >= Floatx4(0.0f)) & (a >= Floatx4(FLT_EPSILON)) & (discriminant >= Floatx4(0.0f));
+
+    // Lanes that miss may divide by zero or take the root of a negative, but
+    // they're masked off
+    fraction = (-b - Sqrt(discriminant)) / a;
+    hit = hit & (fraction >= Floatx4(0.0f)) & (fraction <= maxFraction);
+    normal = (fromCenter + fraction * delta).Normalized();
+    return hit;
+}
+
+// RayCastLocalBox for a packet of segments at once. Returns the lanes that hit.
+static Maskx4 RayCastLocalBoxes(const Vector2& halfWidths, const Vec2x4& start, const Vec2x4& delta,
+    const Floatx4& maxFraction, Floatx4& fraction, Vec2x4& normal)
+{
+    Floatx4 zero(0.0f), one(1.0f);
+    Vec2x4 lower(-1.0f * halfWidths), upper(halfWidths);
+    Maskx4 inside = (Abs(start.x) <= upper.x) & (Abs(start.y) <= upper.y);
+
+    // ClipSegment, on both axes at once. Segments parallel to a slab have to
+    // start inside it.
+    Floatx4 enter = zero;
+    Floatx4 exit = maxFraction;
+    Maskx4 missed = inside;
+    const Floatx4* starts[] = { &start.x, &start.y };
+    const Floatx4* deltas[] = { &delta.x, &delta.y };
+    const Floatx4* lowers[] = { &lower.x, &lower.y };
+    const Floatx4* uppers[] = { &upper.x, &upper.y };
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        Maskx4 parallel = Abs(*deltas[axis]) < Floatx4(FLT_EPSILON);
+        missed = missed | (parallel & ((*starts[axis] < *lowers[axis]) | (*starts[axis] > *uppers[axis])));
+
+        Floatx4 invDelta = one / *deltas[axis];
+        Floatx4 t1 = (*lowers[axis] - *starts[axis]) * invDelta;
+        Floatx4 t2 = (*uppers[axis] - *starts[axis]) * invDelta;
+        enter = Select(parallel, enter, Max(enter, Min(t1, t2)));
+        exit = Select(parallel, exit, Min(exit, Max(t1, t2)));
+    }
+    missed = missed | (enter > exit);
+
+    // The face we entered through is the one whose slab we entered last
+    Vec2x4 hit = start + enter * delta;
+    Floatx4 dx = Abs(Abs(hit.x) - upper.x);
+    Floatx4 dy = Abs(Abs(hit.y) - upper.y);
+    Maskx4 xFace = dx <= dy;
+    normal = Vec2x4(Select(xFace, Select(hit.x >= zero, one, -one), zero), Select(xFace, zero, Select(hit.y >= zero, one, -one)));
+    fraction = enter;
+    return ~missed;
+}
+
+int RayCastBodyPacket(RigidBody* body, const RayPacket& packet, int lanes, RayCastHit* hits)
+{
+    const Shape* shape = body->GetShape();
+    Vec2x4 start = Vec2x4::Load(packet.startX, packet.startY);
+    Vec2x4 delta = Vec2x4::Load(packet.deltaX, packet.deltaY);
+    Floatx4 maxFraction = Floatx4::Load(packet.maxFraction);
+
+    Floatx4 fraction;
+    Vec2x4 normal;
+    Maskx4 hit;
+    switch (shape->Type())
+    {
+    case ShapeType::Circle:
+        hit = RayCastCircles(Vec2x4(body->Position()), Floatx4(((const CircleShape*)shape)->Radius()),
+            start, delta, maxFraction, fraction, normal);
+        break;
+
+    case ShapeType::Box:
+        {
+            // The rotation is found once for every lane
+            Rot2x4 rot(Matrix2(body->Rotation()));
+            Rot2x4 invRot = rot.Transposed();
+            Vector2 halfWidths = 0.5f * ((const BoxShape*)shape)->Size();
+            hit = RayCastLocalBoxes(halfWidths, invRot * (start - Vec2x4(body->Position())), invRot * delta,
+                maxFraction, fraction, normal);
+            normal = rot * normal;
+        }
+        break;
+
+    default:
+        assert(false);
+        return 0;
+    }
+
+    lanes &= hit.Bits();
+    if (lanes == 0)
+    {
+        return 0;
+    }
+
+    Vec2x4 position = start + fraction * delta;
+    for (int lane = 0; lane < RayPacket::Size; ++lane)
+    {
+        if (lanes & (1 << lane))
+        {
+            hits[lane].body = body;
+            hits[lane].fraction = fraction.Lane(lane);
+            hits[lane].position = position.Lane(lane);
+            hits[lane].normal = normal.Lane(lane);
+        }
+    }
+    return lanes;
+}
+
+// Sweeps a circle exactly, as a ray against the body's shape grown by the radius
+static bool CircleCastBody(float radius, const Vector2& start, const Vector2& end,
+    RigidBody* body, float maxFraction, RayCastHit& hit)
+{
+    const Shape* shape = body->GetShape();
+    Vector2 delta = end - start;
+
+    float fraction = FLT_MAX;
+    Vector2 normal;
+    switch (shape->Type())
+    {
+    case ShapeType::Circle:
+        if (!RayCastCircle(body->Position(), ((const CircleShape*)shape)->Radius() + radius, start, delta, maxFraction, fraction, normal))
+        {
+            return false;
+        }
+        break;
+
+    case ShapeType::Box:
+        {
+            // A box grown by a radius is the union of the box stretched
+            // along each axis, and a circle at each corner
+            Matrix2 rot(body->Rotation());
+            Matrix2 invRot = rot.Transposed();
+            Vector2 halfWidths = 0.5f * ((const BoxShape*)shape)->Size();
+            Vector2 localStart = invRot * (start - body->Position());
+            Vector2 localDelta = invRot * delta;
+
+            // Starting inside the grown box means starting in contact
+            Vector2 outside(max(fabsf(localStart.x) - halfWidths.x, 0.0f), max(fabsf(localStart.y) - halfWidths.y, 0.0f));
+            if (outside.LengthSq() < radius * radius)
+            {
+                return false;
+            }
+
+            const Vector2 grownBoxes[] =
+            {
+                Vector2(halfWidths.x + radius, halfWidths.y),
+                Vector2(halfWidths.x, halfWidths.y + radius),
+            };
+            for (int i = 0; i < _countof(grownBoxes); ++i)
+            {
+                float t;
+                Vector2 n;
+                if (RayCastLocalBox(grownBoxes[i], localStart, localDelta, min(fraction, maxFraction), t, n) && t < fraction)
+                {
+                    fraction = t;
+                    normal = n;
+                }
+            }
+
+            const Vector2 corners[] =
+            {
+                Vector2(-halfWidths.x, -halfWidths.y),
+                Vector2(halfWidths.x, -halfWidths.y),
+                Vector2(halfWidths.x, halfWidths.y),
+                Vector2(-halfWidths.x, halfWidths.y),
+            };
+            for (int i = 0; i < _countof(corners); ++i)
+            {
+                float t;
+                Vector2 n;
+                if (RayCastCircle(corners[i], radius, localStart, localDelta, min(fraction, maxFraction), t, n) && t < fraction)
+                {
+                    fraction = t;
+                    normal = n;
+                }
+            }
+
+            if (fraction == FLT_MAX)
+            {
+                return false;
+            }
+            normal = rot * normal;
+        }
+        break;
+
+    default:
+        assert(false);
+        return false;
+    }
+
+    hit.body = body;
+    hit.fraction = fraction;
+    hit.normal = normal;
+    hit.position = start + fraction * delta - radius * normal;
+    return true;
+}
+
+// Largest distance a shape can move without possibly passing through another
+// shape of at least the same size: the radius of the largest circle it contains
+static float InnerRadius(const Shape* shape)
+{
+    switch (shape->Type())
+    {
+    case ShapeType::Circle:
+        return ((const CircleShape*)shape)->Radius();
+
+    case ShapeType::Box:
+        return 0.5f * min(((const BoxShape*)shape)->Size().x, ((const BoxShape*)shape)->Size().y);
+
+    default:
+        assert(false);
+        return 0.0f;
+    }
+}
+
+bool ShapeCastBody(const Shape* shape, float rotation, const Vector2& start, const Vector2& end,
+    RigidBody* body, float maxFraction, RayCastHit& hit)
+{
+    if (shape->Type() == ShapeType::Circle)
+    {
+        return CircleCastBody(((const CircleShape*)shape)->Radius(), start, end, body, maxFraction, hit);
+    }
+
+    // Collide wants bodies, so put the shape on a temporary one. Neither it
+    // nor the body being tested is modified.
+    RigidBody::MassProperties massProperties = { 1.0f, 1.0f, 1.0f, 1.0f };
+    RigidBody swept(const_cast<Shape*>(shape), massProperties);
+    swept.Rotation() = rotation;
+
+    Vector2 delta = end - start;
+    float length = delta.Length();
+    ContactInfo contact;
+
+    // Only the part of the segment where the bounds overlap needs stepping through
+    swept.Position() = Vector2(0.0f, 0.0f);
+    AABB sweptBounds = ComputeAABB(&swept);
+    AABB bodyBounds = ComputeAABB(body);
+    float enter = 0.0f;
+    float exit = maxFraction;
+    if (!ClipSegment(AABB(bodyBounds.lower - sweptBounds.upper, bodyBounds.upper - sweptBounds.lower), start, delta, enter, exit))
+    {
+        return false;
+    }
+
+    swept.Position() = start;
+    if (Collide(&swept, body, contact))
+    {
+        // Starting in contact
+        return false;
+    }
+
+    float step = 0.5f * min(InnerRadius(shape), InnerRadius(body->GetShape()));
+    float fractionStep = length > 0.0f ? max(step / length, FLT_EPSILON) : 1.0f;
+
+    float before = enter;
+    for (float t = enter; ; t = min(t + fractionStep, exit))
+    {
+        swept.Position() = start + t * delta;
+        if (Collide(&swept, body, contact))
+        {
+            // Bisect between the last clear position and this one
+            float clear = before;
+            float touching = t;
+            for (int i = 0; i < 16; ++i)
+            {
+                float mid = 0.5f * (clear + touching);
+                swept.Position() = start + mid * delta;
+                if (Collide(&swept, body, contact))
+                {
+                    touching = mid;
+                }
+                else
+                {
+                    clear = mid;
+                }
+            }
+
+            swept.Position() = start + touching * delta;
+            Collide(&swept, body, contact);
+
+            hit.body = body;
+            hit.fraction = touching;
+            hit.normal = contact.normal;
+            hit.position = contact.worldPosition;
+            return true;
+        }
+
+        if (t >= exit)
+        {
+            return false;
+        }
+        before = t;
+    }
+}
+
+template <class S>
+bool BodyContainsPoint(const RigidBodyT<S>* body, const Vector2T<S>& point)
+{
+    const ShapeT<S>* shape = body->GetShape();
+    switch (shape->Type())
+    {
+    case ShapeType::Circle:
+        {
+            S radius = ((const CircleShapeT<S>*)shape)->Radius();
+            return (point - body->Position()).LengthSq() <= radius * radius;
+        }
+
+    case ShapeType::Box:
+        {
+            Vector2T<S> local = Matrix2T<S>(body->Rotation()).Transposed() * (point - body->Position());
+            Vector2T<S> halfWidths = S(0.5f) * ((const BoxShapeT<S>*)shape)->Size();
+            return Abs(local.x) <= halfWidths.x && Abs(local.y) <= halfWidths.y;
+        }
+
+    default:
+        assert(false);
+        return false;
+    }
+}
+
+template bool Collide(RigidBodyT<float>* body1, RigidBodyT<float>* body2, ContactInfoT<float>& contact);
+template bool Collide(RigidBodyT<double>* body1, RigidBodyT<double>* body2, ContactInfoT<double>& contact);
+template bool Collide(RigidBodyT<Fixed>* body1, RigidBodyT<Fixed>* body2, ContactInfoT<Fixed>& contact);
+
+template bool CollideCircleCircle(RigidBodyT<float>* body1, RigidBodyT<float>* body2, ContactInfoT<float>& contact);
+template bool CollideCircleCircle(RigidBodyT<double>* body1, RigidBodyT<double>* body2, ContactInfoT<double>& contact);
+template bool CollideCircleCircle(RigidBodyT<Fixed>* body1, RigidBodyT<Fixed>* body2, ContactInfoT<Fixed>& contact);
+
+template bool CollideCircleBox(RigidBodyT<float>* body1, RigidBodyT<float>* body2, ContactInfoT<float>& contact);
+template bool CollideCircleBox(RigidBodyT<double>* body1, RigidBodyT<double>* body2, ContactInfoT<double>& contact);
+template bool CollideCircleBox(RigidBodyT<Fixed>* body1, RigidBodyT<Fixed>* body2, ContactInfoT<Fixed>& contact);
+
+template bool CollideBoxBox(RigidBodyT<float>* body1, RigidBodyT<float>* body2, ContactInfoT<float>& contact);
+template bool CollideBoxBox(RigidBodyT<double>* body1, RigidBodyT<double>* body2, ContactInfoT<double>& contact);
+template bool CollideBoxBox(RigidBodyT<Fixed>* body1, RigidBodyT<Fixed>* body2, ContactInfoT<Fixed>& contact);
+
+template bool BodyContainsPoint(const RigidBodyT<float>* body, const Vector2T<float>& point);
+template bool BodyContainsPoint(const RigidBodyT<double>* body, const Vector2T<double>& point);
+template bool BodyContainsPoint(const RigidBodyT<Fixed>* body, const Vector2T<Fixed>& point);
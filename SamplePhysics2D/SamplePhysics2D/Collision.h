@@ -0,0 +1,48 @@
+#pragma once
+
+// Shape specific narrowphase tests that Collide dispatches to. They follow the
+// same contract as Collide, but require the bodies' shapes to be of the types
+// named (in that order). Exposed so they can be exercised individually.
+// Like Collide, they're built for each scalar type (see Scalar.h).
+template <class S>
+bool CollideCircleCircle(RigidBodyT<S>* body1, RigidBodyT<S>* body2, ContactInfoT<S>& contact);
+template <class S>
+bool CollideCircleBox(RigidBodyT<S>* body1, RigidBodyT<S>* body2, ContactInfoT<S>& contact);
+template <class S>
+bool CollideBoxBox(RigidBodyT<S>* body1, RigidBodyT<S>* body2, ContactInfoT<S>& contact);
+
+// Ray & shape casts are only built on float, as the broadphase bounds they're
+// used with are.
+
+struct RayPacket;
+
+// Where a ray (or swept shape) first hits a body
+struct RayCastHit
+{
+    RigidBody* body;    // body hit, or nullptr if nothing was
+    Vector2 position;   // world position of the hit
+    Vector2 normal;     // surface normal of the body at the hit, facing back towards the ray
+    float fraction;     // how far along the ray the hit is (0 at its start, 1 at its end)
+};
+
+// Exact intersection of the segment from start to end with the body's shape.
+// Returns true, filling in hit, if the first intersection lies within
+// maxFraction of the segment. Segments starting inside the shape don't hit it.
+bool RayCastBody(RigidBody* body, const Vector2& start, const Vector2& end, float maxFraction, RayCastHit& hit);
+
+// RayCastBody for the segments of packet in lanes (a bitmask), each up to its
+// lane's maxFraction, all at once. Returns the bitmask of the lanes that hit
+// the body, filling in hits[lane] for each of them; the rest are left alone.
+// Each lane gets the same hit RayCastBody would give it.
+int RayCastBodyPacket(RigidBody* body, const RayPacket& packet, int lanes, RayCastHit* hits);
+
+// Sweeps shape, at the given rotation, from start to end, and finds where it
+// first touches the body. Follows the same contract as RayCastBody. Circles
+// are swept exactly. Boxes are stepped along the segment, in steps small
+// enough not to pass through either shape, then the first contact is refined.
+bool ShapeCastBody(const Shape* shape, float rotation, const Vector2& start, const Vector2& end,
+    RigidBody* body, float maxFraction, RayCastHit& hit);
+
+// True if point lies inside (or on the edge of) the body's shape
+template <class S>
+bool BodyContainsPoint(const RigidBodyT<S>* body, const Vector2T<S>& point);
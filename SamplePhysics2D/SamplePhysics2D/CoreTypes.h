@@ -0,0 +1,21 @@
+#pragma once
+
+// The core (bodies, shapes, contacts & the narrowphase) is templated on the
+// scalar type, as Vector2T & Matrix2T are (see Scalar.h). The engine itself
+// runs on float, and these are the names it uses.
+
+template <class S> class RigidBodyT;
+template <class S> class ShapeT;
+template <class S> class CircleShapeT;
+template <class S> class BoxShapeT;
+template <class S> struct ContactInfoT;
+template <class S> struct ContactCacheT;
+template <class S> class RigidBodyPairT;
+
+typedef RigidBodyT<float> RigidBody;
+typedef ShapeT<float> Shape;
+typedef CircleShapeT<float> CircleShape;
+typedef BoxShapeT<float> BoxShape;
+typedef ContactInfoT<float> ContactInfo;
+typedef ContactCacheT<float> ContactCache;
+typedef RigidBodyPairT<float> RigidBodyPair;
@@ -0,0 +1,42 @@
+#include "Precomp.h"
+#include "DebugDraw.h"
+
+const Color DebugDraw::DefaultPointColor(1.0f, 0.0f, 0.0f, 1.0f);
+const Color DebugDraw::DefaultLineColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+DebugDraw::DebugDraw()
+    : _recording(0)
+    , _frameEnded(false)
+{
+    // Enough for a typical frame, so the first few don't grow the lists
+    for (int i = 0; i < _countof(_frames); ++i)
+    {
+        _frames[i].Direct().Reserve(16384, 1024, 1024);
+    }
+    _drawList.Reserve(16384, 1024, 1024);
+}
+
+void DebugDraw::EndFrame()
+{
+    _recording ^= 1;
+    _frames[_recording].Clear();
+    _frameEnded = true;
+}
+
+const DrawList& DebugDraw::PrepareFrame()
+{
+    // Ending the frame here could swap the lists under threads still recording
+    assert(_frameEnded);
+
+    _drawList.Clear();
+    if (!_frameEnded)
+    {
+        return _drawList;
+    }
+
+    ParallelDrawList& frame = _frames[_recording ^ 1];
+    frame.MergeInto(_drawList);
+    frame.Clear();
+    _frameEnded = false;
+    return _drawList;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "DrawList.h"
+
+class FrameCapture;
+
+// Interface for debug drawing. Recording is the same for every backend:
+// points, lines, boxes & circles are recorded into draw lists (see DrawList),
+// double buffered so that the next frame can be recorded while the last is
+// rendered. Backends implement how a frame is rendered & where it ends up.
+//
+// DebugRenderer renders with D3D11, to a window. SoftwareRenderer rasterizes
+// on the CPU, into a buffer in memory, and needs no GPU (or window) at all.
+class DebugDraw
+{
+public:
+    virtual ~DebugDraw() {}
+
+    // Colors the Draw* functions use when none is given
+    static const Color DefaultLineColor;
+    static const Color DefaultPointColor;
+
+    // Defines what portion of the world coordinate system gets rendered: the
+    // world position at the center of the frame, and how far the frame
+    // extends from it, left & right and up & down
+    virtual void SetViewport(const Vector2& position, const Vector2& size) = 0;
+
+    // Draw a point, optionally providing a color. Otherwise, uses default color
+    // The point is drawn as a tiny hollow square.
+    void DrawPoint(const Vector2& position, const Color& color = DefaultPointColor)
+    {
+        GetDrawList().AddPoint(position, color.Packed());
+    }
+
+    // Draw a line, optionally providing a color. Otherwise, uses default color
+    void DrawLine(const Vector2& start, const Vector2& end, const Color& color = DefaultLineColor)
+    {
+        GetDrawList().AddLine(start, end, color.Packed());
+    }
+
+    // Draw a box, optionally providing a color. Otherwise, uses default color
+    void DrawBox(const Vector2& position, const Vector2& widths, float rotation, const Color& color = DefaultLineColor)
+    {
+        GetDrawList().AddBox(position, widths, rotation, color.Packed());
+    }
+
+    // Draw a circle, optionally providing a color. Otherwise, uses default color
+    // This also draws a line from the center out to the surface based on rotation to visualize roll.
+    void DrawCircle(const Vector2& position, float radius, float rotation, const Color& color = DefaultLineColor)
+    {
+        GetDrawList().AddCircle(position, radius, rotation, color.Packed());
+    }
+
+    // Called once a frame, after EndFrame, to render all batched commands
+    virtual void Render() = 0;
+
+    // Discards everything drawn since the last EndFrame, without rendering it
+    void Clear() { _frames[_recording].Clear(); }
+
+    // Everything drawn directly (rather than from parallel loops) since the
+    // last EndFrame. Circles & boxes (points included) are recorded as a
+    // ShapeInstance each, and expanded into their outlines by the backend.
+    // Lines can be added to it in bulk (see DrawList).
+    DrawList& GetDrawList() { return _frames[_recording].Direct(); }
+
+    // For recording the frame from parallel loops, with a list per thread
+    // (see PhysicsWorld::Draw)
+    ParallelDrawList& GetRecordingLists() { return _frames[_recording]; }
+
+    // Frames are double buffered. EndFrame finishes recording one, and starts
+    // recording the next into the other set of lists, so the next frame can be
+    // recorded (and the world stepped) on one thread while Render draws this
+    // one on another. Every frame must be ended before it's rendered: Render
+    // never swaps the lists itself, so that it can't swap them out from under
+    // threads still recording. Only Render may run at the same time as
+    // recording, never EndFrame. If a frame is ended before the last one was
+    // rendered, the last one is dropped.
+    void EndFrame();
+
+    // Merges the ended frame's lists into the single list Render draws from,
+    // and returns it. Every backend's Render starts with this, but it can also
+    // be called by itself, to time or check recording without rendering.
+    // Asserts that a frame has been ended since the last one was prepared (and
+    // returns an empty frame, if not).
+    const DrawList& PrepareFrame();
+
+    // Sends every frame rendered from now on to capture (or stops capturing,
+    // if null). The capture must outlive the renderer, or be replaced before
+    // it's destroyed.
+    virtual void SetCapture(FrameCapture* capture) = 0;
+
+protected:
+    DebugDraw();
+
+private:
+    // The frame being recorded is _frames[_recording]; the other is the one
+    // last ended, if _frameEnded, waiting to be rendered. PrepareFrame merges
+    // it into _drawList.
+    ParallelDrawList _frames[2];
+    int _recording;
+    bool _frameEnded;
+    DrawList _drawList;
+
+    // Prevent copy
+    DebugDraw(const DebugDraw&);
+    DebugDraw& operator= (const DebugDraw&);
+};
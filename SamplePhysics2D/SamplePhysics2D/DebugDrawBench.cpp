@@ -0,0 +1,276 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "Profiling.h"
+#include "SoftwareRenderer.h"
+
+// Times recording circles & boxes with DebugDraw, which writes one
+// ShapeInstance per shape, next to expanding each into lines as it's drawn
+// (as DebugRenderer used to: 33 lines, with a cosf & sinf per point, for each
+// circle). Then times expanding the recorded circles & boxes into lines, a
+// chunk at a time as SoftwareRenderer does, a point at a time and with
+// ExpandShapes, checks that the two agree exactly, and that the outlines are
+// where drawing lines directly puts them.
+
+static const int ShapeCount = 100000;
+static const int Repeats = 20;
+static const size_t ExpandChunk = 256;     // as SoftwareRenderer
+
+// Recorded through a SoftwareRenderer (any DebugDraw would do), which is never
+// asked to render
+static const uint32_t RecordWidth = 64;
+static const uint32_t RecordHeight = 64;
+
+// What DebugRenderer used to record: every line of every outline, as
+// vertices with a float color
+struct FloatColorVertex
+{
+    FloatColorVertex(const Vector2& position, const Color& color) : position(position), color(color) {}
+
+    Vector2 position;
+    Color color;
+};
+
+static void ExpandLine(std::vector<FloatColorVertex>& vertices, const Vector2& start, const Vector2& end, const Color& color)
+{
+    vertices.push_back(FloatColorVertex(start, color));
+    vertices.push_back(FloatColorVertex(end, color));
+}
+
+static void ExpandCircle(std::vector<FloatColorVertex>& vertices, const Vector2& position, float radius, float rotation, const Color& color)
+{
+    Vector2 first = position + Vector2(radius, 0.0f);
+    Vector2 prev = first;
+    float step = 2.0f * (float)M_PI / (float)CircleSegments;
+    float angle = 0.0f;
+
+    for (int i = 1; i < CircleSegments; ++i)
+    {
+        angle += step;
+        Vector2 p = position + Vector2(cosf(angle) * radius, sinf(angle) * radius);
+        ExpandLine(vertices, prev, p, color);
+        prev = p;
+    }
+
+    ExpandLine(vertices, prev, first, color);
+    ExpandLine(vertices, position, position + Vector2(cosf(rotation) * radius, sinf(rotation) * radius), color);
+}
+
+static void ExpandBox(std::vector<FloatColorVertex>& vertices, const Vector2& position, const Vector2& widths, float rotation, const Color& color)
+{
+    Vector2 size = widths * 0.5f;
+    Vector2 offsets[] =
+    {
+        Vector2(-size.x, -size.y),
+        Vector2(size.x, -size.y),
+        Vector2(size.x, size.y),
+        Vector2(-size.x, size.y),
+    };
+
+    float sinA = sinf(rotation);
+    float cosA = cosf(rotation);
+    for (int i = 0; i < _countof(offsets); ++i)
+    {
+        offsets[i] = Vector2(cosA * offsets[i].x + -sinA * offsets[i].y, sinA * offsets[i].x + cosA * offsets[i].y);
+    }
+
+    for (int i = 0; i < _countof(offsets); ++i)
+    {
+        ExpandLine(vertices, position + offsets[i], position + offsets[(i + 1) % _countof(offsets)], color);
+    }
+}
+
+struct BenchShape
+{
+    Vector2 position;
+    Vector2 size;
+    float rotation;
+    bool circle;
+};
+
+static std::vector<BenchShape> CreateShapes()
+{
+    BenchRandom random(23);
+    std::vector<BenchShape> shapes(ShapeCount);
+    for (auto& shape : shapes)
+    {
+        shape.circle = (random.Next() & 1) != 0;
+        shape.position = Vector2(random.Range(-100.0f, 100.0f), random.Range(-100.0f, 100.0f));
+        shape.size = Vector2(random.Range(0.2f, 2.0f), random.Range(0.2f, 2.0f));
+        shape.rotation = random.Range(-10.0f, 10.0f);
+    }
+    return shapes;
+}
+
+// Each point of each shape's outline, transformed the same way as
+// ExpandShapes, one at a time
+static void ExpandOneAtATime(ShapeType type, const ShapeInstance* shapes, size_t count, Vector2* points)
+{
+    const Vector2* outline = UnitOutline(type);
+    int shapeVertices = OutlineVertices(type);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const ShapeInstance& shape = shapes[i];
+        float c = cosf(shape.rotation);
+        float s = sinf(shape.rotation);
+        float m11 = c * shape.size.x, m12 = -s * shape.size.y;
+        float m21 = s * shape.size.x, m22 = c * shape.size.y;
+        for (int k = 0; k < shapeVertices; ++k)
+        {
+            const Vector2& u = outline[k];
+            points[i * shapeVertices + k] = Vector2(shape.position.x + (m11 * u.x + m12 * u.y),
+                shape.position.y + (m21 * u.x + m22 * u.y));
+        }
+    }
+}
+
+typedef void (*ExpandFunction)(ShapeType type, const ShapeInstance* shapes, size_t count, Vector2* points);
+
+// Expands the shapes as SoftwareRenderer does: ExpandChunk of them at a time,
+// into a buffer small enough to stay in cache
+static double TimeExpanding(ExpandFunction expand, ShapeType type, const std::vector<ShapeInstance>& shapes)
+{
+    std::vector<Vector2> points(ExpandChunk * OutlineVertices(type));
+    int64_t start = GetProfileTicks();
+    for (int r = 0; r < Repeats; ++r)
+    {
+        for (size_t first = 0; first < shapes.size(); first += ExpandChunk)
+        {
+            expand(type, &shapes[first], min(ExpandChunk, shapes.size() - first), points.data());
+        }
+    }
+    return TicksToMilliseconds(GetProfileTicks() - start) * 1e6 / ((double)Repeats * shapes.size());
+}
+
+static double NsPerShape(int64_t ticks)
+{
+    return TicksToMilliseconds(ticks) * 1e6 / ((double)Repeats * ShapeCount);
+}
+
+// The largest distance between the expanded outlines & the lines drawn
+// directly, relative to the shapes' sizes
+static double CompareOutlines(const std::vector<BenchShape>& shapes, const std::vector<FloatColorVertex>& lines,
+    const std::vector<Vector2>& circlePoints, const std::vector<Vector2>& boxPoints)
+{
+    double maxError = 0.0;
+    size_t line = 0, circle = 0, box = 0;
+    for (auto& shape : shapes)
+    {
+        const Vector2* points = shape.circle ? &circlePoints[circle++ * CircleOutlineVertices] : &boxPoints[box++ * BoxOutlineVertices];
+        int count = shape.circle ? CircleOutlineVertices : BoxOutlineVertices;
+        double size = max(shape.size.x, shape.size.y);
+        for (int k = 0; k < count; ++k, ++line)
+        {
+            Vector2 d = points[k] - lines[line].position;
+            maxError = max(maxError, sqrt((double)d.LengthSq()) / size);
+        }
+    }
+    return maxError;
+}
+
+bool BenchDebugDraw(FILE* output)
+{
+    std::vector<BenchShape> shapes = CreateShapes();
+    Color color(0.2f, 0.8f, 0.4f, 1.0f);
+    bool succeeded = true;
+
+    // Recording. Both keep their capacity from one repeat to the next.
+    std::vector<FloatColorVertex> lines;
+    int64_t start = GetProfileTicks();
+    for (int r = 0; r < Repeats; ++r)
+    {
+        lines.clear();
+        for (auto& shape : shapes)
+        {
+            if (shape.circle)
+            {
+                ExpandCircle(lines, shape.position, shape.size.x, shape.rotation, color);
+            }
+            else
+            {
+                ExpandBox(lines, shape.position, shape.size, shape.rotation, color);
+            }
+        }
+    }
+    double linesNs = NsPerShape(GetProfileTicks() - start);
+
+    SoftwareRenderer renderer(RecordWidth, RecordHeight);
+    start = GetProfileTicks();
+    for (int r = 0; r < Repeats; ++r)
+    {
+        renderer.Clear();
+        for (auto& shape : shapes)
+        {
+            if (shape.circle)
+            {
+                renderer.DrawCircle(shape.position, shape.size.x, shape.rotation, color);
+            }
+            else
+            {
+                renderer.DrawBox(shape.position, shape.size, shape.rotation, color);
+            }
+        }
+    }
+    double shapesNs = NsPerShape(GetProfileTicks() - start);
+
+    size_t recordedShapes = renderer.GetDrawList().Circles().size() + renderer.GetDrawList().Boxes().size();
+    fprintf(output, "recording %d shapes (half circles, half boxes):\n", ShapeCount);
+    fprintf(output, "  as lines          %7.2f ns/shape  %6.1f bytes/shape\n", linesNs,
+        (double)(lines.size() * sizeof(FloatColorVertex)) / ShapeCount);
+    fprintf(output, "  as shapes         %7.2f ns/shape  %6.1f bytes/shape  (%.1fx)\n", shapesNs,
+        (double)(recordedShapes * sizeof(ShapeInstance)) / ShapeCount, linesNs / shapesNs);
+    if (recordedShapes != (size_t)ShapeCount)
+    {
+        fprintf(output, "  %d shapes recorded, expected %d\n", (int)recordedShapes, ShapeCount);
+        succeeded = false;
+    }
+
+    // Expanding, as a CPU backend does when it renders
+    const std::vector<ShapeInstance>& circles = renderer.GetDrawList().Circles();
+    const std::vector<ShapeInstance>& boxes = renderer.GetDrawList().Boxes();
+    std::vector<Vector2> circlePoints(circles.size() * CircleOutlineVertices), boxPoints(boxes.size() * BoxOutlineVertices);
+    std::vector<Vector2> referenceCircles(circlePoints.size()), referenceBoxes(boxPoints.size());
+
+    double circlesNs = TimeExpanding(ExpandOneAtATime, ShapeType::Circle, circles);
+    double simdCirclesNs = TimeExpanding(ExpandShapes, ShapeType::Circle, circles);
+    double boxesNs = TimeExpanding(ExpandOneAtATime, ShapeType::Box, boxes);
+    double simdBoxesNs = TimeExpanding(ExpandShapes, ShapeType::Box, boxes);
+
+    fprintf(output, "expanding to lines, %d shapes at a time:\n", (int)ExpandChunk);
+    fprintf(output, "  circles: a point at a time %7.2f ns/shape, ExpandShapes %7.2f ns/shape  (%.1fx)\n",
+        circlesNs, simdCirclesNs, circlesNs / simdCirclesNs);
+    fprintf(output, "  boxes:   a point at a time %7.2f ns/shape, ExpandShapes %7.2f ns/shape  (%.1fx)\n",
+        boxesNs, simdBoxesNs, boxesNs / simdBoxesNs);
+
+    ExpandOneAtATime(ShapeType::Circle, circles.data(), circles.size(), referenceCircles.data());
+    ExpandOneAtATime(ShapeType::Box, boxes.data(), boxes.size(), referenceBoxes.data());
+    ExpandShapes(ShapeType::Circle, circles.data(), circles.size(), circlePoints.data());
+    ExpandShapes(ShapeType::Box, boxes.data(), boxes.size(), boxPoints.data());
+    if (memcmp(circlePoints.data(), referenceCircles.data(), circlePoints.size() * sizeof(Vector2)) != 0 ||
+        memcmp(boxPoints.data(), referenceBoxes.data(), boxPoints.size() * sizeof(Vector2)) != 0)
+    {
+        fprintf(output, "  ExpandShapes differs from expanding a point at a time\n");
+        succeeded = false;
+    }
+
+    // The outlines' points are in the same order as the lines drawn directly,
+    // but found differently (and circles' outlines are rotated, too, which
+    // moves them around the circle). Only boxes can be compared.
+    std::vector<BenchShape> boxShapes;
+    std::vector<FloatColorVertex> boxLines;
+    for (auto& shape : shapes)
+    {
+        if (!shape.circle)
+        {
+            boxShapes.push_back(shape);
+            ExpandBox(boxLines, shape.position, shape.size, shape.rotation, color);
+        }
+    }
+    double error = CompareOutlines(boxShapes, boxLines, circlePoints, boxPoints);
+    fprintf(output, "  boxes' outlines within %.2e (relative to their size) of the lines drawn directly\n", error);
+    if (error > 1e-4)
+    {
+        succeeded = false;
+    }
+
+    return succeeded;
+}
@@ -1,19 +1,22 @@
 #include "Precomp.h"
 #include "DebugRenderer.h"
+#include "FrameCapture.h"
 #include "DebugRendererVS.h"
 #include "DebugRendererPS.h"
+#include "DebugRendererShapeVS.h"
 
 using namespace Microsoft::WRL;
 
-const Color DebugRenderer::DefaultPointColor(1.0f, 0.0f, 0.0f, 1.0f);
-const Color DebugRenderer::DefaultLineColor(1.0f, 1.0f, 1.0f, 1.0f);
-
 DebugRenderer::DebugRenderer()
+    : _capture(nullptr)
+    , _stagingCopied(0)
+    , _stagingPending(0)
 {
 }
 
 DebugRenderer::~DebugRenderer()
 {
+    SetCapture(nullptr);
 }
 
 bool DebugRenderer::Initialize(HWND hwnd)
@@ -43,14 +46,13 @@ bool DebugRenderer::Initialize(HWND hwnd)
     }
 
     // Get back buffer pointer & create a render target view to it
-    ComPtr<ID3D11Texture2D> texture;
-    hr = _swapChain->GetBuffer(0, IID_PPV_ARGS(&texture));
+    hr = _swapChain->GetBuffer(0, IID_PPV_ARGS(&_backBuffer));
     if (FAILED(hr))
     {
         return false;
     }
 
-    hr = _device->CreateRenderTargetView(texture.Get(), nullptr, &_renderTargetView);
+    hr = _device->CreateRenderTargetView(_backBuffer.Get(), nullptr, &_renderTargetView);
     if (FAILED(hr))
     {
         return false;
@@ -69,12 +71,13 @@ bool DebugRenderer::Initialize(HWND hwnd)
         return false;
     }
 
-    // Create input layout describing our vertex data
+    // Create input layout describing our vertex data (LineVertex). The color
+    // is unpacked to floats by the input assembler, so the shader sees a float4.
     D3D11_INPUT_ELEMENT_DESC elems[2] = {};
     elems[0].Format = DXGI_FORMAT_R32G32_FLOAT;
     elems[0].SemanticName = "POSITION";
-    elems[1].AlignedByteOffset = sizeof(Vector2);
-    elems[1].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    elems[1].AlignedByteOffset = offsetof(LineVertex, color);
+    elems[1].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
     elems[1].SemanticName = "COLOR";
 
     hr = _device->CreateInputLayout(elems, _countof(elems), DebugRendererVS, sizeof(DebugRendererVS), &_inputLayout);
@@ -83,12 +86,48 @@ bool DebugRenderer::Initialize(HWND hwnd)
         return false;
     }
 
+    // Shapes are drawn instanced: the unit outline comes from slot 0, and a
+    // ShapeInstance per instance from slot 1
+    hr = _device->CreateVertexShader(DebugRendererShapeVS, sizeof(DebugRendererShapeVS), nullptr, &_shapeVertexShader);
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
+    D3D11_INPUT_ELEMENT_DESC shapeElems[5] = {};
+    shapeElems[0].Format = DXGI_FORMAT_R32G32_FLOAT;
+    shapeElems[0].SemanticName = "POSITION";
+    for (int i = 1; i < _countof(shapeElems); ++i)
+    {
+        shapeElems[i].InputSlot = 1;
+        shapeElems[i].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+        shapeElems[i].InstanceDataStepRate = 1;
+    }
+    shapeElems[1].AlignedByteOffset = offsetof(ShapeInstance, position);
+    shapeElems[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+    shapeElems[1].SemanticName = "INSTANCE_POSITION";
+    shapeElems[2].AlignedByteOffset = offsetof(ShapeInstance, size);
+    shapeElems[2].Format = DXGI_FORMAT_R32G32_FLOAT;
+    shapeElems[2].SemanticName = "INSTANCE_SIZE";
+    shapeElems[3].AlignedByteOffset = offsetof(ShapeInstance, rotation);
+    shapeElems[3].Format = DXGI_FORMAT_R32_FLOAT;
+    shapeElems[3].SemanticName = "INSTANCE_ROTATION";
+    shapeElems[4].AlignedByteOffset = offsetof(ShapeInstance, color);
+    shapeElems[4].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    shapeElems[4].SemanticName = "COLOR";
+
+    hr = _device->CreateInputLayout(shapeElems, _countof(shapeElems), DebugRendererShapeVS, sizeof(DebugRendererShapeVS), &_shapeInputLayout);
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
     // Create vertex & constant buffer. All drawing uses the same vertex buffer.
     // We just copy new vertices into it and draw using it again.
     D3D11_BUFFER_DESC bd = {};
     bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bd.ByteWidth = sizeof(Vertex) * MaxVerticesPerDraw;
-    bd.StructureByteStride = sizeof(Vertex);
+    bd.ByteWidth = sizeof(LineVertex) * MaxVerticesPerDraw;
+    bd.StructureByteStride = sizeof(LineVertex);
     bd.Usage = D3D11_USAGE_DEFAULT;
 
     hr = _device->CreateBuffer(&bd, nullptr, &_vertexBuffer);
@@ -108,14 +147,38 @@ bool DebugRenderer::Initialize(HWND hwnd)
         return false;
     }
 
-    // Set up the graphics pipeline
-    uint32_t stride = sizeof(Vertex);
-    uint32_t offset = 0;
+    // The unit outlines never change
+    Vector2 outlines[CircleOutlineVertices + BoxOutlineVertices];
+    std::copy(UnitOutline(ShapeType::Circle), UnitOutline(ShapeType::Circle) + CircleOutlineVertices, outlines);
+    std::copy(UnitOutline(ShapeType::Box), UnitOutline(ShapeType::Box) + BoxOutlineVertices, outlines + CircleOutlineVertices);
 
-    _context->IASetInputLayout(_inputLayout.Get());
+    D3D11_SUBRESOURCE_DATA outlineData = {};
+    outlineData.pSysMem = outlines;
+
+    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bd.ByteWidth = sizeof(outlines);
+    bd.StructureByteStride = sizeof(Vector2);
+    bd.Usage = D3D11_USAGE_IMMUTABLE;
+
+    hr = _device->CreateBuffer(&bd, &outlineData, &_outlineBuffer);
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
+    bd.ByteWidth = sizeof(ShapeInstance) * MaxInstancesPerDraw;
+    bd.StructureByteStride = sizeof(ShapeInstance);
+    bd.Usage = D3D11_USAGE_DEFAULT;
+
+    hr = _device->CreateBuffer(&bd, nullptr, &_instanceBuffer);
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
+    // Set up the graphics pipeline. The input layout, vertex shader & vertex
+    // buffers are set for lines & shapes in turn when rendering.
     _context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-    _context->IASetVertexBuffers(0, 1, _vertexBuffer.GetAddressOf(), &stride, &offset);
-    _context->VSSetShader(_vertexShader.Get(), nullptr, 0);
     _context->PSSetShader(_pixelShader.Get(), nullptr, 0);
     _context->VSSetConstantBuffers(0, 1, _constantBuffer.GetAddressOf());
 
@@ -140,104 +203,151 @@ void DebugRenderer::SetViewport(const Vector2& position, const Vector2& size)
     _context->UpdateSubresource(_constantBuffer.Get(), 0, nullptr, &constants, sizeof(constants), 0);
 }
 
-void DebugRenderer::DrawPoint(const Vector2& position, const Color& color)
+void DebugRenderer::Render()
 {
-    // Draw the point as a tiny hollow square
-    float size = 0.1f;
+    const DrawList& frame = PrepareFrame();
+
+    static const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    _context->ClearRenderTargetView(_renderTargetView.Get(), clearColor);
+
+    // Draw shapes
+    ID3D11Buffer* shapeBuffers[] = { _outlineBuffer.Get(), _instanceBuffer.Get() };
+    uint32_t shapeStrides[] = { sizeof(Vector2), sizeof(ShapeInstance) };
+    uint32_t shapeOffsets[] = { 0, 0 };
+
+    _context->IASetInputLayout(_shapeInputLayout.Get());
+    _context->IASetVertexBuffers(0, 2, shapeBuffers, shapeStrides, shapeOffsets);
+    _context->VSSetShader(_shapeVertexShader.Get(), nullptr, 0);
+
+    DrawInstances(frame.Circles(), 0, CircleOutlineVertices);
+    DrawInstances(frame.Boxes(), CircleOutlineVertices, BoxOutlineVertices);
+
+    // Draw lines
+    uint32_t stride = sizeof(LineVertex);
+    uint32_t offset = 0;
+
+    _context->IASetInputLayout(_inputLayout.Get());
+    _context->IASetVertexBuffers(0, 1, _vertexBuffer.GetAddressOf(), &stride, &offset);
+    _context->VSSetShader(_vertexShader.Get(), nullptr, 0);
 
-    Vector2 offsets[] =
+    D3D11_BOX box = {};
+    box.back = 1;
+    box.bottom = 1;
+
+    uint32_t numPoints = (uint32_t)frame.LineVertices().size();
+    const LineVertex* points = frame.LineVertices().data();
+    while (numPoints > 0)
     {
-        Vector2(-size, -size),
-        Vector2(size, -size),
-        Vector2(size, size),
-        Vector2(-size, size),
-    };
+        uint32_t num = min(numPoints, MaxVerticesPerDraw);
+        box.right = sizeof(LineVertex) * num;
+        _context->UpdateSubresource(_vertexBuffer.Get(), 0, &box, points, box.right, 0);
+        _context->Draw(num, 0);
+        numPoints -= num;
+        points += num;
+    }
 
-    for (int i = 0; i < _countof(offsets); ++i)
+    if (_capture)
     {
-        DrawLine(position + offsets[i], position + offsets[(i + 1) % _countof(offsets)], color);
+        CaptureFrame();
     }
+
+    _swapChain->Present(1, 0);
 }
 
-void DebugRenderer::DrawLine(const Vector2& start, const Vector2& end, const Color& color)
+void DebugRenderer::DrawInstances(const std::vector<ShapeInstance>& shapes, uint32_t firstVertex, uint32_t vertexCount)
 {
-    _vertices.push_back(Vertex(start, color));
-    _vertices.push_back(Vertex(end, color));
+    D3D11_BOX box = {};
+    box.back = 1;
+    box.bottom = 1;
+
+    uint32_t numShapes = (uint32_t)shapes.size();
+    const ShapeInstance* instances = shapes.data();
+    while (numShapes > 0)
+    {
+        uint32_t num = min(numShapes, MaxInstancesPerDraw);
+        box.right = sizeof(ShapeInstance) * num;
+        _context->UpdateSubresource(_instanceBuffer.Get(), 0, &box, instances, box.right, 0);
+        _context->DrawInstanced(vertexCount, num, firstVertex, 0);
+        numShapes -= num;
+        instances += num;
+    }
 }
 
-void DebugRenderer::DrawBox(const Vector2& position, const Vector2& widths, float rotation, const Color& color)
+void DebugRenderer::SetCapture(FrameCapture* capture)
 {
-    Vector2 size = widths * 0.5f;
-    Vector2 offsets[] =
+    // Finish reading back the frames already copied for the old capture
+    while (_capture && _stagingPending > 0)
     {
-        Vector2(-size.x, -size.y),
-        Vector2(size.x, -size.y),
-        Vector2(size.x, size.y),
-        Vector2(-size.x, size.y),
-    };
+        ReadCapturedFrame(true);
+    }
 
-    // Rotate the offset vectors
-    float sinA = sinf(rotation);
-    float cosA = cosf(rotation);
-    for (int i = 0; i < _countof(offsets); ++i)
+    _capture = capture;
+    if (!capture || _staging[0])
     {
-        offsets[i] = Vector2(cosA * offsets[i].x + -sinA * offsets[i].y, sinA * offsets[i].x + cosA * offsets[i].y);
+        return;
     }
 
-    // Draw lines
-    for (int i = 0; i < _countof(offsets); ++i)
+    // Textures the CPU can read, the same size & format as the back buffer
+    D3D11_TEXTURE2D_DESC desc;
+    _backBuffer->GetDesc(&desc);
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = 0;
+
+    for (uint32_t i = 0; i < StagingFrames; ++i)
     {
-        DrawLine(position + offsets[i], position + offsets[(i + 1) % _countof(offsets)], color);
+        if (FAILED(_device->CreateTexture2D(&desc, nullptr, &_staging[i])))
+        {
+            _capture = nullptr;
+            return;
+        }
     }
 }
 
-void DebugRenderer::DrawCircle(const Vector2& position, float radius, float rotation, const Color& color)
+void DebugRenderer::CaptureFrame()
 {
-    static const int numPoints = 32;
-
-    Vector2 first = position + Vector2(radius, 0.0f);
-    Vector2 prev = first;
-    float step = 2.0f * (float)M_PI / (float)numPoints;
-    float angle = 0.0f;
-
-    for (int i = 1; i < numPoints; ++i)
+    // Hand over whatever the GPU has finished copying, oldest first
+    while (_stagingPending > 0 && ReadCapturedFrame(false))
     {
-        angle += step;
-        Vector2 p = position + Vector2(cosf(angle) * radius, sinf(angle) * radius);
-        DrawLine(prev, p, color);
-        prev = p;
     }
 
-    // Last segment
-    DrawLine(prev, first, color);
+    // With every texture in the ring waiting to be read, the oldest has to be
+    // waited for. That's rare, as it was rendered several frames ago, and the
+    // wait is for the GPU, never for the disk.
+    if (_stagingPending == StagingFrames)
+    {
+        ReadCapturedFrame(true);
+    }
 
-    // Rotation line
-    DrawLine(position, position + Vector2(cosf(rotation) * radius, sinf(rotation) * radius), color);
+    _context->CopyResource(_staging[_stagingCopied % StagingFrames].Get(), _backBuffer.Get());
+    ++_stagingCopied;
+    ++_stagingPending;
 }
 
-void DebugRenderer::Render()
+bool DebugRenderer::ReadCapturedFrame(bool wait)
 {
-    static const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
-    _context->ClearRenderTargetView(_renderTargetView.Get(), clearColor);
+    ID3D11Texture2D* texture = _staging[(_stagingCopied - _stagingPending) % StagingFrames].Get();
 
-    D3D11_BOX box = {};
-    box.back = 1;
-    box.bottom = 1;
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    HRESULT hr = _context->Map(texture, 0, D3D11_MAP_READ, wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+    {
+        return false;
+    }
 
-    // Draw lines
-    uint32_t numPoints = (uint32_t)_vertices.size();
-    Vertex* points = _vertices.data();
-    while (numPoints > 0)
+    --_stagingPending;
+    if (FAILED(hr))
     {
-        uint32_t num = min(numPoints, MaxVerticesPerDraw);
-        box.right = sizeof(Vertex) * num;
-        _context->UpdateSubresource(_vertexBuffer.Get(), 0, &box, points, box.right, 0);
-        _context->Draw(num, 0);
-        numPoints -= num;
-        points += num;
+        return true;
     }
 
-    _swapChain->Present(1, 0);
+    // The capture copies the frame into one of its own buffers (or drops it,
+    // if they're all still waiting to be written)
+    D3D11_TEXTURE2D_DESC desc;
+    texture->GetDesc(&desc);
+    _capture->Capture((const uint8_t*)mapped.pData, desc.Width, desc.Height, mapped.RowPitch);
 
-    _vertices.clear();
+    _context->Unmap(texture, 0);
+    return true;
 }
@@ -1,16 +1,12 @@
 #pragma once
 
-struct Color
-{
-    Color() : r(0.0f), g(0.0f), b(0.0f), a(1.0f) {}
-    Color(float r, float g, float b, float a) : r(r), g(g), b(b), a(a) {}
-    Color(const Color& other) : r(other.r), g(other.g), b(other.b), a(other.a) {}
+#include "DebugDraw.h"
 
-    float r, g, b, a;
-};
+#include <d3d11.h>
+#include <wrl.h>
 
-// Simple debug renderer for visualizing shapes
-class DebugRenderer
+// Debug renderer for visualizing shapes, with D3D11, in a window
+class DebugRenderer : public DebugDraw
 {
 public:
     DebugRenderer();
@@ -19,38 +15,41 @@ public:
     // Initialize debug renderer, outputing to the specified hwnd
     bool Initialize(HWND hwnd);
 
-    // Defines what portion of the world coordinate system gets rendered to the window
-    void SetViewport(const Vector2& position, const Vector2& size);
+    void SetViewport(const Vector2& position, const Vector2& size) override;
 
-    // Draw a point, optionally providing a color. Otherwise, uses default color
-    void DrawPoint(const Vector2& position, const Color& color = DefaultPointColor);
+    // Called once a frame to render all batched commands to the window
+    void Render() override;
 
-    // Draw a line, optionally providing a color. Otherwise, uses default color
-    void DrawLine(const Vector2& start, const Vector2& end, const Color& color = DefaultLineColor);
+    // Frames are copied from the GPU a few frames behind, so reading them
+    // back doesn't stall rendering, and written out on capture's thread
+    void SetCapture(FrameCapture* capture) override;
 
-    // Draw a box, optionally providing a color. Otherwise, uses default color
-    void DrawBox(const Vector2& position, const Vector2& widths, float rotation, const Color& color = DefaultLineColor);
+private:
+    // Draws shapes instanced, in batches of up to MaxInstancesPerDraw. Each
+    // instance is an outline of vertexCount vertices, from firstVertex in _outlineBuffer.
+    void DrawInstances(const std::vector<ShapeInstance>& shapes, uint32_t firstVertex, uint32_t vertexCount);
 
-    // Draw a circle, optionally providing a color. Otherwise, uses default color
-    // This also draws a line from the center out to the surface based on rotation to visualize roll.
-    void DrawCircle(const Vector2& position, float radius, float rotation, const Color& color = DefaultLineColor);
+    // Copies the frame just rendered into the staging ring, and hands any
+    // earlier frames that have finished copying to the capture
+    void CaptureFrame();
 
-    // Called once a frame to render all batched commands to the window
-    void Render();
+    // Reads the oldest frame in the staging ring back into the capture.
+    // Returns false, without waiting, if the GPU hasn't finished copying it.
+    bool ReadCapturedFrame(bool wait);
 
-private:
     // Prevent copy
     DebugRenderer(const DebugRenderer&);
     DebugRenderer& operator= (const DebugRenderer&);
 
 private:
-    static const Color DefaultLineColor;
-    static const Color DefaultPointColor;
-    static const uint32_t MaxVerticesPerDraw = 16384;
+    static const uint32_t MaxVerticesPerDraw = 32768;
+    static const uint32_t MaxInstancesPerDraw = 4096;
+    static const uint32_t StagingFrames = 3;
 
     Microsoft::WRL::ComPtr<IDXGISwapChain> _swapChain;
     Microsoft::WRL::ComPtr<ID3D11Device> _device;
     Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> _backBuffer;
     Microsoft::WRL::ComPtr<ID3D11RenderTargetView> _renderTargetView;
     Microsoft::WRL::ComPtr<ID3D11InputLayout> _inputLayout;
     Microsoft::WRL::ComPtr<ID3D11VertexShader> _vertexShader;
@@ -58,14 +57,12 @@ private:
     Microsoft::WRL::ComPtr<ID3D11Buffer> _vertexBuffer;
     Microsoft::WRL::ComPtr<ID3D11Buffer> _constantBuffer;
 
-    struct Vertex
-    {
-        Vertex() {}
-        Vertex(const Vector2& position, const Color& color) : position(position), color(color) {}
-
-        Vector2 position;
-        Color   color;
-    };
+    // For shapes: the unit circle & box outlines (see DrawCommands.h), one
+    // after the other, and the instances being drawn
+    Microsoft::WRL::ComPtr<ID3D11InputLayout> _shapeInputLayout;
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> _shapeVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> _outlineBuffer;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> _instanceBuffer;
 
     struct Constants
     {
@@ -73,5 +70,10 @@ private:
         Vector2 viewportSize;
     };
 
-    std::vector<Vertex> _vertices;
+    // Frames being copied back from the GPU for capture. _stagingCopied frames
+    // have been copied in all, of which the last _stagingPending haven't been read back.
+    FrameCapture* _capture;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> _staging[StagingFrames];
+    uint32_t _stagingCopied;
+    uint32_t _stagingPending;
 };
@@ -0,0 +1,36 @@
+cbuffer Constants
+{
+    float2 ViewportPosition;
+    float2 ViewportSize;
+};
+
+// Drawn instanced: the vertices are the end points of a unit shape's outline,
+// and each instance is one shape (a ShapeInstance)
+struct VertexIn
+{
+    float2 Outline : POSITION;
+    float2 Position : INSTANCE_POSITION;
+    float2 Size : INSTANCE_SIZE;
+    float Rotation : INSTANCE_ROTATION;
+    float4 Color : COLOR;
+};
+
+struct VertexOut
+{
+    float4 Position : SV_POSITION;
+    float4 Color : COLOR;
+};
+
+VertexOut main(VertexIn input)
+{
+    float s, c;
+    sincos(input.Rotation, s, c);
+
+    float2 local = input.Outline * input.Size;
+    float2 position = input.Position + float2(c * local.x - s * local.y, s * local.x + c * local.y);
+
+    VertexOut output;
+    output.Position = float4((position - ViewportPosition) / ViewportSize, 0, 1);
+    output.Color = input.Color;
+    return output;
+}
@@ -7,7 +7,7 @@ cbuffer Constants
 struct VertexIn
 {
     float2 Position : POSITION;
-    float4 Color : COLOR;
+    float4 Color : COLOR;       // RGBA8 in the vertex buffer, unpacked to [0, 1]
 };
 
 struct VertexOut
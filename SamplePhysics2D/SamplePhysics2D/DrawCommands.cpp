@@ -0,0 +1,98 @@
+#include "Precomp.h"
+#include "DrawCommands.h"
+
+// The outlines are also kept as interleaved x, y floats, and with each
+// point's x & y swapped, for ExpandShapes to transform 2 points per Floatx4
+struct UnitOutlines
+{
+    Vector2 circle[CircleOutlineVertices];
+    Vector2 box[BoxOutlineVertices];
+
+    float circleXYs[CircleOutlineVertices * 2], circleYXs[CircleOutlineVertices * 2];
+    float boxXYs[BoxOutlineVertices * 2], boxYXs[BoxOutlineVertices * 2];
+};
+
+static const UnitOutlines& GetUnitOutlines()
+{
+    static UnitOutlines outlines;
+    static std::once_flag built;
+    std::call_once(built, []()
+    {
+        float step = 2.0f * (float)M_PI / (float)CircleSegments;
+        for (int i = 0; i < CircleSegments; ++i)
+        {
+            // The last segment closes the outline exactly
+            int next = (i + 1) % CircleSegments;
+            outlines.circle[i * 2] = Vector2(cosf(step * i), sinf(step * i));
+            outlines.circle[i * 2 + 1] = Vector2(cosf(step * next), sinf(step * next));
+        }
+        outlines.circle[CircleSegments * 2] = Vector2(0.0f, 0.0f);
+        outlines.circle[CircleSegments * 2 + 1] = Vector2(1.0f, 0.0f);
+
+        Vector2 corners[] =
+        {
+            Vector2(-0.5f, -0.5f),
+            Vector2(0.5f, -0.5f),
+            Vector2(0.5f, 0.5f),
+            Vector2(-0.5f, 0.5f),
+        };
+        for (int i = 0; i < _countof(corners); ++i)
+        {
+            outlines.box[i * 2] = corners[i];
+            outlines.box[i * 2 + 1] = corners[(i + 1) % _countof(corners)];
+        }
+
+        for (int i = 0; i < CircleOutlineVertices; ++i)
+        {
+            outlines.circleXYs[i * 2] = outlines.circleYXs[i * 2 + 1] = outlines.circle[i].x;
+            outlines.circleXYs[i * 2 + 1] = outlines.circleYXs[i * 2] = outlines.circle[i].y;
+        }
+        for (int i = 0; i < BoxOutlineVertices; ++i)
+        {
+            outlines.boxXYs[i * 2] = outlines.boxYXs[i * 2 + 1] = outlines.box[i].x;
+            outlines.boxXYs[i * 2 + 1] = outlines.boxYXs[i * 2] = outlines.box[i].y;
+        }
+    });
+    return outlines;
+}
+
+const Vector2* UnitOutline(ShapeType type)
+{
+    const UnitOutlines& outlines = GetUnitOutlines();
+    return type == ShapeType::Circle ? outlines.circle : outlines.box;
+}
+
+// Both outlines are a whole number of Floatx4s of interleaved x, y floats
+static_assert(CircleOutlineVertices * 2 % Floatx4::Width == 0 && BoxOutlineVertices * 2 % Floatx4::Width == 0,
+    "ExpandShapes has no tail");
+
+void ExpandShapes(ShapeType type, const ShapeInstance* shapes, size_t count, Vector2* points)
+{
+    const UnitOutlines& outlines = GetUnitOutlines();
+    const float* xys = type == ShapeType::Circle ? outlines.circleXYs : outlines.boxXYs;
+    const float* yxs = type == ShapeType::Circle ? outlines.circleYXs : outlines.boxYXs;
+    int shapeFloats = OutlineVertices(type) * 2;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const ShapeInstance& shape = shapes[i];
+
+        // The outline is scaled by size, then rotated: point = position + M * u,
+        // with M = R(rotation) * diag(size). Working on (x, y) pairs, that's
+        // p + (a * (ux, uy) + b * (uy, ux)), with a = (m11, m22) & b = (m12, m21).
+        float c = cosf(shape.rotation);
+        float s = sinf(shape.rotation);
+        float m11 = c * shape.size.x, m12 = -s * shape.size.y;
+        float m21 = s * shape.size.x, m22 = c * shape.size.y;
+        float as[] = { m11, m22, m11, m22 };
+        float bs[] = { m12, m21, m12, m21 };
+        float ps[] = { shape.position.x, shape.position.y, shape.position.x, shape.position.y };
+        Floatx4 a = Floatx4::Load(as), b = Floatx4::Load(bs), p = Floatx4::Load(ps);
+
+        float* out = &points[i * OutlineVertices(type)].x;
+        for (int k = 0; k < shapeFloats; k += Floatx4::Width)
+        {
+            (p + (a * Floatx4::Load(xys + k) + b * Floatx4::Load(yxs + k))).Store(out + k);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Shape.h"
+
+struct Color
+{
+    Color() : r(0.0f), g(0.0f), b(0.0f), a(1.0f) {}
+    Color(float r, float g, float b, float a) : r(r), g(g), b(b), a(a) {}
+    Color(const Color& other) : r(other.r), g(other.g), b(other.b), a(other.a) {}
+
+    // 8 bits a channel, red in the lowest byte (as DXGI_FORMAT_R8G8B8A8_UNORM
+    // lays them out). Channels are clamped to [0, 1].
+    uint32_t Packed() const
+    {
+        return PackChannel(r) | (PackChannel(g) << 8) | (PackChannel(b) << 16) | (PackChannel(a) << 24);
+    }
+
+    float r, g, b, a;
+
+private:
+    static uint32_t PackChannel(float c)
+    {
+        return (uint32_t)(min(max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+};
+
+// One end of a line: 12 bytes, with the color packed (see Color::Packed).
+// The default constructor leaves it uninitialized, so that room for vertices
+// can be made without writing to it twice.
+struct LineVertex
+{
+    LineVertex() {}
+    LineVertex(const Vector2& position, uint32_t color) : position(position), color(color) {}
+
+    Vector2 position;
+    uint32_t color;
+};
+
+static_assert(sizeof(LineVertex) == 12, "LineVertex must stay packed");
+
+// A circle or box to draw, as the renderer records it: one of these per shape,
+// rather than the lines of its outline. The backend expands it, scaling,
+// rotating & moving the outline of a unit circle or box (see below) into place.
+struct ShapeInstance
+{
+    ShapeInstance() {}
+    ShapeInstance(const Vector2& position, const Vector2& size, float rotation, uint32_t color)
+        : position(position), size(size), rotation(rotation), color(color) {}
+
+    Vector2 position;
+    Vector2 size;       // the radius (in both x & y) for circles, the widths for boxes
+    float rotation;
+    uint32_t color;     // see Color::Packed
+};
+
+// Outlines, as lists of lines (pairs of end points), of a circle of radius 1,
+// and a box 1 wide & high, both centered on the origin. The circle's outline
+// is followed by a line from its center to (1, 0), which shows how far it has
+// rolled once rotated.
+static const int CircleSegments = 32;
+static const int CircleOutlineVertices = CircleSegments * 2 + 2;
+static const int BoxOutlineVertices = 8;
+
+inline int OutlineVertices(ShapeType type)
+{
+    return type == ShapeType::Circle ? CircleOutlineVertices : BoxOutlineVertices;
+}
+
+const Vector2* UnitOutline(ShapeType type);
+
+// Expands each shape (all of the given type) into its outline's line end
+// points, OutlineVertices(type) of them per shape, each shape's in turn, into
+// points. Finds each shape's sine & cosine once, then transforms its outline
+// 2 points (4 floats) at a time, writing them out as they're transformed.
+void ExpandShapes(ShapeType type, const ShapeInstance* shapes, size_t count, Vector2* points);
@@ -0,0 +1,153 @@
+#include "Precomp.h"
+#include "DrawList.h"
+
+void DrawList::Reserve(size_t lines, size_t circles, size_t boxes)
+{
+    _lineVertices.reserve(_lineVertices.size() + lines * 2);
+    _circles.reserve(_circles.size() + circles);
+    _boxes.reserve(_boxes.size() + boxes);
+}
+
+void DrawList::Clear()
+{
+    _lineVertices.clear();
+    _circles.clear();
+    _boxes.clear();
+}
+
+LineVertex* DrawList::AppendLines(size_t count)
+{
+    // LineVertex's default constructor doesn't initialize it, so this only
+    // grows the vector
+    size_t first = _lineVertices.size();
+    _lineVertices.resize(first + count * 2);
+    return _lineVertices.data() + first;
+}
+
+void DrawList::AddLines(const Vector2* starts, const Vector2* ends, size_t count, uint32_t color)
+{
+    LineVertex* vertices = AppendLines(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        vertices[i * 2] = LineVertex(starts[i], color);
+        vertices[i * 2 + 1] = LineVertex(ends[i], color);
+    }
+}
+
+void DrawList::AddLines(const LineVertex* vertices, size_t count)
+{
+    _lineVertices.insert(_lineVertices.end(), vertices, vertices + count * 2);
+}
+
+void DrawList::AddCircles(const ShapeInstance* circles, size_t count)
+{
+    _circles.insert(_circles.end(), circles, circles + count);
+}
+
+void DrawList::AddBoxes(const ShapeInstance* boxes, size_t count)
+{
+    _boxes.insert(_boxes.end(), boxes, boxes + count);
+}
+
+void DrawList::Append(const DrawList& other)
+{
+    _lineVertices.insert(_lineVertices.end(), other._lineVertices.begin(), other._lineVertices.end());
+    _circles.insert(_circles.end(), other._circles.begin(), other._circles.end());
+    _boxes.insert(_boxes.end(), other._boxes.begin(), other._boxes.end());
+}
+
+void DrawList::Append(const DrawList& other, const Mark& begin, const Mark& end)
+{
+    _lineVertices.insert(_lineVertices.end(), other._lineVertices.begin() + begin.lineVertices,
+        other._lineVertices.begin() + end.lineVertices);
+    _circles.insert(_circles.end(), other._circles.begin() + begin.circles, other._circles.begin() + end.circles);
+    _boxes.insert(_boxes.end(), other._boxes.begin() + begin.boxes, other._boxes.begin() + end.boxes);
+}
+
+ParallelDrawList::ParallelDrawList()
+    : _directStart(_direct.GetMark())
+    , _section(0)
+    , _parallel(false)
+{
+}
+
+void ParallelDrawList::EndDirectSection()
+{
+    Run run = { _section++, 0, -1, _directStart, _direct.GetMark() };
+    _directRuns.push_back(run);
+    _directStart = run.end;
+}
+
+void ParallelDrawList::BeginParallel(int threadCount)
+{
+    assert(!_parallel && threadCount > 0);
+    EndDirectSection();
+    _parallel = true;
+
+    while (_threads.size() < (size_t)threadCount)
+    {
+        _threads.emplace_back(new ThreadList());
+    }
+}
+
+void ParallelDrawList::EndParallel()
+{
+    assert(_parallel);
+    _parallel = false;
+    ++_section;
+}
+
+DrawList& ParallelDrawList::BeginRun(int thread, size_t first)
+{
+    assert(_parallel && thread >= 0 && thread < (int)_threads.size());
+    ThreadList& threadList = *_threads[thread];
+
+    DrawList::Mark start = threadList.list.GetMark();
+    Run run = { _section, first, thread, start, start };
+    threadList.runs.push_back(run);
+    return threadList.list;
+}
+
+void ParallelDrawList::EndRun(int thread)
+{
+    ThreadList& threadList = *_threads[thread];
+    threadList.runs.back().end = threadList.list.GetMark();
+}
+
+void ParallelDrawList::MergeInto(DrawList& target)
+{
+    assert(!_parallel);
+    EndDirectSection();
+
+    _merging.assign(_directRuns.begin(), _directRuns.end());
+    for (auto& threadList : _threads)
+    {
+        _merging.insert(_merging.end(), threadList->runs.begin(), threadList->runs.end());
+    }
+
+    // (section, first) is unique to each run
+    std::sort(_merging.begin(), _merging.end(), [](const Run& a, const Run& b)
+    {
+        return a.section != b.section ? a.section < b.section : a.first < b.first;
+    });
+
+    for (auto& run : _merging)
+    {
+        const DrawList& list = run.thread < 0 ? _direct : _threads[run.thread]->list;
+        target.Append(list, run.begin, run.end);
+    }
+}
+
+void ParallelDrawList::Clear()
+{
+    assert(!_parallel);
+    _direct.Clear();
+    _directStart = _direct.GetMark();
+    _directRuns.clear();
+    for (auto& threadList : _threads)
+    {
+        threadList->list.Clear();
+        threadList->runs.clear();
+    }
+    _section = 0;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "DrawCommands.h"
+
+// Everything drawn for a frame: lines, as pairs of vertices, and circles &
+// boxes, as a ShapeInstance each. Clearing keeps the capacity, so once a list
+// has grown to fit a frame, recording the next doesn't allocate.
+class DrawList
+{
+public:
+    DrawList() {}
+
+    // Makes room for this many more lines & shapes than are already recorded
+    void Reserve(size_t lines, size_t circles, size_t boxes);
+
+    // Discards everything recorded, keeping the capacity
+    void Clear();
+
+    void AddLine(const Vector2& start, const Vector2& end, uint32_t color)
+    {
+        _lineVertices.push_back(LineVertex(start, color));
+        _lineVertices.push_back(LineVertex(end, color));
+    }
+
+    void AddCircle(const Vector2& position, float radius, float rotation, uint32_t color)
+    {
+        _circles.push_back(ShapeInstance(position, Vector2(radius, radius), rotation, color));
+    }
+
+    void AddBox(const Vector2& position, const Vector2& widths, float rotation, uint32_t color)
+    {
+        _boxes.push_back(ShapeInstance(position, widths, rotation, color));
+    }
+
+    // A point, drawn as a tiny hollow square
+    void AddPoint(const Vector2& position, uint32_t color)
+    {
+        _boxes.push_back(ShapeInstance(position, Vector2(0.2f, 0.2f), 0.0f, color));
+    }
+
+    // Bulk appends. Each grows the list once, then writes straight into it.
+
+    // count lines, from starts[i] to ends[i], all the same color
+    void AddLines(const Vector2* starts, const Vector2* ends, size_t count, uint32_t color);
+
+    // count lines, as pairs of vertices
+    void AddLines(const LineVertex* vertices, size_t count);
+
+    void AddCircles(const ShapeInstance* circles, size_t count);
+    void AddBoxes(const ShapeInstance* boxes, size_t count);
+
+    // Room for count more lines, for the caller to write the vertices of
+    // (2 * count of them) into. The pointer is valid until the list next grows.
+    LineVertex* AppendLines(size_t count);
+
+    // Appends everything in other
+    void Append(const DrawList& other);
+
+    // How much of each kind of thing has been recorded, for marking where a
+    // stretch of recording starts & ends
+    struct Mark
+    {
+        size_t lineVertices;
+        size_t circles;
+        size_t boxes;
+    };
+
+    Mark GetMark() const
+    {
+        Mark mark = { _lineVertices.size(), _circles.size(), _boxes.size() };
+        return mark;
+    }
+
+    // Appends what other recorded between begin & end
+    void Append(const DrawList& other, const Mark& begin, const Mark& end);
+
+    const std::vector<LineVertex>& LineVertices() const { return _lineVertices; }
+    const std::vector<ShapeInstance>& Circles() const { return _circles; }
+    const std::vector<ShapeInstance>& Boxes() const { return _boxes; }
+
+    size_t LineCount() const { return _lineVertices.size() / 2; }
+    bool Empty() const { return _lineVertices.empty() && _circles.empty() && _boxes.empty(); }
+
+private:
+    std::vector<LineVertex> _lineVertices;
+    std::vector<ShapeInstance> _circles;
+    std::vector<ShapeInstance> _boxes;
+
+    // Prevent copy
+    DrawList(const DrawList&);
+    DrawList& operator= (const DrawList&);
+};
+
+// Draw lists for recording a frame from parallel loops. Each thread records
+// into its own DrawList, so they never contend, and each range of a loop is
+// remembered as a run of its thread's list. MergeInto then puts the runs back
+// in order, so the merged frame is the same however the ranges were spread
+// across threads: everything is drawn in the order it would have been by one
+// thread running each loop from start to end.
+//
+// Outside of parallel loops, the thread that owns the lists draws into
+// Direct(). What it draws between loops is kept in order with them.
+class ParallelDrawList
+{
+public:
+    ParallelDrawList();
+
+    DrawList& Direct() { return _direct; }
+
+    // Around each parallel loop, with at most threadCount threads recording
+    void BeginParallel(int threadCount);
+    void EndParallel();
+
+    // Inside the loop, around recording the range of items from first on.
+    // thread is the recording thread's index, in [0, threadCount).
+    DrawList& BeginRun(int thread, size_t first);
+    void EndRun(int thread);
+
+    // Appends everything recorded to target, in order
+    void MergeInto(DrawList& target);
+
+    // Discards everything recorded, keeping the capacity
+    void Clear();
+
+private:
+    // What a run (or stretch of Direct) added to a list, and where it goes
+    // in the frame: by section (each parallel loop, and the direct drawing
+    // between them, is a section), then by the first item of its range
+    struct Run
+    {
+        uint64_t section;
+        uint64_t first;
+        int thread;                 // -1 for Direct
+        DrawList::Mark begin, end;
+    };
+
+    struct ThreadList
+    {
+        DrawList list;
+        std::vector<Run> runs;
+    };
+
+    // Ends the stretch of direct drawing since the last section, as a run
+    void EndDirectSection();
+
+    DrawList _direct;
+    DrawList::Mark _directStart;
+    std::vector<Run> _directRuns;
+    std::vector<std::unique_ptr<ThreadList>> _threads;
+    std::vector<Run> _merging;
+    uint64_t _section;
+    bool _parallel;
+
+    // Prevent copy
+    ParallelDrawList(const ParallelDrawList&);
+    ParallelDrawList& operator= (const ParallelDrawList&);
+};
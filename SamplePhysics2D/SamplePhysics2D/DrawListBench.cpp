@@ -0,0 +1,178 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "DrawList.h"
+#include "Profiling.h"
+#include "SoftwareRenderer.h"
+
+// Records a million lines a frame, as DebugRenderer used to (24 byte vertices
+// with a float color, pushed one at a time), and into a DrawList (12 byte
+// vertices), a line at a time & in bulk. Reports the time for the first frame,
+// which grows the list, and for later ones, which reuse its capacity, along
+// with the bytes recorded (and uploaded to the GPU) per frame, and the rate
+// they're written at. Checks that the bulk appends record the same vertices as
+// adding lines one at a time.
+
+static const int LineCount = 1000000;
+static const int Frames = 10;
+
+// Lines are recorded but never rendered, so the frame's size doesn't matter
+static const uint32_t RecordWidth = 64;
+static const uint32_t RecordHeight = 64;
+
+// DebugRenderer's vertex before it was packed
+struct FloatColorVertex
+{
+    FloatColorVertex(const Vector2& position, const Color& color) : position(position), color(color) {}
+
+    Vector2 position;
+    Color color;
+};
+
+struct LineInputs
+{
+    std::vector<Vector2> starts, ends;
+};
+
+static LineInputs CreateLines()
+{
+    BenchRandom random(41);
+    LineInputs in;
+    in.starts.resize(LineCount);
+    in.ends.resize(LineCount);
+    for (int i = 0; i < LineCount; ++i)
+    {
+        in.starts[i] = Vector2(random.Range(-100.0f, 100.0f), random.Range(-100.0f, 100.0f));
+        in.ends[i] = in.starts[i] + Vector2(random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f));
+    }
+    return in;
+}
+
+struct RecordTimes
+{
+    double firstMs;     // the first frame, growing the list from empty
+    double laterMs;     // the average of the others
+    size_t bytes;       // recorded per frame
+};
+
+// Runs record (which records a frame's lines) for each frame, with clear
+// before each frame but the first
+template <class Record, class Clear>
+static RecordTimes TimeFrames(Record record, Clear clear, size_t vertexSize)
+{
+    RecordTimes times = {};
+    int64_t start = GetProfileTicks();
+    record();
+    times.firstMs = TicksToMilliseconds(GetProfileTicks() - start);
+
+    int64_t ticks = 0;
+    for (int f = 1; f < Frames; ++f)
+    {
+        clear();
+        start = GetProfileTicks();
+        record();
+        ticks += GetProfileTicks() - start;
+    }
+    times.laterMs = TicksToMilliseconds(ticks) / (Frames - 1);
+    times.bytes = (size_t)LineCount * 2 * vertexSize;
+    return times;
+}
+
+static void Report(FILE* output, const char* label, const RecordTimes& times)
+{
+    fprintf(output, "%-30s first %7.2f ms, then %6.2f ms  %5.1f MB/frame  %5.2f GB/s\n", label, times.firstMs,
+        times.laterMs, times.bytes / 1e6, times.bytes / (times.laterMs * 1e6));
+}
+
+bool BenchDrawList(FILE* output)
+{
+    LineInputs in = CreateLines();
+    Color color(0.25f, 0.5f, 1.0f, 1.0f);
+    uint32_t packed = color.Packed();
+    bool succeeded = true;
+
+    fprintf(output, "%d lines a frame, %d frames\n", LineCount, Frames);
+
+    {
+        std::vector<FloatColorVertex> vertices;
+        RecordTimes times = TimeFrames([&]()
+        {
+            for (int i = 0; i < LineCount; ++i)
+            {
+                vertices.push_back(FloatColorVertex(in.starts[i], color));
+                vertices.push_back(FloatColorVertex(in.ends[i], color));
+            }
+        }, [&]() { vertices.clear(); }, sizeof(FloatColorVertex));
+        Report(output, "float color vertices", times);
+    }
+
+    SoftwareRenderer renderer(RecordWidth, RecordHeight);
+    RecordTimes times = TimeFrames([&]()
+    {
+        for (int i = 0; i < LineCount; ++i)
+        {
+            renderer.DrawLine(in.starts[i], in.ends[i], color);
+        }
+    }, [&]() { renderer.Clear(); }, sizeof(LineVertex));
+    Report(output, "DebugDraw::DrawLine", times);
+
+    DrawList single;
+    times = TimeFrames([&]()
+    {
+        for (int i = 0; i < LineCount; ++i)
+        {
+            single.AddLine(in.starts[i], in.ends[i], packed);
+        }
+    }, [&]() { single.Clear(); }, sizeof(LineVertex));
+    Report(output, "DrawList::AddLine", times);
+
+    DrawList bulk;
+    times = TimeFrames([&]()
+    {
+        bulk.AddLines(in.starts.data(), in.ends.data(), LineCount, packed);
+    }, [&]() { bulk.Clear(); }, sizeof(LineVertex));
+    Report(output, "DrawList::AddLines", times);
+
+    // Reserved up front, as a renderer that knows its typical frame would
+    DrawList reserved;
+    reserved.Reserve(LineCount, 0, 0);
+    times = TimeFrames([&]()
+    {
+        reserved.AddLines(in.starts.data(), in.ends.data(), LineCount, packed);
+    }, [&]() { reserved.Clear(); }, sizeof(LineVertex));
+    Report(output, "DrawList::AddLines, reserved", times);
+
+    // Copying a whole list in, as merging lists recorded elsewhere does
+    DrawList copied;
+    times = TimeFrames([&]()
+    {
+        copied.AddLines(bulk.LineVertices().data(), bulk.LineCount());
+    }, [&]() { copied.Clear(); }, sizeof(LineVertex));
+    Report(output, "DrawList::AddLines (vertices)", times);
+
+    fprintf(output, "uploading at 60 frames a second: %.2f GB/s with float colors, %.2f GB/s packed\n",
+        60.0 * LineCount * 2 * sizeof(FloatColorVertex) / 1e9, 60.0 * LineCount * 2 * sizeof(LineVertex) / 1e9);
+
+    const std::vector<LineVertex>& expected = single.LineVertices();
+    const DrawList* lists[] = { &renderer.GetDrawList(), &bulk, &reserved, &copied };
+    for (int i = 0; i < _countof(lists); ++i)
+    {
+        const std::vector<LineVertex>& vertices = lists[i]->LineVertices();
+        if (vertices.size() != expected.size() ||
+            memcmp(vertices.data(), expected.data(), expected.size() * sizeof(LineVertex)) != 0)
+        {
+            fprintf(output, "  list %d recorded different vertices\n", i);
+            succeeded = false;
+        }
+    }
+
+    // Channels round to the nearest of 256 levels, and are clamped
+    uint32_t white = Color(1.0f, 1.0f, 1.0f, 1.0f).Packed();
+    uint32_t clamped = Color(-1.0f, 2.0f, 0.5f, 0.0f).Packed();
+    if (packed != 0xffff8040u || white != 0xffffffffu || clamped != 0x0080ff00u)
+    {
+        fprintf(output, "  colors packed wrong: %08x %08x %08x\n", packed, white, clamped);
+        succeeded = false;
+    }
+
+    return succeeded;
+}
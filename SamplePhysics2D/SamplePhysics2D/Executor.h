@@ -0,0 +1,38 @@
+#pragma once
+
+// Something that can run a loop across several threads. The physics code only
+// ever asks for parallel loops through this, so that a game can hand it the
+// thread pool or job system it already has (by implementing this on top of
+// it) rather than the physics spinning up threads of its own.
+//
+// ThreadPool and JobSystem both implement it.
+class Executor
+{
+public:
+    virtual ~Executor() {}
+
+    // Number of threads loops are spread across (including the caller)
+    virtual int ThreadCount() const = 0;
+
+    // Which of the threads the caller is, in [0, ThreadCount()), for code
+    // running inside a loop to pick out its own per thread scratch space.
+    // Threads running parts of the same loop always get different indices.
+    // Outside of a loop, 0.
+    virtual int CurrentThreadIndex() const = 0;
+
+    // Calls fn(begin, end) for ranges covering [0, count) exactly once, each
+    // no larger than grainSize, and returns once all of them are done. The
+    // calling thread should help out, and ranges may run in any order and on
+    // any thread, so fn must be safe to call concurrently. A loop started from
+    // inside another loop's fn must still complete (running it on the calling
+    // thread is fine).
+    virtual void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& fn) = 0;
+
+protected:
+    Executor() {}
+
+private:
+    // Prevent copy
+    Executor(const Executor&);
+    Executor& operator= (const Executor&);
+};
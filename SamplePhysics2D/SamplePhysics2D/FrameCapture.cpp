@@ -0,0 +1,278 @@
+#include "Precomp.h"
+#include "FrameCapture.h"
+#include "Profiling.h"
+#include "Trace.h"
+
+FrameCapture::FrameCapture(const FrameCaptureSettings& settings)
+    : _settings(settings)
+    , _nextNumber(0)
+    , _flushRequests(0)
+    , _flushesDone(0)
+    , _exiting(false)
+    , _writerPaused(false)
+{
+    assert(settings.path && settings.bufferCount > 0);
+
+    for (int i = 0; i < settings.bufferCount; ++i)
+    {
+        _frames.emplace_back(new Frame());
+        _free.push_back(_frames.back().get());
+    }
+
+    _writer = std::thread(&FrameCapture::WriterMain, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _exiting = true;
+    }
+    _frameQueued.notify_one();
+    _writer.join();
+}
+
+FrameCapture::Frame* FrameCapture::Acquire(uint32_t width, uint32_t height)
+{
+    Frame* frame = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        uint32_t number = _nextNumber++;
+        ++_stats.framesCaptured;
+
+        if (width == 0 || height == 0)
+        {
+            ++_stats.framesDropped;
+            return nullptr;
+        }
+
+        if (_free.empty() && _settings.policy == CapturePolicy::Block)
+        {
+            int64_t start = GetProfileTicks();
+            _frameFreed.wait(lock, [this] { return !_free.empty(); });
+            double ms = TicksToMilliseconds(GetProfileTicks() - start);
+
+            ++_stats.stalls;
+            _stats.stallMs += ms;
+            _stats.maxStallMs = max(_stats.maxStallMs, ms);
+        }
+
+        if (!_free.empty())
+        {
+            frame = _free.back();
+            _free.pop_back();
+        }
+        else if (_settings.policy == CapturePolicy::DropOldest && !_queued.empty())
+        {
+            // The writer hasn't started on this one yet, so it can be taken back
+            frame = _queued.front();
+            _queued.pop_front();
+            ++_stats.framesDropped;
+        }
+        else
+        {
+            // Every buffer is queued or being written
+            ++_stats.framesDropped;
+            return nullptr;
+        }
+
+        frame->number = number;
+    }
+
+    // Outside the lock, as this may allocate (only the first time a buffer
+    // is used at this size, or larger)
+    frame->width = width;
+    frame->height = height;
+    frame->pixels.resize((size_t)width * height * 4);
+    return frame;
+}
+
+void FrameCapture::Submit(Frame* frame)
+{
+    assert(frame);
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (frame->width == 0 || frame->height == 0)
+        {
+            _free.push_back(frame);
+            ++_stats.framesDropped;
+            _frameFreed.notify_all();
+            return;
+        }
+
+        _queued.push_back(frame);
+        _stats.maxQueued = max(_stats.maxQueued, (int)_queued.size());
+    }
+    _frameQueued.notify_one();
+}
+
+bool FrameCapture::Capture(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride)
+{
+    Frame* frame = Acquire(width, height);
+    if (!frame)
+    {
+        return false;
+    }
+
+    size_t rowBytes = (size_t)width * 4;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        memcpy(&frame->pixels[y * rowBytes], pixels + y * stride, rowBytes);
+    }
+
+    Submit(frame);
+    return true;
+}
+
+void FrameCapture::Flush()
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    uint64_t request = ++_flushRequests;
+    _frameQueued.notify_one();
+    _frameFreed.wait(lock, [this, request] { return _flushesDone >= request; });
+}
+
+void FrameCapture::SetWriterPaused(bool paused)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _writerPaused = paused;
+    }
+    _frameQueued.notify_one();
+}
+
+CaptureStats FrameCapture::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _stats;
+}
+
+size_t FrameCapture::WriteImage(const Frame& frame, std::vector<uint8_t>& encoded, double& encodeMs, double& writeMs)
+{
+    // Submit never queues these, but an empty file would be unreadable
+    if (frame.width == 0 || frame.height == 0)
+    {
+        return 0;
+    }
+
+    int64_t start = GetProfileTicks();
+    EncodeImage(_settings.format, frame.pixels.data(), frame.width, frame.height, (size_t)frame.width * 4, encoded);
+    int64_t encodedTicks = GetProfileTicks();
+
+    char name[512];
+    snprintf(name, sizeof(name), _settings.path, frame.number);
+
+    // One write per file
+    FILE* file = fopen(name, "wb");
+    bool written = false;
+    if (file)
+    {
+        written = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+        written &= fclose(file) == 0;
+    }
+    int64_t end = GetProfileTicks();
+
+    encodeMs += TicksToMilliseconds(encodedTicks - start);
+    writeMs += TicksToMilliseconds(end - encodedTicks);
+    return written ? encoded.size() : 0;
+}
+
+void FrameCapture::WriterMain()
+{
+    Tracer::SetThreadName("Frame capture");
+
+    bool raw = _settings.format == ImageFormat::Raw;
+    FILE* rawFile = raw ? fopen(_settings.path, "wb") : nullptr;
+
+    std::vector<Frame*> taken;
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> batch;     // raw frames not yet written
+    uint64_t batchFrames = 0;
+
+    std::unique_lock<std::mutex> lock(_lock);
+    for (;;)
+    {
+        _frameQueued.wait(lock, [this]
+        {
+            return (!_queued.empty() && !_writerPaused) || _exiting || _flushRequests != _flushesDone;
+        });
+
+        // Take everything queued, so the lock isn't held while writing
+        taken.assign(_queued.begin(), _queued.end());
+        _queued.clear();
+        uint64_t flushRequest = _flushRequests;
+        bool finishing = _exiting;
+        lock.unlock();
+
+        CaptureStats done;
+        for (size_t i = 0; i < taken.size(); ++i)
+        {
+            const Frame& frame = *taken[i];
+            if (raw)
+            {
+                int64_t start = GetProfileTicks();
+                batch.insert(batch.end(), frame.pixels.begin(), frame.pixels.end());
+                done.encodeMs += TicksToMilliseconds(GetProfileTicks() - start);
+                ++batchFrames;
+            }
+            else
+            {
+                size_t bytes = WriteImage(frame, encoded, done.encodeMs, done.writeMs);
+                done.bytesWritten += bytes;
+                if (bytes)
+                {
+                    ++done.framesWritten;
+                }
+                else
+                {
+                    ++done.writeErrors;
+                }
+            }
+        }
+
+        // Raw frames are written in batches of at least batchBytes, or whatever
+        // there is when flushing
+        bool flushing = finishing || flushRequest != _flushesDone;
+        if (raw && !batch.empty() && (batch.size() >= _settings.batchBytes || flushing))
+        {
+            int64_t start = GetProfileTicks();
+            bool ok = rawFile && fwrite(batch.data(), 1, batch.size(), rawFile) == batch.size();
+            ok = ok && (!flushing || fflush(rawFile) == 0);
+            done.writeMs += TicksToMilliseconds(GetProfileTicks() - start);
+
+            if (ok)
+            {
+                done.bytesWritten += batch.size();
+                done.framesWritten += batchFrames;
+            }
+            else
+            {
+                ++done.writeErrors;
+            }
+            batch.clear();
+            batchFrames = 0;
+        }
+
+        // The buffers are all freed together, rather than taking the lock for each
+        lock.lock();
+        _free.insert(_free.end(), taken.begin(), taken.end());
+        _stats.framesWritten += done.framesWritten;
+        _stats.writeErrors += done.writeErrors;
+        _stats.bytesWritten += done.bytesWritten;
+        _stats.encodeMs += done.encodeMs;
+        _stats.writeMs += done.writeMs;
+        _flushesDone = flushRequest;
+        _frameFreed.notify_all();
+
+        if (finishing && _queued.empty())
+        {
+            break;
+        }
+    }
+    lock.unlock();
+
+    if (rawFile)
+    {
+        fclose(rawFile);
+    }
+}
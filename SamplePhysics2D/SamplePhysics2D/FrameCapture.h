@@ -0,0 +1,138 @@
+#pragma once
+
+#include "ImageWriter.h"
+
+// What FrameCapture does when a frame is captured while every one of its
+// buffers is still waiting to be written
+enum class CapturePolicy
+{
+    DropNewest = 0,     // skip the new frame
+    DropOldest,         // reuse the buffer of the oldest frame not yet being written
+    Block,              // wait for the writer to free a buffer (backpressure)
+};
+
+struct FrameCaptureSettings
+{
+    FrameCaptureSettings()
+        : path("frame_%06u.png")
+        , format(ImageFormat::Png)
+        , policy(CapturePolicy::DropNewest)
+        , bufferCount(8)
+        , batchBytes(8 << 20)
+    {}
+
+    // For PPM & PNG, a printf pattern for each frame's file name, given the
+    // frame number (for instance "capture/frame_%06u.png"). Raw frames are all
+    // appended, back to back, to the single file named by path. The string
+    // must outlive the capture.
+    const char* path;
+
+    ImageFormat format;
+    CapturePolicy policy;
+
+    // Frames that can be waiting to be written at once. Each buffer holds a
+    // whole frame, and they're all allocated up front.
+    int bufferCount;
+
+    // Raw frames are collected until there's at least this much to write,
+    // then written with one call
+    size_t batchBytes;
+};
+
+// Counters since the capture was created
+struct CaptureStats
+{
+    CaptureStats()
+        : framesCaptured(0), framesWritten(0), framesDropped(0), writeErrors(0), stalls(0), maxQueued(0)
+        , bytesWritten(0), stallMs(0), maxStallMs(0), encodeMs(0), writeMs(0)
+    {}
+
+    uint64_t framesCaptured;    // frames handed to Capture / Acquire
+    uint64_t framesWritten;
+    uint64_t framesDropped;     // by DropNewest or DropOldest, with no free buffer, or empty
+    uint64_t writeErrors;       // frames (or raw batches) that couldn't be written
+    uint64_t stalls;            // times Block made the capturing thread wait
+    int maxQueued;              // most frames ever waiting at once
+    uint64_t bytesWritten;
+    double stallMs;             // total time the capturing thread spent waiting
+    double maxStallMs;          // longest single wait
+    double encodeMs;            // time the writer spent encoding
+    double writeMs;             // and writing
+};
+
+// Writes frames out as an image sequence (or raw stream) on a background
+// thread, so that the thread rendering them never waits on encoding or the
+// disk (unless the policy is Block, and the writer falls behind).
+//
+// Frames go through a fixed set of buffers. The capturing thread fills a free
+// buffer & queues it; the writer takes everything queued at once, encodes it,
+// writes it, and frees the buffers again. Frames are numbered in the order
+// they're captured, dropped ones included, so gaps in the file names show
+// where frames were dropped.
+class FrameCapture
+{
+public:
+    struct Frame
+    {
+        uint32_t width, height;
+        uint32_t number;
+        std::vector<uint8_t> pixels;    // RGBA, 8 bits a channel, rows width * 4 bytes apart, top row first
+    };
+
+    explicit FrameCapture(const FrameCaptureSettings& settings);
+
+    // Writes out everything still queued before returning
+    ~FrameCapture();
+
+    // Returns a buffer to render the next frame into, sized for width x height,
+    // or nullptr if the frame is dropped. Empty frames (width or height 0, say
+    // from a minimized window) are always dropped. Every buffer returned must
+    // be passed to Submit, once filled in.
+    Frame* Acquire(uint32_t width, uint32_t height);
+
+    // Queues the frame for writing. A frame whose size has been changed to
+    // empty since it was acquired is dropped instead, freeing its buffer.
+    void Submit(Frame* frame);
+
+    // Acquires, copies pixels (RGBA rows, stride bytes apart) in & submits.
+    // Returns false if the frame was dropped (or empty).
+    bool Capture(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride);
+
+    // Waits until everything submitted so far has been written
+    void Flush();
+
+    // While paused, the writer leaves queued frames alone (after finishing
+    // any it has already taken), so the buffers fill up & the policy kicks
+    // in. Flush & the destructor still write everything out.
+    void SetWriterPaused(bool paused);
+
+    CaptureStats GetStats() const;
+
+private:
+    void WriterMain();
+
+    // Encodes & writes one image file, on the writer thread. Returns the
+    // bytes written, or 0 if it couldn't be written.
+    size_t WriteImage(const Frame& frame, std::vector<uint8_t>& encoded, double& encodeMs, double& writeMs);
+
+    FrameCaptureSettings _settings;
+
+    std::vector<std::unique_ptr<Frame>> _frames;
+    std::vector<Frame*> _free;
+    std::deque<Frame*> _queued;
+    uint32_t _nextNumber;
+    uint64_t _flushRequests;            // bumped by each Flush
+    uint64_t _flushesDone;              // the last request the writer has finished
+    bool _exiting;
+    bool _writerPaused;
+    CaptureStats _stats;
+
+    mutable std::mutex _lock;
+    std::condition_variable _frameQueued;
+    std::condition_variable _frameFreed;     // also signalled when a flush is done
+    std::thread _writer;
+
+    // Prevent copy
+    FrameCapture(const FrameCapture&);
+    FrameCapture& operator= (const FrameCapture&);
+};
@@ -0,0 +1,220 @@
+#include "Precomp.h"
+#include "ImageWriter.h"
+
+const char* ImageExtension(ImageFormat format)
+{
+    switch (format)
+    {
+    case ImageFormat::Ppm: return "ppm";
+    case ImageFormat::Png: return "png";
+    case ImageFormat::Raw: return "raw";
+    default: assert(false); return "";
+    }
+}
+
+static void Append(std::vector<uint8_t>& output, const void* data, size_t size)
+{
+    output.insert(std::end(output), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+static void AppendBigEndian(std::vector<uint8_t>& output, uint32_t value)
+{
+    uint8_t bytes[] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+    Append(output, bytes, sizeof(bytes));
+}
+
+static void EncodePpm(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, std::vector<uint8_t>& output)
+{
+    char header[64];
+    int headerSize = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+    output.resize(headerSize + (size_t)width * height * 3);
+    memcpy(output.data(), header, headerSize);
+
+    uint8_t* out = output.data() + headerSize;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* row = pixels + y * stride;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            out[0] = row[0];
+            out[1] = row[1];
+            out[2] = row[2];
+            out += 3;
+            row += 4;
+        }
+    }
+}
+
+// CRC-32 (as zlib & PNG use it), four bytes at a time ("slicing by 4"):
+// table[k][b] is the CRC of byte b followed by k zero bytes
+static uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    static uint32_t table[4][256];
+    static std::once_flag tableBuilt;
+    std::call_once(tableBuilt, []()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            for (int k = 1; k < 4; ++k)
+            {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    });
+
+    crc = ~crc;
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        crc ^= (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) | ((uint32_t)data[i + 2] << 16) | ((uint32_t)data[i + 3] << 24);
+        crc = table[3][crc & 0xFF] ^ table[2][(crc >> 8) & 0xFF] ^ table[1][(crc >> 16) & 0xFF] ^ table[0][crc >> 24];
+    }
+    for (; i < size; ++i)
+    {
+        crc = table[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Appends a PNG chunk: length, type, data & the CRC of the type & data
+static void AppendPngChunk(std::vector<uint8_t>& output, const char* type, const uint8_t* data, size_t size)
+{
+    AppendBigEndian(output, (uint32_t)size);
+    size_t crcStart = output.size();
+    Append(output, type, 4);
+    Append(output, data, size);
+    AppendBigEndian(output, Crc32(0, output.data() + crcStart, output.size() - crcStart));
+}
+
+// PNG's pixel data is a zlib stream. Rather than compressing, the rows (each
+// preceded by a filter type byte of 0, for none) go in deflate's stored
+// blocks, which just copy up to 65535 bytes through at a time.
+static void EncodePng(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, std::vector<uint8_t>& output)
+{
+    static const uint8_t Signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static const size_t MaxStoredBlock = 65535;
+
+    size_t rowSize = (size_t)width * 4 + 1;
+    size_t rawSize = rowSize * height;
+    size_t blockCount = max((rawSize + MaxStoredBlock - 1) / MaxStoredBlock, (size_t)1);
+    size_t idatSize = 2 + rawSize + blockCount * 5 + 4;
+
+    output.clear();
+    output.reserve(sizeof(Signature) + 25 + 12 + idatSize + 12);
+    Append(output, Signature, sizeof(Signature));
+
+    uint8_t header[13] = {};
+    header[0] = (uint8_t)(width >> 24); header[1] = (uint8_t)(width >> 16); header[2] = (uint8_t)(width >> 8); header[3] = (uint8_t)width;
+    header[4] = (uint8_t)(height >> 24); header[5] = (uint8_t)(height >> 16); header[6] = (uint8_t)(height >> 8); header[7] = (uint8_t)height;
+    header[8] = 8;      // bits per channel
+    header[9] = 6;      // RGBA
+    AppendPngChunk(output, "IHDR", header, sizeof(header));
+
+    // The IDAT chunk is built in place: length, type, then the zlib stream
+    AppendBigEndian(output, (uint32_t)idatSize);
+    size_t crcStart = output.size();
+    Append(output, "IDAT", 4);
+
+    static const uint8_t ZlibHeader[] = { 0x78, 0x01 };
+    Append(output, ZlibHeader, sizeof(ZlibHeader));
+
+    // Adler-32 of the uncompressed data, kept as we go
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t blockLeft = 0;
+    size_t rawLeft = rawSize;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* row = pixels + y * stride;
+        for (size_t i = 0; i < rowSize; )
+        {
+            if (blockLeft == 0)
+            {
+                blockLeft = min(rawLeft, MaxStoredBlock);
+                uint8_t blockHeader[] =
+                {
+                    (uint8_t)(blockLeft == rawLeft ? 1 : 0),
+                    (uint8_t)blockLeft, (uint8_t)(blockLeft >> 8),
+                    (uint8_t)~blockLeft, (uint8_t)(~blockLeft >> 8),
+                };
+                Append(output, blockHeader, sizeof(blockHeader));
+            }
+
+            // The filter byte, or as much of the row as fits in the block
+            const uint8_t none = 0;
+            const uint8_t* data = i == 0 ? &none : row + (i - 1);
+            size_t size = i == 0 ? 1 : min(rowSize - i, blockLeft);
+            Append(output, data, size);
+
+            // Reduced at least every 5552 bytes, before adlerB can overflow
+            for (size_t k = 0; k < size; )
+            {
+                size_t end = min(k + 5552, size);
+                for (; k < end; ++k)
+                {
+                    adlerA += data[k];
+                    adlerB += adlerA;
+                }
+                adlerA %= 65521;
+                adlerB %= 65521;
+            }
+
+            i += size;
+            blockLeft -= size;
+            rawLeft -= size;
+        }
+    }
+    AppendBigEndian(output, (adlerB << 16) | adlerA);
+
+    AppendBigEndian(output, Crc32(0, output.data() + crcStart, output.size() - crcStart));
+    AppendPngChunk(output, "IEND", nullptr, 0);
+}
+
+static void EncodeRaw(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, std::vector<uint8_t>& output)
+{
+    size_t rowSize = (size_t)width * 4;
+    output.resize(rowSize * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        memcpy(output.data() + y * rowSize, pixels + y * stride, rowSize);
+    }
+}
+
+void EncodeImage(ImageFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride,
+    std::vector<uint8_t>& output)
+{
+    switch (format)
+    {
+    case ImageFormat::Ppm: EncodePpm(pixels, width, height, stride, output); break;
+    case ImageFormat::Png: EncodePng(pixels, width, height, stride, output); break;
+    case ImageFormat::Raw: EncodeRaw(pixels, width, height, stride, output); break;
+    default: assert(false); output.clear(); break;
+    }
+}
+
+bool WriteImageFile(const char* path, ImageFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride)
+{
+    if (width == 0 || height == 0)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> encoded;
+    EncodeImage(format, pixels, width, height, stride, encoded);
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool written = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+    return (fclose(file) == 0) && written;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Image file formats frames can be written in
+enum class ImageFormat
+{
+    Ppm = 0,    // binary PPM (P6): RGB, 8 bits a channel. Alpha is dropped.
+    Png,        // RGBA, 8 bits a channel, stored uncompressed (fast to write, big on disk)
+    Raw,        // just the RGBA pixels, row after row, with no header
+};
+
+// File extension for the format, without the dot
+const char* ImageExtension(ImageFormat format);
+
+// Encodes width x height RGBA pixels (8 bits a channel, rows stride bytes
+// apart, top row first) in the given format, replacing the contents of output.
+// output keeps its capacity, so reusing one for every frame doesn't allocate.
+void EncodeImage(ImageFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride,
+    std::vector<uint8_t>& output);
+
+// Encodes & writes the image to path. Returns false if it couldn't be
+// written, or if it's empty (width or height 0), which nothing can open.
+bool WriteImageFile(const char* path, ImageFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride);
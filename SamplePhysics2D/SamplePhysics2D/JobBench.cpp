@@ -0,0 +1,220 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+#include "JobSystem.h"
+
+// Steps the same scenes with Update's stages run on the calling thread only,
+// on a ThreadPool, and on a JobSystem, on increasing numbers of threads and
+// with a few grain sizes. Reports the time per step (total, finding pairs &
+// solving), and checks that every configuration ends up bit identical to the
+// single threaded run.
+//
+// Two scenes: one big pile (a single island, so the solver can't be split
+// up), and many separate short stacks (lots of small islands).
+//
+// Then times the narrowphase alone, over a heap of bodies dropped on top of
+// each other (over 100k candidate pairs), on increasing numbers of threads.
+
+static const int Steps = 100;
+static const float Dt = 1.0f / 60.0f;
+
+struct JobScene
+{
+    const char* name;
+    int bodyCount;  // for the pile
+    int stackCount; // for the stacks (if not 0)
+};
+
+struct JobResult
+{
+    double stepMs;
+    double pairsMs;
+    double solveMs;
+    int islands;
+    uint64_t hash;
+};
+
+static JobResult RunScene(const JobScene& scene, Executor* executor, const PhysicsWorld::GrainSizes& grainSizes)
+{
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 20);
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    if (scene.stackCount > 0)
+    {
+        CreateBenchStacks(&world, bodies, scene.stackCount, 5, 5);
+    }
+    else
+    {
+        CreateBenchScene(&world, bodies, scene.bodyCount, 3);
+    }
+
+    world.SetExecutor(executor);
+    world.SetGrainSizes(grainSizes);
+
+    JobResult result = {};
+    int64_t start = GetProfileTicks();
+    for (int step = 0; step < Steps; ++step)
+    {
+        world.Update(Dt);
+        result.pairsMs += world.GetStepStats().updatePairsMs;
+        result.solveMs += world.GetStepStats().solveMs;
+    }
+    result.stepMs = TicksToMilliseconds(GetProfileTicks() - start) / Steps;
+    result.pairsMs /= Steps;
+    result.solveMs /= Steps;
+    result.islands = world.GetStepStats().islands;
+    result.hash = world.ComputeStateHash();
+    return result;
+}
+
+static bool Report(FILE* output, const char* label, const JobResult& result, const JobResult& reference)
+{
+    fprintf(output, "%-24s %8.3f ms/step  (pairs %7.3f, solve %7.3f)  %5d islands  %5.2fx\n",
+        label, result.stepMs, result.pairsMs, result.solveMs, result.islands, reference.stepMs / result.stepMs);
+
+    if (result.hash != reference.hash)
+    {
+        fprintf(output, "  state diverged from the single threaded run\n");
+        return false;
+    }
+    return true;
+}
+
+// Bodies scattered over a small area, so that most of them overlap
+static void CreateHeap(PhysicsWorld* world, std::vector<std::unique_ptr<RigidBody>>& bodies, int count)
+{
+    BenchRandom random(17);
+    for (int i = 0; i < count; ++i)
+    {
+        RigidBody* body;
+        if (random.Next() % 2 == 0)
+        {
+            body = new RigidBody(new CircleShape(random.Range(0.8f, 1.2f)), 5.0f);
+        }
+        else
+        {
+            body = new RigidBody(new BoxShape(random.Range(1.6f, 2.4f), random.Range(1.6f, 2.4f)), 5.0f);
+        }
+        body->Position() = Vector2(random.Range(-6.0f, 6.0f), random.Range(-6.0f, 6.0f));
+        body->Rotation() = random.Range(-3.0f, 3.0f);
+        bodies.push_back(std::unique_ptr<RigidBody>(body));
+        world->AddBody(body);
+    }
+}
+
+static bool BenchNarrowphaseScaling(FILE* output, const std::vector<int>& threadCounts)
+{
+    static const int HeapSize = 1500;
+    static const int Repeats = 10;
+
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 20);
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    CreateHeap(&world, bodies, HeapSize);
+
+    std::vector<uint8_t> initialState;
+    world.SaveState(initialState);
+
+    bool succeeded = true;
+    uint64_t referenceHash = 0;
+    double singleThreadMs = 0;
+    for (auto& threads : threadCounts)
+    {
+        JobSystem jobs(threads);
+        world.SetExecutor(&jobs);
+
+        // Each repeat steps from the same starting state
+        double narrowphaseMs = 0;
+        for (int i = 0; i < Repeats; ++i)
+        {
+            world.LoadState(initialState.data(), initialState.size());
+            world.Update(Dt);
+            narrowphaseMs += world.GetStepStats().narrowphaseMs;
+        }
+        narrowphaseMs /= Repeats;
+
+        if (threads == threadCounts.front())
+        {
+            fprintf(output, "-- narrowphase, %d bodies, %d candidate pairs, %d in contact --\n",
+                HeapSize, world.GetStepStats().pairsTested, world.GetStepStats().pairsColliding);
+            referenceHash = world.ComputeStateHash();
+            singleThreadMs = narrowphaseMs;
+        }
+        fprintf(output, "%2d threads %8.3f ms (%.2fx)\n", threads, narrowphaseMs, singleThreadMs / narrowphaseMs);
+
+        if (world.ComputeStateHash() != referenceHash)
+        {
+            fprintf(output, "  state diverged from the single threaded run\n");
+            succeeded = false;
+        }
+
+        world.SetExecutor(nullptr);
+    }
+
+    return succeeded;
+}
+
+bool BenchJobs(FILE* output)
+{
+    static const JobScene Scenes[] =
+    {
+        { "pile", 1000, 0 },
+        { "stacks", 0, 200 },
+    };
+
+    // One thread, then doubling up to every hardware thread (and at least 4,
+    // so that the threaded paths always get exercised)
+    std::vector<int> threadCounts;
+    int hardwareThreads = max((int)std::thread::hardware_concurrency(), 4);
+    for (int threads = 1; threads < hardwareThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    bool succeeded = true;
+    for (int i = 0; i < _countof(Scenes); ++i)
+    {
+        fprintf(output, "-- %s, %d steps --\n", Scenes[i].name, Steps);
+
+        PhysicsWorld::GrainSizes defaultGrains;
+        JobResult reference = RunScene(Scenes[i], nullptr, defaultGrains);
+        succeeded &= Report(output, "no executor", reference, reference);
+
+        char label[64];
+        for (auto& threads : threadCounts)
+        {
+            ThreadPool pool(threads - 1);
+            snprintf(label, sizeof(label), "thread pool, %d threads", threads);
+            succeeded &= Report(output, label, RunScene(Scenes[i], &pool, defaultGrains), reference);
+        }
+
+        for (auto& threads : threadCounts)
+        {
+            JobSystem jobs(threads);
+            snprintf(label, sizeof(label), "job system, %d threads", threads);
+            succeeded &= Report(output, label, RunScene(Scenes[i], &jobs, defaultGrains), reference);
+            fprintf(output, "  %llu steals\n", (unsigned long long)jobs.StealCount());
+        }
+
+        // Grain sizes, on the most threads
+        static const size_t BodyGrains[] = { 8, 32, 128, 512 };
+        for (int g = 0; g < _countof(BodyGrains); ++g)
+        {
+            PhysicsWorld::GrainSizes grains;
+            grains.bodies = BodyGrains[g];
+            grains.pairs = BodyGrains[g] * 4;
+            grains.islands = max(BodyGrains[g] / 16, (size_t)1);
+
+            JobSystem jobs(threadCounts.back());
+            snprintf(label, sizeof(label), "job system, grain %u", (uint32_t)BodyGrains[g]);
+            succeeded &= Report(output, label, RunScene(Scenes[i], &jobs, grains), reference);
+        }
+    }
+
+    succeeded &= BenchNarrowphaseScaling(output, threadCounts);
+
+    return succeeded;
+}
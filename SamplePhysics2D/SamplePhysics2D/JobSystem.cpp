@@ -0,0 +1,202 @@
+#include "Precomp.h"
+#include "JobSystem.h"
+#include "Trace.h"
+
+// The JobSystem whose loop this thread is running part of (if any), and which
+// of its threads this is. Loops started from inside one of the same JobSystem's
+// loops run inline, rather than waiting on the loop they're part of.
+static thread_local const JobSystem* t_owner = nullptr;
+static thread_local int t_threadIndex = 0;
+
+JobSystem::JobSystem(int threadCount)
+    : _generation(0)
+    , _busyWorkers(0)
+    , _exiting(false)
+    , _fn(nullptr)
+    , _grainSize(1)
+    , _remaining(0)
+    , _steals(0)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = max((int)std::thread::hardware_concurrency(), 1);
+    }
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        _queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+
+    for (int i = 1; i < threadCount; ++i)
+    {
+        _workers.push_back(std::thread([this, i]() { WorkerMain(i); }));
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _exiting = true;
+    }
+    _workReady.notify_all();
+
+    for (auto& worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+int JobSystem::CurrentThreadIndex() const
+{
+    return t_owner == this ? t_threadIndex : 0;
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grainSize = max(grainSize, (size_t)1);
+
+    // Not worth waking anyone for a single range, and loops nested inside
+    // another can't wait for the threads running the outer loop
+    if (_workers.empty() || count <= grainSize || t_owner == this)
+    {
+        for (size_t begin = 0; begin < count; begin += grainSize)
+        {
+            fn(begin, min(begin + grainSize, count));
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock(_submitLock);
+
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _fn = &fn;
+        _grainSize = grainSize;
+        _remaining = count;
+        _busyWorkers = (int)_workers.size();
+        ++_generation;
+    }
+
+    // The whole loop starts out in the caller's queue. Workers steal halves
+    // of it as they wake up.
+    {
+        std::lock_guard<std::mutex> lock(_queues[0]->lock);
+        Range all = { 0, count };
+        _queues[0]->ranges.push_back(all);
+    }
+    _workReady.notify_all();
+
+    const JobSystem* outerOwner = t_owner;
+    int outerThreadIndex = t_threadIndex;
+    t_owner = this;
+    t_threadIndex = 0;
+    RunTasks(0);
+    t_owner = outerOwner;
+    t_threadIndex = outerThreadIndex;
+
+    // Wait for the workers to notice the loop has finished
+    std::unique_lock<std::mutex> lock(_lock);
+    _workDone.wait(lock, [this]() { return _busyWorkers == 0; });
+    _fn = nullptr;
+}
+
+void JobSystem::RunTasks(int index)
+{
+    WorkQueue& queue = *_queues[index];
+
+    while (_remaining > 0)
+    {
+        Range range;
+        if (!TakeRange(index, range))
+        {
+            // Everything left is already being run
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Split off the upper half until what's left is small enough to run,
+        // leaving the halves for this thread to come back to, or for others to steal
+        while (range.end - range.begin > _grainSize)
+        {
+            Range upper = { range.begin + (range.end - range.begin) / 2, range.end };
+            range.end = upper.begin;
+
+            std::lock_guard<std::mutex> lock(queue.lock);
+            queue.ranges.push_back(upper);
+        }
+
+        (*_fn)(range.begin, range.end);
+        _remaining -= range.end - range.begin;
+    }
+}
+
+bool JobSystem::TakeRange(int index, Range& range)
+{
+    // Own queue first, newest range (which was split off what this thread
+    // just ran, so its data is likely still in cache)
+    {
+        WorkQueue& queue = *_queues[index];
+        std::lock_guard<std::mutex> lock(queue.lock);
+        if (!queue.ranges.empty())
+        {
+            range = queue.ranges.back();
+            queue.ranges.pop_back();
+            return true;
+        }
+    }
+
+    // Then steal the oldest range from the next thread along that has any
+    int queueCount = (int)_queues.size();
+    for (int i = 1; i < queueCount; ++i)
+    {
+        WorkQueue& victim = *_queues[(index + i) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.ranges.empty())
+        {
+            range = victim.ranges.front();
+            victim.ranges.pop_front();
+            ++_steals;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::WorkerMain(int index)
+{
+    Tracer::SetThreadName("Job Worker");
+    t_owner = this;
+    t_threadIndex = index;
+
+    uint64_t lastGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            _workReady.wait(lock, [this, lastGeneration]() { return _exiting || _generation != lastGeneration; });
+            if (_exiting)
+            {
+                return;
+            }
+            lastGeneration = _generation;
+        }
+
+        {
+            TRACE_SCOPE("JobSystem::ParallelFor");
+            RunTasks(index);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            --_busyWorkers;
+        }
+        _workDone.notify_one();
+    }
+}
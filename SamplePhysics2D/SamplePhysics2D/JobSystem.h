@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Executor.h"
+
+// Work stealing scheduler for parallel loops. Each thread has its own queue of
+// ranges. A thread takes the most recently queued range from its own queue,
+// and splits it in half (queueing the upper half) until it's down to the grain
+// size, then runs it. A thread whose queue is empty steals the oldest (and so
+// largest) range from another's.
+//
+// This balances loops whose iterations vary a lot in cost (such as finding
+// each body's contacts, or solving islands of very different sizes) far
+// better than handing out fixed chunks, while threads mostly work on ranges
+// next to the ones they just ran.
+//
+// Like ThreadPool, the calling thread joins in, and only one loop runs at a
+// time. Loops started from inside one of its running loops run on the calling
+// thread.
+class JobSystem : public Executor
+{
+public:
+    // Creates threadCount - 1 worker threads (the caller makes up the last
+    // one). By default, one thread per hardware thread.
+    explicit JobSystem(int threadCount = -1);
+    ~JobSystem();
+
+    int ThreadCount() const override { return (int)_queues.size(); }
+    int CurrentThreadIndex() const override;
+
+    void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& fn) override;
+
+    // Number of ranges taken from another thread's queue, since creation
+    uint64_t StealCount() const { return _steals; }
+
+private:
+    struct Range
+    {
+        size_t begin, end;
+    };
+
+    // The owner pushes & pops at the back, thieves take from the front
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<Range> ranges;
+    };
+
+    void WorkerMain(int index);
+
+    // Runs ranges of the current loop, as thread index, until it's finished
+    void RunTasks(int index);
+
+    // Takes the next range for thread index to run, from its own queue or
+    // someone else's. Returns false if every queue is empty.
+    bool TakeRange(int index, Range& range);
+
+    std::vector<std::unique_ptr<WorkQueue>> _queues;    // _queues[0] is the caller's
+    std::vector<std::thread> _workers;                  // _workers[i] owns _queues[i + 1]
+
+    std::mutex _submitLock;             // held for the duration of a loop
+    std::mutex _lock;
+    std::condition_variable _workReady;
+    std::condition_variable _workDone;
+    uint64_t _generation;               // bumped for each new loop
+    int _busyWorkers;                   // workers yet to finish the current loop
+    bool _exiting;
+
+    // The current loop
+    const std::function<void(size_t, size_t)>* _fn;
+    size_t _grainSize;
+    std::atomic<size_t> _remaining;     // iterations not yet run
+    std::atomic<uint64_t> _steals;
+
+    // Prevent copy
+    JobSystem(const JobSystem&);
+    JobSystem& operator= (const JobSystem&);
+};
@@ -0,0 +1,85 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "Broadphase.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+// Carries a row of boxes up & down (and side to side) on a kinematic platform.
+// Checks the platform follows exactly the velocities it's given, without
+// being pushed around by what it's carrying, and that the boxes ride on top
+// of it rather than sinking into it.
+
+static const int BoxCount = 40;
+static const int SettleSteps = 60;
+static const int Steps = 600;
+static const float Dt = 1.0f / 60.0f;
+
+bool BenchKinematic(FILE* output)
+{
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 10);
+
+    RigidBody* platform = new RigidBody(new BoxShape((float)BoxCount + 2.0f, 1.0f), 100.0f);
+    platform->MakeKinematic();
+    bodies.push_back(std::unique_ptr<RigidBody>(platform));
+    world.AddBody(platform);
+
+    for (int i = 0; i < BoxCount; ++i)
+    {
+        RigidBody* body = new RigidBody(new BoxShape(0.9f, 0.9f), 5.0f);
+        body->Position() = Vector2(i - 0.5f * BoxCount + 0.5f, 0.95f);
+        bodies.push_back(std::unique_ptr<RigidBody>(body));
+        world.AddBody(body);
+    }
+
+    for (int i = 0; i < SettleSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+
+    Vector2 expectedPosition = platform->Position();
+    bool followedVelocity = true;
+    float maxPenetration = 0.0f;
+    int proxiesUpdated = 0;
+    double stepMs = 0;
+
+    for (int i = 0; i < Steps; ++i)
+    {
+        // Bob up & down, and sway a little
+        float t = i * Dt;
+        Vector2 velocity(0.5f * cosf(1.3f * t), 2.0f * cosf(2.0f * t));
+        platform->LinearVelocity() = velocity;
+
+        int64_t start = GetProfileTicks();
+        world.Update(Dt);
+        stepMs += TicksToMilliseconds(GetProfileTicks() - start);
+        proxiesUpdated += world.GetStepStats().proxiesUpdated;
+
+        expectedPosition += Dt * velocity;
+        if (platform->LinearVelocity().x != velocity.x || platform->LinearVelocity().y != velocity.y ||
+            platform->Position().x != expectedPosition.x || platform->Position().y != expectedPosition.y ||
+            platform->Rotation() != 0.0f)
+        {
+            followedVelocity = false;
+        }
+
+        float platformTop = ComputeAABB(platform).upper.y;
+        for (size_t j = 1; j < bodies.size(); ++j)
+        {
+            maxPenetration = max(maxPenetration, platformTop - ComputeAABB(bodies[j].get()).lower.y);
+        }
+    }
+
+    fprintf(output, "%d boxes on a kinematic platform, %d steps\n", BoxCount, Steps);
+    fprintf(output, "Step                %8.3f ms\n", stepMs / Steps);
+    fprintf(output, "Proxy refits        %8d (%.2f per step)\n", proxiesUpdated, (double)proxiesUpdated / Steps);
+    fprintf(output, "Max penetration     %8.4f\n", maxPenetration);
+    fprintf(output, "Platform followed its velocity exactly: %s\n", followedVelocity ? "yes" : "NO");
+
+    // Penetration is only corrected gradually, so while the platform is
+    // accelerating upwards boxes sink in by a few frames of its motion
+    static const float MaxAllowedPenetration = 0.15f;
+    return followedVelocity && maxPenetration < MaxAllowedPenetration;
+}
@@ -1,8 +1,16 @@
 #include "Precomp.h"
-#include "DebugRenderer.h"
+#include "Benchmarks.h"
+#include "FrameCapture.h"
 #include "PhysicsWorld.h"
 #include "RigidBody.h"
-#include "Shape.h"
+#include "SampleScene.h"
+#include "SoftwareRenderer.h"
+#include "Trace.h"
+
+#include <string>
+
+#ifdef _WIN32
+#include "DebugRenderer.h"
 
 // Name used to register our window class, and set our window title.
 static const wchar_t AppClassName[] = L"SamplePhysics2D";
@@ -12,10 +20,63 @@ static HWND AppInitialize(HINSTANCE instance, int width, int height);
 
 // Application window message processing callback
 static LRESULT CALLBACK AppWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+#endif
+
+// Fills the world with the sample's scene (see CreateSampleScene)
+static void CreateScene(PhysicsWorld* world, std::vector<std::unique_ptr<RigidBody>>& bodies);
+
+// How a headless run goes, read from the command line:
+//   -frames N        frames to run (600, 10 seconds at 60 Hz)
+//   -format F        ppm, png or raw to write every frame out, none (the
+//                    default) to only simulate & render them
+//   -output DIR      existing directory to write frames to (the current one).
+//                    Images are DIR/frame_000000.png, ..., raw frames all go
+//                    to DIR/frames.raw.
+struct HeadlessOptions
+{
+    HeadlessOptions() : frameCount(600), writeFrames(false), format(ImageFormat::Png), directory(".") {}
+
+    int frameCount;
+    bool writeFrames;
+    ImageFormat format;
+    std::string directory;
+};
 
+// Reads the headless options from the command line. Returns false (having
+// reported why) if any are malformed.
+static bool ParseHeadlessOptions(const char* commandLine, HeadlessOptions& options);
+
+// Runs the scene without a window (or GPU), rendering each frame on the CPU,
+// and writes them out if asked to. Returns false if any couldn't be written.
+static bool RunHeadless(PhysicsWorld* world, const HeadlessOptions& options);
+
+#ifdef _WIN32
 // Main entry point
-int WINAPI WinMain(HINSTANCE instance, HINSTANCE, LPSTR, int)
+int WINAPI WinMain(HINSTANCE instance, HINSTANCE, LPSTR commandLine, int)
 {
+    // Run headless benchmarks instead, if asked to
+    if (strstr(commandLine, "-bench"))
+    {
+        return RunBenchmarks(commandLine) ? 0 : -3;
+    }
+
+    // Create a physics world object to run our simulation
+    std::unique_ptr<PhysicsWorld> world(new PhysicsWorld(Vector2(0.0f, -20.0f), 100));
+
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    CreateScene(world.get(), bodies);
+
+    // Or run it without a window, if asked to
+    if (strstr(commandLine, "-headless"))
+    {
+        HeadlessOptions options;
+        if (!ParseHeadlessOptions(commandLine, options))
+        {
+            return -4;
+        }
+        return RunHeadless(world.get(), options) ? 0 : -5;
+    }
+
     // Create our main application window
     HWND hwnd = AppInitialize(instance, 800, 600);
     if (!hwnd)
@@ -23,6 +84,10 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE, LPSTR, int)
         return -1;
     }
 
+    // Capture every frame to frame_000000.png, frame_000001.png, ... if asked
+    // to. Declared before the renderer, so that it outlives it.
+    std::unique_ptr<FrameCapture> capture;
+
     // Create debug renderer, which we'll use to visualize our physics code
     std::unique_ptr<DebugRenderer> renderer(new DebugRenderer);
     if (!renderer->Initialize(hwnd))
@@ -30,45 +95,17 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE, LPSTR, int)
         return -2;
     }
 
-    // Create a physics world object to run our simulation
-    std::unique_ptr<PhysicsWorld> world(new PhysicsWorld(Vector2(0.0f, -20.0f), 100));
-
-    // Create an assortment of random objects
-    srand(0);
-
-    std::vector<std::unique_ptr<RigidBody>> bodies;
-
-    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(2, 2), 5.0f)));
-    for (int i = 0; i < 10; ++i)
+    if (strstr(commandLine, "-capture"))
     {
-        if (rand() % 2 == 0)
-        {
-            bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new CircleShape((rand() % 5 + 1) * 0.4f), 5.0f)));
-        }
-        else
-        {
-            bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(rand() % 2 + 1.0f, rand() % 2 + 1.0f), 5.0f)));
-        }
-        bodies[bodies.size() - 1]->Position() = Vector2(rand() % 20 - 10, rand() % 50 + 2);
+        capture.reset(new FrameCapture(FrameCaptureSettings()));
+        renderer->SetCapture(capture.get());
     }
 
-    // Walls
-    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(20.0f, 1.0f), FLT_MAX)));
-    bodies[bodies.size() - 1]->Position() = Vector2(0.0f, -10.0f);
-    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(1.0f, 20.0f), FLT_MAX)));
-    bodies[bodies.size() - 1]->Position() = Vector2(-10.0f, 0.0f);
-    bodies[bodies.size() - 1]->Rotation() = 0.3f;
-    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(1.0f, 20.0f), FLT_MAX)));
-    bodies[bodies.size() - 1]->Position() = Vector2(10.0f, 0.0f);
-    bodies[bodies.size() - 1]->Rotation() = -0.3f;
+    // Record a timeline of the simulation, which can be dumped with the T key
+    Tracer::SetThreadName("Main");
+    Tracer::Enable(true);
 
-    // Add them to the world
-    for (auto& body : bodies)
-    {
-        world->AddBody(body.get());
-    }
-
-    SetWindowText(hwnd, L"ESC=Exit, ArrowKeys=Move Object_0");
+    SetWindowText(hwnd, L"ESC=Exit, ArrowKeys=Move Object_0, T=Write physics_trace.json");
 
     // Make window visible and active
     ShowWindow(hwnd, SW_SHOW);
@@ -111,8 +148,18 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE, LPSTR, int)
                 bodies[0]->Force() += Vector2(0.0f, -100.0f);
             }
 
+            // Write out the trace on key down (not every frame it's held)
+            static bool traceKeyWasDown = false;
+            bool traceKeyDown = (GetAsyncKeyState('T') & 0x8000) != 0;
+            if (traceKeyDown && !traceKeyWasDown)
+            {
+                Tracer::WriteChromeTrace("physics_trace.json");
+            }
+            traceKeyWasDown = traceKeyDown;
+
             world->Update(dt);
             world->Draw(renderer.get());
+            renderer->EndFrame();
 
             // Refresh
             renderer->Render();
@@ -121,7 +168,170 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE, LPSTR, int)
 
     return 0;
 }
+#else
+// Main entry point. Without Windows there's no window (or D3D) to render to,
+// so this only runs the benchmarks or a headless run, when asked to as
+// WinMain is.
+int main(int argc, char* argv[])
+{
+    // Joined back up into the one command line WinMain gets
+    std::vector<char> commandLine;
+    for (int i = 1; i < argc; ++i)
+    {
+        commandLine.insert(commandLine.end(), argv[i], argv[i] + strlen(argv[i]));
+        commandLine.push_back(' ');
+    }
+    commandLine.push_back('\0');
+
+    if (strstr(commandLine.data(), "-bench"))
+    {
+        return RunBenchmarks(commandLine.data()) ? 0 : -3;
+    }
+
+    HeadlessOptions options;
+    if (!strstr(commandLine.data(), "-headless"))
+    {
+        fprintf(stderr, "Usage: %s -bench [names...]\n"
+            "       %s -headless [-frames N] [-format ppm|png|raw|none] [-output DIR]\n", argv[0], argv[0]);
+        return -1;
+    }
+    if (!ParseHeadlessOptions(commandLine.data(), options))
+    {
+        return -4;
+    }
+
+    std::unique_ptr<PhysicsWorld> world(new PhysicsWorld(Vector2(0.0f, -20.0f), 100));
+
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    CreateScene(world.get(), bodies);
+
+    return RunHeadless(world.get(), options) ? 0 : -5;
+}
+#endif
+
+void CreateScene(PhysicsWorld* world, std::vector<std::unique_ptr<RigidBody>>& bodies)
+{
+    CreateSampleScene(bodies);
+
+    // Add them to the world
+    for (auto& body : bodies)
+    {
+        world->AddBody(body.get());
+    }
+}
+
+// The word following option on the command line (up to the next space), or
+// an empty string if option isn't there
+static std::string FindOption(const char* commandLine, const char* option)
+{
+    const char* value = strstr(commandLine, option);
+    if (!value)
+    {
+        return std::string();
+    }
+
+    value += strlen(option);
+    while (*value == ' ')
+    {
+        ++value;
+    }
+    const char* end = value;
+    while (*end != ' ' && *end != '\0')
+    {
+        ++end;
+    }
+    return std::string(value, end);
+}
 
+bool ParseHeadlessOptions(const char* commandLine, HeadlessOptions& options)
+{
+    std::string frames = FindOption(commandLine, "-frames");
+    if (!frames.empty())
+    {
+        options.frameCount = atoi(frames.c_str());
+        if (options.frameCount <= 0)
+        {
+            fprintf(stderr, "-frames needs a number of frames, not \"%s\"\n", frames.c_str());
+            return false;
+        }
+    }
+
+    std::string format = FindOption(commandLine, "-format");
+    static const ImageFormat Formats[] = { ImageFormat::Ppm, ImageFormat::Png, ImageFormat::Raw };
+    options.writeFrames = false;
+    for (int i = 0; i < _countof(Formats); ++i)
+    {
+        if (format == ImageExtension(Formats[i]))
+        {
+            options.format = Formats[i];
+            options.writeFrames = true;
+        }
+    }
+    if (!options.writeFrames && !format.empty() && format != "none")
+    {
+        fprintf(stderr, "-format needs ppm, png, raw or none, not \"%s\"\n", format.c_str());
+        return false;
+    }
+
+    std::string directory = FindOption(commandLine, "-output");
+    if (!directory.empty())
+    {
+        options.directory = directory;
+    }
+    return true;
+}
+
+bool RunHeadless(PhysicsWorld* world, const HeadlessOptions& options)
+{
+    // Every frame is written, however long that takes. Declared before the
+    // renderer, so that it outlives it.
+    std::string path;
+    std::unique_ptr<FrameCapture> capture;
+    if (options.writeFrames)
+    {
+        if (options.format == ImageFormat::Raw)
+        {
+            path = options.directory + "/frames.raw";
+        }
+        else
+        {
+            path = options.directory + "/frame_%06u." + ImageExtension(options.format);
+        }
+
+        FrameCaptureSettings settings;
+        settings.path = path.c_str();
+        settings.format = options.format;
+        settings.policy = CapturePolicy::Block;
+        capture.reset(new FrameCapture(settings));
+    }
+
+    SoftwareRenderer renderer(800, 600);
+    renderer.SetCapture(capture.get());
+
+    static const float dt = 1.0f / 60.0f;
+    for (int i = 0; i < options.frameCount; ++i)
+    {
+        world->Update(dt);
+        world->Draw(&renderer);
+        renderer.EndFrame();
+        renderer.Render();
+    }
+
+    if (!capture)
+    {
+        printf("%d frames simulated & rendered, none written\n", options.frameCount);
+        return true;
+    }
+
+    capture->Flush();
+    CaptureStats stats = capture->GetStats();
+    printf("%d frames: %llu written to %s (%.1f MB), %llu couldn't be\n", options.frameCount,
+        (unsigned long long)stats.framesWritten, path.c_str(), stats.bytesWritten / (1024.0 * 1024.0),
+        (unsigned long long)stats.writeErrors);
+    return stats.writeErrors == 0;
+}
+
+#ifdef _WIN32
 HWND AppInitialize(HINSTANCE instance, int width, int height)
 {
     // Register a window class for our application
@@ -161,4 +371,4 @@ LRESULT CALLBACK AppWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam
 
     return DefWindowProc(hwnd, msg, wParam, lParam);
 }
-
+#endif
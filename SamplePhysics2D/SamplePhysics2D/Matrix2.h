@@ -1,38 +1,57 @@
 #pragma once
 
-// Simple 2x2 matrix
-struct Matrix2
+// Simple 2x2 matrix, on any of the scalar types in Scalar.h. Trivially
+// copyable, like Vector2T.
+template <class S>
+struct Matrix2T
 {
-    Matrix2() {}
-    Matrix2(float angle)
+    typedef S Scalar;
+    typedef Vector2T<S> Vector;
+
+    Matrix2T() {}
+    Matrix2T(S angle)
     {
-        float c = cosf(angle);
-        float s = sinf(angle);
+        S c = Cos(angle);
+        S s = Sin(angle);
         col1.x = c; col2.x = -s;
         col1.y = s; col2.y = c;
     }
 
-    Matrix2(const Vector2& col1, const Vector2& col2) : col1(col1), col2(col2) {}
+    MATH_CONSTEXPR Matrix2T(const Vector& col1, const Vector& col2) : col1(col1), col2(col2) {}
 
     void Transpose()
     {
         std::swap(col1.y, col2.x);
     }
 
-    Matrix2 Transposed() const
+    MATH_CONSTEXPR Matrix2T Transposed() const
     {
-        return Matrix2(Vector2(col1.x, col2.x), Vector2(col1.y, col2.y));
+        return Matrix2T(Vector(col1.x, col2.x), Vector(col1.y, col2.y));
     }
 
-    Vector2 col1, col2;
+    Vector col1, col2;
 };
 
-inline Vector2 operator* (const Matrix2& A, const Vector2& v)
+typedef Matrix2T<float> Matrix2;
+
+template <class S>
+inline MATH_CONSTEXPR Vector2T<S> operator* (const Matrix2T<S>& A, const Vector2T<S>& v)
 {
-    return Vector2(A.col1.x * v.x + A.col2.x * v.y, A.col1.y * v.x + A.col2.y * v.y);
+    return Vector2T<S>(A.col1.x * v.x + A.col2.x * v.y, A.col1.y * v.x + A.col2.y * v.y);
 }
 
-inline Matrix2 operator* (const Matrix2& A, const Matrix2& B)
+template <class S>
+inline MATH_CONSTEXPR Matrix2T<S> operator* (const Matrix2T<S>& A, const Matrix2T<S>& B)
 {
-    return Matrix2(A * B.col1, A * B.col2);
+    return Matrix2T<S>(A * B.col1, A * B.col2);
 }
+
+static_assert(std::is_trivially_copyable<Matrix2>::value, "Matrix2 must stay trivially copyable");
+static_assert(std::is_standard_layout<Matrix2>::value, "Matrix2 must stay standard layout");
+static_assert(sizeof(Matrix2) == 2 * sizeof(Vector2), "Matrix2 must be just its two columns");
+
+#ifdef MATH_HAS_CONSTEXPR
+static_assert((Matrix2(Vector2(0, 1), Vector2(-1, 0)) * Vector2(1, 0)).y == 1.0f, "Matrix2 * Vector2");
+static_assert((Matrix2(Vector2(0, 1), Vector2(-1, 0)).Transposed() * Vector2(1, 0)).y == -1.0f, "Transposed");
+static_assert((Matrix2(Vector2(0, 1), Vector2(-1, 0)) * Matrix2(Vector2(0, 1), Vector2(-1, 0))).col1.x == -1.0f, "Matrix2 * Matrix2");
+#endif
@@ -0,0 +1,264 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "Collision.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "RigidBodyPair.h"
+#include "Shape.h"
+
+// Times each of the shape specific colliders in isolation over a large number
+// of random pairs, then cross checks every result against a slow, brute force
+// separating axis test done in double precision. Any optimized version of a
+// collider should report zero mismatches here before it's used.
+
+static const int BodyPoolSize = 4096;
+static const int PairCount = 2000000;
+
+// Distances are compared with this tolerance. Pairs whose reference
+// penetration is within it of touching are too close to call, and skipped.
+static const double Tolerance = 1e-3;
+
+typedef bool (*Collider)(RigidBody* body1, RigidBody* body2, ContactInfo& contact);
+
+// Projection of a shape onto an axis
+struct Interval
+{
+    double lo, hi;
+};
+
+static void GetBoxCorners(const RigidBody* body, double corners[4][2])
+{
+    const BoxShape* box = (const BoxShape*)body->GetShape();
+    double c = cos((double)body->Rotation());
+    double s = sin((double)body->Rotation());
+    double hw = 0.5 * box->Size().x;
+    double hh = 0.5 * box->Size().y;
+    static const double signs[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+
+    for (int i = 0; i < 4; ++i)
+    {
+        double x = signs[i][0] * hw;
+        double y = signs[i][1] * hh;
+        corners[i][0] = body->Position().x + c * x - s * y;
+        corners[i][1] = body->Position().y + s * x + c * y;
+    }
+}
+
+static Interval Project(const RigidBody* body, double ax, double ay)
+{
+    Interval result;
+    if (body->GetShape()->Type() == ShapeType::Circle)
+    {
+        double center = body->Position().x * ax + body->Position().y * ay;
+        double radius = ((const CircleShape*)body->GetShape())->Radius();
+        result.lo = center - radius;
+        result.hi = center + radius;
+    }
+    else
+    {
+        double corners[4][2];
+        GetBoxCorners(body, corners);
+        result.lo = DBL_MAX;
+        result.hi = -DBL_MAX;
+        for (int i = 0; i < 4; ++i)
+        {
+            double d = corners[i][0] * ax + corners[i][1] * ay;
+            result.lo = min(result.lo, d);
+            result.hi = max(result.hi, d);
+        }
+    }
+    return result;
+}
+
+// Overlap of the two shapes along a unit axis. Negative if they're separated on it.
+static double OverlapOnAxis(const RigidBody* body1, const RigidBody* body2, double ax, double ay)
+{
+    Interval a = Project(body1, ax, ay);
+    Interval b = Project(body2, ax, ay);
+    return min(a.hi - b.lo, b.hi - a.lo);
+}
+
+static void AddBoxAxes(std::vector<Vector2>& axes, const RigidBody* body)
+{
+    Matrix2 rot(body->Rotation());
+    axes.push_back(rot.col1);
+    axes.push_back(rot.col2);
+}
+
+// Brute force penetration depth: the minimum overlap over every candidate
+// separating axis. Returns a negative value if the shapes are separated.
+static double ReferencePenetration(const RigidBody* body1, const RigidBody* body2)
+{
+    std::vector<Vector2> axes;
+    const RigidBody* bodies[] = { body1, body2 };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        const RigidBody* body = bodies[i];
+        const RigidBody* other = bodies[1 - i];
+
+        if (body->GetShape()->Type() == ShapeType::Box)
+        {
+            AddBoxAxes(axes, body);
+        }
+        else if (other->GetShape()->Type() == ShapeType::Circle)
+        {
+            // Circle vs circle only has the one axis between centers
+            axes.push_back(other->Position() - body->Position());
+        }
+        else
+        {
+            // Circle vs box adds the axis from the circle to the box's nearest corner
+            double corners[4][2];
+            GetBoxCorners(other, corners);
+            int nearest = 0;
+            double nearestD2 = DBL_MAX;
+            for (int j = 0; j < 4; ++j)
+            {
+                double dx = corners[j][0] - body->Position().x;
+                double dy = corners[j][1] - body->Position().y;
+                if (dx * dx + dy * dy < nearestD2)
+                {
+                    nearestD2 = dx * dx + dy * dy;
+                    nearest = j;
+                }
+            }
+            axes.push_back(Vector2((float)(corners[nearest][0] - body->Position().x), (float)(corners[nearest][1] - body->Position().y)));
+        }
+    }
+
+    double penetration = DBL_MAX;
+    for (auto& axis : axes)
+    {
+        double length = sqrt((double)axis.x * axis.x + (double)axis.y * axis.y);
+        if (length == 0.0)
+        {
+            continue;
+        }
+        penetration = min(penetration, OverlapOnAxis(body1, body2, axis.x / length, axis.y / length));
+    }
+    return penetration;
+}
+
+struct ColliderCase
+{
+    const char* name;
+    Collider collide;
+    ShapeType type1;
+    ShapeType type2;
+};
+
+static RigidBody* CreateRandomBody(BenchRandom& random, ShapeType type)
+{
+    Shape* shape;
+    if (type == ShapeType::Circle)
+    {
+        shape = new CircleShape(random.Range(0.1f, 1.5f));
+    }
+    else
+    {
+        shape = new BoxShape(random.Range(0.1f, 2.0f), random.Range(0.1f, 2.0f));
+    }
+
+    RigidBody* body = new RigidBody(shape, 1.0f);
+    body->Position() = Vector2(random.Range(-1.5f, 1.5f), random.Range(-1.5f, 1.5f));
+    body->Rotation() = random.Range(-(float)M_PI, (float)M_PI);
+    return body;
+}
+
+static bool RunCase(FILE* output, const ColliderCase& test)
+{
+    BenchRandom random(1234);
+
+    std::vector<std::unique_ptr<RigidBody>> pool1, pool2;
+    for (int i = 0; i < BodyPoolSize; ++i)
+    {
+        pool1.push_back(std::unique_ptr<RigidBody>(CreateRandomBody(random, test.type1)));
+        pool2.push_back(std::unique_ptr<RigidBody>(CreateRandomBody(random, test.type2)));
+    }
+
+    std::vector<RigidBody*> bodies1(PairCount), bodies2(PairCount);
+    for (int i = 0; i < PairCount; ++i)
+    {
+        bodies1[i] = pool1[random.Next() % BodyPoolSize].get();
+        bodies2[i] = pool2[random.Next() % BodyPoolSize].get();
+    }
+
+    // Timed pass. The hit count keeps the calls from being optimized away.
+    int hits = 0;
+    ContactInfo contact;
+    int64_t start = GetProfileTicks();
+    for (int i = 0; i < PairCount; ++i)
+    {
+        if (test.collide(bodies1[i], bodies2[i], contact))
+        {
+            ++hits;
+        }
+    }
+    double ms = TicksToMilliseconds(GetProfileTicks() - start);
+
+    // Validation pass
+    int mismatches = 0;
+    int skipped = 0;
+    for (int i = 0; i < PairCount; ++i)
+    {
+        double reference = ReferencePenetration(bodies1[i], bodies2[i]);
+        if (fabs(reference) < Tolerance)
+        {
+            ++skipped;
+            continue;
+        }
+
+        ContactInfo result;
+        bool hit = test.collide(bodies1[i], bodies2[i], result);
+        bool ok = (hit == (reference > 0.0));
+
+        if (ok && hit)
+        {
+            // Reported depth must match the true depth, and the shapes
+            // must overlap by that much along the reported normal
+            double length = sqrt((double)result.normal.x * result.normal.x + (double)result.normal.y * result.normal.y);
+            double alongNormal = OverlapOnAxis(bodies1[i], bodies2[i], result.normal.x / length, result.normal.y / length);
+            ok = fabs(length - 1.0) < Tolerance &&
+                fabs(-result.distance - reference) < Tolerance &&
+                fabs(alongNormal - reference) < Tolerance;
+        }
+
+        if (!ok)
+        {
+            if (mismatches < 5)
+            {
+                fprintf(output, "  mismatch: pair %d reference %f, collider %s %f\n",
+                    i, reference, hit ? "hit" : "miss", hit ? -result.distance : 0.0f);
+            }
+            ++mismatches;
+        }
+    }
+
+    fprintf(output, "%-20s %8d hits  %7.2f ns/pair  %7.2f Mpairs/s  %d mismatches (%d near-touching skipped)\n",
+        test.name, hits, ms * 1e6 / PairCount, PairCount / (ms * 1000.0), mismatches, skipped);
+
+    return mismatches == 0;
+}
+
+bool BenchNarrowphase(FILE* output)
+{
+    static const ColliderCase cases[] =
+    {
+        { "CollideCircleCircle", CollideCircleCircle, ShapeType::Circle, ShapeType::Circle },
+        { "CollideCircleBox", CollideCircleBox, ShapeType::Circle, ShapeType::Box },
+        { "CollideBoxBox", CollideBoxBox, ShapeType::Box, ShapeType::Box },
+    };
+
+    fprintf(output, "%d random pairs per collider\n", PairCount);
+
+    bool succeeded = true;
+    for (int i = 0; i < _countof(cases); ++i)
+    {
+        if (!RunCase(output, cases[i]))
+        {
+            succeeded = false;
+        }
+    }
+    return succeeded;
+}
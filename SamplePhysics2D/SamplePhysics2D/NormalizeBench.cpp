@@ -0,0 +1,189 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+// Times normalizing an array of vectors (some of them zero) one at a time with
+// Vector2 (branching around the zeros, and with NormalizedOrZero), and with the
+// batched NormalizeOrZero kernel. The array fits in cache, so that this times
+// the math rather than memory. Reports the largest error of each against double
+// precision, and checks that zeros stay zeros.
+//
+// Build with MATH_FAST_INV_SQRT defined to compare the fast path.
+//
+// Then checks that a body resting in a world without gravity (which used to
+// make Update normalize a zero velocity) stays put, rather than going NaN.
+
+static const int Count = 1 << 14;
+static const int Repeats = 1000;
+
+struct NormalizeInputs
+{
+    std::vector<Vector2> vectors;
+    std::vector<float> xs, ys;
+};
+
+static NormalizeInputs CreateInputs()
+{
+    BenchRandom random(37);
+    NormalizeInputs in;
+    for (int i = 0; i < Count; ++i)
+    {
+        Vector2 v(random.Range(-100.0f, 100.0f), random.Range(-100.0f, 100.0f));
+        if (i % 16 == 0)
+        {
+            v = Vector2(0.0f, 0.0f);
+        }
+        else if (i % 16 == 1)
+        {
+            // Too short to normalize
+            v = Vector2(1e-30f, -1e-30f);
+        }
+        else if (i % 16 == 2)
+        {
+            v = v * 1e-6f;
+        }
+        in.vectors.push_back(v);
+        in.xs.push_back(v.x);
+        in.ys.push_back(v.y);
+    }
+    return in;
+}
+
+struct NormalizeCheck
+{
+    double maxError;    // relative to the length of the result
+    int wrong;          // zeros not left zero, or non-finite results
+};
+
+static NormalizeCheck Check(const NormalizeInputs& in, const float* xs, const float* ys)
+{
+    NormalizeCheck check = {};
+    for (int i = 0; i < Count; ++i)
+    {
+        double x = in.vectors[i].x;
+        double y = in.vectors[i].y;
+        double length = sqrt(x * x + y * y);
+
+        if (!std::isfinite(xs[i]) || !std::isfinite(ys[i]))
+        {
+            ++check.wrong;
+        }
+        else if (length * length < FLT_MIN)
+        {
+            check.wrong += (xs[i] != 0.0f || ys[i] != 0.0f);
+        }
+        else
+        {
+            double error = max(fabs(xs[i] - x / length), fabs(ys[i] - y / length));
+            check.maxError = max(check.maxError, error);
+        }
+    }
+    return check;
+}
+
+static bool Report(FILE* output, const char* label, double ns, double referenceNs, const NormalizeCheck& check)
+{
+    fprintf(output, "%-28s %6.3f ns/vector (%.2fx)  max error %.2e%s\n", label, ns, referenceNs / ns, check.maxError,
+        check.wrong ? "  bad results" : "");
+    return check.wrong == 0;
+}
+
+static double NsPerVector(int64_t ticks)
+{
+    return TicksToMilliseconds(ticks) * 1e6 / ((double)Repeats * Count);
+}
+
+// With no gravity, nothing ever moves a resting body, so its velocity stays
+// exactly zero from step to step
+static bool CheckRestingBody(FILE* output)
+{
+    PhysicsWorld world(Vector2(0.0f, 0.0f), 10);
+    RigidBody body(new CircleShape(0.5f), 1.0f);
+    world.AddBody(&body);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        world.Update(1.0f / 60.0f);
+    }
+
+    bool still = body.Position().x == 0.0f && body.Position().y == 0.0f && body.LinearVelocity().LengthSq() == 0.0f;
+    fprintf(output, "resting body without gravity: %s\n", still ? "stayed put" : "moved");
+    world.RemoveBody(&body);
+    return still;
+}
+
+bool BenchNormalize(FILE* output)
+{
+#if defined(MATH_FAST_INV_SQRT)
+    fprintf(output, "inverse square root: fast (estimate + Newton step)\n");
+#else
+    fprintf(output, "inverse square root: exact\n");
+#endif
+
+    NormalizeInputs in = CreateInputs();
+    std::vector<float> xs(Count), ys(Count);
+    bool succeeded = true;
+
+    // Normalized, skipping zeros
+    int64_t start = GetProfileTicks();
+    for (int r = 0; r < Repeats; ++r)
+    {
+        for (int i = 0; i < Count; ++i)
+        {
+            const Vector2& v = in.vectors[i];
+            Vector2 n = v.LengthSq() >= FLT_MIN ? v.Normalized() : Vector2(0.0f, 0.0f);
+            xs[i] = n.x;
+            ys[i] = n.y;
+        }
+    }
+    double branchNs = NsPerVector(GetProfileTicks() - start);
+    succeeded &= Report(output, "Normalized, branching", branchNs, branchNs, Check(in, xs.data(), ys.data()));
+
+    start = GetProfileTicks();
+    for (int r = 0; r < Repeats; ++r)
+    {
+        for (int i = 0; i < Count; ++i)
+        {
+            Vector2 n = in.vectors[i].NormalizedOrZero();
+            xs[i] = n.x;
+            ys[i] = n.y;
+        }
+    }
+    double orZeroNs = NsPerVector(GetProfileTicks() - start);
+    succeeded &= Report(output, "NormalizedOrZero", orZeroNs, branchNs, Check(in, xs.data(), ys.data()));
+
+    // The batched kernel works in place, so each repeat starts from a fresh copy
+    int64_t ticks = 0;
+    for (int r = 0; r < Repeats; ++r)
+    {
+        std::copy(in.xs.begin(), in.xs.end(), xs.begin());
+        std::copy(in.ys.begin(), in.ys.end(), ys.begin());
+
+        start = GetProfileTicks();
+        NormalizeOrZero(xs.data(), ys.data(), Count);
+        ticks += GetProfileTicks() - start;
+    }
+    succeeded &= Report(output, "NormalizeOrZero (batched)", NsPerVector(ticks), branchNs, Check(in, xs.data(), ys.data()));
+
+    // Odd lengths, for the partial tail
+    std::copy(in.xs.begin(), in.xs.begin() + 13, xs.begin());
+    std::copy(in.ys.begin(), in.ys.begin() + 13, ys.begin());
+    NormalizeOrZero(xs.data(), ys.data(), 13);
+    for (int i = 0; i < 13; ++i)
+    {
+        Vector2 n = in.vectors[i].NormalizedOrZero();
+        if (xs[i] != n.x || ys[i] != n.y)
+        {
+            fprintf(output, "  batched result %d differs from NormalizedOrZero\n", i);
+            succeeded = false;
+            break;
+        }
+    }
+
+    succeeded &= CheckRestingBody(output);
+
+    return succeeded;
+}
@@ -0,0 +1,163 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "DrawList.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "SoftwareRenderer.h"
+
+// Times PhysicsWorld::Draw on a large pile, on one thread & on a JobSystem
+// (with every thread recording into its own list), and merging the lists for
+// rendering. Checks that the merged frame is identical however it was
+// recorded. Then times a frame loop that steps, draws & prepares each frame in
+// turn, next to one where each frame is prepared (merged & expanded into
+// lines, standing in for rendering) on another thread, while the next step is
+// taken & drawn.
+
+static const int BodyCount = 20000;
+static const int LoopBodyCount = 4000;
+static const int SettleSteps = 60;
+static const int Frames = 30;
+static const float Dt = 1.0f / 60.0f;
+
+// Frames are prepared but never rasterized, so they can be tiny
+static const uint32_t RecordWidth = 64;
+static const uint32_t RecordHeight = 64;
+
+// Expands the frame's shapes into lines, as a CPU backend would
+static void ExpandFrame(const DrawList& frame, std::vector<Vector2>& points)
+{
+    size_t circles = frame.Circles().size();
+    size_t boxes = frame.Boxes().size();
+    points.resize(circles * CircleOutlineVertices + boxes * BoxOutlineVertices);
+    ExpandShapes(ShapeType::Circle, frame.Circles().data(), circles, points.data());
+    ExpandShapes(ShapeType::Box, frame.Boxes().data(), boxes, points.data() + circles * CircleOutlineVertices);
+}
+
+static bool SameFrame(const DrawList& a, const DrawList& b)
+{
+    return a.LineVertices().size() == b.LineVertices().size() && a.Circles().size() == b.Circles().size() &&
+        a.Boxes().size() == b.Boxes().size() &&
+        memcmp(a.LineVertices().data(), b.LineVertices().data(), a.LineVertices().size() * sizeof(LineVertex)) == 0 &&
+        memcmp(a.Circles().data(), b.Circles().data(), a.Circles().size() * sizeof(ShapeInstance)) == 0 &&
+        memcmp(a.Boxes().data(), b.Boxes().data(), a.Boxes().size() * sizeof(ShapeInstance)) == 0;
+}
+
+struct DrawTimes
+{
+    double drawMs;
+    double mergeMs;
+};
+
+// Draws the world's current state Frames times, keeping the last merged frame
+static DrawTimes TimeDraw(PhysicsWorld* world, DebugDraw& renderer, DrawList& last)
+{
+    DrawTimes times = {};
+    for (int f = 0; f < Frames; ++f)
+    {
+        int64_t start = GetProfileTicks();
+        world->Draw(&renderer);
+        renderer.EndFrame();
+        int64_t drawn = GetProfileTicks();
+        const DrawList& frame = renderer.PrepareFrame();
+        int64_t end = GetProfileTicks();
+
+        times.drawMs += TicksToMilliseconds(drawn - start) / Frames;
+        times.mergeMs += TicksToMilliseconds(end - drawn) / Frames;
+        if (f == Frames - 1)
+        {
+            last.Clear();
+            last.Append(frame);
+        }
+    }
+    return times;
+}
+
+// Steps, draws & prepares each frame, either in turn or with each frame
+// prepared on another thread while the next is stepped & drawn. Returns ms per frame.
+static double TimeFrameLoop(bool overlapped)
+{
+    BenchPile scene;
+    CreateBenchScene(scene, LoopBodyCount, 17, SettleSteps);
+    scene.world->CreateJobSystem(-1);
+
+    SoftwareRenderer renderer(RecordWidth, RecordHeight);
+    std::vector<Vector2> points;
+    std::thread preparing;
+
+    int64_t start = GetProfileTicks();
+    for (int f = 0; f < Frames; ++f)
+    {
+        scene.world->Update(Dt);
+        scene.world->Draw(&renderer);
+
+        if (!overlapped)
+        {
+            renderer.EndFrame();
+            ExpandFrame(renderer.PrepareFrame(), points);
+            continue;
+        }
+
+        if (preparing.joinable())
+        {
+            preparing.join();
+        }
+        renderer.EndFrame();
+        preparing = std::thread([&]()
+        {
+            ExpandFrame(renderer.PrepareFrame(), points);
+        });
+    }
+    if (preparing.joinable())
+    {
+        preparing.join();
+    }
+    return TicksToMilliseconds(GetProfileTicks() - start) / Frames;
+}
+
+bool BenchParallelDraw(FILE* output)
+{
+    BenchPile scene;
+    CreateBenchScene(scene, BodyCount, 17, SettleSteps);
+    bool succeeded = true;
+
+    SoftwareRenderer renderer(RecordWidth, RecordHeight);
+    DrawList serialFrame;
+    DrawTimes serial = TimeDraw(scene.world.get(), renderer, serialFrame);
+
+    scene.world->CreateJobSystem(-1);
+    int threads = scene.world->GetExecutor()->ThreadCount();
+    DrawList parallelFrame;
+    DrawTimes parallel = TimeDraw(scene.world.get(), renderer, parallelFrame);
+
+    // Many more, smaller runs
+    PhysicsWorld::GrainSizes grainSizes;
+    grainSizes.bodies = 7;
+    grainSizes.pairs = 13;
+    scene.world->SetGrainSizes(grainSizes);
+    DrawList fineFrame;
+    DrawTimes fine = TimeDraw(scene.world.get(), renderer, fineFrame);
+
+    fprintf(output, "%d bodies, %d circles & boxes (points included) a frame\n", BodyCount,
+        (int)(serialFrame.Circles().size() + serialFrame.Boxes().size()));
+    fprintf(output, "Draw, 1 thread                              draw %6.3f ms  merge %6.3f ms\n", serial.drawMs, serial.mergeMs);
+    fprintf(output, "Draw, %2d threads                            draw %6.3f ms  merge %6.3f ms (%.2fx)\n", threads,
+        parallel.drawMs, parallel.mergeMs, serial.drawMs / parallel.drawMs);
+    fprintf(output, "Draw, %2d threads, small ranges              draw %6.3f ms  merge %6.3f ms\n", threads,
+        fine.drawMs, fine.mergeMs);
+
+    if (!SameFrame(serialFrame, parallelFrame) || !SameFrame(serialFrame, fineFrame))
+    {
+        fprintf(output, "  frames drawn in parallel differ from the one drawn on one thread\n");
+        succeeded = false;
+    }
+
+    double sequentialMs = TimeFrameLoop(false);
+    double overlappedMs = TimeFrameLoop(true);
+    fprintf(output, "%d bodies, stepped, drawn & prepared:\n", LoopBodyCount);
+    fprintf(output, "step, draw & prepare in turn                %6.3f ms/frame\n", sequentialMs);
+    fprintf(output, "prepare overlapping the next step & draw    %6.3f ms/frame (%.2fx)\n", overlappedMs,
+        sequentialMs / overlappedMs);
+
+    return succeeded;
+}
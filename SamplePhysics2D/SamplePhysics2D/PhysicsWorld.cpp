@@ -3,164 +3,1046 @@
 #include "RigidBody.h"
 #include "RigidBodyPair.h"
 #include "Shape.h"
-#include "DebugRenderer.h"
+#include "DebugDraw.h"
+#include "Trace.h"
+#include "WorldStages.h"
+
+// Kinematic bodies' broadphase bounds are enlarged by this much, and extended
+// by this many seconds of their current velocity, so they only need refitting
+// every so often as the bodies move
+static const float ProxyMargin = 0.1f;
+static const float ProxyLookahead = 0.25f;
+
+static void RefitProxy(const RigidBody* body, AABB& proxy)
+{
+    proxy = ComputeAABB(body, ProxyMargin);
+
+    Vector2 displacement = ProxyLookahead * body->LinearVelocity();
+    proxy.lower += Vector2(min(displacement.x, 0.0f), min(displacement.y, 0.0f));
+    proxy.upper += Vector2(max(displacement.x, 0.0f), max(displacement.y, 0.0f));
+}
 
 PhysicsWorld::PhysicsWorld(const Vector2& gravity, int maxIterations)
     : _gravity(gravity)
     , _maxIterations(maxIterations)
+    , _nextBodyId(1)
+    , _staticTreeDirty(false)
+    , _movingTreeDirty(false)
+    , _reuseLinearTolerance(0.0f)
+    , _reuseAngularTolerance(0.0f)
+    , _executor(nullptr)
+{
+}
+
+void PhysicsWorld::SetContactReuseTolerances(float linear, float angular)
 {
+    // Reuse needs both, so one without the other is most likely a mistake
+    assert(linear >= 0.0f && angular >= 0.0f);
+    assert((linear > 0.0f) == (angular > 0.0f));
+
+    _reuseLinearTolerance = linear;
+    _reuseAngularTolerance = angular;
+}
+
+void PhysicsWorld::CreateJobSystem(int threadCount)
+{
+    _executor = nullptr;
+    _ownedJobSystem.reset();
+
+    if (threadCount != 0)
+    {
+        _ownedJobSystem.reset(new JobSystem(threadCount));
+        _executor = _ownedJobSystem.get();
+    }
+}
+
+void PhysicsWorld::SetExecutor(Executor* executor)
+{
+    _executor = executor;
+    _ownedJobSystem.reset();
+}
+
+void PhysicsWorld::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& fn)
+{
+    if (_executor)
+    {
+        _executor->ParallelFor(count, grainSize, fn);
+    }
+    else if (count > 0)
+    {
+        fn(0, count);
+    }
 }
 
 void PhysicsWorld::AddBody(RigidBody* body)
 {
+    // Ids always increase, so _bodies stays sorted by id
+    body->_id = _nextBodyId++;
     _bodies.push_back(body);
+
+    if (body->IsKinematic())
+    {
+        _kinematicBodies.push_back(body);
+        _kinematicProxies.push_back(AABB());
+        RefitProxy(body, _kinematicProxies.back());
+    }
+    else if (body->InvMass() == 0.0f)
+    {
+        _staticBodies.push_back(body);
+        _staticTreeDirty = true;
+        return;
+    }
+    else
+    {
+        _dynamicBodies.push_back(body);
+    }
+    _movingTreeDirty = true;
 }
 
-void PhysicsWorld::RemoveBody(RigidBody* body)
+void PhysicsWorld::AddBodies(RigidBody* bodies, size_t count)
+{
+    // Every list is grown once, to its final size
+    size_t staticCount = 0;
+    size_t kinematicCount = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        kinematicCount += bodies[i].IsKinematic();
+        staticCount += !bodies[i].IsKinematic() && bodies[i].InvMass() == 0.0f;
+    }
+    _bodies.reserve(_bodies.size() + count);
+    _staticBodies.reserve(_staticBodies.size() + staticCount);
+    _kinematicBodies.reserve(_kinematicBodies.size() + kinematicCount);
+    _kinematicProxies.reserve(_kinematicProxies.size() + kinematicCount);
+    _dynamicBodies.reserve(_dynamicBodies.size() + count - staticCount - kinematicCount);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        AddBody(&bodies[i]);
+    }
+}
+
+// Erases body from list, if it's in it. Returns true if it was.
+static bool EraseBody(std::vector<RigidBody*>& list, RigidBody* body)
 {
-    for (auto it = std::begin(_bodies); it != std::end(_bodies); ++it)
+    for (auto it = std::begin(list); it != std::end(list); ++it)
     {
         if ((*it) == body)
         {
-            _bodies.erase(it);
-            return;
+            list.erase(it);
+            return true;
         }
     }
+    return false;
+}
+
+void PhysicsWorld::RemoveBody(RigidBody* body)
+{
+    if (!EraseBody(_bodies, body))
+    {
+        return;
+    }
+
+    if (body->IsKinematic())
+    {
+        size_t index = std::find(std::begin(_kinematicBodies), std::end(_kinematicBodies), body) - std::begin(_kinematicBodies);
+        _kinematicBodies.erase(std::begin(_kinematicBodies) + index);
+        _kinematicProxies.erase(std::begin(_kinematicProxies) + index);
+        _movingTreeDirty = true;
+    }
+    else if (EraseBody(_staticBodies, body))
+    {
+        // Rebuilt by the next query or Update, so removing many bodies in a
+        // row only rebuilds once, and queries still never find the removed one
+        _staticTreeDirty = true;
+    }
+    else
+    {
+        EraseBody(_dynamicBodies, body);
+        _movingTreeDirty = true;
+    }
+
+    // The next step looks up cached contacts in _pairs, so don't leave any
+    // pointing at the removed body
+    _pairs.erase(std::remove_if(std::begin(_pairs), std::end(_pairs), [body](const RigidBodyPair& pair)
+    {
+        return pair.Body1() == body || pair.Body2() == body;
+    }), std::end(_pairs));
 }
 
 void PhysicsWorld::Update(float dt)
 {
+#if PHYSICS_PROFILING
+    _stats = StepStats();
+#endif
+    PROFILE_STAGE(_stats.totalMs);
+    TRACE_SCOPE("PhysicsWorld::Update");
+
     float invDt = dt > 0.0f ? 1.0f / dt : 0.0f;
 
     // Determine overlapping bodies and update contact points
-    UpdatePairs();
+    {
+        PROFILE_STAGE(_stats.updatePairsMs);
+        TRACE_SCOPE("UpdatePairs");
+        UpdatePairs();
+    }
 
     // Integrate forces to obtain updated velocities
-    for (auto& body : _bodies)
     {
-        if (body->InvMass() == 0.0f)
-            continue;
-
-        body->LinearVelocity() += dt * (_gravity + body->InvMass() * body->Force());
-        body->AngularVelocity() += dt * body->InvI() * body->Torque();
+        PROFILE_STAGE(_stats.integrateForcesMs);
+        TRACE_SCOPE("IntegrateForces");
 
-        // Dampen the velocities to simulate friction (we'll add friction simulation later)
-        static const float DampeningTerm = 0.001f;
-        body->LinearVelocity() += -body->LinearVelocity().Normalized() * DampeningTerm;
-        body->AngularVelocity() += (body->AngularVelocity() > 0) ? -DampeningTerm : DampeningTerm;
+        PROFILE_COUNT(_stats.bodiesActive, (int)_dynamicBodies.size());
 
-        // Clamp to 0 if the value becomes too low
-        static const float ClampThreshold = 0.01f;
-        if (body->LinearVelocity().LengthSq() < ClampThreshold)
+        ParallelFor(_dynamicBodies.size(), _grainSizes.bodies, [this, dt](size_t begin, size_t end)
         {
-            body->LinearVelocity() = Vector2(0, 0);
-        }
-        if (fabsf(body->AngularVelocity()) < ClampThreshold)
-        {
-            body->AngularVelocity() = 0.0f;
-        }
+            IntegrateForces(_dynamicBodies.data() + begin, end - begin, _gravity, dt);
+        });
     }
 
     // Do all one time init for the pairs
-    for (auto& pair : _pairs)
     {
-        pair.second.PreSolve(invDt);
+        PROFILE_STAGE(_stats.preSolveMs);
+        TRACE_SCOPE("PreSolve");
+
+        ParallelFor(_pairs.size(), _grainSizes.pairs, [this, invDt](size_t begin, size_t end)
+        {
+            PreSolvePairs(_pairs.data() + begin, end - begin, invDt);
+        });
     }
 
     // Sequential Impulse (SI) loop. See Erin Catto's GDC slides for SI info
-    for (int i = 0; i < _maxIterations; ++i)
     {
-        for (auto& pair : _pairs)
+        PROFILE_STAGE(_stats.solveMs);
+        TRACE_SCOPE("Solve");
+
+        if (_executor && _executor->ThreadCount() > 1)
+        {
+            SolveIslands();
+        }
+        else
         {
-            pair.second.Solve();
+            SolvePairs(_pairs.data(), _pairs.size(), _maxIterations);
         }
+
+        PROFILE_COUNT(_stats.iterations, _maxIterations);
     }
 
     // Integrate new velocities to obtain final state vector (position, rotation).
     // Also clear out any forces in preparation for the next frame
-    for (auto& body : _bodies)
     {
-        if (body->InvMass() == 0.0f)
-            continue;
+        PROFILE_STAGE(_stats.integrateVelocitiesMs);
+        TRACE_SCOPE("IntegrateVelocities");
 
-        body->Position() += dt * body->LinearVelocity();
-        body->Rotation() += dt * body->AngularVelocity();
+        ParallelFor(_dynamicBodies.size(), _grainSizes.bodies, [this, dt](size_t begin, size_t end)
+        {
+            IntegrateVelocities(_dynamicBodies.data() + begin, end - begin, dt);
+        });
 
-        body->Force() = Vector2(0, 0);
-        body->Torque() = 0.0f;
+        // Kinematic bodies just follow their velocities
+        IntegrateVelocities(_kinematicBodies.data(), _kinematicBodies.size(), dt);
     }
+
+    // Bodies have moved, so the next scene query rebuilds what it sees
+    _movingTreeDirty = true;
 }
 
-void PhysicsWorld::Draw(DebugRenderer* renderer)
+void PhysicsWorld::UpdateQueryTree() const
 {
-    for (auto& body : _bodies)
+    TRACE_SCOPE("UpdateQueryTree");
+    _movingBodies.clear();
+    _movingBodies.insert(std::end(_movingBodies), std::begin(_dynamicBodies), std::end(_dynamicBodies));
+    _movingBodies.insert(std::end(_movingBodies), std::begin(_kinematicBodies), std::end(_kinematicBodies));
+    _movingTree.Build(_movingBodies, TreeBuild::Median);
+    _movingTreeDirty = false;
+}
+
+void PhysicsWorld::UpdateStaticTree() const
+{
+    TRACE_SCOPE("BuildStaticTree");
+    _staticTree.Build(_staticBodies, TreeBuild::SAH);
+    _staticTreeDirty = false;
+}
+
+void PhysicsWorld::PrepareQueryTrees() const
+{
+    if (!_staticTreeDirty && !_movingTreeDirty)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_queryTreeLock);
+    if (_staticTreeDirty)
+    {
+        UpdateStaticTree();
+    }
+    if (_movingTreeDirty)
+    {
+        UpdateQueryTree();
+    }
+}
+
+bool PhysicsWorld::RayCast(const Vector2& start, const Vector2& end, RayCastHit* hit) const
+{
+    return RayCastBatch(&start, &end, 1, hit) != 0;
+}
+
+size_t PhysicsWorld::RayCastBatch(const Vector2* starts, const Vector2* ends, size_t count, RayCastHit* hits) const
+{
+    PrepareQueryTrees();
+
+    // Consecutive rays go through the trees together, a packet at a time.
+    // Rays through the moving tree are clipped to what they hit in the static one.
+    const BodyTree* trees[] = { &_staticTree, &_movingTree };
+    size_t hitCount = 0;
+
+    for (size_t first = 0; first < count; first += RayPacket::Size)
     {
-        const Shape* shape = body->GetShape();
+        const Vector2* packetStarts = starts + first;
+        const Vector2* packetEnds = ends + first;
+        RayCastHit* packetHits = hits + first;
 
-        switch (shape->Type())
+        RayPacket packet;
+        for (int i = 0; i < RayPacket::Size; ++i)
         {
-        case ShapeType::Circle:
-            renderer->DrawCircle(body->Position(), ((CircleShape*)shape)->Radius(), body->Rotation());
-            break;
+            if (first + i < count)
+            {
+                packet.Set(i, packetStarts[i], packetEnds[i]);
+                packetHits[i].body = nullptr;
+                packetHits[i].fraction = 1.0f;
+            }
+            else
+            {
+                packet.Clear(i);
+            }
+        }
 
-        case ShapeType::Box:
-            renderer->DrawBox(body->Position(), ((BoxShape*)shape)->Size(), body->Rotation());
-            break;
+        for (int tree = 0; tree < _countof(trees); ++tree)
+        {
+            trees[tree]->RayCastPacket(packet, [&packet, packetHits](int lanes, RigidBody* body)
+            {
+                // Keep each lane's nearest hit, and clip its segment there
+                RayCastHit candidates[RayPacket::Size];
+                int hitLanes = RayCastBodyPacket(body, packet, lanes, candidates);
+                for (int lane = 0; hitLanes != 0; ++lane, hitLanes >>= 1)
+                {
+                    RayCastHit& hit = packetHits[lane];
+                    if ((hitLanes & 1) && (!hit.body || candidates[lane].fraction < hit.fraction))
+                    {
+                        hit = candidates[lane];
+                        packet.maxFraction[lane] = hit.fraction;
+                    }
+                }
+            });
+        }
 
-        default:
-            assert(false);
-            break;
+        for (int i = 0; i < RayPacket::Size && first + i < count; ++i)
+        {
+            if (packetHits[i].body)
+            {
+                ++hitCount;
+            }
         }
     }
 
+    return hitCount;
+}
+
+bool PhysicsWorld::ShapeCast(const Shape* shape, float rotation, const Vector2& start, const Vector2& end, RayCastHit* hit) const
+{
+    // Sweep the shape's bounds through the trees, then test exactly
+    RigidBody::MassProperties massProperties = { 1.0f, 1.0f, 1.0f, 1.0f };
+    RigidBody bounds(const_cast<Shape*>(shape), massProperties);
+    bounds.Rotation() = rotation;
+    Vector2 extents = ComputeAABB(&bounds).upper;
+
+    hit->body = nullptr;
+    hit->fraction = 1.0f;
+
+    PrepareQueryTrees();
+    const BodyTree* trees[] = { &_staticTree, &_movingTree };
+    for (int tree = 0; tree < _countof(trees); ++tree)
+    {
+        trees[tree]->SweepBox(start, end, extents, [shape, rotation, &start, &end, hit](RigidBody* body) -> float
+        {
+            RayCastHit candidate;
+            if (ShapeCastBody(shape, rotation, start, end, body, hit->fraction, candidate) &&
+                (!hit->body || candidate.fraction < hit->fraction))
+            {
+                *hit = candidate;
+            }
+            return hit->fraction;
+        });
+    }
+
+    return hit->body != nullptr;
+}
+
+void PhysicsWorld::QueryAABB(const AABB& box, std::vector<RigidBody*>& results) const
+{
+    PrepareQueryTrees();
+    _staticTree.Query(box, results);
+    _movingTree.Query(box, results);
+}
+
+void PhysicsWorld::QueryAABBBatch(const AABB* boxes, size_t count, std::vector<RigidBody*>& results, std::vector<uint32_t>& counts) const
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t before = results.size();
+        QueryAABB(boxes[i], results);
+        counts.push_back((uint32_t)(results.size() - before));
+    }
+}
+
+void PhysicsWorld::QueryPoint(const Vector2& point, std::vector<RigidBody*>& results) const
+{
+    // Find candidates by their bounds, then keep just those containing the point
+    size_t first = results.size();
+    QueryAABB(AABB(point, point), results);
+
+    size_t kept = first;
+    for (size_t i = first; i < results.size(); ++i)
+    {
+        if (BodyContainsPoint(results[i], point))
+        {
+            results[kept++] = results[i];
+        }
+    }
+    results.resize(kept);
+}
+
+// FNV-1a, fed 32 bits at a time
+static void HashBits(uint64_t& hash, uint32_t bits)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        hash ^= (bits >> (i * 8)) & 0xFF;
+        hash *= 0x100000001B3ull;
+    }
+}
+
+static void HashFloat(uint64_t& hash, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    HashBits(hash, bits);
+}
+
+uint64_t PhysicsWorld::ComputeStateHash() const
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (auto& body : _bodies)
+    {
+        HashBits(hash, body->Id());
+        HashFloat(hash, body->Position().x);
+        HashFloat(hash, body->Position().y);
+        HashFloat(hash, body->Rotation());
+        HashFloat(hash, body->LinearVelocity().x);
+        HashFloat(hash, body->LinearVelocity().y);
+        HashFloat(hash, body->AngularVelocity());
+    }
+
+    // Pairs are sorted by id, so this walk is in the same order every run
     for (auto& pair : _pairs)
     {
-        if (pair.second.HasContact())
+        HashBits(hash, pair.Body1()->Id());
+        HashBits(hash, pair.Body2()->Id());
+        HashFloat(hash, pair.Contact().impulseNormal);
+    }
+
+    return hash;
+}
+
+// Snapshot layout: a header, followed by one BodyState per body (in _bodies
+// order), followed by one PairState per cached pair (in _pairs order), then
+// (if contact reuse was on) one ContactCache per pair. The contacts
+// themselves are found again by the next step, so they aren't saved.
+// Bump the version whenever any of these change.
+static const uint32_t StateMagic = 0x54535750; // 'PWST'
+static const uint32_t StateVersion = 3;
+
+struct StateHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bodyCount;
+    uint32_t pairCount;
+    uint32_t hasCaches;
+};
+
+struct BodyState
+{
+    uint32_t id;
+    Vector2 position;
+    Vector2 linearVelocity;
+    Vector2 force;
+    float rotation;
+    float angularVelocity;
+    float torque;
+};
+
+struct PairState
+{
+    // Index of each body in _bodies
+    uint32_t body1;
+    uint32_t body2;
+    float impulseNormal;
+};
+
+// Snapshots are written & read by casting the buffer to these
+static_assert(std::is_trivially_copyable<BodyState>::value, "BodyState must be trivially copyable");
+static_assert(std::is_trivially_copyable<PairState>::value, "PairState must be trivially copyable");
+static_assert(std::is_trivially_copyable<ContactCache>::value, "ContactCache must be trivially copyable");
+
+uint32_t PhysicsWorld::FindBodyIndex(uint32_t id) const
+{
+    // Ids are handed out sequentially, so unless bodies have been removed,
+    // a body's index is just its offset from the first id.
+    uint32_t index = id - _bodies[0]->Id();
+    if (index < _bodies.size() && _bodies[index]->Id() == id)
+    {
+        return index;
+    }
+
+    // Otherwise, _bodies is still sorted by id
+    return (uint32_t)(std::lower_bound(std::begin(_bodies), std::end(_bodies), id,
+        [](const RigidBody* body, uint32_t id) { return body->Id() < id; }) - std::begin(_bodies));
+}
+
+void PhysicsWorld::SaveState(std::vector<uint8_t>& buffer) const
+{
+    // Caches are only ever read to reuse contacts
+    bool saveCaches = _reuseLinearTolerance > 0.0f && _reuseAngularTolerance > 0.0f;
+    size_t size = sizeof(StateHeader) + _bodies.size() * sizeof(BodyState) +
+        _pairs.size() * (sizeof(PairState) + (saveCaches ? sizeof(ContactCache) : 0));
+    buffer.resize(size);
+
+    StateHeader* header = (StateHeader*)buffer.data();
+    header->magic = StateMagic;
+    header->version = StateVersion;
+    header->bodyCount = (uint32_t)_bodies.size();
+    header->pairCount = (uint32_t)_pairs.size();
+    header->hasCaches = saveCaches ? 1 : 0;
+
+    BodyState* bodies = (BodyState*)(header + 1);
+    for (size_t i = 0; i < _bodies.size(); ++i)
+    {
+        const RigidBody* body = _bodies[i];
+        BodyState& state = bodies[i];
+        state.id = body->Id();
+        state.position = body->Position();
+        state.linearVelocity = body->LinearVelocity();
+        state.force = body->Force();
+        state.rotation = body->Rotation();
+        state.angularVelocity = body->AngularVelocity();
+        state.torque = body->Torque();
+    }
+
+    PairState* pairs = (PairState*)(bodies + _bodies.size());
+    for (size_t i = 0; i < _pairs.size(); ++i)
+    {
+        const RigidBodyPair& pair = _pairs[i];
+        PairState& state = pairs[i];
+        state.body1 = FindBodyIndex(pair.Body1()->Id());
+        state.body2 = FindBodyIndex(pair.Body2()->Id());
+        state.impulseNormal = pair.Contact().impulseNormal;
+    }
+
+    if (saveCaches)
+    {
+        ContactCache* caches = (ContactCache*)(pairs + _pairs.size());
+        for (size_t i = 0; i < _pairs.size(); ++i)
         {
-            renderer->DrawPoint(pair.second.Contact().worldPosition);
+            caches[i] = _pairs[i].Cache();
         }
     }
 }
 
+bool PhysicsWorld::LoadState(const uint8_t* data, size_t size)
+{
+    // Validate everything up front, so we never apply a partial snapshot.
+    // Reusing contacts needs the caches, so they must have been saved.
+    const StateHeader* header = (const StateHeader*)data;
+    bool reuseContacts = _reuseLinearTolerance > 0.0f && _reuseAngularTolerance > 0.0f;
+    if (size < sizeof(StateHeader) ||
+        header->magic != StateMagic ||
+        header->version != StateVersion ||
+        header->bodyCount != _bodies.size() ||
+        (reuseContacts && !header->hasCaches) ||
+        size < sizeof(StateHeader) + header->bodyCount * sizeof(BodyState) +
+            header->pairCount * (sizeof(PairState) + (header->hasCaches ? sizeof(ContactCache) : 0)))
+    {
+        return false;
+    }
+
+    const BodyState* bodies = (const BodyState*)(header + 1);
+    for (size_t i = 0; i < _bodies.size(); ++i)
+    {
+        if (bodies[i].id != _bodies[i]->Id())
+        {
+            return false;
+        }
+    }
+
+    const PairState* pairs = (const PairState*)(bodies + header->bodyCount);
+    for (uint32_t i = 0; i < header->pairCount; ++i)
+    {
+        if (pairs[i].body1 >= header->bodyCount || pairs[i].body2 >= header->bodyCount)
+        {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < _bodies.size(); ++i)
+    {
+        RigidBody* body = _bodies[i];
+        const BodyState& state = bodies[i];
+        body->Position() = state.position;
+        body->LinearVelocity() = state.linearVelocity;
+        body->Force() = state.force;
+        body->Rotation() = state.rotation;
+        body->AngularVelocity() = state.angularVelocity;
+        body->Torque() = state.torque;
+    }
+
+    // Pairs were saved in key order, so they can go straight back in. The
+    // list keeps its capacity, so this doesn't allocate once it's warmed up.
+    const ContactCache* caches = (reuseContacts ? (const ContactCache*)(pairs + header->pairCount) : nullptr);
+    _pairs.clear();
+    for (uint32_t i = 0; i < header->pairCount; ++i)
+    {
+        _pairs.emplace_back(_bodies[pairs[i].body1], _bodies[pairs[i].body2], pairs[i].impulseNormal,
+            caches ? &caches[i] : nullptr);
+    }
+
+    // Bodies have moved, so queries rebuild their tree before they next run
+    _movingTreeDirty = true;
+
+    return true;
+}
+
+void PhysicsWorld::Draw(DebugDraw* draw)
+{
+    // Bodies & contacts are each drawn by a parallel loop, with every thread
+    // recording into its own list. The lists are merged in order when rendered.
+    ParallelDrawList& lists = draw->GetRecordingLists();
+    int threadCount = _executor ? _executor->ThreadCount() : 1;
+    uint32_t lineColor = DebugDraw::DefaultLineColor.Packed();
+    uint32_t pointColor = DebugDraw::DefaultPointColor.Packed();
+
+    lists.BeginParallel(threadCount);
+    ParallelFor(_bodies.size(), _grainSizes.bodies, [&](size_t begin, size_t end)
+    {
+        int thread = _executor ? _executor->CurrentThreadIndex() : 0;
+        DrawList& list = lists.BeginRun(thread, begin);
+        for (size_t i = begin; i < end; ++i)
+        {
+            const RigidBody* body = _bodies[i];
+            const Shape* shape = body->GetShape();
+
+            switch (shape->Type())
+            {
+            case ShapeType::Circle:
+                list.AddCircle(body->Position(), ((const CircleShape*)shape)->Radius(), body->Rotation(), lineColor);
+                break;
+
+            case ShapeType::Box:
+                list.AddBox(body->Position(), ((const BoxShape*)shape)->Size(), body->Rotation(), lineColor);
+                break;
+
+            default:
+                assert(false);
+                break;
+            }
+        }
+        lists.EndRun(thread);
+    });
+    lists.EndParallel();
+
+    // Contact points
+    lists.BeginParallel(threadCount);
+    ParallelFor(_pairs.size(), _grainSizes.pairs, [&](size_t begin, size_t end)
+    {
+        int thread = _executor ? _executor->CurrentThreadIndex() : 0;
+        DrawList& list = lists.BeginRun(thread, begin);
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (_pairs[i].HasContact())
+            {
+                list.AddPoint(_pairs[i].Contact().worldPosition, pointColor);
+            }
+        }
+        lists.EndRun(thread);
+    });
+    lists.EndParallel();
+}
+
 void PhysicsWorld::UpdatePairs()
 {
-    // Ideally, we'd implement some sort of broadphase to reduce the number of pairs.
-    // For now, we'll just brute force n^2
-    for (int i = 0; i < (int)_bodies.size(); ++i)
+    if (_staticTreeDirty)
     {
-        RigidBody* body1 = _bodies[i];
+        UpdateStaticTree();
+    }
 
-        for (int j = i + 1; j < (int)_bodies.size(); ++j)
+    // Kinematic bodies' bounds only change when they escape them, and
+    // dynamic bodies are only tested against the static & kinematic bodies
+    // whose bounds they overlap. Kinematic vs static & kinematic pairs can
+    // never respond to each other, so they're never even considered.
+    UpdateKinematicProxies();
+
+    {
+        PROFILE_STAGE(_stats.broadphaseMs);
+        TRACE_SCOPE("FindCandidates");
+        FindCandidates();
+    }
+
+    {
+        PROFILE_STAGE(_stats.narrowphaseMs);
+        TRACE_SCOPE("FindContacts");
+        FindContacts();
+    }
+
+    // Restore PairKey order (which the solver, hash & snapshots depend on).
+    // Each pair's first body always has the lower id.
+    std::sort(std::begin(_pairs), std::end(_pairs), [](const RigidBodyPair& a, const RigidBodyPair& b)
+    {
+        return (a.Body1()->Id() < b.Body1()->Id()) ||
+            (a.Body1()->Id() == b.Body1()->Id() && a.Body2()->Id() < b.Body2()->Id());
+    });
+}
+
+void PhysicsWorld::FindCandidates()
+{
+    // Bounds are grown a little, so that rounding differences between them
+    // and the exact shapes never lose a touching pair. This is the same
+    // margin the trees build with.
+    static const float BoundsMargin = 0.001f;
+
+    _dynamicBounds.resize(_dynamicBodies.size());
+    ParallelFor(_dynamicBodies.size(), _grainSizes.bodies, [this](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            _dynamicBounds[i] = ComputeAABB(_dynamicBodies[i], BoundsMargin);
+        }
+    });
+
+    // Every dynamic body moves every step, so their tree is rebuilt from
+    // scratch, the fast way
+    {
+        TRACE_SCOPE("BuildDynamicTree");
+        _dynamicTree.Build(_dynamicBodies, TreeBuild::Median);
+    }
+
+    // Each block of dynamic bodies is tested against the dynamic bodies with
+    // higher ids (so each pair is only found once), and the static &
+    // kinematic bodies it overlaps
+    size_t blockSize = max(_grainSizes.bodies, (size_t)1);
+    size_t blockCount = (_dynamicBodies.size() + blockSize - 1) / blockSize;
+    if (_candidateBlocks.size() < blockCount)
+    {
+        _candidateBlocks.resize(blockCount);
+    }
+
+    ParallelFor(blockCount, 1, [this, blockSize](size_t firstBlock, size_t lastBlock)
+    {
+        for (size_t blockIndex = firstBlock; blockIndex < lastBlock; ++blockIndex)
         {
-            RigidBody* body2 = _bodies[j];
+            CandidateBlock& block = _candidateBlocks[blockIndex];
+            block.candidates.clear();
 
-            // If both are completely immovable, nothing to do
-            if (body1->InvMass() == 0.0f && body2->InvMass() == 0.0f)
+            size_t first = blockIndex * blockSize;
+            size_t last = min(first + blockSize, _dynamicBodies.size());
+            for (size_t i = first; i < last; ++i)
             {
-                continue;
+                RigidBody* body = _dynamicBodies[i];
+                const AABB& bounds = _dynamicBounds[i];
+
+                block.found.clear();
+                _dynamicTree.Query(bounds, block.found);
+
+                for (auto& other : block.found)
+                {
+                    if (other->Id() > body->Id())
+                    {
+                        CandidatePair candidate = { body, other };
+                        block.candidates.push_back(candidate);
+                    }
+                }
+
+                block.found.clear();
+                _staticTree.Query(bounds, block.found);
+
+                for (auto& staticBody : block.found)
+                {
+                    CandidatePair candidate = { body, staticBody };
+                    block.candidates.push_back(candidate);
+                }
+
+                for (size_t k = 0; k < _kinematicBodies.size(); ++k)
+                {
+                    if (Overlaps(bounds, _kinematicProxies[k]))
+                    {
+                        CandidatePair candidate = { body, _kinematicBodies[k] };
+                        block.candidates.push_back(candidate);
+                    }
+                }
             }
+        }
+    });
+
+    _candidates.clear();
+    for (size_t blockIndex = 0; blockIndex < blockCount; ++blockIndex)
+    {
+        const CandidateBlock& block = _candidateBlocks[blockIndex];
+        _candidates.insert(std::end(_candidates), std::begin(block.candidates), std::end(block.candidates));
+    }
+    PROFILE_COUNT(_stats.pairsTested, (int)_candidates.size());
+}
 
-            // Define new pair structure
-            RigidBodyPair pair(body1, body2);
-            PairKey key(body1, body2);
+void PhysicsWorld::FindContacts()
+{
+    size_t arenaCount = _executor ? (size_t)_executor->ThreadCount() : 1;
+    if (_contactArenas.size() < arenaCount)
+    {
+        _contactArenas.resize(arenaCount);
+    }
+    for (auto& arena : _contactArenas)
+    {
+        arena.pairs.clear();
+        arena.runs.clear();
+        arena.contactsReused = 0;
+        arena.contactsRecomputed = 0;
+    }
 
-            if (pair.HasContact())
+    // Last step's pairs are where cached contacts come from. They're sorted
+    // by PairKey, so each body's pairs (as the lower id) are together.
+    _previousPairs.swap(_pairs);
+
+    bool reuseContacts = _reuseLinearTolerance > 0.0f && _reuseAngularTolerance > 0.0f;
+    if (reuseContacts)
+    {
+        _previousPairStarts.assign(_nextBodyId + 1, 0);
+        for (auto& pair : _previousPairs)
+        {
+            ++_previousPairStarts[pair.Body1()->Id() + 1];
+        }
+        for (uint32_t id = 1; id <= _nextBodyId; ++id)
+        {
+            _previousPairStarts[id] += _previousPairStarts[id - 1];
+        }
+    }
+
+    // Each candidate's collision test is independent of the others, so they
+    // can run in any order, on any thread. Every thread appends what it finds
+    // to its own arena, so there's no sharing (or locking) between them.
+    ParallelFor(_candidates.size(), _grainSizes.pairs, [this, reuseContacts](size_t begin, size_t end)
+    {
+        uint32_t arenaIndex = _executor ? (uint32_t)_executor->CurrentThreadIndex() : 0;
+        ContactArena& arena = _contactArenas[arenaIndex];
+
+        ContactRun run;
+        run.firstCandidate = (uint32_t)begin;
+        run.arena = arenaIndex;
+        run.offset = (uint32_t)arena.pairs.size();
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const RigidBodyPair* previous = reuseContacts ? FindPreviousPair(_candidates[i].body1, _candidates[i].body2) : nullptr;
+            if (previous)
             {
-                // Update the existing pair, if one exists. If not, add one
-                auto it = _pairs.find(key);
-                if (it == std::end(_pairs))
+                RigidBodyPair pair(*previous, _reuseLinearTolerance, _reuseAngularTolerance);
+                if (pair.ContactReused())
                 {
-                    _pairs.insert(std::make_pair(key, pair));
+                    ++arena.contactsReused;
                 }
                 else
                 {
-                    it->second = pair;
+                    ++arena.contactsRecomputed;
+                }
+
+                if (pair.HasContact())
+                {
+                    arena.pairs.push_back(pair);
                 }
             }
             else
             {
-                _pairs.erase(key);
+                RigidBodyPair pair(_candidates[i].body1, _candidates[i].body2);
+                if (pair.HasContact())
+                {
+                    arena.pairs.push_back(pair);
+                }
+            }
+        }
+
+        run.count = (uint32_t)arena.pairs.size() - run.offset;
+        if (run.count > 0)
+        {
+            arena.runs.push_back(run);
+        }
+    });
+
+    // Merge. Putting the runs back in candidate order gives the same list of
+    // pairs whichever threads found them.
+    _contactRuns.clear();
+    for (auto& arena : _contactArenas)
+    {
+        _contactRuns.insert(std::end(_contactRuns), std::begin(arena.runs), std::end(arena.runs));
+        PROFILE_COUNT(_stats.contactsReused, arena.contactsReused);
+        PROFILE_COUNT(_stats.contactsRecomputed, arena.contactsRecomputed);
+    }
+    std::sort(std::begin(_contactRuns), std::end(_contactRuns), [](const ContactRun& a, const ContactRun& b)
+    {
+        return a.firstCandidate < b.firstCandidate;
+    });
+
+    // Contacts are recomputed from scratch every step, so rather than looking
+    // up & updating each pair, just rebuild the list. The list keeps its
+    // capacity from step to step.
+    _pairs.clear();
+    for (auto& run : _contactRuns)
+    {
+        const std::vector<RigidBodyPair>& pairs = _contactArenas[run.arena].pairs;
+        _pairs.insert(std::end(_pairs), std::begin(pairs) + run.offset, std::begin(pairs) + run.offset + run.count);
+    }
+    PROFILE_COUNT(_stats.pairsColliding, (int)_pairs.size());
+}
+
+const RigidBodyPair* PhysicsWorld::FindPreviousPair(const RigidBody* body1, const RigidBody* body2) const
+{
+    PairKey key(body1, body2);
+    for (uint32_t i = _previousPairStarts[key.id1]; i < _previousPairStarts[key.id1 + 1]; ++i)
+    {
+        if (_previousPairs[i].Body2()->Id() == key.id2)
+        {
+            return &_previousPairs[i];
+        }
+    }
+    return nullptr;
+}
+
+void PhysicsWorld::UpdateKinematicProxies()
+{
+    // Most steps, kinematic bodies stay within their enlarged bounds, so
+    // those can be left as they are
+    for (size_t i = 0; i < _kinematicBodies.size(); ++i)
+    {
+        if (!Contains(_kinematicProxies[i], ComputeAABB(_kinematicBodies[i])))
+        {
+            PROFILE_COUNT(_stats.proxiesUpdated, 1);
+            RefitProxy(_kinematicBodies[i], _kinematicProxies[i]);
+        }
+    }
+}
+
+// Root of index's set, halving the path to it on the way up
+static uint32_t FindRoot(std::vector<uint32_t>& parents, uint32_t index)
+{
+    while (parents[index] != index)
+    {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
+    }
+    return index;
+}
+
+void PhysicsWorld::BuildIslands()
+{
+    size_t bodyCount = _dynamicBodies.size();
+    _islandParents.resize(bodyCount);
+    for (size_t i = 0; i < bodyCount; ++i)
+    {
+        _dynamicBodies[i]->_islandIndex = (uint32_t)i;
+        _islandParents[i] = (uint32_t)i;
+    }
+
+    // Join the sets of the two bodies of each pair between dynamic bodies
+    for (auto& pair : _pairs)
+    {
+        if (pair.Body1()->InvMass() != 0.0f && pair.Body2()->InvMass() != 0.0f)
+        {
+            uint32_t root1 = FindRoot(_islandParents, pair.Body1()->_islandIndex);
+            uint32_t root2 = FindRoot(_islandParents, pair.Body2()->_islandIndex);
+            if (root1 < root2)
+            {
+                _islandParents[root2] = root1;
+            }
+            else
+            {
+                _islandParents[root1] = root2;
             }
         }
     }
+
+    // Number the islands in the order their first pairs appear, and count
+    // the pairs in each. Every pair has at least one dynamic body.
+    _islandOfRoot.assign(bodyCount, UINT32_MAX);
+    _pairIslands.resize(_pairs.size());
+    _islandStarts.clear();
+    for (size_t i = 0; i < _pairs.size(); ++i)
+    {
+        const RigidBody* body = (_pairs[i].Body1()->InvMass() != 0.0f) ? _pairs[i].Body1() : _pairs[i].Body2();
+        uint32_t root = FindRoot(_islandParents, body->_islandIndex);
+        if (_islandOfRoot[root] == UINT32_MAX)
+        {
+            _islandOfRoot[root] = (uint32_t)_islandStarts.size();
+            _islandStarts.push_back(0);
+        }
+
+        _pairIslands[i] = _islandOfRoot[root];
+        ++_islandStarts[_pairIslands[i]];
+    }
+
+    // Turn the counts into offsets (plus one for the end of the last island),
+    // then place each pair in its island, keeping them in _pairs order
+    uint32_t offset = 0;
+    for (auto& start : _islandStarts)
+    {
+        uint32_t count = start;
+        start = offset;
+        offset += count;
+    }
+    _islandStarts.push_back(offset);
+
+    _islandPairs.resize(_pairs.size());
+    for (size_t i = 0; i < _pairs.size(); ++i)
+    {
+        _islandPairs[_islandStarts[_pairIslands[i]]++] = (uint32_t)i;
+    }
+
+    // Placing the pairs moved each island's start on to the next island's
+    for (size_t i = _islandStarts.size() - 1; i > 0; --i)
+    {
+        _islandStarts[i] = _islandStarts[i - 1];
+    }
+    _islandStarts[0] = 0;
+}
+
+void PhysicsWorld::SolveIslands()
+{
+    BuildIslands();
+
+    // Each island's pairs are solved in the same order as they would be
+    // solving all of _pairs at once, and islands share no bodies that the
+    // solver writes to, so this gives exactly the same results. Scenes
+    // where everything touches (one big pile) are a single island though,
+    // which runs on a single thread.
+    size_t islandCount = _islandStarts.size() - 1;
+    PROFILE_COUNT(_stats.islands, (int)islandCount);
+
+    ParallelFor(islandCount, _grainSizes.islands, [this](size_t begin, size_t end)
+    {
+        for (size_t island = begin; island < end; ++island)
+        {
+            for (int i = 0; i < _maxIterations; ++i)
+            {
+                for (uint32_t k = _islandStarts[island]; k < _islandStarts[island + 1]; ++k)
+                {
+                    _pairs[_islandPairs[k]].Solve();
+                }
+            }
+        }
+    });
 }
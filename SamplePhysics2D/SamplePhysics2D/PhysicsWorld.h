@@ -1,9 +1,12 @@
 #pragma once
 
 #include "RigidBodyPair.h"
+#include "Broadphase.h"
+#include "Collision.h"
+#include "Profiling.h"
+#include "JobSystem.h"
 
-class RigidBody;
-class DebugRenderer;
+class DebugDraw;
 
 // The physics world is the container for the physics simulation.
 class PhysicsWorld
@@ -13,19 +16,253 @@ public:
     // number of iterations the solver is allowed to use.
     PhysicsWorld(const Vector2& gravity, int maxIterations);
 
+    // Bodies are assigned their ids here, in the order they're added.
+    // Static bodies (those with infinite mass, that aren't kinematic) must not
+    // be moved once added.
     void AddBody(RigidBody* body);
+
+    // Adds a contiguous array of bodies in one go (in array order)
+    void AddBodies(RigidBody* bodies, size_t count);
     void RemoveBody(RigidBody* body);
 
+    // All bodies in the world, sorted by id (the order they were added)
+    const std::vector<RigidBody*>& Bodies() const { return _bodies; }
+
     // Step the simulation forward by dt seconds
     void Update(float dt);
 
-    void Draw(DebugRenderer* renderer);
+    // Records the bodies & contact points into draw's lists for the frame,
+    // split across the executor's threads (if the world has one)
+    void Draw(DebugDraw* draw);
+
+    // Update runs its stages (finding contacts, integration, PreSolve, and
+    // solving islands of touching bodies) as parallel loops on an executor, if
+    // the world has one. The results are bit identical however many threads
+    // there are, and whatever the grain sizes.
+
+    // Creates a JobSystem for the world to own & use, with threadCount
+    // threads (-1 for one per hardware thread). 0 goes back to running
+    // everything on the calling thread.
+    void CreateJobSystem(int threadCount);
+
+    // Uses an existing executor instead (for instance, one wrapping the
+    // game's own thread pool), or none if null. The world doesn't take it
+    // over, so it must outlive the world (or be swapped out before it's destroyed).
+    void SetExecutor(Executor* executor);
+    Executor* GetExecutor() const { return _executor; }
+
+    // How much work each task of Update's parallel loops is given. Smaller
+    // tasks balance better across threads, but each has a fixed overhead.
+    struct GrainSizes
+    {
+        GrainSizes() : bodies(64), pairs(256), islands(4) {}
+
+        size_t bodies;      // bodies per task, when finding contacts & integrating
+        size_t pairs;       // pairs per task, for PreSolve
+        size_t islands;     // islands per task, for the solver
+    };
+
+    const GrainSizes& GetGrainSizes() const { return _grainSizes; }
+    void SetGrainSizes(const GrainSizes& grainSizes) { _grainSizes = grainSizes; }
+
+    // Touching bodies that have moved less than these (in distance & angle)
+    // relative to each other since their contact was last found keep that
+    // contact, rather than having collision detection run on them again.
+    // Contacts are only reused when both tolerances are greater than zero;
+    // pass zeros for both to turn it off. It's off by default, because it
+    // measured slower than always running the narrowphase: checking each pair
+    // against its previous contact costs about as much as the box & circle
+    // tests it skips, and only resting stacks at the loosest tolerance come
+    // out ahead (see the coherence benchmark).
+    void SetContactReuseTolerances(float linear, float angular);
+
+    // Scene queries. These see bodies where they were at the end of the most
+    // recent Update (or LoadState), and see bodies added or removed since
+    // then: the first query after an Update, or after bodies are added or
+    // removed, rebuilds the trees it searches, so steps taken without any
+    // queries never pay for them. Otherwise they don't modify the world, so
+    // any number of them can run at once, from any threads, as long as
+    // nothing is updating (or adding to) the world.
+
+    // Finds the first body hit by the segment from start to end. Returns false
+    // if there isn't one. Segments starting inside a body don't hit it.
+    bool RayCast(const Vector2& start, const Vector2& end, RayCastHit* hit) const;
+
+    // Casts count segments, writing the first hit for each into hits (with a
+    // null body for those that miss). Returns the number that hit something.
+    // Consecutive segments are traversed together in packets, so this is
+    // cheaper than casting them one at a time, especially when neighbors in
+    // the array start close together & point the same way (see BatchRayCaster).
+    size_t RayCastBatch(const Vector2* starts, const Vector2* ends, size_t count, RayCastHit* hits) const;
+
+    // Sweeps shape, at the given rotation, from start to end, and finds the
+    // first body it touches. Returns false if there isn't one.
+    bool ShapeCast(const Shape* shape, float rotation, const Vector2& start, const Vector2& end, RayCastHit* hit) const;
+
+    // Appends the bodies whose bounds overlap box to results
+    void QueryAABB(const AABB& box, std::vector<RigidBody*>& results) const;
+
+    // Runs count box queries, appending the results of each in turn to
+    // results, and the number of bodies each one found to counts
+    void QueryAABBBatch(const AABB* boxes, size_t count, std::vector<RigidBody*>& results, std::vector<uint32_t>& counts) const;
+
+    // Appends the bodies containing point to results
+    void QueryPoint(const Vector2& point, std::vector<RigidBody*>& results) const;
+
+    // Timings and counters from the most recent Update.
+    // All zero if PHYSICS_PROFILING is disabled.
+    const StepStats& GetStepStats() const { return _stats; }
+
+    // Hash of the full simulation state (each body's state vector, and the
+    // impulses accumulated on each contact). Runs fed identical inputs produce
+    // identical hashes after every step, so comparing them is a cheap way to
+    // assert that replays or lockstep peers haven't diverged.
+    uint64_t ComputeStateHash() const;
+
+    // Writes a snapshot of the complete simulation state (bodies' state
+    // vectors, pairs & their accumulated impulses, and with contact reuse on,
+    // the pairs' caches) into buffer, for rollback. Contact points aren't
+    // saved, as the next step finds them again. The buffer is resized to
+    // exactly the snapshot's size, so it can be passed straight to LoadState;
+    // its capacity is kept, so saving into the same one repeatedly doesn't
+    // allocate.
+    void SaveState(std::vector<uint8_t>& buffer) const;
+
+    // Restores a snapshot written by SaveState. The world must hold the same
+    // bodies, in the same order, as when it was saved, and if contact reuse
+    // is on now, it must have been on then. Simulation resumes bit identically
+    // from the restored state (contact points are only drawn again after the
+    // next step). Returns false (and leaves the world untouched) if the
+    // snapshot is invalid or doesn't match the world.
+    bool LoadState(const uint8_t* data, size_t size);
 
 private:
+    // Pair whose bounds overlap, for the narrowphase to test
+    struct CandidatePair
+    {
+        RigidBody* body1;
+        RigidBody* body2;
+    };
+
+    // Candidates are found for a block of GrainSizes::bodies dynamic bodies
+    // per task, each writing into its own block's list. The lists are then
+    // joined in block order. Blocks keep their capacity from step to step.
+    struct CandidateBlock
+    {
+        std::vector<CandidatePair> candidates;
+        std::vector<RigidBody*> found;      // scratch for tree queries
+    };
+
+    // The narrowphase's contacts from candidates [firstCandidate,
+    // firstCandidate + count), stored in an arena from offset on
+    struct ContactRun
+    {
+        uint32_t firstCandidate;
+        uint32_t arena;
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // Contacts found by one thread's narrowphase tasks, plus a run for each
+    // task, so they can be put back in candidate order however the tasks were
+    // spread across threads. Arenas keep their capacity from step to step.
+    struct ContactArena
+    {
+        std::vector<RigidBodyPair> pairs;
+        std::vector<ContactRun> runs;
+        int contactsReused;
+        int contactsRecomputed;
+    };
+
     void UpdatePairs();
 
+    // Broadphase. Fills _candidates with the pairs of bodies whose bounds
+    // overlap, in the same order every run.
+    void FindCandidates();
+
+    // Narrowphase. Runs collision detection on every candidate, in parallel,
+    // then merges the contacts from each thread's arena into _pairs.
+    void FindContacts();
+
+    // Runs fn over [0, count) on the executor, or on this thread if there isn't one
+    void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& fn);
+
+    // Groups _pairs into islands, sets of pairs linked by the dynamic bodies
+    // they share. Static & kinematic bodies never have impulses applied to
+    // them, so they don't link islands together, and each island can be
+    // solved independently of (and in parallel with) the others.
+    void BuildIslands();
+
+    // Runs the solver iterations over each island's pairs, in parallel
+    void SolveIslands();
+
+    // The pair for the same bodies in _previousPairs, or null if there isn't one
+    const RigidBodyPair* FindPreviousPair(const RigidBody* body1, const RigidBody* body2) const;
+
+    // Rebuilds the tree of moving bodies that scene queries use
+    void UpdateQueryTree() const;
+
+    // Rebuilds the tree of static bodies, which both finding pairs and queries use
+    void UpdateStaticTree() const;
+
+    // Rebuilds whichever trees bodies have been added to or removed from since
+    // they were last built. Any number of queries can run at once, so the first
+    // to find a tree out of date rebuilds it while the others wait.
+    void PrepareQueryTrees() const;
+
+    // Refits the bounds of any kinematic bodies that have moved out of them
+    void UpdateKinematicProxies();
+
+    // Index into _bodies of the body with the given id
+    uint32_t FindBodyIndex(uint32_t id) const;
+
     Vector2 _gravity;
     int _maxIterations;
+    uint32_t _nextBodyId;
     std::vector<RigidBody*> _bodies;
-    std::map<PairKey, RigidBodyPair> _pairs;
+
+    // _bodies split into those that are simulated, those moved only by their
+    // velocities, and those that never move. All are sorted by id. Statics are
+    // only ever visited through _staticTree, which is rebuilt (by the next
+    // Update or query) whenever one is added or removed.
+    std::vector<RigidBody*> _dynamicBodies;
+    std::vector<RigidBody*> _kinematicBodies;
+    std::vector<AABB> _kinematicProxies;    // enlarged bounds of each of _kinematicBodies
+    std::vector<RigidBody*> _staticBodies;
+    mutable BodyTree _staticTree;
+    mutable std::atomic<bool> _staticTreeDirty;
+
+    // Dynamic & kinematic bodies, for scene queries. Rebuilt by the first
+    // query after a step, or after bodies are added, removed or loaded.
+    mutable BodyTree _movingTree;
+    mutable std::vector<RigidBody*> _movingBodies;
+    mutable std::atomic<bool> _movingTreeDirty;
+    mutable std::mutex _queryTreeLock;     // held while queries rebuild the trees
+    std::vector<RigidBodyPair> _pairs;  // pairs in contact, sorted by PairKey
+    std::vector<RigidBodyPair> _previousPairs;  // last step's _pairs, while finding contacts
+    std::vector<uint32_t> _previousPairStarts;  // by id, the first of _previousPairs whose Body1 has it
+    float _reuseLinearTolerance;
+    float _reuseAngularTolerance;
+
+    Executor* _executor;
+    std::unique_ptr<JobSystem> _ownedJobSystem;
+    GrainSizes _grainSizes;
+
+    std::vector<AABB> _dynamicBounds;       // bounds of each of _dynamicBodies
+    BodyTree _dynamicTree;                  // _dynamicBodies at their _dynamicBounds, for finding pairs
+    std::vector<CandidateBlock> _candidateBlocks;
+    std::vector<CandidatePair> _candidates;
+    std::vector<ContactArena> _contactArenas;   // one per executor thread
+    std::vector<ContactRun> _contactRuns;
+
+    // Union find over _dynamicBodies, used to build islands. Each island's
+    // pairs are _islandPairs[_islandStarts[i], _islandStarts[i + 1]), as
+    // indices into _pairs (in _pairs order).
+    std::vector<uint32_t> _islandParents;
+    std::vector<uint32_t> _islandOfRoot;
+    std::vector<uint32_t> _pairIslands;
+    std::vector<uint32_t> _islandPairs;
+    std::vector<uint32_t> _islandStarts;
+
+    StepStats _stats;
 };
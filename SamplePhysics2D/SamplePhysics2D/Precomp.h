@@ -1,18 +1,48 @@
 #pragma once
 
+#ifdef _WIN32
 #include <Windows.h>
-#include <d3d11.h>
-#include <wrl.h>
+#endif
 
 #include <stdint.h>
+#include <stdio.h>
 #include <assert.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <float.h>
+#include <string.h>
 
 #include <memory>
 #include <vector>
 #include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+#include <chrono>
+
+#ifndef _WIN32
+// The rest of Windows.h that the code uses: its min & max, and _countof
+using std::min;
+using std::max;
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+#endif
+
+// Don't let the compiler fuse multiplies and adds (FMA). Whether it does so
+// varies with compiler, flags and target, and changes results in the last
+// bits, so the simulation wouldn't be bit identical across builds & machines.
+#pragma fp_contract (off)
 
 // math headers
+#include "SimdFloat.h"
+#include "Scalar.h"
 #include "Vector2.h"
-#include "Matrix2.h"
\ No newline at end of file
+#include "Matrix2.h"
+#include "Vector2Wide.h"
+
+// core types
+#include "CoreTypes.h"
\ No newline at end of file
@@ -0,0 +1,18 @@
+#include "Precomp.h"
+#include "Profiling.h"
+
+// steady_clock reads the high resolution counter (QueryPerformanceCounter on
+// Windows, clock_gettime(CLOCK_MONOTONIC) elsewhere), and never goes backwards
+typedef std::chrono::steady_clock ProfileClock;
+
+static const double MillisecondsPerTick = 1000.0 * ProfileClock::period::num / ProfileClock::period::den;
+
+int64_t GetProfileTicks()
+{
+    return (int64_t)ProfileClock::now().time_since_epoch().count();
+}
+
+double TicksToMilliseconds(int64_t ticks)
+{
+    return (double)ticks * MillisecondsPerTick;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Set PHYSICS_PROFILING to 0 (in the project's preprocessor definitions) to
+// compile all of the step instrumentation out of the physics code.
+#ifndef PHYSICS_PROFILING
+#define PHYSICS_PROFILING 1
+#endif
+
+// Reads the high resolution performance counter
+int64_t GetProfileTicks();
+
+// Converts a performance counter delta into milliseconds
+double TicksToMilliseconds(int64_t ticks);
+
+// Timings and counters gathered over a single PhysicsWorld::Update
+struct StepStats
+{
+    StepStats()
+        : updatePairsMs(0), broadphaseMs(0), narrowphaseMs(0), integrateForcesMs(0), preSolveMs(0)
+        , solveMs(0), integrateVelocitiesMs(0), totalMs(0)
+        , bodiesActive(0), pairsTested(0), pairsColliding(0), iterations(0)
+        , proxiesUpdated(0), islands(0), contactsReused(0), contactsRecomputed(0)
+    {}
+
+    // Time spent in each stage of the step, in milliseconds
+    double updatePairsMs;
+    double broadphaseMs;        // part of updatePairsMs spent finding candidate pairs
+    double narrowphaseMs;       // and part spent testing them for contact
+    double integrateForcesMs;
+    double preSolveMs;
+    double solveMs;
+    double integrateVelocitiesMs;
+    double totalMs;
+
+    int bodiesActive;       // non static bodies integrated this step
+    int pairsTested;        // candidate pairs passed to the narrowphase (Collide)
+    int pairsColliding;     // pairs found to be in contact
+    int iterations;         // solver iterations run
+    int proxiesUpdated;     // kinematic bodies that moved out of their broadphase bounds
+    int islands;            // islands solved in parallel (0 when solving on one thread)
+    int contactsReused;     // contacts carried over from an earlier step (narrowphase skipped)
+    int contactsRecomputed; // pairs in contact last step that moved too far to reuse it (if reuse is on)
+};
+
+// Measures the lifetime of the object and writes it out (in ms) on destruction
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(double& result) : _result(result), _start(GetProfileTicks()) {}
+    ~ScopedStageTimer() { _result = TicksToMilliseconds(GetProfileTicks() - _start); }
+
+private:
+    double& _result;
+    int64_t _start;
+
+    // Prevent copy
+    ScopedStageTimer(const ScopedStageTimer&);
+    ScopedStageTimer& operator= (const ScopedStageTimer&);
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if PHYSICS_PROFILING
+// Times the enclosing scope, storing the result in the given StepStats field
+#define PROFILE_STAGE(result) ScopedStageTimer PROFILE_CONCAT(_stageTimer, __LINE__)(result)
+// Adds to one of the StepStats counters
+#define PROFILE_COUNT(counter, n) ((counter) += (n))
+#else
+#define PROFILE_STAGE(result)
+#define PROFILE_COUNT(counter, n) ((void)0)
+#endif
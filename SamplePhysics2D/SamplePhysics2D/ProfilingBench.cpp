@@ -0,0 +1,91 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+
+// Measures what the step instrumentation costs. Times a stage timer (reading
+// the counter twice & storing the result) on its own, then steps piles of
+// bodies and reports the timers' share of each step. Fails if that's 1% or
+// more.
+//
+// Building with PHYSICS_PROFILING set to 0 compiles the timers out; the step
+// times reported then are the ones to compare against.
+
+static const int TimerRuns = 1000000;
+static const int SettleSteps = 30;
+static const int Steps = 200;
+static const float Dt = 1.0f / 60.0f;
+
+// Stage timers started by each PhysicsWorld::Update: the whole step, finding
+// pairs (& its broadphase and narrowphase), integrating forces, PreSolve,
+// solving, integrating velocities & updating the query tree
+static const int TimersPerStep = 9;
+
+static const double MaxOverhead = 0.01;
+
+static double TimeStageTimer()
+{
+    double result = 0, sum = 0;
+    int64_t start = GetProfileTicks();
+    for (int i = 0; i < TimerRuns; ++i)
+    {
+        {
+            ScopedStageTimer timer(result);
+        }
+        sum += result;
+    }
+    int64_t ticks = GetProfileTicks() - start;
+
+    // Uses the results, so the loop isn't optimized away
+    return sum >= 0 ? TicksToMilliseconds(ticks) * 1e6 / TimerRuns : 0;
+}
+
+// Returns the time per step, in ms
+static double TimeSteps(int bodyCount)
+{
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 10);
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    CreateBenchScene(&world, bodies, bodyCount, 29);
+    for (int i = 0; i < SettleSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+
+    int64_t start = GetProfileTicks();
+    for (int i = 0; i < Steps; ++i)
+    {
+        world.Update(Dt);
+    }
+    return TicksToMilliseconds(GetProfileTicks() - start) / Steps;
+}
+
+bool BenchProfiling(FILE* output)
+{
+    static const int BodyCounts[] = { 100, 1000, 10000 };
+
+#if PHYSICS_PROFILING
+    double timerNs = TimeStageTimer();
+    fprintf(output, "profiling on: %.1f ns a stage timer, %d timers a step\n", timerNs, TimersPerStep);
+#else
+    fprintf(output, "profiling compiled out\n");
+#endif
+
+    bool succeeded = true;
+    for (int i = 0; i < _countof(BodyCounts); ++i)
+    {
+        double stepMs = TimeSteps(BodyCounts[i]);
+#if PHYSICS_PROFILING
+        double overhead = TimersPerStep * timerNs * 1e-6 / stepMs;
+        fprintf(output, "%6d bodies  %8.3f ms/step  timers %6.3f%%\n", BodyCounts[i], stepMs, overhead * 100.0);
+        if (overhead >= MaxOverhead)
+        {
+            fprintf(output, "  over the %.0f%% budget\n", MaxOverhead * 100.0);
+            succeeded = false;
+        }
+#else
+        fprintf(output, "%6d bodies  %8.3f ms/step\n", BodyCounts[i], stepMs);
+#endif
+    }
+    return succeeded;
+}
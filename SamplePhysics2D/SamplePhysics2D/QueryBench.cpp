@@ -0,0 +1,230 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "Broadphase.h"
+#include "Collision.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+// Runs scene queries against a settled pile of bodies, checks each kind
+// against brute force over every body, and checks that rays cast from several
+// threads at once give the same results as casting them on one.
+
+static const int BodyCount = 2000;
+static const int SettleSteps = 30;
+static const int RayCount = 20000;
+static const int BoxQueryCount = 5000;
+static const int PointQueryCount = 20000;
+static const int ShapeCastCount = 500;
+static const int ThreadCount = 4;
+static const float Dt = 1.0f / 60.0f;
+
+// Two hits agree if they found the same body, or (if two bodies are touching
+// where the ray enters) bodies at the same distance
+static bool SameHit(const RayCastHit& a, const RayCastHit& b)
+{
+    if (!a.body || !b.body)
+    {
+        return a.body == b.body;
+    }
+    return a.body == b.body || fabsf(a.fraction - b.fraction) < 1e-5f;
+}
+
+// Random point around (and somewhat above) the pile
+static Vector2 RandomPoint(BenchRandom& random, float width, float height)
+{
+    return Vector2(random.Range(-0.6f * width, 0.6f * width), random.Range(-1.0f, 1.2f * height));
+}
+
+bool BenchQuery(FILE* output)
+{
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 10);
+    CreateBenchScene(&world, bodies, BodyCount, 11);
+    for (int i = 0; i < SettleSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+
+    float width = sqrtf((float)BodyCount) + 2.0f;
+    float height = (float)BodyCount / sqrtf((float)BodyCount) + 1.0f;
+    BenchRandom random(12);
+    int mismatches = 0;
+
+    // Rays, one at a time & batched, against brute force
+    std::vector<Vector2> starts(RayCount), ends(RayCount);
+    for (int i = 0; i < RayCount; ++i)
+    {
+        starts[i] = RandomPoint(random, width, height);
+        ends[i] = starts[i] + Vector2(random.Range(-20.0f, 20.0f), random.Range(-20.0f, 20.0f));
+    }
+
+    std::vector<RayCastHit> hits(RayCount), batchHits(RayCount);
+    int64_t start = GetProfileTicks();
+    for (int i = 0; i < RayCount; ++i)
+    {
+        world.RayCast(starts[i], ends[i], &hits[i]);
+    }
+    double rayMs = TicksToMilliseconds(GetProfileTicks() - start);
+
+    start = GetProfileTicks();
+    size_t hitCount = world.RayCastBatch(starts.data(), ends.data(), RayCount, batchHits.data());
+    double batchMs = TicksToMilliseconds(GetProfileTicks() - start);
+
+    start = GetProfileTicks();
+    for (int i = 0; i < RayCount; ++i)
+    {
+        RayCastHit expected = {};
+        expected.fraction = 1.0f;
+        for (auto& body : world.Bodies())
+        {
+            RayCastHit candidate;
+            if (RayCastBody(body, starts[i], ends[i], expected.fraction, candidate) &&
+                (!expected.body || candidate.fraction < expected.fraction))
+            {
+                expected = candidate;
+            }
+        }
+
+        if (!SameHit(hits[i], expected) || !SameHit(batchHits[i], expected))
+        {
+            ++mismatches;
+        }
+    }
+    double bruteRayMs = TicksToMilliseconds(GetProfileTicks() - start);
+
+    // The same batch split across threads
+    std::vector<RayCastHit> threadHits(RayCount);
+    std::vector<std::thread> threads;
+    start = GetProfileTicks();
+    for (int t = 0; t < ThreadCount; ++t)
+    {
+        size_t first = (size_t)RayCount * t / ThreadCount;
+        size_t last = (size_t)RayCount * (t + 1) / ThreadCount;
+        threads.push_back(std::thread([&world, &starts, &ends, &threadHits, first, last]()
+        {
+            world.RayCastBatch(&starts[first], &ends[first], last - first, &threadHits[first]);
+        }));
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    double threadMs = TicksToMilliseconds(GetProfileTicks() - start);
+
+    int threadMismatches = 0;
+    for (int i = 0; i < RayCount; ++i)
+    {
+        if (threadHits[i].body != batchHits[i].body || threadHits[i].fraction != batchHits[i].fraction)
+        {
+            ++threadMismatches;
+        }
+    }
+
+    // Boxes: everything brute force finds must be found (the trees pad
+    // bounds slightly, so may find a little more)
+    std::vector<AABB> boxes(BoxQueryCount);
+    for (int i = 0; i < BoxQueryCount; ++i)
+    {
+        Vector2 center = RandomPoint(random, width, height);
+        Vector2 extents(random.Range(0.1f, 3.0f), random.Range(0.1f, 3.0f));
+        boxes[i] = AABB(center - extents, center + extents);
+    }
+
+    std::vector<RigidBody*> results;
+    std::vector<uint32_t> counts;
+    start = GetProfileTicks();
+    world.QueryAABBBatch(boxes.data(), boxes.size(), results, counts);
+    double boxMs = TicksToMilliseconds(GetProfileTicks() - start);
+    size_t boxResults = results.size();
+
+    size_t offset = 0;
+    for (int i = 0; i < BoxQueryCount; ++i)
+    {
+        auto first = std::begin(results) + offset;
+        auto last = first + counts[i];
+        for (auto& body : world.Bodies())
+        {
+            if (Overlaps(ComputeAABB(body), boxes[i]) && std::find(first, last, body) == last)
+            {
+                ++mismatches;
+            }
+        }
+        offset += counts[i];
+    }
+
+    // Points must find exactly the bodies containing them
+    double pointMs = 0;
+    for (int i = 0; i < PointQueryCount; ++i)
+    {
+        Vector2 point = RandomPoint(random, width, height);
+        results.clear();
+        start = GetProfileTicks();
+        world.QueryPoint(point, results);
+        pointMs += TicksToMilliseconds(GetProfileTicks() - start);
+
+        size_t expected = 0;
+        for (auto& body : world.Bodies())
+        {
+            if (BodyContainsPoint(body, point))
+            {
+                ++expected;
+                if (std::find(std::begin(results), std::end(results), body) == std::end(results))
+                {
+                    ++mismatches;
+                }
+            }
+        }
+        if (expected != results.size())
+        {
+            ++mismatches;
+        }
+    }
+
+    // Shape casts, alternating circles & boxes
+    CircleShape circle(0.3f);
+    BoxShape box(0.5f, 0.3f);
+    double shapeCastMs = 0;
+    for (int i = 0; i < ShapeCastCount; ++i)
+    {
+        const Shape* shape = (i % 2 == 0) ? (const Shape*)&circle : (const Shape*)&box;
+        float rotation = random.Range(0.0f, 3.0f);
+        Vector2 from = Vector2(random.Range(-0.6f * width, 0.6f * width), 1.3f * height);
+        Vector2 to = from + Vector2(random.Range(-10.0f, 10.0f), -1.5f * height);
+
+        RayCastHit hit;
+        start = GetProfileTicks();
+        world.ShapeCast(shape, rotation, from, to, &hit);
+        shapeCastMs += TicksToMilliseconds(GetProfileTicks() - start);
+
+        RayCastHit expected = {};
+        expected.fraction = 1.0f;
+        for (auto& body : world.Bodies())
+        {
+            RayCastHit candidate;
+            if (ShapeCastBody(shape, rotation, from, to, body, expected.fraction, candidate) &&
+                (!expected.body || candidate.fraction < expected.fraction))
+            {
+                expected = candidate;
+            }
+        }
+        if (!SameHit(hit, expected))
+        {
+            ++mismatches;
+        }
+    }
+
+    fprintf(output, "%d bodies\n", BodyCount + 3);
+    fprintf(output, "RayCast          %8.3f us/ray (brute force %.3f), %u of %d hit\n",
+        rayMs * 1000.0 / RayCount, bruteRayMs * 1000.0 / RayCount, (uint32_t)hitCount, RayCount);
+    fprintf(output, "RayCastBatch     %8.3f us/ray\n", batchMs * 1000.0 / RayCount);
+    fprintf(output, "  on %d threads  %8.3f us/ray, %d differences\n", ThreadCount, threadMs * 1000.0 / RayCount, threadMismatches);
+    fprintf(output, "QueryAABBBatch   %8.3f us/box (%.1f bodies found on average)\n",
+        boxMs * 1000.0 / BoxQueryCount, (double)boxResults / BoxQueryCount);
+    fprintf(output, "QueryPoint       %8.3f us/point\n", pointMs * 1000.0 / PointQueryCount);
+    fprintf(output, "ShapeCast        %8.3f us/cast\n", shapeCastMs * 1000.0 / ShapeCastCount);
+    fprintf(output, "Mismatches against brute force: %d\n", mismatches);
+
+    return mismatches == 0 && threadMismatches == 0;
+}
@@ -0,0 +1,124 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "BatchRayCaster.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "ThreadPool.h"
+
+// Casts a tick's worth of AI sensor rays (a fan of rays from each of a few
+// hundred agents, submitted in no particular order) against a settled pile,
+// one at a time, in packets, sorted into coherent packets, and sorted across
+// a thread pool. Reports rays per second for each, and checks they all agree.
+
+static const int BodyCount = 2000;
+static const int SettleSteps = 30;
+static const int AgentCount = 500;
+static const int RaysPerAgent = 100;
+static const int RayCount = AgentCount * RaysPerAgent;
+static const float RayLength = 15.0f;
+static const int Ticks = 5;
+static const float Dt = 1.0f / 60.0f;
+
+static bool SameHit(const RayCastHit& a, const RayCastHit& b)
+{
+    if (!a.body || !b.body)
+    {
+        return a.body == b.body;
+    }
+    return a.body == b.body || fabsf(a.fraction - b.fraction) < 1e-5f;
+}
+
+bool BenchRayCast(FILE* output)
+{
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 10);
+    CreateBenchScene(&world, bodies, BodyCount, 21);
+    for (int i = 0; i < SettleSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+
+    // Agents scattered over the pile, each sweeping a 90 degree fan
+    float width = sqrtf((float)BodyCount);
+    BenchRandom random(22);
+    std::vector<Vector2> starts, ends;
+    for (int i = 0; i < AgentCount; ++i)
+    {
+        Vector2 agent(random.Range(-0.5f * width, 0.5f * width), random.Range(0.0f, width));
+        float facing = random.Range(0.0f, 2.0f * (float)M_PI);
+        for (int j = 0; j < RaysPerAgent; ++j)
+        {
+            float angle = facing + (j - 0.5f * RaysPerAgent) * (0.5f * (float)M_PI / RaysPerAgent);
+            starts.push_back(agent);
+            ends.push_back(agent + RayLength * Vector2(cosf(angle), sinf(angle)));
+        }
+    }
+
+    // Submitted in no particular order
+    for (int i = RayCount - 1; i > 0; --i)
+    {
+        int j = (int)(random.Next() % (uint32_t)(i + 1));
+        std::swap(starts[i], starts[j]);
+        std::swap(ends[i], ends[j]);
+    }
+
+    std::vector<RayCastHit> expected(RayCount), hits(RayCount);
+    ThreadPool pool;
+    BatchRayCaster unsorted;
+    unsorted.EnableSorting(false);
+    BatchRayCaster sorted;
+    BatchRayCaster threaded(&pool);
+
+    struct Method
+    {
+        const char* name;
+        BatchRayCaster* caster;
+    };
+    Method methods[] =
+    {
+        { "RayCast, one at a time", nullptr },
+        { "Packets", &unsorted },
+        { "Sorted packets", &sorted },
+        { "Sorted packets, threaded", &threaded },
+    };
+
+    fprintf(output, "%d rays per tick (%d agents), %d bodies, %d threads\n", RayCount, AgentCount, BodyCount + 3, pool.ThreadCount());
+
+    int mismatches = 0;
+    for (int m = 0; m < _countof(methods); ++m)
+    {
+        std::vector<RayCastHit>& results = (m == 0) ? expected : hits;
+
+        int64_t start = GetProfileTicks();
+        for (int tick = 0; tick < Ticks; ++tick)
+        {
+            if (methods[m].caster)
+            {
+                methods[m].caster->Cast(world, starts.data(), ends.data(), RayCount, results.data());
+            }
+            else
+            {
+                for (int i = 0; i < RayCount; ++i)
+                {
+                    world.RayCast(starts[i], ends[i], &results[i]);
+                }
+            }
+        }
+        double ms = TicksToMilliseconds(GetProfileTicks() - start) / Ticks;
+
+        int methodMismatches = 0;
+        for (int i = 0; m > 0 && i < RayCount; ++i)
+        {
+            if (!SameHit(hits[i], expected[i]))
+            {
+                ++methodMismatches;
+            }
+        }
+        mismatches += methodMismatches;
+
+        fprintf(output, "%-26s %8.2f ms/tick %8.2f Mrays/s, %d mismatches\n", methods[m].name, ms, RayCount / (ms * 1000.0), methodMismatches);
+    }
+
+    return mismatches == 0;
+}
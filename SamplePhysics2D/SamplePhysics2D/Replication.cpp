@@ -0,0 +1,368 @@
+#include "Precomp.h"
+#include "Replication.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+
+// Packet layout (bit packed, least significant bit first):
+//   32 bits    tick
+//   32 bits    baseline tick
+//    1 bit     1 if this is a delta from the baseline, 0 if it's a full state
+//   32 bits    body count
+// then for each body:
+//    1 bit     1 if the body is included
+//   if included, for each of its 6 values, the zigzag encoded delta from the
+//   baseline value as:
+//    6 bits    number of significant bits (n)
+//    n bits    the delta
+
+static const int RotationBits = 16;
+static const int32_t MaxQuantized = 1 << 30;
+static const int RotationValue = 2;
+
+class BitWriter
+{
+public:
+    BitWriter(std::vector<uint8_t>& buffer) : _buffer(buffer), _scratch(0), _scratchBits(0)
+    {
+        _buffer.clear();
+    }
+
+    void Write(uint32_t value, int bits)
+    {
+        if (bits == 0)
+        {
+            return;
+        }
+
+        _scratch |= (uint64_t)(value & (uint32_t)(0xFFFFFFFFull >> (32 - bits))) << _scratchBits;
+        _scratchBits += bits;
+        while (_scratchBits >= 8)
+        {
+            _buffer.push_back((uint8_t)_scratch);
+            _scratch >>= 8;
+            _scratchBits -= 8;
+        }
+    }
+
+    void Flush()
+    {
+        if (_scratchBits > 0)
+        {
+            _buffer.push_back((uint8_t)_scratch);
+            _scratch = 0;
+            _scratchBits = 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& _buffer;
+    uint64_t _scratch;
+    int _scratchBits;
+
+    // Prevent copy
+    BitWriter(const BitWriter&);
+    BitWriter& operator= (const BitWriter&);
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, size_t size) : _data(data), _size(size), _position(0), _overrun(false) {}
+
+    uint32_t Read(int bits)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < bits; ++i, ++_position)
+        {
+            if (_position >= _size * 8)
+            {
+                _overrun = true;
+                return 0;
+            }
+            value |= (uint32_t)((_data[_position >> 3] >> (_position & 7)) & 1) << i;
+        }
+        return value;
+    }
+
+    // True if a read went past the end of the data
+    bool Overrun() const { return _overrun; }
+
+private:
+    const uint8_t* _data;
+    size_t _size;
+    size_t _position;   // in bits
+    bool _overrun;
+};
+
+static int32_t Quantize(float value, float precision)
+{
+    float q = floorf(value / precision + 0.5f);
+    return (int32_t)max(-(float)MaxQuantized, min((float)MaxQuantized, q));
+}
+
+static void QuantizeBody(const RigidBody* body, const ReplicationSettings& settings, ReplicatedBody& result)
+{
+    static const float TwoPi = 2.0f * (float)M_PI;
+
+    // Wrap rotation into [0, 2pi) and use the full range of RotationBits
+    float rotation = body->Rotation() - TwoPi * floorf(body->Rotation() / TwoPi);
+
+    result.values[0] = Quantize(body->Position().x, settings.positionPrecision);
+    result.values[1] = Quantize(body->Position().y, settings.positionPrecision);
+    result.values[RotationValue] = (int32_t)floorf(rotation / TwoPi * (1 << RotationBits) + 0.5f) & ((1 << RotationBits) - 1);
+    result.values[3] = Quantize(body->LinearVelocity().x, settings.velocityPrecision);
+    result.values[4] = Quantize(body->LinearVelocity().y, settings.velocityPrecision);
+    result.values[5] = Quantize(body->AngularVelocity(), settings.velocityPrecision);
+}
+
+static void ApplyBody(const ReplicatedBody& state, const ReplicationSettings& settings, RigidBody* body)
+{
+    body->Position() = Vector2(state.values[0] * settings.positionPrecision, state.values[1] * settings.positionPrecision);
+    body->Rotation() = state.values[RotationValue] * (2.0f * (float)M_PI / (1 << RotationBits));
+    body->LinearVelocity() = Vector2(state.values[3] * settings.velocityPrecision, state.values[4] * settings.velocityPrecision);
+    body->AngularVelocity() = state.values[5] * settings.velocityPrecision;
+}
+
+// Difference between a value and its baseline. Rotations wrap around. Other
+// values wrap around too, modulo 2^32, which ApplyDelta undoes exactly: values
+// at opposite ends of the quantized range (+-MaxQuantized) are 2^31 apart,
+// which doesn't fit in an int32_t.
+static int32_t Delta(int i, int32_t value, int32_t baseline)
+{
+    int32_t delta = (int32_t)((uint32_t)value - (uint32_t)baseline);
+    if (i == RotationValue)
+    {
+        delta = (int32_t)(int16_t)delta;
+    }
+    return delta;
+}
+
+static int32_t ApplyDelta(int i, int32_t baseline, int32_t delta)
+{
+    int32_t value = (int32_t)((uint32_t)baseline + (uint32_t)delta);
+    if (i == RotationValue)
+    {
+        value &= (1 << RotationBits) - 1;
+    }
+    return value;
+}
+
+static void WriteDelta(BitWriter& writer, int32_t delta)
+{
+    // Zigzag, so small negative values are small too
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+
+    int bits = 0;
+    while (bits < 32 && (zigzag >> bits) != 0)
+    {
+        ++bits;
+    }
+
+    writer.Write(bits, 6);
+    writer.Write(zigzag, bits);
+}
+
+static int32_t ReadDelta(BitReader& reader)
+{
+    int bits = (int)reader.Read(6);
+    uint32_t zigzag = reader.Read(min(bits, 32));
+    return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+ReplicationHistory::ReplicationHistory()
+    : _next(0)
+{
+    for (int i = 0; i < Size; ++i)
+    {
+        _ticks[i] = 0;
+        _valid[i] = false;
+    }
+}
+
+void ReplicationHistory::Add(uint32_t tick, std::vector<ReplicatedBody>& state)
+{
+    // Replace any older entry for the same tick
+    for (int i = 0; i < Size; ++i)
+    {
+        if (_valid[i] && _ticks[i] == tick)
+        {
+            _valid[i] = false;
+        }
+    }
+
+    int slot = _next;
+    _next = (_next + 1) % Size;
+
+    _ticks[slot] = tick;
+    _valid[slot] = true;
+    _states[slot].swap(state);
+}
+
+const std::vector<ReplicatedBody>* ReplicationHistory::Find(uint32_t tick) const
+{
+    for (int i = 0; i < Size; ++i)
+    {
+        if (_valid[i] && _ticks[i] == tick)
+        {
+            return &_states[i];
+        }
+    }
+    return nullptr;
+}
+
+ReplicationEncoder::ReplicationEncoder(const ReplicationSettings& settings)
+    : _settings(settings)
+    , _ackedTick(0)
+    , _hasAck(false)
+    , _lastBodiesSent(0)
+    , _lastEncodeMs(0)
+{
+}
+
+void ReplicationEncoder::Encode(const PhysicsWorld& world, uint32_t tick, std::vector<uint8_t>& packet)
+{
+    int64_t start = GetProfileTicks();
+
+    const std::vector<RigidBody*>& bodies = world.Bodies();
+
+    // Fall back to a full state if we have no usable baseline
+    const std::vector<ReplicatedBody>* baseline = _hasAck ? _history.Find(_ackedTick) : nullptr;
+    if (baseline && baseline->size() != bodies.size())
+    {
+        baseline = nullptr;
+    }
+
+    // What the receiver will have after decoding this packet. Built separately
+    // and added to the history at the end, since adding may evict the baseline.
+    std::vector<ReplicatedBody>& state = _scratch;
+    state.resize(bodies.size());
+
+    BitWriter writer(packet);
+    writer.Write(tick, 32);
+    writer.Write(baseline ? _ackedTick : 0, 32);
+    writer.Write(baseline ? 1 : 0, 1);
+    writer.Write((uint32_t)bodies.size(), 32);
+
+    _lastBodiesSent = 0;
+    for (size_t i = 0; i < bodies.size(); ++i)
+    {
+        ReplicatedBody current;
+        QuantizeBody(bodies[i], _settings, current);
+
+        bool send = true;
+        if (baseline)
+        {
+            send = false;
+            for (int j = 0; j < _countof(current.values); ++j)
+            {
+                int32_t delta = Delta(j, current.values[j], (*baseline)[i].values[j]);
+                if (delta > _settings.changeThreshold || delta < -_settings.changeThreshold)
+                {
+                    send = true;
+                    break;
+                }
+            }
+        }
+
+        writer.Write(send ? 1 : 0, 1);
+        if (send)
+        {
+            for (int j = 0; j < _countof(current.values); ++j)
+            {
+                WriteDelta(writer, Delta(j, current.values[j], baseline ? (*baseline)[i].values[j] : 0));
+            }
+            state[i] = current;
+            ++_lastBodiesSent;
+        }
+        else
+        {
+            state[i] = (*baseline)[i];
+        }
+    }
+
+    writer.Flush();
+
+    _history.Add(tick, state);
+
+    _lastEncodeMs = TicksToMilliseconds(GetProfileTicks() - start);
+}
+
+void ReplicationEncoder::Acknowledge(uint32_t tick)
+{
+    // Acks can arrive out of order. Only ever move the baseline forward.
+    if (!_hasAck || (int32_t)(tick - _ackedTick) > 0)
+    {
+        _ackedTick = tick;
+        _hasAck = true;
+    }
+}
+
+ReplicationDecoder::ReplicationDecoder(const ReplicationSettings& settings)
+    : _settings(settings)
+    , _lastTick(0)
+{
+}
+
+bool ReplicationDecoder::Decode(const uint8_t* packet, size_t size, PhysicsWorld* mirror)
+{
+    const std::vector<RigidBody*>& bodies = mirror->Bodies();
+
+    BitReader reader(packet, size);
+    uint32_t tick = reader.Read(32);
+    uint32_t baselineTick = reader.Read(32);
+    bool isDelta = reader.Read(1) != 0;
+    uint32_t count = reader.Read(32);
+
+    if (reader.Overrun() || count != bodies.size())
+    {
+        return false;
+    }
+
+    const std::vector<ReplicatedBody>* baseline = nullptr;
+    if (isDelta)
+    {
+        baseline = _history.Find(baselineTick);
+        if (!baseline || baseline->size() != count)
+        {
+            return false;
+        }
+    }
+
+    // Decode into a scratch entry first, so a bad packet doesn't touch the world
+    std::vector<ReplicatedBody>& state = _scratch;
+    state.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (reader.Read(1))
+        {
+            for (int j = 0; j < _countof(state[i].values); ++j)
+            {
+                state[i].values[j] = ApplyDelta(j, baseline ? (*baseline)[i].values[j] : 0, ReadDelta(reader));
+            }
+        }
+        else if (baseline)
+        {
+            state[i] = (*baseline)[i];
+        }
+        else
+        {
+            // Full states have to include every body
+            return false;
+        }
+    }
+
+    if (reader.Overrun())
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ApplyBody(state[i], _settings, bodies[i]);
+    }
+
+    _history.Add(tick, state);
+    _lastTick = tick;
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+class PhysicsWorld;
+
+// Replicates the state of the bodies in a world to a mirror world (for
+// instance, on a client) with bandwidth proportional to what's changing.
+//
+// Every tick, the encoder quantizes each body's position, rotation and
+// velocities, and compares them against the most recent state the receiver
+// has acknowledged (the baseline). Only bodies that have moved beyond a
+// threshold since the baseline are sent, as bit packed deltas from it. The
+// decoder keeps the same history of baselines, rebuilds the full state, and
+// applies it to the mirror world.
+//
+// Both worlds must hold the same bodies, added in the same order.
+
+struct ReplicationSettings
+{
+    ReplicationSettings()
+        : positionPrecision(1.0f / 1024.0f)
+        , velocityPrecision(1.0f / 256.0f)
+        , changeThreshold(1)
+    {}
+
+    float positionPrecision;    // quantization step for positions, in world units
+    float velocityPrecision;    // quantization step for linear & angular velocities
+    int changeThreshold;        // bodies within this many steps of their baseline aren't sent
+};
+
+// Quantized state of one body
+struct ReplicatedBody
+{
+    int32_t values[6];          // x, y, rotation, linear velocity x & y, angular velocity
+};
+
+// Ring of recently sent (or received) states, looked up by tick
+class ReplicationHistory
+{
+public:
+    ReplicationHistory();
+
+    // Adds the state for tick, replacing the oldest entry (and any older entry
+    // for the same tick). The state is swapped in rather than copied, so state
+    // is left holding the evicted entry's storage, for reuse.
+    void Add(uint32_t tick, std::vector<ReplicatedBody>& state);
+
+    // Returns the state for tick, or nullptr if it's no longer (or was never) in the history
+    const std::vector<ReplicatedBody>* Find(uint32_t tick) const;
+
+private:
+    static const int Size = 64;
+
+    uint32_t _ticks[Size];
+    bool _valid[Size];
+    std::vector<ReplicatedBody> _states[Size];
+    int _next;
+};
+
+class ReplicationEncoder
+{
+public:
+    ReplicationEncoder(const ReplicationSettings& settings = ReplicationSettings());
+
+    // Encodes the world's state at tick into packet (replacing its contents),
+    // as a delta from the most recently acknowledged tick.
+    void Encode(const PhysicsWorld& world, uint32_t tick, std::vector<uint8_t>& packet);
+
+    // Tells the encoder the receiver has decoded the packet for tick
+    void Acknowledge(uint32_t tick);
+
+    // Bodies sent, and time taken, by the last Encode
+    size_t LastBodiesSent() const { return _lastBodiesSent; }
+    double LastEncodeMs() const { return _lastEncodeMs; }
+
+private:
+    ReplicationSettings _settings;
+    ReplicationHistory _history;
+    std::vector<ReplicatedBody> _scratch;
+    uint32_t _ackedTick;
+    bool _hasAck;
+    size_t _lastBodiesSent;
+    double _lastEncodeMs;
+};
+
+class ReplicationDecoder
+{
+public:
+    ReplicationDecoder(const ReplicationSettings& settings = ReplicationSettings());
+
+    // Applies a packet to the mirror world. Returns false if the packet is
+    // malformed, doesn't match the world, or is a delta from a baseline we
+    // no longer have. The caller should acknowledge LastTick() on success.
+    bool Decode(const uint8_t* packet, size_t size, PhysicsWorld* mirror);
+
+    uint32_t LastTick() const { return _lastTick; }
+
+private:
+    ReplicationSettings _settings;
+    ReplicationHistory _history;
+    std::vector<ReplicatedBody> _scratch;
+    uint32_t _lastTick;
+};
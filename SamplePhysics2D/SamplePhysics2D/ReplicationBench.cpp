@@ -0,0 +1,171 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Replication.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+// Replicates a settling pile of bodies to a mirror world through an in memory
+// channel with latency (both for packets and acks), and reports bandwidth and
+// encode cost. Once the pile comes to rest, the mirror must match the source
+// to within the replication precision.
+//
+// First checks that a body jumping between the ends of the quantized range
+// (beyond which positions & velocities are clamped) is sent correctly.
+
+static const int BodyCount = 1000;
+static const int Ticks = 300;
+static const int LatencyTicks = 3;
+static const float Dt = 1.0f / 60.0f;
+
+// Packets (or acks) in flight, delivered LatencyTicks after they're sent
+struct InFlight
+{
+    uint32_t deliverAt;
+    std::vector<uint8_t> packet;
+};
+
+// Sends a body from one corner of the quantized range to the opposite one and
+// back, as deltas. Returns false if the mirror didn't follow it exactly.
+static bool CheckRangeEdges(FILE* output)
+{
+    ReplicationSettings settings;
+
+    // Far enough out to be clamped in every direction
+    float edge = 4.0f * (1 << 30) * max(settings.positionPrecision, settings.velocityPrecision);
+    const float corners[] = { -edge, edge, -edge };
+
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    PhysicsWorld server(Vector2(), 10);
+    PhysicsWorld client(Vector2(), 10);
+    for (int i = 0; i < 2; ++i)
+    {
+        PhysicsWorld* world = i == 0 ? &server : &client;
+        bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new CircleShape(0.5f), 1.0f)));
+        world->AddBody(bodies.back().get());
+    }
+    RigidBody* source = bodies[0].get();
+    RigidBody* mirror = bodies[1].get();
+
+    ReplicationEncoder encoder(settings);
+    ReplicationDecoder decoder(settings);
+    std::vector<uint8_t> packet;
+    bool matched = true;
+    for (uint32_t tick = 1; tick <= _countof(corners); ++tick)
+    {
+        float corner = corners[tick - 1];
+        source->Position() = Vector2(corner, -corner);
+        source->LinearVelocity() = Vector2(-corner, corner);
+        source->AngularVelocity() = corner;
+
+        encoder.Encode(server, tick, packet);
+        if (!decoder.Decode(packet.data(), packet.size(), &client))
+        {
+            matched = false;
+            break;
+        }
+        encoder.Acknowledge(decoder.LastTick());
+
+        // Clamped to the ends of the range
+        float position = (1 << 30) * settings.positionPrecision;
+        float velocity = (1 << 30) * settings.velocityPrecision;
+        float sign = corner < 0.0f ? -1.0f : 1.0f;
+        matched &= mirror->Position().x == sign * position && mirror->Position().y == -sign * position &&
+            mirror->LinearVelocity().x == -sign * velocity && mirror->LinearVelocity().y == sign * velocity &&
+            mirror->AngularVelocity() == sign * velocity;
+    }
+
+    fprintf(output, "Across the whole quantized range: %s\n", matched ? "exact" : "WRONG");
+    return matched;
+}
+
+bool BenchReplication(FILE* output)
+{
+    if (!CheckRangeEdges(output))
+    {
+        return false;
+    }
+
+    std::vector<std::unique_ptr<RigidBody>> serverBodies, clientBodies;
+    PhysicsWorld server(Vector2(0.0f, -20.0f), 10);
+    PhysicsWorld client(Vector2(0.0f, -20.0f), 10);
+    CreateBenchScene(&server, serverBodies, BodyCount, 3);
+    CreateBenchScene(&client, clientBodies, BodyCount, 3);
+
+    ReplicationSettings settings;
+    ReplicationEncoder encoder(settings);
+    ReplicationDecoder decoder(settings);
+
+    std::deque<InFlight> packets;
+    std::deque<std::pair<uint32_t, uint32_t>> acks;     // (deliverAt, tick)
+
+    size_t totalBytes = 0;
+    size_t firstBytes = 0;
+    size_t lastSecondBytes = 0;
+    double totalEncodeMs = 0;
+    int decodeFailures = 0;
+
+    // Keep sending for a while after we stop simulating, so the client catches up
+    for (uint32_t tick = 1; tick <= Ticks + 4 * LatencyTicks; ++tick)
+    {
+        if (tick <= Ticks)
+        {
+            server.Update(Dt);
+        }
+
+        packets.push_back(InFlight());
+        packets.back().deliverAt = tick + LatencyTicks;
+        encoder.Encode(server, tick, packets.back().packet);
+
+        size_t bytes = packets.back().packet.size();
+        totalBytes += bytes;
+        totalEncodeMs += encoder.LastEncodeMs();
+        if (tick == 1)
+        {
+            firstBytes = bytes;
+        }
+        if (tick > Ticks - 60 && tick <= Ticks)
+        {
+            lastSecondBytes += bytes;
+        }
+
+        while (!packets.empty() && packets.front().deliverAt <= tick)
+        {
+            if (decoder.Decode(packets.front().packet.data(), packets.front().packet.size(), &client))
+            {
+                acks.push_back(std::make_pair(tick + LatencyTicks, decoder.LastTick()));
+            }
+            else
+            {
+                ++decodeFailures;
+            }
+            packets.pop_front();
+        }
+
+        while (!acks.empty() && acks.front().first <= tick)
+        {
+            encoder.Acknowledge(acks.front().second);
+            acks.pop_front();
+        }
+    }
+
+    // Compare the mirror against the (now resting) source
+    float maxError = 0.0f;
+    for (size_t i = 0; i < server.Bodies().size(); ++i)
+    {
+        Vector2 delta = server.Bodies()[i]->Position() - client.Bodies()[i]->Position();
+        maxError = max(maxError, max(fabsf(delta.x), fabsf(delta.y)));
+    }
+    float allowedError = (settings.changeThreshold + 0.5f) * settings.positionPrecision;
+
+    int totalTicks = Ticks + 4 * LatencyTicks;
+    fprintf(output, "%d bodies, %d ticks, %d tick latency\n", BodyCount, totalTicks, LatencyTicks);
+    fprintf(output, "Unquantized full state  %8u bytes/tick\n", (uint32_t)(BodyCount * 6 * sizeof(float)));
+    fprintf(output, "First (full) packet     %8u bytes\n", (uint32_t)firstBytes);
+    fprintf(output, "Average                 %8.1f bytes/tick\n", (double)totalBytes / totalTicks);
+    fprintf(output, "Last simulated second   %8.1f bytes/tick\n", lastSecondBytes / 60.0);
+    fprintf(output, "Encode                  %8.2f us/tick\n", totalEncodeMs * 1000.0 / totalTicks);
+    fprintf(output, "Decode failures %d, max position error %f (allowed %f)\n", decodeFailures, maxError, allowedError);
+
+    return decodeFailures == 0 && maxError <= allowedError;
+}
@@ -2,32 +2,73 @@
 #include "RigidBody.h"
 #include "Shape.h"
 
-RigidBody::RigidBody(Shape* shape, float mass)
+template <class S>
+RigidBodyT<S>::RigidBodyT(ShapeT<S>* shape, S mass)
     : _shape(shape)
-    , _rotation(0.0f)
-    , _angularVelocity(0.0f)
-    , _torque(0.0f)
+    , _ownsShape(true)
+    , _kinematic(false)
+    , _id(0)
+    , _islandIndex(0)
+    , _rotation(0)
+    , _angularVelocity(0)
+    , _torque(0)
     , _mass(mass)
 {
     assert(shape);
 
-    if (mass < FLT_MAX)
+    if (mass < ScalarTraits<S>::Max())
     {
-        _invMass = 1.0f / mass;
+        _invMass = S(1) / mass;
         _I = _shape->ComputeI(mass);
-        _invI = 1.0f / _I;
+        _invI = S(1) / _I;
     }
     else
     {
         // approx infinate mass (immovable object)
-        _invMass = 0.0f;
-        _I = FLT_MAX;
-        _invI = 0.0f;
+        _invMass = S(0);
+        _I = ScalarTraits<S>::Max();
+        _invI = S(0);
     }
 }
 
-RigidBody::~RigidBody()
+template <class S>
+RigidBodyT<S>::RigidBodyT(ShapeT<S>* shape, const MassProperties& massProperties)
+    : _shape(shape)
+    , _ownsShape(false)
+    , _kinematic(false)
+    , _id(0)
+    , _islandIndex(0)
+    , _rotation(0)
+    , _angularVelocity(0)
+    , _torque(0)
+    , _mass(massProperties.mass)
+    , _invMass(massProperties.invMass)
+    , _I(massProperties.I)
+    , _invI(massProperties.invI)
+{
+    assert(shape);
+}
+
+template <class S>
+void RigidBodyT<S>::MakeKinematic()
+{
+    assert(_id == 0);
+
+    _kinematic = true;
+    _invMass = S(0);
+    _invI = S(0);
+}
+
+template <class S>
+RigidBodyT<S>::~RigidBodyT()
 {
-    delete _shape;
+    if (_ownsShape)
+    {
+        delete _shape;
+    }
     _shape = nullptr;
 }
+
+template class RigidBodyT<float>;
+template class RigidBodyT<double>;
+template class RigidBodyT<Fixed>;
@@ -1,54 +1,94 @@
 #pragma once
 
-class Shape;
-
-// A rigid body is a dynamic object which can be affected by forces and constraints
-class RigidBody
+// A rigid body is a dynamic object which can be affected by forces and constraints.
+// S is the scalar type (see Scalar.h); the engine uses RigidBody, on float.
+template <class S>
+class RigidBodyT
 {
 public:
+    typedef S Scalar;
+    typedef Vector2T<S> Vector;
+
     // The rigid body takes over the shape's lifetime.
     // When the rigid body is destroyed, it will delete the shape
-    RigidBody(Shape* shape, float mass);
-    ~RigidBody();
+    RigidBodyT(ShapeT<S>* shape, S mass);
+
+    // Mass properties are normally computed from the shape when the body is
+    // created, but can also be supplied up front (for instance, precomputed
+    // in a scene file).
+    struct MassProperties
+    {
+        S mass, invMass;
+        S I, invI;
+    };
+
+    // Creates a body with precomputed mass properties. Unlike the constructor
+    // above, the body does NOT take over the shape's lifetime. The caller
+    // keeps ownership, and must keep the shape alive as long as the body.
+    RigidBodyT(ShapeT<S>* shape, const MassProperties& massProperties);
 
-    const Shape* GetShape() const { return _shape; }
+    ~RigidBodyT();
 
-    const Vector2& Position() const { return _position; }
-    Vector2& Position() { return _position; }
+    // Turns this into a kinematic body. Kinematic bodies are moved only by
+    // their velocities, which are left to the user to set. They're treated as
+    // having infinite mass, so they push dynamic bodies out of the way but are
+    // never pushed back, and gravity & forces don't affect them. Move them by
+    // setting their velocities rather than their positions, so that the bodies
+    // they push get a chance to respond. Must be called before the body is
+    // added to a world.
+    void MakeKinematic();
+    bool IsKinematic() const { return _kinematic; }
 
-    const Vector2& LinearVelocity() const { return _linearVelocity; }
-    Vector2& LinearVelocity() { return _linearVelocity; }
+    const ShapeT<S>* GetShape() const { return _shape; }
 
-    const Vector2& Force() const { return _force; }
-    Vector2& Force() { return _force; }
+    // Stable identifier, assigned when the body is added to a world. Bodies
+    // added in the same order always get the same ids, which is what pairs
+    // are ordered by (rather than by address) to keep the simulation deterministic.
+    uint32_t Id() const { return _id; }
 
-    const float Mass() const { return _mass; }
-    const float InvMass() const { return _invMass; }
+    const Vector& Position() const { return _position; }
+    Vector& Position() { return _position; }
 
-    const float Rotation() const { return _rotation; }
-    float& Rotation() { return _rotation; }
+    const Vector& LinearVelocity() const { return _linearVelocity; }
+    Vector& LinearVelocity() { return _linearVelocity; }
 
-    const float AngularVelocity() const { return _angularVelocity; }
-    float& AngularVelocity() { return _angularVelocity; }
+    const Vector& Force() const { return _force; }
+    Vector& Force() { return _force; }
 
-    const float Torque() const { return _torque; }
-    float& Torque() { return _torque; }
+    const S Mass() const { return _mass; }
+    const S InvMass() const { return _invMass; }
 
-    const float I() const { return _I; }
-    const float InvI() const { return _invI; }
+    const S Rotation() const { return _rotation; }
+    S& Rotation() { return _rotation; }
+
+    const S AngularVelocity() const { return _angularVelocity; }
+    S& AngularVelocity() { return _angularVelocity; }
+
+    const S Torque() const { return _torque; }
+    S& Torque() { return _torque; }
+
+    const S I() const { return _I; }
+    const S InvI() const { return _invI; }
 
 private:
-    Shape* _shape;
+    friend class PhysicsWorld;
+    template <class> friend class ScalarWorld;
+
+    ShapeT<S>* _shape;
+    bool _ownsShape;
+    bool _kinematic;
+    uint32_t _id;
+    uint32_t _islandIndex;  // index in the world's dynamic bodies, while building islands
 
     // Linear
-    Vector2 _position;
-    Vector2 _linearVelocity;
-    Vector2 _force;
-    float _mass, _invMass;
+    Vector _position;
+    Vector _linearVelocity;
+    Vector _force;
+    S _mass, _invMass;
 
     // Angular
-    float _rotation;
-    float _angularVelocity;
-    float _torque;
-    float _I, _invI;
+    S _rotation;
+    S _angularVelocity;
+    S _torque;
+    S _I, _invI;
 };
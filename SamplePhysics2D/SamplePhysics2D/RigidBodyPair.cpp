@@ -2,10 +2,51 @@
 #include "RigidBodyPair.h"
 #include "RigidBody.h"
 
-RigidBodyPair::RigidBodyPair(RigidBody* body1, RigidBody* body2)
+template <class S>
+PairKey::PairKey(const RigidBodyT<S>* body1, const RigidBodyT<S>* body2)
 {
-    // Always store the body with the lower address as the first
-    if (body1 <= body2)
+    if (body1->Id() <= body2->Id())
+    {
+        id1 = body1->Id();
+        id2 = body2->Id();
+    }
+    else
+    {
+        id1 = body2->Id();
+        id2 = body1->Id();
+    }
+}
+
+template <class S>
+RigidBodyPairT<S>::RigidBodyPairT(Body* body1, Body* body2)
+{
+    // Always store the body with the lower id as the first
+    if (body1->Id() <= body2->Id())
+    {
+        _body1 = body1;
+        _body2 = body2;
+    }
+    else
+    {
+        _body1 = body2;
+        _body2 = body1;
+    }
+
+    _contactReused = false;
+    _hasContact = Collide(_body1, _body2, _contact);
+    if (_hasContact)
+    {
+        CacheContact();
+    }
+}
+
+template <class S>
+RigidBodyPairT<S>::RigidBodyPairT(Body* body1, Body* body2, S impulseNormal, const ContactCache* cache)
+    : _cache()
+    , _hasContact(false)
+    , _contactReused(false)
+{
+    if (body1->Id() <= body2->Id())
     {
         _body1 = body1;
         _body2 = body2;
@@ -16,25 +57,76 @@ RigidBodyPair::RigidBodyPair(RigidBody* body1, RigidBody* body2)
         _body2 = body1;
     }
 
+    _contact.impulseNormal = impulseNormal;
+    if (cache)
+    {
+        _cache = *cache;
+    }
+}
+
+template <class S>
+RigidBodyPairT<S>::RigidBodyPairT(const RigidBodyPairT& previous, S linearTolerance, S angularTolerance)
+    : _body1(previous._body1)
+    , _body2(previous._body2)
+    , _cache(previous._cache)
+    , _contactReused(false)
+{
+    Vector2T<S> moved = (_body1->Position() - _body2->Position()) - _cache.separation;
+    S turned1 = _body1->Rotation() - _cache.rotation1;
+    S turned2 = _body2->Rotation() - _cache.rotation2;
+
+    if (moved.LengthSq() < linearTolerance * linearTolerance &&
+        Abs(turned1 - turned2) < angularTolerance && Abs(turned2) < angularTolerance)
+    {
+        // Body1 has barely moved relative to body2, so neither has the
+        // contact. If they're still touching, keep it.
+        S distance = _cache.distance + Dot(moved, _cache.normal);
+        if (distance <= S(0))
+        {
+            _contact.worldPosition = _body2->Position() + _cache.offset + moved;
+            _contact.normal = _cache.normal;
+            _contact.distance = distance;
+            _hasContact = true;
+            _contactReused = true;
+            return;
+        }
+    }
+
     _hasContact = Collide(_body1, _body2, _contact);
+    if (_hasContact)
+    {
+        CacheContact();
+    }
+}
+
+template <class S>
+void RigidBodyPairT<S>::CacheContact()
+{
+    _cache.separation = _body1->Position() - _body2->Position();
+    _cache.rotation1 = _body1->Rotation();
+    _cache.rotation2 = _body2->Rotation();
+    _cache.offset = _contact.worldPosition - _body2->Position();
+    _cache.normal = _contact.normal;
+    _cache.distance = _contact.distance;
 }
 
-void RigidBodyPair::PreSolve(float invDt)
+template <class S>
+void RigidBodyPairT<S>::PreSolve(S invDt)
 {
-    static const float Slop = 0.01f;
-    static const float BiasFactor = 0.1f;
+    const S Slop = S(0.01f);
+    const S BiasFactor = S(0.1f);
 
     // Vectors from each object's center to the contact point
     _contact.r1 = _contact.worldPosition - _body1->Position();
     _contact.r2 = _contact.worldPosition - _body2->Position();
 
     // Find how much of each r is along contact normal
-    float rn1 = Dot(_contact.r1, _contact.normal);
-    float rn2 = Dot(_contact.r2, _contact.normal);
+    S rn1 = Dot(_contact.r1, _contact.normal);
+    S rn2 = Dot(_contact.r2, _contact.normal);
 
     // To compute effective inverseMass along contact normal,
     // start with the linear masses.
-    float kNormal = _body1->InvMass() + _body2->InvMass();
+    S kNormal = _body1->InvMass() + _body2->InvMass();
 
     // Then, to account for rotational moment of inertia, we need
     // to apply the square of the amount of r perpendicular to the normal.
@@ -48,39 +140,56 @@ void RigidBodyPair::PreSolve(float invDt)
         _body2->InvI() * (Dot(_contact.r2, _contact.r2) - rn2 * rn2);
 
     // The impulse computation actually needs the inverse of these values, so invert here
-    _contact.massNormal = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
+    _contact.massNormal = kNormal > S(0) ? S(1) / kNormal : S(0);
 
     // The bias is an additional boost to the impulse to compensate for already penetrating
     // objects to resolve the penetration in addition to solving velocity.
-    _contact.positionBias = -BiasFactor * invDt * min(0.0f, _contact.distance + Slop);
+    _contact.positionBias = -BiasFactor * invDt * min(S(0), _contact.distance + Slop);
 }
 
-void RigidBodyPair::Solve()
+template <class S>
+void RigidBodyPairT<S>::Solve()
 {
     // Relative velocity at contact
-    Vector2 relVel = 
+    Vector2T<S> relVel = 
         _body1->LinearVelocity() + Cross(_body1->AngularVelocity(), _contact.r1) -
         _body2->LinearVelocity() - Cross(_body2->AngularVelocity(), _contact.r2);
 
     // Compute impulse along normal, using the mass normal we prebuilt and
     // the amount of relative velocity along the normal
-    float velNormal = Dot(relVel, _contact.normal);
-    float deltaImpulseNormal = _contact.massNormal * (-velNormal + _contact.positionBias);
+    S velNormal = Dot(relVel, _contact.normal);
+    S deltaImpulseNormal = _contact.massNormal * (-velNormal + _contact.positionBias);
 
     // Clamp the accum. impulse so we don't apply negative impulse
-    float accumImpulseNormal = _contact.impulseNormal;
-    _contact.impulseNormal = max(accumImpulseNormal + deltaImpulseNormal, 0.0f);
+    S accumImpulseNormal = _contact.impulseNormal;
+    _contact.impulseNormal = max(accumImpulseNormal + deltaImpulseNormal, S(0));
     deltaImpulseNormal = _contact.impulseNormal - accumImpulseNormal;
 
     // Put impulse in vector form and apply to each object
-    Vector2 impulseNormal = deltaImpulseNormal * _contact.normal;
+    Vector2T<S> impulseNormal = deltaImpulseNormal * _contact.normal;
 
-    // For linear, we apply directly
-    _body1->LinearVelocity() += _body1->InvMass() * impulseNormal;
-    // For angular, we convert to resulting angular component
-    // by crossing with the vector from center to the point of contact
-    _body1->AngularVelocity() += _body1->InvI() * Cross(_contact.r1, impulseNormal);
+    // Bodies with infinite mass (static & kinematic) are never written to.
+    // Their velocities are whatever they were set to.
+    if (_body1->InvMass() != S(0))
+    {
+        // For linear, we apply directly
+        _body1->LinearVelocity() += _body1->InvMass() * impulseNormal;
+        // For angular, we convert to resulting angular component
+        // by crossing with the vector from center to the point of contact
+        _body1->AngularVelocity() += _body1->InvI() * Cross(_contact.r1, impulseNormal);
+    }
 
-    _body2->LinearVelocity() -= _body2->InvMass() * impulseNormal;
-    _body2->AngularVelocity() -= _body2->InvI() * Cross(_contact.r2, impulseNormal);
+    if (_body2->InvMass() != S(0))
+    {
+        _body2->LinearVelocity() -= _body2->InvMass() * impulseNormal;
+        _body2->AngularVelocity() -= _body2->InvI() * Cross(_contact.r2, impulseNormal);
+    }
 }
+
+template PairKey::PairKey(const RigidBodyT<float>* body1, const RigidBodyT<float>* body2);
+template PairKey::PairKey(const RigidBodyT<double>* body1, const RigidBodyT<double>* body2);
+template PairKey::PairKey(const RigidBodyT<Fixed>* body1, const RigidBodyT<Fixed>* body2);
+
+template class RigidBodyPairT<float>;
+template class RigidBodyPairT<double>;
+template class RigidBodyPairT<Fixed>;
@@ -1,84 +1,130 @@
 #pragma once
 
-class RigidBody;
-
-// In order to use the std::map efficiently to look up pairs of objects,
-// we define the following key type, and implement a less than operator for it.
+// Pairs are kept sorted by the following key type, so we implement a less
+// than operator for it. Keys are built from body ids rather than addresses,
+// so that pairs are visited in the same order on every run.
 struct PairKey
 {
-    PairKey(RigidBody* body1, RigidBody* body2)
-    {
-        // Always store the body with the lower address as the first
-        if (body1 <= body2)
-        {
-            this->body1 = body1;
-            this->body2 = body2;
-        }
-        else
-        {
-            this->body1 = body2;
-            this->body2 = body1;
-        }
-    }
-
-    RigidBody* body1;
-    RigidBody* body2;
+    template <class S>
+    PairKey(const RigidBodyT<S>* body1, const RigidBodyT<S>* body2);
+
+    // Always store the lower id as the first
+    uint32_t id1;
+    uint32_t id2;
 };
 
 inline bool operator< (const PairKey& lhs, const PairKey& rhs)
 {
-    return (lhs.body1 < rhs.body1) ||
-        (lhs.body1 == rhs.body1 && lhs.body2 < rhs.body2);
+    return (lhs.id1 < rhs.id1) ||
+        (lhs.id1 == rhs.id1 && lhs.id2 < rhs.id2);
 }
 
 // Defines a single contact point between two bodies, along with some
 // support data about the contact that is built up and cached here.
-struct ContactInfo
+template <class S>
+struct ContactInfoT
+{
+    ContactInfoT()
+        : distance(0)
+        , impulseNormal(0)
+        , impulseBias(0)
+        , massNormal(0)
+        , positionBias(0)
+    {}
+
+    Vector2T<S> worldPosition;  // world position of the contact point
+    Vector2T<S> normal;         // normal (pointing away from body2)
+    Vector2T<S> r1, r2;         // relative position of contact for each object
+    S           distance;       // distance between the two objects at the contact. Negative for overlap
+    S           impulseNormal;  // Accumulated impulse along the normal
+    S           impulseBias;    // Accumulated impulse along normal for position bias
+    S           massNormal;     // Effective combined mass along the normal
+    S           positionBias;   // Bias factor to make up for penetration
+};
+
+// Where the bodies of a pair were relative to each other the last time
+// collision detection actually ran on them, and the contact it found then.
+// While the bodies stay put relative to each other (for instance, resting in
+// a settled pile), that contact can be carried over from step to step instead
+// of being found all over again.
+//
+// Everything is kept in world orientation, relative to body2's position, so
+// that checking whether the bodies have moved needs no trig.
+template <class S>
+struct ContactCacheT
 {
-    ContactInfo() { memset(this, 0, sizeof(ContactInfo)); }
-
-    Vector2 worldPosition;  // world position of the contact point
-    Vector2 normal;         // normal (pointing away from body2)
-    Vector2 r1, r2;         // relative position of contact for each object
-    float   distance;       // distance between the two objects at the contact. Negative for overlap
-    float   impulseNormal;  // Accumulated impulse along the normal
-    float   impulseBias;    // Accumulated impulse along normal for position bias
-    float   massNormal;     // Effective combined mass along the normal
-    float   positionBias;   // Bias factor to make up for penetration
+    Vector2T<S> separation;     // body1's position less body2's
+    S           rotation1;      // each body's rotation
+    S           rotation2;
+    Vector2T<S> offset;         // contact point less body2's position
+    Vector2T<S> normal;
+    S           distance;
 };
 
 // Tests body1 and body2 for collision, and if one exists, the contact info is filled in
 // and the function returns true. Otherwise, returns false.
-bool Collide(RigidBody* body1, RigidBody* body2, ContactInfo& contact);
+template <class S>
+bool Collide(RigidBodyT<S>* body1, RigidBodyT<S>* body2, ContactInfoT<S>& contact);
 
 // For each pair of objects potentially interacting (colliding) with each other
 // we need a RigidBodyPair object. This can be expanded later to be more
 // of a manifold, iteratively building up a collection of contact points.
-class RigidBodyPair
+template <class S>
+class RigidBodyPairT
 {
 public:
-    RigidBodyPair(RigidBody* body1, RigidBody* body2);
+    typedef RigidBodyT<S> Body;
+    typedef ContactInfoT<S> ContactInfo;
+    typedef ContactCacheT<S> ContactCache;
 
-    const RigidBody* Body1() const { return _body1; }
-    RigidBody*& Body1() { return _body1; }
+    RigidBodyPairT(Body* body1, Body* body2);
 
-    const RigidBody* Body2() const { return _body2; }
-    RigidBody*& Body2() { return _body2; }
+    // Recreate a pair restored from a snapshot, without running collision
+    // detection again. Only what the next step needs comes back: the
+    // accumulated impulse (for hashing) and, if given, the cache (for contact
+    // reuse). The contact itself isn't known until the next step finds it
+    // again, so until then HasContact is false.
+    RigidBodyPairT(Body* body1, Body* body2, S impulseNormal, const ContactCache* cache);
+
+    // Recreate the pair found for the same bodies on the previous step. If
+    // they've moved less than the tolerances (in distance & angle) relative
+    // to each other, and neither has turned by more than the angular
+    // tolerance, since collision detection last ran on them, its contact is
+    // carried over: moved along with the bodies, with its distance updated
+    // for any motion along the normal. Otherwise, collision detection runs again.
+    RigidBodyPairT(const RigidBodyPairT& previous, S linearTolerance, S angularTolerance);
+
+    const Body* Body1() const { return _body1; }
+    Body*& Body1() { return _body1; }
+
+    const Body* Body2() const { return _body2; }
+    Body*& Body2() { return _body2; }
 
     bool HasContact() const { return _hasContact; }
 
+    // True if the contact was carried over from an earlier step, rather
+    // than found by collision detection
+    bool ContactReused() const { return _contactReused; }
+
+    const ContactCache& Cache() const { return _cache; }
+
     const ContactInfo& Contact() const { return _contact; }
     ContactInfo& Contact() { return _contact; }
 
     // Prior to beginning solver iterations, set up some one time info
-    void PreSolve(float invDt);
+    void PreSolve(S invDt);
 
     // Solve a single iteration. Computes and applies impulses
     void Solve();
 
 private:
-    RigidBody* _body1;
-    RigidBody* _body2;
+    // Records where the bodies are & the contact in _cache
+    void CacheContact();
+
+    Body* _body1;
+    Body* _body2;
     ContactInfo _contact;
+    ContactCache _cache;
     bool _hasContact;
+    bool _contactReused;
 };
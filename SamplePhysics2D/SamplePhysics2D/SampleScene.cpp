@@ -0,0 +1,34 @@
+#include "Precomp.h"
+#include "SampleScene.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+void CreateSampleScene(std::vector<std::unique_ptr<RigidBody>>& bodies)
+{
+    // Create an assortment of random objects
+    srand(0);
+
+    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(2, 2), 5.0f)));
+    for (int i = 0; i < 10; ++i)
+    {
+        if (rand() % 2 == 0)
+        {
+            bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new CircleShape((rand() % 5 + 1) * 0.4f), 5.0f)));
+        }
+        else
+        {
+            bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(rand() % 2 + 1.0f, rand() % 2 + 1.0f), 5.0f)));
+        }
+        bodies[bodies.size() - 1]->Position() = Vector2(rand() % 20 - 10, rand() % 50 + 2);
+    }
+
+    // Walls
+    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(20.0f, 1.0f), FLT_MAX)));
+    bodies[bodies.size() - 1]->Position() = Vector2(0.0f, -10.0f);
+    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(1.0f, 20.0f), FLT_MAX)));
+    bodies[bodies.size() - 1]->Position() = Vector2(-10.0f, 0.0f);
+    bodies[bodies.size() - 1]->Rotation() = 0.3f;
+    bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(new BoxShape(1.0f, 20.0f), FLT_MAX)));
+    bodies[bodies.size() - 1]->Position() = Vector2(10.0f, 0.0f);
+    bodies[bodies.size() - 1]->Rotation() = -0.3f;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// The sample's scene: a box (always the first body, which the arrow keys
+// push around), ten random circles & boxes above it, and a container of
+// three static walls. Appends the bodies to bodies, in that order, without
+// adding them to any world. The same bodies are created every time.
+void CreateSampleScene(std::vector<std::unique_ptr<RigidBody>>& bodies);
@@ -0,0 +1,429 @@
+#pragma once
+
+// constexpr, where the compiler supports it (VS2013 doesn't), so that math
+// on constants can be folded at compile time
+#if !defined(_MSC_VER) || _MSC_VER >= 1900
+#define MATH_HAS_CONSTEXPR
+#define MATH_CONSTEXPR constexpr
+#else
+#define MATH_CONSTEXPR
+#endif
+
+// The scalar types the core (Vector2T, Matrix2T, RigidBodyT, the narrowphase
+// & solver) can be built on, chosen at compile time by template argument:
+//
+//   float   what the engine (PhysicsWorld) runs on
+//   double  for very large worlds, where float runs out of precision far
+//           from the origin
+//   Fixed   Q16.16 fixed point, for lockstep simulation that has to stay bit
+//           identical across machines & compilers
+//
+// Generic code does its math through the overloads here (Sqrt, InvSqrt, Abs,
+// Sin, Cos) and ScalarTraits, and writes its constants as S(0.5f) and so on.
+
+// Q16.16 fixed point number: 16 integer bits (a range of about +/-32768) and
+// 16 fractional bits (a resolution of about 1.5e-5). Only integer math is used,
+// so results are the same on every machine, whatever the compiler or floating
+// point settings. Products are rounded to nearest, quotients truncated, and
+// dividing by zero saturates. Sums & differences wrap around (rather than
+// being undefined, as signed overflow is, which compilers are free to treat
+// differently). Nothing else checks for overflow, so keep coordinates well
+// inside the range (lengths get squared along the way).
+//
+// Converting from float or double does use the floating point unit, but
+// that's exact (every float is scaled by a power of two, then rounded once),
+// so it's the same everywhere too. Keep it to constants & inputs, though: it's
+// slower than the integer math.
+class Fixed
+{
+public:
+    MATH_CONSTEXPR Fixed() : _raw(0) {}
+    MATH_CONSTEXPR Fixed(int value) : _raw((int32_t)((uint32_t)value << 16)) {}
+    Fixed(float value) : _raw(FromDouble(value)) {}
+    Fixed(double value) : _raw(FromDouble(value)) {}
+
+    static Fixed FromRaw(int32_t raw)
+    {
+        Fixed f;
+        f._raw = raw;
+        return f;
+    }
+
+    int32_t Raw() const { return _raw; }
+
+    float ToFloat() const { return (float)_raw * (1.0f / 65536.0f); }
+    double ToDouble() const { return (double)_raw * (1.0 / 65536.0); }
+
+    Fixed operator- () const { return FromRaw((int32_t)(0u - (uint32_t)_raw)); }
+
+    Fixed& operator+= (Fixed other) { _raw = (int32_t)((uint32_t)_raw + (uint32_t)other._raw); return *this; }
+    Fixed& operator-= (Fixed other) { _raw = (int32_t)((uint32_t)_raw - (uint32_t)other._raw); return *this; }
+    Fixed& operator*= (Fixed other) { return *this = Mul(*this, other); }
+    Fixed& operator/= (Fixed other) { return *this = Div(*this, other); }
+
+    static Fixed Mul(Fixed a, Fixed b)
+    {
+        return FromRaw((int32_t)(((int64_t)a._raw * b._raw + 0x8000) >> 16));
+    }
+
+    static Fixed Div(Fixed a, Fixed b)
+    {
+        if (b._raw == 0)
+        {
+            return FromRaw(a._raw >= 0 ? INT32_MAX : INT32_MIN);
+        }
+        int64_t quotient = (int64_t)a._raw * 65536 / b._raw;
+        return FromRaw((int32_t)max(min(quotient, (int64_t)INT32_MAX), (int64_t)INT32_MIN));
+    }
+
+private:
+    // Rounded to nearest (halves away from zero), saturating (so FLT_MAX
+    // becomes the largest Fixed)
+    static int32_t FromDouble(double value)
+    {
+        double scaled = value * 65536.0;
+        if (scaled >= 2147483647.0)
+        {
+            return INT32_MAX;
+        }
+        if (scaled <= -2147483648.0)
+        {
+            return INT32_MIN;
+        }
+        return (int32_t)(scaled >= 0.0 ? scaled + 0.5 : scaled - 0.5);
+    }
+
+    int32_t _raw;
+};
+
+inline Fixed operator+ (Fixed a, Fixed b) { return a += b; }
+inline Fixed operator- (Fixed a, Fixed b) { return a -= b; }
+inline Fixed operator* (Fixed a, Fixed b) { return Fixed::Mul(a, b); }
+inline Fixed operator/ (Fixed a, Fixed b) { return Fixed::Div(a, b); }
+
+inline bool operator< (Fixed a, Fixed b) { return a.Raw() < b.Raw(); }
+inline bool operator<= (Fixed a, Fixed b) { return a.Raw() <= b.Raw(); }
+inline bool operator> (Fixed a, Fixed b) { return a.Raw() > b.Raw(); }
+inline bool operator>= (Fixed a, Fixed b) { return a.Raw() >= b.Raw(); }
+inline bool operator== (Fixed a, Fixed b) { return a.Raw() == b.Raw(); }
+inline bool operator!= (Fixed a, Fixed b) { return a.Raw() != b.Raw(); }
+
+static_assert(std::is_trivially_copyable<Fixed>::value, "Fixed must stay trivially copyable");
+static_assert(sizeof(Fixed) == sizeof(int32_t), "Fixed must be just its raw value");
+
+// Limits & constants, for each scalar type
+template <class S>
+struct ScalarTraits;
+
+template <>
+struct ScalarTraits<float>
+{
+    static const char* Name() { return "float"; }
+    static float Max() { return FLT_MAX; }
+    static float Epsilon() { return FLT_EPSILON; }
+
+    // Smallest squared length that can be normalized
+    static float Tiny() { return FLT_MIN; }
+};
+
+template <>
+struct ScalarTraits<double>
+{
+    static const char* Name() { return "double"; }
+    static double Max() { return DBL_MAX; }
+    static double Epsilon() { return DBL_EPSILON; }
+    static double Tiny() { return DBL_MIN; }
+};
+
+template <>
+struct ScalarTraits<Fixed>
+{
+    static const char* Name() { return "Q16.16 fixed"; }
+    static Fixed Max() { return Fixed::FromRaw(INT32_MAX); }
+    static Fixed Epsilon() { return Fixed::FromRaw(1); }
+    static Fixed Tiny() { return Fixed::FromRaw(1); }
+};
+
+// float's InvSqrt is in SimdFloat.h, as it can use the vector unit's estimate
+inline float Sqrt(float x) { return sqrtf(x); }
+inline float Abs(float x) { return fabsf(x); }
+inline float Sin(float x) { return sinf(x); }
+inline float Cos(float x) { return cosf(x); }
+inline float ToFloat(float x) { return x; }
+
+inline double Sqrt(double x) { return sqrt(x); }
+inline double InvSqrt(double x) { return 1.0 / sqrt(x); }
+inline double Abs(double x) { return fabs(x); }
+inline double Sin(double x) { return sin(x); }
+inline double Cos(double x) { return cos(x); }
+inline float ToFloat(double x) { return (float)x; }
+
+inline Fixed Abs(Fixed x) { return x.Raw() < 0 ? -x : x; }
+inline float ToFloat(Fixed x) { return x.ToFloat(); }
+
+// Number of leading zero bits in x, which mustn't be zero
+inline int LeadingZeros64(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63 - (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#else
+    int zeros = 0;
+    for (uint64_t bit = 1ull << 63; !(x & bit); bit >>= 1)
+    {
+        ++zeros;
+    }
+    return zeros;
+#endif
+}
+
+// 1/sqrt(m) for m in [1, 4), in Q16.16, at 96 evenly spaced intervals: entry i
+// is for the middle of [(i + 32) / 32, (i + 33) / 32), rounded to nearest. It
+// only has to be close enough for Newton's method to take over.
+static MATH_CONSTEXPR const int32_t FixedInvSqrtTable[96] =
+{
+    65030, 64052, 63117, 62222, 61363, 60540, 59748, 58987,
+    58254, 57548, 56867, 56210, 55574, 54960, 54366, 53791,
+    53233, 52693, 52169, 51660, 51165, 50685, 50218, 49763,
+    49321, 48890, 48470, 48061, 47663, 47273, 46894, 46523,
+    46161, 45807, 45462, 45124, 44793, 44470, 44153, 43843,
+    43540, 43243, 42951, 42666, 42386, 42112, 41843, 41579,
+    41320, 41065, 40816, 40571, 40330, 40093, 39861, 39632,
+    39408, 39187, 38970, 38756, 38546, 38340, 38136, 37936,
+    37739, 37545, 37354, 37166, 36980, 36798, 36618, 36441,
+    36266, 36093, 35924, 35756, 35591, 35428, 35267, 35109,
+    34953, 34798, 34646, 34496, 34347, 34201, 34056, 33913,
+    33772, 33633, 33496, 33360, 33225, 33093, 32962, 32832
+};
+
+#ifdef MATH_HAS_CONSTEXPR
+// Checks the table against sqrt found by Newton's method at compile time
+MATH_CONSTEXPR double SqrtNewton(double x, double guess, int n)
+{
+    return n == 0 ? guess : SqrtNewton(x, 0.5 * (guess + x / guess), n - 1);
+}
+
+MATH_CONSTEXPR int32_t FixedInvSqrtEntry(int i)
+{
+    return (int32_t)(65536.0 / SqrtNewton((i + 32.5) / 32, 1.5, 12) + 0.5);
+}
+
+MATH_CONSTEXPR bool FixedInvSqrtTableMatches(int i)
+{
+    return i >= 96 || (FixedInvSqrtTable[i] == FixedInvSqrtEntry(i) && FixedInvSqrtTableMatches(i + 1));
+}
+
+static_assert(FixedInvSqrtTableMatches(0), "FixedInvSqrtTable doesn't match 1/sqrt");
+#endif
+
+// 1/sqrt(n), for an integer n > 0, as a mantissa & exponent:
+// 1/sqrt(n) = mantissa / 2^31 / 2^(31 - halfShift).
+//
+// n is shifted up by an even number of bits into [2^62, 2^64), making it
+// m * 2^62 for some m in [1, 4). 1/sqrt(m), which is in (0.5, 1], is looked
+// up in the table & then refined by two steps of Newton's method, using only
+// multiplies. That's good to about 30 bits.
+struct FixedInvSqrtResult
+{
+    uint32_t mantissa;  // Q1.31
+    int halfShift;      // half the shift that normalized n
+    uint32_t m;         // n's normalized mantissa, in Q2.30
+};
+
+inline FixedInvSqrtResult FixedInvSqrtParts(uint64_t n)
+{
+    assert(n != 0);
+    int shift = LeadingZeros64(n) & ~1;
+    uint64_t normalized = n << shift;
+
+    FixedInvSqrtResult result;
+    result.halfShift = shift / 2;
+    result.m = (uint32_t)(normalized >> 32);
+
+    // r = r * (3 - m * r^2) / 2
+    uint64_t r = (uint64_t)FixedInvSqrtTable[(normalized >> 57) - 32] << 15;
+    for (int i = 0; i < 2; ++i)
+    {
+        uint64_t r2 = (r * r) >> 31;
+        uint64_t mr2 = ((uint64_t)result.m * r2) >> 30;
+        r = (r * ((3ull << 31) - mr2)) >> 32;
+    }
+    result.mantissa = (uint32_t)r;
+    return result;
+}
+
+// sqrt(n), for an integer n, to within one
+inline uint32_t FixedSqrtOf(uint64_t n)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    // sqrt(n) = m * 1/sqrt(m) * 2^(31 - halfShift)
+    FixedInvSqrtResult parts = FixedInvSqrtParts(n);
+    uint64_t root = ((uint64_t)parts.m * parts.mantissa) >> (30 + parts.halfShift);
+    return (uint32_t)min(root, (uint64_t)0xFFFFFFFFu);
+}
+
+// Negative numbers give 0
+inline Fixed Sqrt(Fixed x)
+{
+    if (x.Raw() <= 0)
+    {
+        return Fixed();
+    }
+
+    // sqrt(raw / 2^16) * 2^16 = sqrt(raw * 2^16)
+    return Fixed::FromRaw((int32_t)FixedSqrtOf((uint64_t)x.Raw() << 16));
+}
+
+// Saturates for 0 & numbers too small for the result to fit
+inline Fixed InvSqrt(Fixed x)
+{
+    if (x.Raw() <= 0)
+    {
+        return ScalarTraits<Fixed>::Max();
+    }
+
+    // 2^16 / sqrt(raw / 2^16) = 2^32 / sqrt(raw * 2^16)
+    FixedInvSqrtResult parts = FixedInvSqrtParts((uint64_t)x.Raw() << 16);
+    int shift = 30 - parts.halfShift;
+    if (shift <= 0)
+    {
+        return ScalarTraits<Fixed>::Max();
+    }
+    return Fixed::FromRaw((int32_t)min((uint64_t)parts.mantissa >> shift, (uint64_t)INT32_MAX));
+}
+
+// Length of the vector (x, y). The squares are kept in 64 bits (as Q32.32),
+// so short vectors, whose squares would round to zero in Q16.16, still have
+// a length, and long ones don't overflow.
+inline Fixed FixedLength(Fixed x, Fixed y)
+{
+    uint64_t lengthSq = (uint64_t)((int64_t)x.Raw() * x.Raw()) + (uint64_t)((int64_t)y.Raw() * y.Raw());
+    return Fixed::FromRaw((int32_t)min(FixedSqrtOf(lengthSq), (uint32_t)INT32_MAX));
+}
+
+// (x, y) scaled to unit length, or zero if it's zero. Multiplies by the
+// inverse length, found as above (with the squares in 64 bits), so there's no
+// division.
+inline void FixedNormalizeOrZero(Fixed& x, Fixed& y)
+{
+    uint64_t lengthSq = (uint64_t)((int64_t)x.Raw() * x.Raw()) + (uint64_t)((int64_t)y.Raw() * y.Raw());
+    if (lengthSq == 0)
+    {
+        return;
+    }
+
+    // raw * 2^16 / sqrt(lengthSq), rounded to nearest
+    FixedInvSqrtResult parts = FixedInvSqrtParts(lengthSq);
+    int shift = 46 - parts.halfShift;
+    int64_t half = 1ll << (shift - 1);
+    x = Fixed::FromRaw((int32_t)(((int64_t)x.Raw() * parts.mantissa + half) >> shift));
+    y = Fixed::FromRaw((int32_t)(((int64_t)y.Raw() * parts.mantissa + half) >> shift));
+}
+
+// sin over a quarter turn, in Q16.16, at 256 evenly spaced angles (and one
+// past the end, so that interpolating never reads off the end): entry i is
+// sin(i * pi / 512), rounded to nearest.
+static MATH_CONSTEXPR const int32_t FixedSinTable[258] =
+{
+    0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+    3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+    6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+    9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+    12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+    15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+    19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+    22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+    25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+    28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+    30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+    33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+    36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+    39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+    41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+    44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+    46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+    48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+    50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+    52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+    54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+    56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+    57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+    59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+    60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+    61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+    62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+    63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+    64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+    64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+    65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+    65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+    65536, 65535
+};
+
+#ifdef MATH_HAS_CONSTEXPR
+// Checks the table against sin's Taylor series, evaluated at compile time
+MATH_CONSTEXPR double SinSeries(double x, double term, int n)
+{
+    return n > 20 ? 0.0 : term + SinSeries(x, -term * x * x / ((2 * n) * (2 * n + 1)), n + 1);
+}
+
+MATH_CONSTEXPR int32_t FixedSinEntry(int i)
+{
+    return (int32_t)(SinSeries(i * (M_PI / 512), i * (M_PI / 512), 1) * 65536.0 + 0.5);
+}
+
+MATH_CONSTEXPR bool FixedSinTableMatches(int i)
+{
+    return i >= 258 || (FixedSinTable[i] == FixedSinEntry(i) && FixedSinTableMatches(i + 1));
+}
+
+static_assert(FixedSinTableMatches(0), "FixedSinTable doesn't match sin");
+#endif
+
+// sin(angle), for angle in 1/2^26ths of a turn (so that wrapping around is
+// just dropping the high bits), interpolated from the table
+inline Fixed FixedSinOfTurn(uint32_t turn)
+{
+    turn &= (1u << 26) - 1;
+
+    // Each quarter turn is 256 table steps, with 16 bits of fraction. The
+    // second & fourth quarters run back down the table, and the third &
+    // fourth are negative.
+    uint32_t quadrant = turn >> 24;
+    uint32_t position = turn & 0xffffff;
+    if (quadrant & 1)
+    {
+        position = 0x1000000 - position;
+    }
+
+    uint32_t index = position >> 16;
+    int32_t fraction = (int32_t)(position & 0xffff);
+    int32_t lo = FixedSinTable[index];
+    int32_t hi = FixedSinTable[index + 1];
+    int32_t value = lo + (int32_t)(((int64_t)(hi - lo) * fraction) >> 16);
+    return Fixed::FromRaw((quadrant & 2) ? -value : value);
+}
+
+// angle (in radians) in 1/2^26ths of a turn
+inline uint32_t FixedAngleToTurn(Fixed angle)
+{
+    static const int64_t TurnsPerRadian = 10680707;    // 2^10 / (2 pi), in Q16.16
+    return (uint32_t)(((int64_t)angle.Raw() * TurnsPerRadian) >> 16);
+}
+
+inline Fixed Sin(Fixed angle)
+{
+    return FixedSinOfTurn(FixedAngleToTurn(angle));
+}
+
+inline Fixed Cos(Fixed angle)
+{
+    return FixedSinOfTurn(FixedAngleToTurn(angle) + (1u << 24));
+}
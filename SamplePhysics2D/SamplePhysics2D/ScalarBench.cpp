@@ -0,0 +1,323 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "ScalarWorld.h"
+#include "Shape.h"
+
+// One benchmark per scalar type the core is built on (scalar-float,
+// scalar-double & scalar-fixed). Each steps the same pile with ScalarWorld on
+// that type, and reports:
+//
+//   - ms per step, next to PhysicsWorld (float, on one thread)
+//   - how far the bodies end up from where the double run puts them
+//   - what Collide costs per pair tested
+//   - whether two runs give the same hash
+//
+// scalar-float also checks that ScalarWorld<float> matches PhysicsWorld bit
+// for bit. scalar-fixed checks that the pile ends up exactly where it always
+// does (whatever the machine, compiler or floating point settings), that
+// stepping it takes no more than twice as long as PhysicsWorld does on float
+// (both run the same stages & broadphase, see WorldStages.h), and reports the
+// error & cost of Fixed's math next to float's.
+
+static const int BodyCount = 400;
+static const int Steps = 200;
+static const float Dt = 1.0f / 60.0f;
+static const int Iterations = 10;
+
+// What the pile hashes to on Fixed. Unlike float's, this is the same for
+// every build on every machine, so one that doesn't match can't run in
+// lockstep with the others.
+static const uint64_t FixedPileHash = 0x9a58e6fa4d638964ull;
+
+// Slowest Fixed may step, as a multiple of PhysicsWorld's time
+static const double MaxFixedSlowdown = 2.0;
+
+template <class S>
+struct ScalarBodies
+{
+    std::vector<std::unique_ptr<RigidBodyT<S>>> bodies;
+};
+
+static double AsDouble(float value) { return value; }
+static double AsDouble(double value) { return value; }
+static double AsDouble(Fixed value) { return value.ToDouble(); }
+
+// Copies of the float bodies (shapes, mass & where they are) on S
+template <class S>
+static ScalarBodies<S> ConvertBodies(const std::vector<std::unique_ptr<RigidBody>>& source)
+{
+    ScalarBodies<S> converted;
+    for (auto& original : source)
+    {
+        const Shape* shape = original->GetShape();
+        ShapeT<S>* copy;
+        if (shape->Type() == ShapeType::Circle)
+        {
+            copy = new CircleShapeT<S>(S(((const CircleShape*)shape)->Radius()));
+        }
+        else
+        {
+            const Vector2& size = ((const BoxShape*)shape)->Size();
+            copy = new BoxShapeT<S>(S(size.x), S(size.y));
+        }
+
+        S mass = original->InvMass() == 0.0f ? ScalarTraits<S>::Max() : S(original->Mass());
+        RigidBodyT<S>* body = new RigidBodyT<S>(copy, mass);
+        body->Position() = Vector2T<S>(original->Position().x, original->Position().y);
+        body->Rotation() = S(original->Rotation());
+        converted.bodies.push_back(std::unique_ptr<RigidBodyT<S>>(body));
+    }
+    return converted;
+}
+
+struct PileResult
+{
+    double msPerStep;
+    uint64_t hash;
+    std::vector<double> positions;  // x & y of each body, at the end
+};
+
+template <class S>
+static PileResult RunPile(const std::vector<std::unique_ptr<RigidBody>>& source)
+{
+    ScalarBodies<S> scalarBodies = ConvertBodies<S>(source);
+    ScalarWorld<S> world(Vector2T<S>(0.0f, -20.0f), Iterations);
+    for (auto& body : scalarBodies.bodies)
+    {
+        world.AddBody(body.get());
+    }
+
+    S dt = S(Dt);
+    int64_t start = GetProfileTicks();
+    for (int i = 0; i < Steps; ++i)
+    {
+        world.Update(dt);
+    }
+
+    PileResult result;
+    result.msPerStep = TicksToMilliseconds(GetProfileTicks() - start) / Steps;
+    result.hash = world.ComputeStateHash();
+    for (auto& body : scalarBodies.bodies)
+    {
+        result.positions.push_back(AsDouble(body->Position().x));
+        result.positions.push_back(AsDouble(body->Position().y));
+    }
+    return result;
+}
+
+// Collide over every pair of a jumble of bodies, most of them close enough
+// to touch
+template <class S>
+static void TimeCollide(FILE* output)
+{
+    BenchRandom random(41);
+    std::vector<std::unique_ptr<RigidBody>> source;
+    for (int i = 0; i < 256; ++i)
+    {
+        Shape* shape;
+        if (random.Next() % 2 == 0)
+        {
+            shape = new CircleShape(random.Range(0.3f, 1.0f));
+        }
+        else
+        {
+            shape = new BoxShape(random.Range(0.5f, 2.0f), random.Range(0.5f, 2.0f));
+        }
+        source.push_back(std::unique_ptr<RigidBody>(new RigidBody(shape, 1.0f)));
+        source.back()->Position() = Vector2(random.Range(-4.0f, 4.0f), random.Range(-4.0f, 4.0f));
+        source.back()->Rotation() = random.Range(-3.0f, 3.0f);
+    }
+
+    ScalarBodies<S> scalarBodies = ConvertBodies<S>(source);
+    std::vector<RigidBodyT<S>*> bodies;
+    for (auto& body : scalarBodies.bodies)
+    {
+        bodies.push_back(body.get());
+    }
+
+    static const int Repeats = 20;
+    int hits = 0;
+    int64_t start = GetProfileTicks();
+    for (int r = 0; r < Repeats; ++r)
+    {
+        for (size_t i = 0; i < bodies.size(); ++i)
+        {
+            for (size_t j = i + 1; j < bodies.size(); ++j)
+            {
+                ContactInfoT<S> contact;
+                hits += Collide(bodies[i], bodies[j], contact);
+            }
+        }
+    }
+    double pairs = (double)Repeats * bodies.size() * (bodies.size() - 1) / 2;
+    fprintf(output, "Collide            %8.2f ns/pair (%d%% touching)\n",
+        TicksToMilliseconds(GetProfileTicks() - start) * 1e6 / pairs, (int)(100.0 * hits / pairs));
+}
+
+// Where TimeMathOp's results go, so that they aren't optimized away
+static volatile double MathSink;
+
+// Times op over values, in ns per value
+template <class T, class Op>
+static double TimeMathOp(const std::vector<T>& values, Op op)
+{
+    static const int Repeats = 200;
+    T sum = T(0);
+    int64_t start = GetProfileTicks();
+    for (int r = 0; r < Repeats; ++r)
+    {
+        for (auto& value : values)
+        {
+            sum += op(value);
+        }
+    }
+    double ns = TicksToMilliseconds(GetProfileTicks() - start) * 1e6 / ((double)Repeats * values.size());
+    MathSink = AsDouble(sum);
+    return ns;
+}
+
+template <class T>
+static void TimeMath(FILE* output, const char* name, const std::vector<T>& values)
+{
+    double sqrtNs = TimeMathOp(values, [](T x) { return Sqrt(x); });
+    double divideNs = TimeMathOp(values, [](T x) { return T(1) / (x + T(1)); });
+    double normalizeNs = TimeMathOp(values, [](T x) { return Vector2T<T>(x, T(1)).Normalized().x; });
+    double rotateNs = TimeMathOp(values, [](T x) { return Matrix2T<T>(x).col1.y; });
+    fprintf(output, "%-6s sqrt %5.2f  divide %5.2f  normalize %5.2f  Matrix2(angle) %5.2f ns\n",
+        name, sqrtNs, divideNs, normalizeNs, rotateNs);
+}
+
+// Largest errors in Fixed's approximations against double, and their cost
+// next to float's
+static void ReportFixedMath(FILE* output)
+{
+    BenchRandom random(43);
+    double sinError = 0, cosError = 0, sqrtError = 0, normalizeError = 0;
+    for (int i = 0; i < 100000; ++i)
+    {
+        Fixed angle(random.Range(-100.0f, 100.0f));
+        sinError = max(sinError, fabs(Sin(angle).ToDouble() - sin(angle.ToDouble())));
+        cosError = max(cosError, fabs(Cos(angle).ToDouble() - cos(angle.ToDouble())));
+
+        Fixed x(random.Range(0.0f, 1000.0f));
+        sqrtError = max(sqrtError, fabs(Sqrt(x).ToDouble() - sqrt(x.ToDouble())));
+
+        Vector2T<Fixed> v(random.Range(-10.0f, 10.0f), random.Range(-0.01f, 0.01f));
+        double length = sqrt(v.x.ToDouble() * v.x.ToDouble() + v.y.ToDouble() * v.y.ToDouble());
+        if (length > 0)
+        {
+            Vector2T<Fixed> n = v.Normalized();
+            normalizeError = max(normalizeError, fabs(n.x.ToDouble() - v.x.ToDouble() / length));
+            normalizeError = max(normalizeError, fabs(n.y.ToDouble() - v.y.ToDouble() / length));
+        }
+    }
+    fprintf(output, "Fixed math max error: sin %.2e, cos %.2e, sqrt %.2e, normalize %.2e (resolution %.2e)\n",
+        sinError, cosError, sqrtError, normalizeError, 1.0 / 65536.0);
+
+    std::vector<float> floats;
+    std::vector<Fixed> fixeds;
+    for (int i = 0; i < 4096; ++i)
+    {
+        float value = random.Range(0.0f, 100.0f);
+        floats.push_back(value);
+        fixeds.push_back(Fixed(value));
+    }
+    TimeMath(output, "float", floats);
+    TimeMath(output, "Fixed", fixeds);
+}
+
+template <class S>
+static bool BenchScalar(FILE* output)
+{
+    std::vector<std::unique_ptr<RigidBody>> source;
+    PhysicsWorld world(Vector2(0.0f, -20.0f), Iterations);
+    CreateBenchScene(&world, source, BodyCount, 5);
+
+    // The same pile on the world itself, for comparison
+    PileResult reference;
+    {
+        std::vector<std::unique_ptr<RigidBody>> bodies;
+        PhysicsWorld floatWorld(Vector2(0.0f, -20.0f), Iterations);
+        CreateBenchScene(&floatWorld, bodies, BodyCount, 5);
+
+        int64_t start = GetProfileTicks();
+        for (int i = 0; i < Steps; ++i)
+        {
+            floatWorld.Update(Dt);
+        }
+        reference.msPerStep = TicksToMilliseconds(GetProfileTicks() - start) / Steps;
+        reference.hash = floatWorld.ComputeStateHash();
+    }
+
+    PileResult first = RunPile<S>(source);
+    PileResult second = RunPile<S>(source);
+    PileResult precise = RunPile<double>(source);
+
+    double maxDrift = 0, totalDrift = 0;
+    for (size_t i = 0; i < first.positions.size(); i += 2)
+    {
+        double dx = first.positions[i] - precise.positions[i];
+        double dy = first.positions[i + 1] - precise.positions[i + 1];
+        double drift = sqrt(dx * dx + dy * dy);
+        maxDrift = max(maxDrift, drift);
+        totalDrift += drift;
+    }
+
+    fprintf(output, "-- %s, %d bodies, %d steps --\n", ScalarTraits<S>::Name(), BodyCount + 3, Steps);
+    fprintf(output, "PhysicsWorld       %8.3f ms/step\n", reference.msPerStep);
+    fprintf(output, "ScalarWorld        %8.3f ms/step (%.2fx PhysicsWorld's time)\n", first.msPerStep, first.msPerStep / reference.msPerStep);
+    fprintf(output, "distance from double: mean %.3g, max %.3g\n", totalDrift / (first.positions.size() / 2), maxDrift);
+    TimeCollide<S>(output);
+
+    bool succeeded = true;
+    if (first.hash != second.hash)
+    {
+        fprintf(output, "  runs differ (%016llx vs %016llx)\n", (unsigned long long)first.hash, (unsigned long long)second.hash);
+        succeeded = false;
+    }
+
+    if (std::is_same<S, float>::value)
+    {
+        bool matches = first.hash == reference.hash;
+        fprintf(output, "matches PhysicsWorld bit for bit: %s\n", matches ? "yes" : "no");
+        succeeded &= matches;
+    }
+
+    if (std::is_same<S, Fixed>::value)
+    {
+        bool matches = first.hash == FixedPileHash;
+        fprintf(output, "hash %016llx, %s\n", (unsigned long long)first.hash,
+            matches ? "the same as every other build" : "DIFFERENT from other builds");
+        succeeded &= matches;
+
+        // The faster of the two runs, so one hiccup doesn't fail it
+        double slowdown = min(first.msPerStep, second.msPerStep) / reference.msPerStep;
+        if (slowdown > MaxFixedSlowdown)
+        {
+            fprintf(output, "  %.2fx PhysicsWorld's time, over the %.1fx allowed\n", slowdown, MaxFixedSlowdown);
+            succeeded = false;
+        }
+
+        ReportFixedMath(output);
+    }
+
+    return succeeded;
+}
+
+bool BenchScalarFloat(FILE* output)
+{
+    return BenchScalar<float>(output);
+}
+
+bool BenchScalarDouble(FILE* output)
+{
+    return BenchScalar<double>(output);
+}
+
+bool BenchScalarFixed(FILE* output)
+{
+    return BenchScalar<Fixed>(output);
+}
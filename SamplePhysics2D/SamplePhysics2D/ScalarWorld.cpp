@@ -0,0 +1,161 @@
+#include "Precomp.h"
+#include "ScalarWorld.h"
+#include "RigidBody.h"
+#include "Shape.h"
+#include "WorldStages.h"
+
+template <class S>
+ScalarWorld<S>::ScalarWorld(const Vector& gravity, int maxIterations)
+    : _gravity(gravity)
+    , _maxIterations(maxIterations)
+    , _nextBodyId(1)
+    , _staticTreeDirty(false)
+{
+}
+
+template <class S>
+void ScalarWorld<S>::AddBody(Body* body)
+{
+    body->_id = _nextBodyId++;
+    _bodies.push_back(body);
+
+    if (body->IsKinematic())
+    {
+        _kinematicBodies.push_back(body);
+        _movingBodies.push_back(body);
+    }
+    else if (body->InvMass() != S(0))
+    {
+        _dynamicBodies.push_back(body);
+        _movingBodies.push_back(body);
+    }
+    else
+    {
+        _staticBodies.push_back(body);
+        _staticTreeDirty = true;
+    }
+}
+
+template <class S>
+void ScalarWorld<S>::Update(S dt)
+{
+    S invDt = dt > S(0) ? S(1) / dt : S(0);
+
+    // Determine overlapping bodies and update contact points
+    UpdatePairs();
+
+    IntegrateForces(_dynamicBodies.data(), _dynamicBodies.size(), _gravity, dt);
+    PreSolvePairs(_pairs.data(), _pairs.size(), invDt);
+    SolvePairs(_pairs.data(), _pairs.size(), _maxIterations);
+    IntegrateVelocities(_dynamicBodies.data(), _dynamicBodies.size(), dt);
+    IntegrateVelocities(_kinematicBodies.data(), _kinematicBodies.size(), dt);
+}
+
+template <class S>
+void ScalarWorld<S>::UpdatePairs()
+{
+    // Query bounds are grown more than PhysicsWorld's, so that rounding (which
+    // is coarser on Fixed) never loses a touching pair
+    static const float Margin = 0.01f;
+
+    if (_staticTreeDirty)
+    {
+        _staticTree.Build(_staticBodies, TreeBuild::SAH);
+        _staticTreeDirty = false;
+    }
+    _movingTree.Build(_movingBodies, TreeBuild::Median);
+
+    // Each dynamic body is tested against the bodies its bounds overlap. Pairs
+    // of dynamic bodies are found from both sides, so only the one found from
+    // the lower id is kept. Pairs that can't respond to each other (static &
+    // kinematic bodies) are never looked for, as in PhysicsWorld.
+    _pairs.clear();
+    for (auto& body : _dynamicBodies)
+    {
+        AABB bounds = ComputeAABB(body, Margin);
+        _found.clear();
+        _staticTree.Query(bounds, _found);
+        _movingTree.Query(bounds, _found);
+
+        for (auto& other : _found)
+        {
+            bool otherDynamic = !other->IsKinematic() && other->InvMass() != S(0);
+            if (otherDynamic && other->Id() <= body->Id())
+            {
+                continue;
+            }
+
+            Pair pair(body, other);
+            if (pair.HasContact())
+            {
+                _pairs.push_back(pair);
+            }
+        }
+    }
+
+    // PairKey order, as PhysicsWorld sorts them into
+    std::sort(std::begin(_pairs), std::end(_pairs), [](const Pair& a, const Pair& b)
+    {
+        return PairKey(a.Body1(), a.Body2()) < PairKey(b.Body1(), b.Body2());
+    });
+}
+
+// FNV-1a, fed 32 bits at a time, as PhysicsWorld's hash is
+static void HashBits(uint64_t& hash, uint32_t bits)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        hash ^= (bits >> (i * 8)) & 0xFF;
+        hash *= 0x100000001B3ull;
+    }
+}
+
+static void HashScalar(uint64_t& hash, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    HashBits(hash, bits);
+}
+
+static void HashScalar(uint64_t& hash, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    HashBits(hash, (uint32_t)bits);
+    HashBits(hash, (uint32_t)(bits >> 32));
+}
+
+static void HashScalar(uint64_t& hash, Fixed value)
+{
+    HashBits(hash, (uint32_t)value.Raw());
+}
+
+template <class S>
+uint64_t ScalarWorld<S>::ComputeStateHash() const
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (auto& body : _bodies)
+    {
+        HashBits(hash, body->Id());
+        HashScalar(hash, body->Position().x);
+        HashScalar(hash, body->Position().y);
+        HashScalar(hash, body->Rotation());
+        HashScalar(hash, body->LinearVelocity().x);
+        HashScalar(hash, body->LinearVelocity().y);
+        HashScalar(hash, body->AngularVelocity());
+    }
+
+    for (auto& pair : _pairs)
+    {
+        HashBits(hash, pair.Body1()->Id());
+        HashBits(hash, pair.Body2()->Id());
+        HashScalar(hash, pair.Contact().impulseNormal);
+    }
+
+    return hash;
+}
+
+template class ScalarWorld<float>;
+template class ScalarWorld<double>;
+template class ScalarWorld<Fixed>;
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "RigidBodyPair.h"
+#include "Broadphase.h"
+
+// A minimal world that runs on any of the scalar types (see Scalar.h): for
+// instance, on double for a server simulating far from the origin, or on
+// Fixed for lockstep clients that have to stay bit identical.
+//
+// It steps as PhysicsWorld's serial path does, calling the same stages (see
+// WorldStages.h) in the same order, so on float it gives bit identical
+// results. Pairs are found in the same BodyTrees as PhysicsWorld's, on float
+// bounds rounded outwards from the bodies' own scalars. What it leaves out is
+// scene queries, threading, contact reuse & snapshots.
+template <class S>
+class ScalarWorld
+{
+public:
+    typedef S Scalar;
+    typedef Vector2T<S> Vector;
+    typedef RigidBodyT<S> Body;
+    typedef RigidBodyPairT<S> Pair;
+
+    ScalarWorld(const Vector& gravity, int maxIterations);
+
+    // Bodies are assigned their ids here, in the order they're added, as in
+    // PhysicsWorld. The world doesn't take them over.
+    void AddBody(Body* body);
+
+    // All bodies in the world, sorted by id (the order they were added)
+    const std::vector<Body*>& Bodies() const { return _bodies; }
+
+    // The touching pairs found by the most recent Update, sorted by id
+    const std::vector<Pair>& Pairs() const { return _pairs; }
+
+    // Step the simulation forward by dt seconds
+    void Update(S dt);
+
+    // Hash of the bodies' states & the contacts' impulses. On float, the same
+    // as PhysicsWorld::ComputeStateHash for the same bodies & steps.
+    uint64_t ComputeStateHash() const;
+
+private:
+    void UpdatePairs();
+
+    Vector _gravity;
+    int _maxIterations;
+    uint32_t _nextBodyId;
+
+    std::vector<Body*> _bodies;
+    std::vector<Body*> _dynamicBodies;
+    std::vector<Body*> _kinematicBodies;
+    std::vector<Body*> _staticBodies;
+    BodyTreeT<S> _staticTree;       // rebuilt by the next Update when a static body is added
+    bool _staticTreeDirty;
+    std::vector<Body*> _movingBodies;   // dynamic & kinematic, rebuilt into _movingTree every step
+    BodyTreeT<S> _movingTree;
+    std::vector<Body*> _found;      // bodies found by each tree query
+    std::vector<Pair> _pairs;
+
+    // Prevent copy
+    ScalarWorld(const ScalarWorld&);
+    ScalarWorld& operator= (const ScalarWorld&);
+};
@@ -0,0 +1,310 @@
+#include "Precomp.h"
+#include "Scene.h"
+#include "PhysicsWorld.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// File layout: a SceneHeader, followed by bodyCount SceneBody records.
+// Bump the version whenever either of these change.
+static const uint32_t SceneMagic = 0x4E435350; // 'PSCN'
+static const uint32_t SceneVersion = 2;
+
+// SceneBody flags
+static const uint32_t SceneBodyKinematic = 0x1;
+
+struct SceneHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bodyCount;
+    uint32_t circleCount;
+};
+
+struct SceneBody
+{
+    uint32_t shapeType;     // ShapeType
+    uint32_t flags;         // SceneBody flags
+    float size[2];          // box width & height, or circle radius (and 0)
+    float position[2];
+    float rotation;
+    float mass, invMass;
+    float I, invI;
+};
+
+bool WriteSceneFile(const char* path, const RigidBody* const* bodies, size_t count)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    SceneHeader header = {};
+    header.magic = SceneMagic;
+    header.version = SceneVersion;
+    header.bodyCount = (uint32_t)count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (bodies[i]->GetShape()->Type() == ShapeType::Circle)
+        {
+            ++header.circleCount;
+        }
+    }
+    fwrite(&header, sizeof(header), 1, file);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const RigidBody* body = bodies[i];
+        const Shape* shape = body->GetShape();
+
+        SceneBody record = {};
+        record.shapeType = (uint32_t)shape->Type();
+        record.flags = body->IsKinematic() ? SceneBodyKinematic : 0;
+        switch (shape->Type())
+        {
+        case ShapeType::Circle:
+            record.size[0] = ((const CircleShape*)shape)->Radius();
+            break;
+
+        case ShapeType::Box:
+            record.size[0] = ((const BoxShape*)shape)->Size().x;
+            record.size[1] = ((const BoxShape*)shape)->Size().y;
+            break;
+
+        default:
+            assert(false);
+            break;
+        }
+        record.position[0] = body->Position().x;
+        record.position[1] = body->Position().y;
+        record.rotation = body->Rotation();
+        record.mass = body->Mass();
+        record.invMass = body->InvMass();
+        record.I = body->I();
+        record.invI = body->InvI();
+
+        fwrite(&record, sizeof(record), 1, file);
+    }
+
+    bool succeeded = (ferror(file) == 0);
+    fclose(file);
+    return succeeded;
+}
+
+// Read only memory mapping of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+#ifdef _WIN32
+    MappedFile() : _file(INVALID_HANDLE_VALUE), _mapping(nullptr), _data(nullptr), _size(0) {}
+
+    ~MappedFile()
+    {
+        if (_data)
+        {
+            UnmapViewOfFile(_data);
+        }
+        if (_mapping)
+        {
+            CloseHandle(_mapping);
+        }
+        if (_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(_file);
+        }
+    }
+
+    bool Open(const char* path)
+    {
+        _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (_file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+        {
+            return false;
+        }
+
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!_mapping)
+        {
+            return false;
+        }
+
+        _data = (const uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+        _size = (size_t)size.QuadPart;
+        return _data != nullptr;
+    }
+#else
+    MappedFile() : _file(-1), _data(nullptr), _size(0) {}
+
+    ~MappedFile()
+    {
+        if (_data)
+        {
+            munmap((void*)_data, _size);
+        }
+        if (_file != -1)
+        {
+            close(_file);
+        }
+    }
+
+    bool Open(const char* path)
+    {
+        _file = open(path, O_RDONLY);
+        if (_file == -1)
+        {
+            return false;
+        }
+
+        struct stat status;
+        if (fstat(_file, &status) != 0 || status.st_size == 0)
+        {
+            return false;
+        }
+
+        // The whole file is read, once, so map it all in up front rather
+        // than faulting it in a page at a time
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE;
+#endif
+        void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, flags, _file, 0);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        _data = (const uint8_t*)data;
+        _size = (size_t)status.st_size;
+        madvise(data, _size, MADV_SEQUENTIAL);
+        return true;
+    }
+#endif
+
+    const uint8_t* Data() const { return _data; }
+    size_t Size() const { return _size; }
+
+private:
+#ifdef _WIN32
+    HANDLE _file;
+    HANDLE _mapping;
+#else
+    int _file;
+#endif
+    const uint8_t* _data;
+    size_t _size;
+
+    // Prevent copy
+    MappedFile(const MappedFile&);
+    MappedFile& operator= (const MappedFile&);
+};
+
+Scene::Scene()
+    : _bodies(nullptr)
+    , _bodyCount(0)
+{
+}
+
+Scene::~Scene()
+{
+    Clear();
+}
+
+void Scene::Clear()
+{
+    for (size_t i = 0; i < _bodyCount; ++i)
+    {
+        _bodies[i].~RigidBody();
+    }
+    ::operator delete(_bodies);
+    _bodies = nullptr;
+    _bodyCount = 0;
+
+    _circles.reset();
+    _boxes.reset();
+}
+
+bool Scene::Load(const char* path)
+{
+    Clear();
+
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+
+    const SceneHeader* header = (const SceneHeader*)file.Data();
+    if (file.Size() < sizeof(SceneHeader) ||
+        header->magic != SceneMagic ||
+        header->version != SceneVersion ||
+        header->circleCount > header->bodyCount ||
+        file.Size() < sizeof(SceneHeader) + (size_t)header->bodyCount * sizeof(SceneBody))
+    {
+        return false;
+    }
+
+    const SceneBody* records = (const SceneBody*)(header + 1);
+    size_t count = header->bodyCount;
+
+    // One block per shape type, and one for all the bodies
+    _circles.reset(new CircleShape[header->circleCount]);
+    _boxes.reset(new BoxShape[count - header->circleCount]);
+    _bodies = (RigidBody*)::operator new(count * sizeof(RigidBody));
+
+    size_t numCircles = 0;
+    size_t numBoxes = 0;
+    for (; _bodyCount < count; ++_bodyCount)
+    {
+        const SceneBody& record = records[_bodyCount];
+
+        Shape* shape;
+        if (record.shapeType == (uint32_t)ShapeType::Circle && numCircles < header->circleCount)
+        {
+            CircleShape* circle = &_circles[numCircles++];
+            circle->Radius() = record.size[0];
+            shape = circle;
+        }
+        else if (record.shapeType == (uint32_t)ShapeType::Box && numBoxes < count - header->circleCount)
+        {
+            BoxShape* box = &_boxes[numBoxes++];
+            box->Size() = Vector2(record.size[0], record.size[1]);
+            shape = box;
+        }
+        else
+        {
+            // Corrupt file
+            Clear();
+            return false;
+        }
+
+        RigidBody::MassProperties massProperties = { record.mass, record.invMass, record.I, record.invI };
+        RigidBody* body = new (&_bodies[_bodyCount]) RigidBody(shape, massProperties);
+        body->Position() = Vector2(record.position[0], record.position[1]);
+        body->Rotation() = record.rotation;
+        if (record.flags & SceneBodyKinematic)
+        {
+            body->MakeKinematic();
+        }
+    }
+
+    return true;
+}
+
+void Scene::AddToWorld(PhysicsWorld* world)
+{
+    world->AddBodies(_bodies, _bodyCount);
+}
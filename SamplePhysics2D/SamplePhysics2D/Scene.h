@@ -0,0 +1,46 @@
+#pragma once
+
+class PhysicsWorld;
+
+// Writes the bodies out to a scene file, which can be loaded with Scene::Load.
+// Returns false if the file couldn't be written.
+bool WriteSceneFile(const char* path, const RigidBody* const* bodies, size_t count);
+
+// A set of bodies loaded from a scene file.
+//
+// Scene files are a flat array of fixed size body records, including the mass
+// properties precomputed when the file was written. Loading memory maps the
+// file and creates all of the bodies and shapes directly from it, into a few
+// contiguous blocks owned by the scene. There's no per body allocation, and
+// no shape mass computation at load time.
+//
+// The scene owns its bodies, so it must outlive any world they're added to.
+class Scene
+{
+public:
+    Scene();
+    ~Scene();
+
+    // Replaces the scene's contents with the bodies in the file. Returns false
+    // (leaving the scene empty) if the file is missing or isn't a valid scene.
+    bool Load(const char* path);
+
+    size_t BodyCount() const { return _bodyCount; }
+    RigidBody* Bodies() { return _bodies; }
+
+    // Adds all of the scene's bodies to the world
+    void AddToWorld(PhysicsWorld* world);
+
+private:
+    void Clear();
+
+    // Prevent copy
+    Scene(const Scene&);
+    Scene& operator= (const Scene&);
+
+private:
+    std::unique_ptr<CircleShape[]> _circles;
+    std::unique_ptr<BoxShape[]> _boxes;
+    RigidBody* _bodies;     // raw block, bodies constructed in place
+    size_t _bodyCount;
+};
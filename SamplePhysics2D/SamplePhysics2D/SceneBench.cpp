@@ -0,0 +1,137 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "Scene.h"
+#include "Shape.h"
+
+// Compares building a large level (mostly static boxes, with some circles,
+// dynamic & kinematic bodies) procedurally, body by body, against loading
+// the same level from a scene file, reporting the time of the load itself &
+// of adding its bodies to the world. Both start cold (on memory they haven't
+// touched yet), as a level load would.
+//
+// Checks that every loaded body matches its procedural counterpart exactly:
+// shape type & size, mass & inertia (and their inverses), position,
+// rotation, and whether it's kinematic. Then checks the worlds hash the same.
+
+static const int BodyCount = 200000;
+static const char ScenePath[] = "bench_scene.bin";
+
+static bool SameShape(const Shape* a, const Shape* b)
+{
+    if (a->Type() != b->Type())
+    {
+        return false;
+    }
+
+    switch (a->Type())
+    {
+    case ShapeType::Circle:
+        return ((const CircleShape*)a)->Radius() == ((const CircleShape*)b)->Radius();
+
+    case ShapeType::Box:
+        return ((const BoxShape*)a)->Size().x == ((const BoxShape*)b)->Size().x &&
+            ((const BoxShape*)a)->Size().y == ((const BoxShape*)b)->Size().y;
+
+    default:
+        assert(false);
+        return false;
+    }
+}
+
+static bool SameBody(const RigidBody* a, const RigidBody* b)
+{
+    return SameShape(a->GetShape(), b->GetShape()) &&
+        a->Mass() == b->Mass() && a->InvMass() == b->InvMass() &&
+        a->I() == b->I() && a->InvI() == b->InvI() &&
+        a->Position().x == b->Position().x && a->Position().y == b->Position().y &&
+        a->Rotation() == b->Rotation() &&
+        a->IsKinematic() == b->IsKinematic();
+}
+
+bool BenchScene(FILE* output)
+{
+    // Procedural
+    int64_t start = GetProfileTicks();
+
+    BenchRandom random(7);
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    PhysicsWorld proceduralWorld(Vector2(0.0f, -20.0f), 10);
+    int circles = 0;
+    int moving = 0;
+    for (int i = 0; i < BodyCount; ++i)
+    {
+        Shape* shape;
+        if (i % 8 == 0)
+        {
+            shape = new CircleShape(random.Range(0.25f, 2.0f));
+            ++circles;
+        }
+        else
+        {
+            shape = new BoxShape(random.Range(0.5f, 4.0f), random.Range(0.5f, 4.0f));
+        }
+
+        float mass = (i % 16 == 1) ? random.Range(1.0f, 10.0f) : FLT_MAX;
+        bodies.push_back(std::unique_ptr<RigidBody>(new RigidBody(shape, mass)));
+        bodies.back()->Position() = Vector2(random.Range(-1000.0f, 1000.0f), random.Range(-1000.0f, 1000.0f));
+        bodies.back()->Rotation() = random.Range(-(float)M_PI, (float)M_PI);
+        if (i % 64 == 3)
+        {
+            bodies.back()->MakeKinematic();
+        }
+        moving += (mass != FLT_MAX) || bodies.back()->IsKinematic();
+        proceduralWorld.AddBody(bodies.back().get());
+    }
+
+    double proceduralMs = TicksToMilliseconds(GetProfileTicks() - start);
+
+    std::vector<const RigidBody*> bodyList;
+    for (auto& body : bodies)
+    {
+        bodyList.push_back(body.get());
+    }
+    if (!WriteSceneFile(ScenePath, bodyList.data(), bodyList.size()))
+    {
+        fprintf(output, "Failed to write %s\n", ScenePath);
+        return false;
+    }
+
+    // Scene file
+    start = GetProfileTicks();
+
+    Scene scene;
+    bool loaded = scene.Load(ScenePath);
+    int64_t loadedTicks = GetProfileTicks();
+
+    PhysicsWorld sceneWorld(Vector2(0.0f, -20.0f), 10);
+    scene.AddToWorld(&sceneWorld);
+    int64_t end = GetProfileTicks();
+
+    double loadMs = TicksToMilliseconds(loadedTicks - start);
+    double addMs = TicksToMilliseconds(end - loadedTicks);
+
+    remove(ScenePath);
+
+    int mismatches = 0;
+    if (loaded && scene.BodyCount() == bodies.size())
+    {
+        for (size_t i = 0; i < bodies.size(); ++i)
+        {
+            mismatches += !SameBody(bodies[i].get(), &scene.Bodies()[i]);
+        }
+    }
+    bool matches = loaded && scene.BodyCount() == bodies.size() && mismatches == 0 &&
+        sceneWorld.ComputeStateHash() == proceduralWorld.ComputeStateHash();
+
+    fprintf(output, "%d bodies (%d circles, %d dynamic or kinematic, the rest static boxes)\n", BodyCount, circles, moving);
+    fprintf(output, "Procedural  %8.2f ms\n", proceduralMs);
+    fprintf(output, "Scene file  %8.2f ms (%.2fx): Load %.2f ms, AddToWorld %.2f ms\n", loadMs + addMs,
+        proceduralMs / (loadMs + addMs), loadMs, addMs);
+    fprintf(output, "Loaded bodies: %d of %d differ from the procedural ones\n", mismatches, (int)scene.BodyCount());
+    fprintf(output, "Loaded world %s the procedural one\n", matches ? "matches" : "DOES NOT MATCH");
+
+    return matches;
+}
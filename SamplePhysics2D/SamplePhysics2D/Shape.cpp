@@ -1,12 +1,21 @@
 #include "Precomp.h"
 #include "Shape.h"
 
-float CircleShape::ComputeI(float mass) const
+template <class S>
+S CircleShapeT<S>::ComputeI(S mass) const
 {
-    return mass * (_radius * _radius) / 4.0f;
+    return mass * (_radius * _radius) / S(4);
 }
 
-float BoxShape::ComputeI(float mass) const
+template <class S>
+S BoxShapeT<S>::ComputeI(S mass) const
 {
-    return mass * (_size.x * _size.x + _size.y * _size.y) / 12.0f;
+    return mass * (_size.x * _size.x + _size.y * _size.y) / S(12);
 }
+
+template class CircleShapeT<float>;
+template class CircleShapeT<double>;
+template class CircleShapeT<Fixed>;
+template class BoxShapeT<float>;
+template class BoxShapeT<double>;
+template class BoxShapeT<Fixed>;
@@ -6,56 +6,62 @@ enum class ShapeType
     Box,
 };
 
-class Shape
+// S is the scalar type (see Scalar.h); the engine uses Shape, on float
+template <class S>
+class ShapeT
 {
 public:
+    typedef S Scalar;
+
     ShapeType Type() const { return _type; }
 
     // Compute moment of inertia for the shape, given mass.
     // http://en.wikipedia.org/wiki/List_of_moments_of_inertia contains
     // a list of formulas for common shapes.
-    virtual float ComputeI(float mass) const = 0;
+    virtual S ComputeI(S mass) const = 0;
 
 protected:
     // Force this to only be a base class by making ctor protected
-    Shape(ShapeType type) : _type(type) {}
+    ShapeT(ShapeType type) : _type(type) {}
 
 private:
     ShapeType _type;
 
     // Prevent copy
-    Shape(const Shape&);
-    Shape& operator= (const Shape&);
+    ShapeT(const ShapeT&);
+    ShapeT& operator= (const ShapeT&);
 };
 
-class CircleShape : public Shape
+template <class S>
+class CircleShapeT : public ShapeT<S>
 {
 public:
-    CircleShape() : Shape(ShapeType::Circle), _radius(1.0f) {}
-    CircleShape(float radius) : Shape(ShapeType::Circle), _radius(radius) {}
+    CircleShapeT() : ShapeT<S>(ShapeType::Circle), _radius(1) {}
+    CircleShapeT(S radius) : ShapeT<S>(ShapeType::Circle), _radius(radius) {}
 
-    const float Radius() const { return _radius; }
-    float& Radius() { return _radius; }
+    const S Radius() const { return _radius; }
+    S& Radius() { return _radius; }
 
     // Shape
-    float ComputeI(float mass) const override;
+    S ComputeI(S mass) const override;
 
 private:
-    float _radius;
+    S _radius;
 };
 
-class BoxShape : public Shape
+template <class S>
+class BoxShapeT : public ShapeT<S>
 {
 public:
-    BoxShape() : Shape(ShapeType::Box), _size(1.0f, 1.0f) {}
-    BoxShape(float w, float h) : Shape(ShapeType::Box), _size(w, h) {}
+    BoxShapeT() : ShapeT<S>(ShapeType::Box), _size(1, 1) {}
+    BoxShapeT(S w, S h) : ShapeT<S>(ShapeType::Box), _size(w, h) {}
 
-    const Vector2& Size() const { return _size; }
-    Vector2& Size() { return _size; }
+    const Vector2T<S>& Size() const { return _size; }
+    Vector2T<S>& Size() { return _size; }
 
     // Shape
-    float ComputeI(float mass) const override;
+    S ComputeI(S mass) const override;
 
 private:
-    Vector2 _size;
+    Vector2T<S> _size;
 };
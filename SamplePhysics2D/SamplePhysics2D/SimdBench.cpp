@@ -0,0 +1,285 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "Profiling.h"
+
+// Checks that every Vec2xN & Rot2xN operation gives bit identical results, in
+// every lane, to the Vector2 / Matrix2 operation it mirrors. Then times a
+// small kernel (moving contact points into world space, and finding the
+// normal between them, much like the narrowphase does) written with Vector2,
+// Vec2x4 and Vec2x8.
+
+static const int Count = 4096;
+static const int Repeats = 200;
+
+// Random inputs, as structures of arrays
+struct SimdInputs
+{
+    std::vector<float> ax, ay, bx, by, s, angle, c2, s2;
+};
+
+static SimdInputs CreateInputs()
+{
+    BenchRandom random(23);
+    SimdInputs in;
+    for (int i = 0; i < Count; ++i)
+    {
+        in.ax.push_back(random.Range(-10.0f, 10.0f));
+        in.ay.push_back(random.Range(-10.0f, 10.0f));
+        in.bx.push_back(random.Range(-10.0f, 10.0f));
+        in.by.push_back(random.Range(-10.0f, 10.0f));
+        in.s.push_back(random.Range(-5.0f, 5.0f));
+        in.angle.push_back(random.Range(-4.0f, 4.0f));
+
+        float angle = random.Range(-4.0f, 4.0f);
+        in.c2.push_back(cosf(angle));
+        in.s2.push_back(sinf(angle));
+    }
+    return in;
+}
+
+static bool SameBits(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+static bool SameBits(const Vector2& a, const Vector2& b)
+{
+    return SameBits(a.x, b.x) && SameBits(a.y, b.y);
+}
+
+static bool SameBits(const Matrix2& a, const Matrix2& b)
+{
+    return SameBits(a.col1, b.col1) && SameBits(a.col2, b.col2);
+}
+
+// Compares each operation, a lane at a time. Returns the number of mismatches.
+template <class V, class R>
+static int CheckWidth(FILE* output, const SimdInputs& in)
+{
+    typedef typename V::Float F;
+    const int W = V::Width;
+
+    const char* failed = nullptr;
+    int mismatches = 0;
+    auto check = [&](bool same, const char* name)
+    {
+        if (!same)
+        {
+            ++mismatches;
+            failed = name;
+        }
+    };
+
+    for (int base = 0; base < Count; base += W)
+    {
+        V a = V::Load(&in.ax[base], &in.ay[base]);
+        V b = V::Load(&in.bx[base], &in.by[base]);
+        F s = F::Load(&in.s[base]);
+        R ra = R::FromAngles(&in.angle[base]);
+        R rb = R::Load(&in.c2[base], &in.s2[base]);
+
+        V sum = a + b;
+        V difference = a - b;
+        V negated = -a;
+        V scaled = a * s;
+        V scaledLeft = s * a;
+        V divided = a / s;
+        F dot = Dot(a, b);
+        F cross = Cross(a, b);
+        V crossVS = Cross(a, s);
+        V crossSV = Cross(s, a);
+        F length = a.Length();
+        V normalized = a.Normalized();
+        V rotated = ra * a;
+        V unrotated = ra.Transposed() * a;
+        R combined = ra * rb;
+        V selected = Select(dot > F(0.0f), a, b);
+        V accumulated = a;
+        accumulated += b;
+        accumulated -= scaled;
+
+        for (int i = 0; i < W; ++i)
+        {
+            Vector2 sa(in.ax[base + i], in.ay[base + i]);
+            Vector2 sb(in.bx[base + i], in.by[base + i]);
+            float ss = in.s[base + i];
+            Matrix2 ma(in.angle[base + i]);
+            Matrix2 mb(Vector2(in.c2[base + i], in.s2[base + i]), Vector2(-in.s2[base + i], in.c2[base + i]));
+
+            check(SameBits(sum.Lane(i), sa + sb), "operator+");
+            check(SameBits(difference.Lane(i), sa - sb), "operator-");
+            check(SameBits(negated.Lane(i), -sa), "negate");
+            check(SameBits(scaled.Lane(i), sa * ss), "operator* (vector, float)");
+            check(SameBits(scaledLeft.Lane(i), ss * sa), "operator* (float, vector)");
+            check(SameBits(divided.Lane(i), sa / ss), "operator/");
+            check(SameBits(dot.Lane(i), Dot(sa, sb)), "Dot");
+            check(SameBits(cross.Lane(i), Cross(sa, sb)), "Cross (vector, vector)");
+            check(SameBits(crossVS.Lane(i), Cross(sa, ss)), "Cross (vector, float)");
+            check(SameBits(crossSV.Lane(i), Cross(ss, sa)), "Cross (float, vector)");
+            check(SameBits(length.Lane(i), sa.Length()), "Length");
+            check(SameBits(normalized.Lane(i), sa.Normalized()), "Normalized");
+            check(SameBits(rotated.Lane(i), ma * sa), "rotate");
+            check(SameBits(unrotated.Lane(i), ma.Transposed() * sa), "rotate (transposed)");
+            check(SameBits(ra.Lane(i), ma), "FromAngles");
+            check(SameBits(combined.Lane(i), ma * mb), "combine rotations");
+            check(SameBits(selected.Lane(i), Dot(sa, sb) > 0.0f ? sa : sb), "Select");
+            check(SameBits(accumulated.Lane(i), sa + sb - sa * ss), "operator+= / -=");
+        }
+
+        // Partial loads & stores, for the ends of arrays
+        float xs[W + 1], ys[W + 1];
+        xs[W - 1] = ys[W - 1] = 123.0f;
+        V partial = V::Load(&in.ax[base], &in.ay[base], W - 1);
+        partial.Store(xs, ys, W - 1);
+        check(partial.Lane(W - 1).x == 0.0f && partial.Lane(W - 1).y == 0.0f, "Load (partial)");
+        check(xs[W - 1] == 123.0f && ys[W - 1] == 123.0f && xs[0] == in.ax[base], "Store (partial)");
+    }
+
+    // Masks
+    F lanes = F::Load(&in.s[0]);
+    typename F::Mask positive = lanes > F(0.0f);
+    int bits = 0;
+    for (int i = 0; i < W; ++i)
+    {
+        bits |= (in.s[i] > 0.0f) << i;
+    }
+    check(positive.Bits() == bits, "mask Bits");
+    check((positive | ~positive).All() && !(positive & ~positive).Any(), "mask logic");
+    check((positive ^ positive).Bits() == 0, "mask xor");
+
+    fprintf(output, "%d wide: %d mismatches%s%s\n", W, mismatches, failed ? ", last in " : "", failed ? failed : "");
+    return mismatches;
+}
+
+// Contact points (local to each body) moved into world space, and the unit
+// normal between them, for each of Count pairs of bodies
+struct KernelData
+{
+    std::vector<float> p1x, p1y, c1, s1, l1x, l1y;
+    std::vector<float> p2x, p2y, c2, s2, l2x, l2y;
+    std::vector<float> nx, ny;
+};
+
+static void KernelScalar(KernelData& d)
+{
+    for (int i = 0; i < Count; ++i)
+    {
+        Matrix2 r1(Vector2(d.c1[i], d.s1[i]), Vector2(-d.s1[i], d.c1[i]));
+        Matrix2 r2(Vector2(d.c2[i], d.s2[i]), Vector2(-d.s2[i], d.c2[i]));
+        Vector2 w1 = Vector2(d.p1x[i], d.p1y[i]) + r1 * Vector2(d.l1x[i], d.l1y[i]);
+        Vector2 w2 = Vector2(d.p2x[i], d.p2y[i]) + r2 * Vector2(d.l2x[i], d.l2y[i]);
+        Vector2 delta = w2 - w1;
+        Vector2 n = delta.LengthSq() > 0.0f ? delta.Normalized() : Vector2(0.0f, 1.0f);
+        d.nx[i] = n.x;
+        d.ny[i] = n.y;
+    }
+}
+
+template <class V, class R>
+static void KernelWide(KernelData& d)
+{
+    typedef typename V::Float F;
+    V up(Vector2(0.0f, 1.0f));
+    for (int i = 0; i < Count; i += V::Width)
+    {
+        R r1 = R::Load(&d.c1[i], &d.s1[i]);
+        R r2 = R::Load(&d.c2[i], &d.s2[i]);
+        V w1 = V::Load(&d.p1x[i], &d.p1y[i]) + r1 * V::Load(&d.l1x[i], &d.l1y[i]);
+        V w2 = V::Load(&d.p2x[i], &d.p2y[i]) + r2 * V::Load(&d.l2x[i], &d.l2y[i]);
+        V delta = w2 - w1;
+        typename F::Mask apart = delta.LengthSq() > F(0.0f);
+        V n = Select(apart, Select(apart, delta, up).Normalized(), up);
+        n.Store(&d.nx[i], &d.ny[i]);
+    }
+}
+
+static KernelData CreateKernelData()
+{
+    BenchRandom random(29);
+    KernelData d;
+    std::vector<float>* arrays[] = { &d.p1x, &d.p1y, &d.l1x, &d.l1y, &d.p2x, &d.p2y, &d.l2x, &d.l2y };
+    for (int i = 0; i < Count; ++i)
+    {
+        for (int a = 0; a < _countof(arrays); ++a)
+        {
+            arrays[a]->push_back(random.Range(-2.0f, 2.0f));
+        }
+
+        float angle1 = random.Range(-4.0f, 4.0f);
+        float angle2 = random.Range(-4.0f, 4.0f);
+        d.c1.push_back(cosf(angle1));
+        d.s1.push_back(sinf(angle1));
+        d.c2.push_back(cosf(angle2));
+        d.s2.push_back(sinf(angle2));
+    }
+
+    // Some pairs exactly on top of each other, for the fallback normal
+    for (int i = 0; i < Count; i += 37)
+    {
+        d.p2x[i] = d.p1x[i];
+        d.p2y[i] = d.p1y[i];
+        d.l1x[i] = d.l1y[i] = d.l2x[i] = d.l2y[i] = 0.0f;
+    }
+
+    d.nx.resize(Count);
+    d.ny.resize(Count);
+    return d;
+}
+
+static double TimeKernel(void (*kernel)(KernelData&), KernelData& d)
+{
+    int64_t start = GetProfileTicks();
+    for (int i = 0; i < Repeats; ++i)
+    {
+        kernel(d);
+    }
+    return TicksToMilliseconds(GetProfileTicks() - start) * 1e6 / ((double)Repeats * Count);
+}
+
+bool BenchSimd(FILE* output)
+{
+#if defined(SIMD_AVX)
+    fprintf(output, "instruction set: AVX\n");
+#elif defined(SIMD_SSE)
+    fprintf(output, "instruction set: SSE2 (8 wide is 2 x 4)\n");
+#elif defined(SIMD_NEON)
+    fprintf(output, "instruction set: NEON (8 wide is 2 x 4)\n");
+#else
+    fprintf(output, "instruction set: none (scalar fallback)\n");
+#endif
+
+    SimdInputs inputs = CreateInputs();
+    int mismatches = CheckWidth<Vec2x4, Rot2x4>(output, inputs);
+    mismatches += CheckWidth<Vec2x8, Rot2x8>(output, inputs);
+
+    KernelData data = CreateKernelData();
+    double scalarNs = TimeKernel(KernelScalar, data);
+    std::vector<float> nx = data.nx, ny = data.ny;
+
+    struct WideKernel
+    {
+        const char* name;
+        void (*run)(KernelData&);
+    };
+    static const WideKernel Kernels[] =
+    {
+        { "Vec2x4", KernelWide<Vec2x4, Rot2x4> },
+        { "Vec2x8", KernelWide<Vec2x8, Rot2x8> },
+    };
+
+    fprintf(output, "-- world space contact normals, %d pairs --\n", Count);
+    fprintf(output, "%-8s %6.2f ns/pair\n", "Vector2", scalarNs);
+    for (int k = 0; k < _countof(Kernels); ++k)
+    {
+        double ns = TimeKernel(Kernels[k].run, data);
+        bool same = memcmp(nx.data(), data.nx.data(), Count * sizeof(float)) == 0 &&
+            memcmp(ny.data(), data.ny.data(), Count * sizeof(float)) == 0;
+        fprintf(output, "%-8s %6.2f ns/pair (%.2fx)%s\n", Kernels[k].name, ns, scalarNs / ns, same ? "" : "  results differ from Vector2");
+        if (!same)
+        {
+            ++mismatches;
+        }
+    }
+
+    return mismatches == 0;
+}
@@ -0,0 +1,521 @@
+#pragma once
+
+// Floats (and comparison masks) 4 & 8 at a time, on whatever vector
+// instructions the build targets: AVX, SSE2 or NEON, or plain C++ if none of
+// those. Define SIMD_SCALAR to force the plain C++ version (for instance, to
+// check a kernel against it).
+//
+// Every operation rounds exactly like the scalar float operation it stands in
+// for (there's no FMA, and no reciprocal or square root estimates, other than
+// InvSqrt's when asked for), so a kernel ported lane by lane from scalar code
+// gives bit identical results.
+//
+// Without AVX, Floatx8 is a pair of Floatx4s. Pass these by reference: 32 bit
+// x86 can't pass aligned types by value.
+#if defined(SIMD_SCALAR)
+#elif defined(__AVX__)
+#define SIMD_AVX
+#define SIMD_SSE
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SIMD_SSE
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define SIMD_NEON
+#endif
+
+#if defined(SIMD_AVX)
+#include <immintrin.h>
+#elif defined(SIMD_SSE)
+#include <emmintrin.h>
+#elif defined(SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+// Normalizing divides by a square root. By default, that's done exactly, the
+// same as 1.0f / sqrtf(x), so results are the same on every machine. Define
+// MATH_FAST_INV_SQRT to use the hardware's reciprocal square root estimate
+// refined with a Newton step instead: a relative error of about 1e-6, for a
+// few times the throughput. The estimate differs between CPU vendors, so that
+// gives up bit identical results across machines.
+inline float InvSqrt(float x)
+{
+#if !defined(MATH_FAST_INV_SQRT)
+    return 1.0f / sqrtf(x);
+#else
+#if defined(SIMD_SSE)
+    float e = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+#elif defined(SIMD_NEON)
+    float32x2_t v = vdup_n_f32(x);
+    float32x2_t estimate = vrsqrte_f32(v);
+    estimate = vmul_f32(estimate, vrsqrts_f32(vmul_f32(v, estimate), estimate));
+    float e = vget_lane_f32(estimate, 0);
+#else
+    // Bit trick for the estimate
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5f375a86 - (bits >> 1);
+    float e;
+    memcpy(&e, &bits, sizeof(e));
+    e = e * (1.5f - 0.5f * x * e * e);
+#endif
+    return e * (1.5f - 0.5f * x * e * e);
+#endif
+}
+
+//
+// 4 wide
+//
+
+// Result of comparing Floatx4s: all bits set in lanes where the comparison
+// held, clear elsewhere
+struct Maskx4
+{
+    static const int Width = 4;
+
+    Maskx4() {}
+
+#if defined(SIMD_SSE)
+    explicit Maskx4(__m128 v) : v(v) {}
+
+    // Bit i set if lane i is
+    int Bits() const { return _mm_movemask_ps(v); }
+
+    __m128 v;
+#elif defined(SIMD_NEON)
+    explicit Maskx4(uint32x4_t v) : v(v) {}
+
+    int Bits() const
+    {
+        static const uint32_t LaneBits[4] = { 1, 2, 4, 8 };
+        uint32x4_t bits = vandq_u32(v, vld1q_u32(LaneBits));
+        uint32x2_t sum = vorr_u32(vget_low_u32(bits), vget_high_u32(bits));
+        return (int)(vget_lane_u32(sum, 0) | vget_lane_u32(sum, 1));
+    }
+
+    uint32x4_t v;
+#else
+    int Bits() const { return (v[0] & 1) | (v[1] & 2) | (v[2] & 4) | (v[3] & 8); }
+
+    uint32_t v[4];
+#endif
+
+    bool Any() const { return Bits() != 0; }
+    bool All() const { return Bits() == 0xf; }
+};
+
+struct Floatx4
+{
+    static const int Width = 4;
+    typedef Maskx4 Mask;
+
+    Floatx4() {}
+
+#if defined(SIMD_SSE)
+    explicit Floatx4(__m128 v) : v(v) {}
+    Floatx4(float f) : v(_mm_set1_ps(f)) {}
+
+    // Width floats from p (which needn't be aligned)
+    static Floatx4 Load(const float* p) { return Floatx4(_mm_loadu_ps(p)); }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+    __m128 v;
+#elif defined(SIMD_NEON)
+    explicit Floatx4(float32x4_t v) : v(v) {}
+    Floatx4(float f) : v(vdupq_n_f32(f)) {}
+
+    static Floatx4 Load(const float* p) { return Floatx4(vld1q_f32(p)); }
+    void Store(float* p) const { vst1q_f32(p, v); }
+
+    float32x4_t v;
+#else
+    Floatx4(float f) { v[0] = v[1] = v[2] = v[3] = f; }
+
+    static Floatx4 Load(const float* p)
+    {
+        Floatx4 r;
+        r.v[0] = p[0]; r.v[1] = p[1]; r.v[2] = p[2]; r.v[3] = p[3];
+        return r;
+    }
+    void Store(float* p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+
+    float v[4];
+#endif
+
+    // The first count (up to Width) floats from p, the rest of the lanes 0,
+    // for the ends of arrays
+    static Floatx4 Load(const float* p, int count)
+    {
+        float lanes[Width] = {};
+        for (int i = 0; i < count && i < Width; ++i)
+        {
+            lanes[i] = p[i];
+        }
+        return Load(lanes);
+    }
+
+    void Store(float* p, int count) const
+    {
+        float lanes[Width];
+        Store(lanes);
+        for (int i = 0; i < count && i < Width; ++i)
+        {
+            p[i] = lanes[i];
+        }
+    }
+
+    float Lane(int i) const
+    {
+        float lanes[Width];
+        Store(lanes);
+        return lanes[i];
+    }
+};
+
+#if defined(SIMD_SSE)
+
+inline Floatx4 operator- (const Floatx4& a) { return Floatx4(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))); }
+inline Floatx4 operator+ (const Floatx4& a, const Floatx4& b) { return Floatx4(_mm_add_ps(a.v, b.v)); }
+inline Floatx4 operator- (const Floatx4& a, const Floatx4& b) { return Floatx4(_mm_sub_ps(a.v, b.v)); }
+inline Floatx4 operator* (const Floatx4& a, const Floatx4& b) { return Floatx4(_mm_mul_ps(a.v, b.v)); }
+inline Floatx4 operator/ (const Floatx4& a, const Floatx4& b) { return Floatx4(_mm_div_ps(a.v, b.v)); }
+
+inline Floatx4 Sqrt(const Floatx4& a) { return Floatx4(_mm_sqrt_ps(a.v)); }
+inline Floatx4 Abs(const Floatx4& a) { return Floatx4(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+inline Floatx4 Min(const Floatx4& a, const Floatx4& b) { return Floatx4(_mm_min_ps(a.v, b.v)); }
+inline Floatx4 Max(const Floatx4& a, const Floatx4& b) { return Floatx4(_mm_max_ps(a.v, b.v)); }
+
+inline Maskx4 operator< (const Floatx4& a, const Floatx4& b) { return Maskx4(_mm_cmplt_ps(a.v, b.v)); }
+inline Maskx4 operator<= (const Floatx4& a, const Floatx4& b) { return Maskx4(_mm_cmple_ps(a.v, b.v)); }
+inline Maskx4 operator> (const Floatx4& a, const Floatx4& b) { return Maskx4(_mm_cmpgt_ps(a.v, b.v)); }
+inline Maskx4 operator>= (const Floatx4& a, const Floatx4& b) { return Maskx4(_mm_cmpge_ps(a.v, b.v)); }
+inline Maskx4 operator== (const Floatx4& a, const Floatx4& b) { return Maskx4(_mm_cmpeq_ps(a.v, b.v)); }
+inline Maskx4 operator!= (const Floatx4& a, const Floatx4& b) { return Maskx4(_mm_cmpneq_ps(a.v, b.v)); }
+
+inline Maskx4 operator& (const Maskx4& a, const Maskx4& b) { return Maskx4(_mm_and_ps(a.v, b.v)); }
+inline Maskx4 operator| (const Maskx4& a, const Maskx4& b) { return Maskx4(_mm_or_ps(a.v, b.v)); }
+inline Maskx4 operator^ (const Maskx4& a, const Maskx4& b) { return Maskx4(_mm_xor_ps(a.v, b.v)); }
+inline Maskx4 operator~ (const Maskx4& a) { return Maskx4(_mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1)))); }
+
+// a in the lanes where mask is set, b in the others
+inline Floatx4 Select(const Maskx4& mask, const Floatx4& a, const Floatx4& b)
+{
+    return Floatx4(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)));
+}
+
+// 1 / Sqrt(a), rounding the same as the scalar InvSqrt
+inline Floatx4 InvSqrt(const Floatx4& a)
+{
+#if !defined(MATH_FAST_INV_SQRT)
+    return Floatx4(1.0f) / Sqrt(a);
+#else
+    Floatx4 e(_mm_rsqrt_ps(a.v));
+    return e * (Floatx4(1.5f) - Floatx4(0.5f) * a * e * e);
+#endif
+}
+
+// Stores x0, y0, x1, y1, ... to xy (2 * Width floats), as for an array of
+// Vector2s
+inline void StoreInterleaved(const Floatx4& x, const Floatx4& y, float* xy)
+{
+    _mm_storeu_ps(xy, _mm_unpacklo_ps(x.v, y.v));
+    _mm_storeu_ps(xy + 4, _mm_unpackhi_ps(x.v, y.v));
+}
+
+#elif defined(SIMD_NEON)
+
+inline Floatx4 operator- (const Floatx4& a) { return Floatx4(vnegq_f32(a.v)); }
+inline Floatx4 operator+ (const Floatx4& a, const Floatx4& b) { return Floatx4(vaddq_f32(a.v, b.v)); }
+inline Floatx4 operator- (const Floatx4& a, const Floatx4& b) { return Floatx4(vsubq_f32(a.v, b.v)); }
+inline Floatx4 operator* (const Floatx4& a, const Floatx4& b) { return Floatx4(vmulq_f32(a.v, b.v)); }
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+inline Floatx4 operator/ (const Floatx4& a, const Floatx4& b) { return Floatx4(vdivq_f32(a.v, b.v)); }
+inline Floatx4 Sqrt(const Floatx4& a) { return Floatx4(vsqrtq_f32(a.v)); }
+#else
+// 32 bit ARM only has estimates for these, which wouldn't round like the
+// scalar operations, so they're done a lane at a time
+inline Floatx4 operator/ (const Floatx4& a, const Floatx4& b)
+{
+    float x[4], y[4];
+    a.Store(x);
+    b.Store(y);
+    for (int i = 0; i < 4; ++i)
+    {
+        x[i] /= y[i];
+    }
+    return Floatx4::Load(x);
+}
+
+inline Floatx4 Sqrt(const Floatx4& a)
+{
+    float x[4];
+    a.Store(x);
+    for (int i = 0; i < 4; ++i)
+    {
+        x[i] = sqrtf(x[i]);
+    }
+    return Floatx4::Load(x);
+}
+#endif
+
+inline Floatx4 Abs(const Floatx4& a) { return Floatx4(vabsq_f32(a.v)); }
+inline Floatx4 Min(const Floatx4& a, const Floatx4& b) { return Floatx4(vminq_f32(a.v, b.v)); }
+inline Floatx4 Max(const Floatx4& a, const Floatx4& b) { return Floatx4(vmaxq_f32(a.v, b.v)); }
+
+inline Maskx4 operator< (const Floatx4& a, const Floatx4& b) { return Maskx4(vcltq_f32(a.v, b.v)); }
+inline Maskx4 operator<= (const Floatx4& a, const Floatx4& b) { return Maskx4(vcleq_f32(a.v, b.v)); }
+inline Maskx4 operator> (const Floatx4& a, const Floatx4& b) { return Maskx4(vcgtq_f32(a.v, b.v)); }
+inline Maskx4 operator>= (const Floatx4& a, const Floatx4& b) { return Maskx4(vcgeq_f32(a.v, b.v)); }
+inline Maskx4 operator== (const Floatx4& a, const Floatx4& b) { return Maskx4(vceqq_f32(a.v, b.v)); }
+inline Maskx4 operator!= (const Floatx4& a, const Floatx4& b) { return Maskx4(vmvnq_u32(vceqq_f32(a.v, b.v))); }
+
+inline Maskx4 operator& (const Maskx4& a, const Maskx4& b) { return Maskx4(vandq_u32(a.v, b.v)); }
+inline Maskx4 operator| (const Maskx4& a, const Maskx4& b) { return Maskx4(vorrq_u32(a.v, b.v)); }
+inline Maskx4 operator^ (const Maskx4& a, const Maskx4& b) { return Maskx4(veorq_u32(a.v, b.v)); }
+inline Maskx4 operator~ (const Maskx4& a) { return Maskx4(vmvnq_u32(a.v)); }
+
+inline Floatx4 Select(const Maskx4& mask, const Floatx4& a, const Floatx4& b)
+{
+    return Floatx4(vbslq_f32(mask.v, a.v, b.v));
+}
+
+inline Floatx4 InvSqrt(const Floatx4& a)
+{
+#if !defined(MATH_FAST_INV_SQRT)
+    return Floatx4(1.0f) / Sqrt(a);
+#else
+    float32x4_t estimate = vrsqrteq_f32(a.v);
+    estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(a.v, estimate), estimate));
+    Floatx4 e(estimate);
+    return e * (Floatx4(1.5f) - Floatx4(0.5f) * a * e * e);
+#endif
+}
+
+inline void StoreInterleaved(const Floatx4& x, const Floatx4& y, float* xy)
+{
+    float32x4x2_t pairs = { { x.v, y.v } };
+    vst2q_f32(xy, pairs);
+}
+
+#else
+
+// Applies expr (in terms of a[i] & b[i]) to each lane
+#define SIMD_LANES(Result, expr) \
+    Result r; \
+    for (int i = 0; i < 4; ++i) \
+    { \
+        r.v[i] = (expr); \
+    } \
+    return r;
+
+#define SIMD_MASK(condition) ((condition) ? 0xffffffffu : 0u)
+
+inline Floatx4 operator- (const Floatx4& a) { SIMD_LANES(Floatx4, -a.v[i]) }
+inline Floatx4 operator+ (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Floatx4, a.v[i] + b.v[i]) }
+inline Floatx4 operator- (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Floatx4, a.v[i] - b.v[i]) }
+inline Floatx4 operator* (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Floatx4, a.v[i] * b.v[i]) }
+inline Floatx4 operator/ (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Floatx4, a.v[i] / b.v[i]) }
+
+inline Floatx4 Sqrt(const Floatx4& a) { SIMD_LANES(Floatx4, sqrtf(a.v[i])) }
+inline Floatx4 Abs(const Floatx4& a) { SIMD_LANES(Floatx4, fabsf(a.v[i])) }
+inline Floatx4 Min(const Floatx4& a, const Floatx4& b) { SIMD_LANES(Floatx4, a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+inline Floatx4 Max(const Floatx4& a, const Floatx4& b) { SIMD_LANES(Floatx4, a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+
+inline Maskx4 operator< (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Maskx4, SIMD_MASK(a.v[i] < b.v[i])) }
+inline Maskx4 operator<= (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Maskx4, SIMD_MASK(a.v[i] <= b.v[i])) }
+inline Maskx4 operator> (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Maskx4, SIMD_MASK(a.v[i] > b.v[i])) }
+inline Maskx4 operator>= (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Maskx4, SIMD_MASK(a.v[i] >= b.v[i])) }
+inline Maskx4 operator== (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Maskx4, SIMD_MASK(a.v[i] == b.v[i])) }
+inline Maskx4 operator!= (const Floatx4& a, const Floatx4& b) { SIMD_LANES(Maskx4, SIMD_MASK(a.v[i] != b.v[i])) }
+
+inline Maskx4 operator& (const Maskx4& a, const Maskx4& b) { SIMD_LANES(Maskx4, a.v[i] & b.v[i]) }
+inline Maskx4 operator| (const Maskx4& a, const Maskx4& b) { SIMD_LANES(Maskx4, a.v[i] | b.v[i]) }
+inline Maskx4 operator^ (const Maskx4& a, const Maskx4& b) { SIMD_LANES(Maskx4, a.v[i] ^ b.v[i]) }
+inline Maskx4 operator~ (const Maskx4& a) { SIMD_LANES(Maskx4, ~a.v[i]) }
+
+inline Floatx4 Select(const Maskx4& mask, const Floatx4& a, const Floatx4& b) { SIMD_LANES(Floatx4, mask.v[i] ? a.v[i] : b.v[i]) }
+
+inline Floatx4 InvSqrt(const Floatx4& a) { SIMD_LANES(Floatx4, InvSqrt(a.v[i])) }
+
+inline void StoreInterleaved(const Floatx4& x, const Floatx4& y, float* xy)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        xy[i * 2] = x.v[i];
+        xy[i * 2 + 1] = y.v[i];
+    }
+}
+
+#undef SIMD_LANES
+#undef SIMD_MASK
+
+#endif
+
+//
+// 8 wide
+//
+
+struct Maskx8
+{
+    static const int Width = 8;
+
+    Maskx8() {}
+
+#if defined(SIMD_AVX)
+    explicit Maskx8(__m256 v) : v(v) {}
+
+    int Bits() const { return _mm256_movemask_ps(v); }
+
+    __m256 v;
+#else
+    Maskx8(const Maskx4& lo, const Maskx4& hi) : lo(lo), hi(hi) {}
+
+    int Bits() const { return lo.Bits() | (hi.Bits() << 4); }
+
+    Maskx4 lo, hi;
+#endif
+
+    bool Any() const { return Bits() != 0; }
+    bool All() const { return Bits() == 0xff; }
+};
+
+struct Floatx8
+{
+    static const int Width = 8;
+    typedef Maskx8 Mask;
+
+    Floatx8() {}
+
+#if defined(SIMD_AVX)
+    explicit Floatx8(__m256 v) : v(v) {}
+    Floatx8(float f) : v(_mm256_set1_ps(f)) {}
+
+    static Floatx8 Load(const float* p) { return Floatx8(_mm256_loadu_ps(p)); }
+    void Store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    __m256 v;
+#else
+    Floatx8(const Floatx4& lo, const Floatx4& hi) : lo(lo), hi(hi) {}
+    Floatx8(float f) : lo(f), hi(f) {}
+
+    static Floatx8 Load(const float* p) { return Floatx8(Floatx4::Load(p), Floatx4::Load(p + 4)); }
+    void Store(float* p) const { lo.Store(p); hi.Store(p + 4); }
+
+    Floatx4 lo, hi;
+#endif
+
+    static Floatx8 Load(const float* p, int count)
+    {
+        float lanes[Width] = {};
+        for (int i = 0; i < count && i < Width; ++i)
+        {
+            lanes[i] = p[i];
+        }
+        return Load(lanes);
+    }
+
+    void Store(float* p, int count) const
+    {
+        float lanes[Width];
+        Store(lanes);
+        for (int i = 0; i < count && i < Width; ++i)
+        {
+            p[i] = lanes[i];
+        }
+    }
+
+    float Lane(int i) const
+    {
+        float lanes[Width];
+        Store(lanes);
+        return lanes[i];
+    }
+};
+
+#if defined(SIMD_AVX)
+
+inline Floatx8 operator- (const Floatx8& a) { return Floatx8(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))); }
+inline Floatx8 operator+ (const Floatx8& a, const Floatx8& b) { return Floatx8(_mm256_add_ps(a.v, b.v)); }
+inline Floatx8 operator- (const Floatx8& a, const Floatx8& b) { return Floatx8(_mm256_sub_ps(a.v, b.v)); }
+inline Floatx8 operator* (const Floatx8& a, const Floatx8& b) { return Floatx8(_mm256_mul_ps(a.v, b.v)); }
+inline Floatx8 operator/ (const Floatx8& a, const Floatx8& b) { return Floatx8(_mm256_div_ps(a.v, b.v)); }
+
+inline Floatx8 Sqrt(const Floatx8& a) { return Floatx8(_mm256_sqrt_ps(a.v)); }
+inline Floatx8 Abs(const Floatx8& a) { return Floatx8(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+inline Floatx8 Min(const Floatx8& a, const Floatx8& b) { return Floatx8(_mm256_min_ps(a.v, b.v)); }
+inline Floatx8 Max(const Floatx8& a, const Floatx8& b) { return Floatx8(_mm256_max_ps(a.v, b.v)); }
+
+inline Maskx8 operator< (const Floatx8& a, const Floatx8& b) { return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+inline Maskx8 operator<= (const Floatx8& a, const Floatx8& b) { return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+inline Maskx8 operator> (const Floatx8& a, const Floatx8& b) { return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+inline Maskx8 operator>= (const Floatx8& a, const Floatx8& b) { return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+inline Maskx8 operator== (const Floatx8& a, const Floatx8& b) { return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)); }
+inline Maskx8 operator!= (const Floatx8& a, const Floatx8& b) { return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ)); }
+
+inline Maskx8 operator& (const Maskx8& a, const Maskx8& b) { return Maskx8(_mm256_and_ps(a.v, b.v)); }
+inline Maskx8 operator| (const Maskx8& a, const Maskx8& b) { return Maskx8(_mm256_or_ps(a.v, b.v)); }
+inline Maskx8 operator^ (const Maskx8& a, const Maskx8& b) { return Maskx8(_mm256_xor_ps(a.v, b.v)); }
+inline Maskx8 operator~ (const Maskx8& a) { return Maskx8(_mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))); }
+
+inline Floatx8 Select(const Maskx8& mask, const Floatx8& a, const Floatx8& b)
+{
+    return Floatx8(_mm256_blendv_ps(b.v, a.v, mask.v));
+}
+
+inline Floatx8 InvSqrt(const Floatx8& a)
+{
+#if !defined(MATH_FAST_INV_SQRT)
+    return Floatx8(1.0f) / Sqrt(a);
+#else
+    Floatx8 e(_mm256_rsqrt_ps(a.v));
+    return e * (Floatx8(1.5f) - Floatx8(0.5f) * a * e * e);
+#endif
+}
+
+// The unpacks work within each half, so the halves are put back in order after
+inline void StoreInterleaved(const Floatx8& x, const Floatx8& y, float* xy)
+{
+    __m256 lo = _mm256_unpacklo_ps(x.v, y.v);
+    __m256 hi = _mm256_unpackhi_ps(x.v, y.v);
+    _mm256_storeu_ps(xy, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(xy + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+#else
+
+inline Floatx8 operator- (const Floatx8& a) { return Floatx8(-a.lo, -a.hi); }
+inline Floatx8 operator+ (const Floatx8& a, const Floatx8& b) { return Floatx8(a.lo + b.lo, a.hi + b.hi); }
+inline Floatx8 operator- (const Floatx8& a, const Floatx8& b) { return Floatx8(a.lo - b.lo, a.hi - b.hi); }
+inline Floatx8 operator* (const Floatx8& a, const Floatx8& b) { return Floatx8(a.lo * b.lo, a.hi * b.hi); }
+inline Floatx8 operator/ (const Floatx8& a, const Floatx8& b) { return Floatx8(a.lo / b.lo, a.hi / b.hi); }
+
+inline Floatx8 Sqrt(const Floatx8& a) { return Floatx8(Sqrt(a.lo), Sqrt(a.hi)); }
+inline Floatx8 Abs(const Floatx8& a) { return Floatx8(Abs(a.lo), Abs(a.hi)); }
+inline Floatx8 Min(const Floatx8& a, const Floatx8& b) { return Floatx8(Min(a.lo, b.lo), Min(a.hi, b.hi)); }
+inline Floatx8 Max(const Floatx8& a, const Floatx8& b) { return Floatx8(Max(a.lo, b.lo), Max(a.hi, b.hi)); }
+
+inline Maskx8 operator< (const Floatx8& a, const Floatx8& b) { return Maskx8(a.lo < b.lo, a.hi < b.hi); }
+inline Maskx8 operator<= (const Floatx8& a, const Floatx8& b) { return Maskx8(a.lo <= b.lo, a.hi <= b.hi); }
+inline Maskx8 operator> (const Floatx8& a, const Floatx8& b) { return Maskx8(a.lo > b.lo, a.hi > b.hi); }
+inline Maskx8 operator>= (const Floatx8& a, const Floatx8& b) { return Maskx8(a.lo >= b.lo, a.hi >= b.hi); }
+inline Maskx8 operator== (const Floatx8& a, const Floatx8& b) { return Maskx8(a.lo == b.lo, a.hi == b.hi); }
+inline Maskx8 operator!= (const Floatx8& a, const Floatx8& b) { return Maskx8(a.lo != b.lo, a.hi != b.hi); }
+
+inline Maskx8 operator& (const Maskx8& a, const Maskx8& b) { return Maskx8(a.lo & b.lo, a.hi & b.hi); }
+inline Maskx8 operator| (const Maskx8& a, const Maskx8& b) { return Maskx8(a.lo | b.lo, a.hi | b.hi); }
+inline Maskx8 operator^ (const Maskx8& a, const Maskx8& b) { return Maskx8(a.lo ^ b.lo, a.hi ^ b.hi); }
+inline Maskx8 operator~ (const Maskx8& a) { return Maskx8(~a.lo, ~a.hi); }
+
+inline Floatx8 Select(const Maskx8& mask, const Floatx8& a, const Floatx8& b)
+{
+    return Floatx8(Select(mask.lo, a.lo, b.lo), Select(mask.hi, a.hi, b.hi));
+}
+
+inline Floatx8 InvSqrt(const Floatx8& a) { return Floatx8(InvSqrt(a.lo), InvSqrt(a.hi)); }
+
+inline void StoreInterleaved(const Floatx8& x, const Floatx8& y, float* xy)
+{
+    StoreInterleaved(x.lo, y.lo, xy);
+    StoreInterleaved(x.hi, y.hi, xy + 8);
+}
+
+#endif
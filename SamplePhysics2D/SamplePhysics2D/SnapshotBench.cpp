@@ -0,0 +1,93 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+
+// Measures PhysicsWorld::SaveState & LoadState on a settling pile of bodies,
+// with contact reuse off & on (when the pairs' caches are saved too), and
+// checks that a restored world resumes bit identically. Also checks that a
+// snapshot without caches is refused by a world reusing contacts.
+
+static const int BodyCount = 5000;
+static const int WarmupSteps = 3;
+static const int ResumeSteps = 3;
+static const int Repeats = 1000;
+static const float Dt = 1.0f / 60.0f;
+static const float ReuseTolerance = 0.01f;
+
+static bool RunSnapshot(FILE* output, float reuseTolerance, std::vector<uint8_t>& snapshot)
+{
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 10);
+    CreateBenchScene(&world, bodies, BodyCount, 42);
+    world.SetContactReuseTolerances(reuseTolerance, reuseTolerance);
+
+    // Get some contacts (and accumulated impulses) into the pair cache
+    for (int i = 0; i < WarmupSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+
+    world.SaveState(snapshot);
+
+    int64_t start = GetProfileTicks();
+    for (int i = 0; i < Repeats; ++i)
+    {
+        world.SaveState(snapshot);
+    }
+    double saveMs = TicksToMilliseconds(GetProfileTicks() - start) / Repeats;
+
+    // Run ahead, then roll back & replay the same steps
+    for (int i = 0; i < ResumeSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+    uint64_t expected = world.ComputeStateHash();
+
+    start = GetProfileTicks();
+    for (int i = 0; i < Repeats; ++i)
+    {
+        if (!world.LoadState(snapshot.data(), snapshot.size()))
+        {
+            fprintf(output, "LoadState rejected its own snapshot\n");
+            return false;
+        }
+    }
+    double loadMs = TicksToMilliseconds(GetProfileTicks() - start) / Repeats;
+
+    for (int i = 0; i < ResumeSteps; ++i)
+    {
+        world.Update(Dt);
+    }
+    uint64_t actual = world.ComputeStateHash();
+
+    fprintf(output, "-- contact reuse %s --\n", reuseTolerance > 0.0f ? "on (caches saved)" : "off");
+    fprintf(output, "%d bodies, %u byte snapshot\n", BodyCount, (uint32_t)snapshot.size());
+    fprintf(output, "SaveState  %8.2f us\n", saveMs * 1000.0);
+    fprintf(output, "LoadState  %8.2f us\n", loadMs * 1000.0);
+    fprintf(output, "Resume after %d steps: %s (%016llx vs %016llx)\n", ResumeSteps,
+        actual == expected ? "bit identical" : "DIVERGED", (unsigned long long)actual, (unsigned long long)expected);
+
+    return actual == expected;
+}
+
+bool BenchSnapshot(FILE* output)
+{
+    std::vector<uint8_t> withoutCaches;
+    std::vector<uint8_t> withCaches;
+    bool succeeded = RunSnapshot(output, 0.0f, withoutCaches);
+    succeeded &= RunSnapshot(output, ReuseTolerance, withCaches);
+
+    // Reusing contacts needs the caches
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 10);
+    CreateBenchScene(&world, bodies, BodyCount, 42);
+    world.SetContactReuseTolerances(ReuseTolerance, ReuseTolerance);
+    if (world.LoadState(withoutCaches.data(), withoutCaches.size()))
+    {
+        fprintf(output, "a snapshot without caches was loaded with contact reuse on\n");
+        succeeded = false;
+    }
+    return succeeded;
+}
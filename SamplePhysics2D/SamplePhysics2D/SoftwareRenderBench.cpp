@@ -0,0 +1,296 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "FrameCapture.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "SoftwareRenderer.h"
+
+// Checks SoftwareRenderer's lines on a small frame, where a world unit is a
+// pixel: that random lines (many of them crossing the frame's edges, or far
+// outside it) only set pixels on the line, without gaps, that both ends are
+// drawn, and that lines outside the frame or with non finite ends draw nothing.
+//
+// Then times rendering piles of bodies headless, and stepping, drawing,
+// rendering & capturing (as a raw stream, deleted again afterwards) a run of
+// frames. Build with SIMD_SCALAR defined to compare setting lines up without SIMD.
+
+static const uint32_t CheckWidth = 64;
+static const uint32_t CheckHeight = 48;
+static const int RandomLines = 500;
+
+static const uint32_t Width = 800;
+static const uint32_t Height = 600;
+static const int Frames = 60;
+static const int CaptureFrames = 120;
+static const int SettleSteps = 30;
+static const float Dt = 1.0f / 60.0f;
+
+static const char RawPath[] = "bench_softrender.raw";
+
+// Renders just the line from start to end, in world units that are pixels (y up)
+static void RenderLine(SoftwareRenderer& renderer, const Vector2& start, const Vector2& end)
+{
+    renderer.SetViewport(Vector2(0.5f * CheckWidth, 0.5f * CheckHeight), Vector2(0.5f * CheckWidth, 0.5f * CheckHeight));
+    renderer.DrawLine(start, end);
+    renderer.EndFrame();
+    renderer.Render();
+}
+
+static const uint32_t* Row(const SoftwareRenderer& renderer, uint32_t y)
+{
+    return (const uint32_t*)(renderer.Pixels() + y * renderer.Stride());
+}
+
+static bool IsSet(const SoftwareRenderer& renderer, uint32_t x, uint32_t y)
+{
+    return Row(renderer, y)[x] == DebugDraw::DefaultLineColor.Packed();
+}
+
+static int CountSet(const SoftwareRenderer& renderer)
+{
+    int count = 0;
+    for (uint32_t y = 0; y < renderer.Height(); ++y)
+    {
+        for (uint32_t x = 0; x < renderer.Width(); ++x)
+        {
+            count += IsSet(renderer, x, y);
+        }
+    }
+    return count;
+}
+
+// Distance from p to the segment from a to b
+static float SegmentDistance(const Vector2& p, const Vector2& a, const Vector2& b)
+{
+    Vector2 ab = b - a;
+    float lengthSq = ab.LengthSq();
+    float t = lengthSq > 0.0f ? min(max(Dot(p - a, ab) / lengthSq, 0.0f), 1.0f) : 0.0f;
+    return (a + ab * t - p).Length();
+}
+
+// Checks the pixels set for the line from start to end (in world units, with
+// y up). Returns the number of problems found.
+static int CheckLine(const SoftwareRenderer& renderer, const Vector2& start, const Vector2& end)
+{
+    // In pixels, with y down
+    Vector2 a(start.x, CheckHeight - start.y);
+    Vector2 b(end.x, CheckHeight - end.y);
+    int problems = 0;
+
+    // Every pixel set is on the line. Centers are within half a pixel of it
+    // (along either axis), plus a little for clipping & stepping rounding off.
+    std::vector<int> columns(CheckWidth), rows(CheckHeight);
+    for (uint32_t y = 0; y < CheckHeight; ++y)
+    {
+        for (uint32_t x = 0; x < CheckWidth; ++x)
+        {
+            if (IsSet(renderer, x, y))
+            {
+                problems += SegmentDistance(Vector2(x + 0.5f, y + 0.5f), a, b) > 0.75f;
+                ++columns[x];
+                ++rows[y];
+            }
+        }
+    }
+
+    // Both ends, where they're inside the frame (clear of its edges)
+    Vector2 ends[] = { a, b };
+    for (auto& p : ends)
+    {
+        if (p.x >= 1.0f && p.x < CheckWidth - 1.0f && p.y >= 1.0f && p.y < CheckHeight - 1.0f)
+        {
+            problems += !IsSet(renderer, (uint32_t)p.x, (uint32_t)p.y);
+        }
+    }
+
+    // No gaps: along its longer axis, every column (or row) the visible part
+    // of the line crosses has a pixel in it
+    bool alongX = fabsf(b.x - a.x) >= fabsf(b.y - a.y);
+    const std::vector<int>& lines = alongX ? columns : rows;
+    int first = -1, last = -1;
+    for (int i = 0; i < (int)lines.size(); ++i)
+    {
+        if (lines[i])
+        {
+            first = first < 0 ? i : first;
+            last = i;
+        }
+    }
+    for (int i = first + 1; i < last; ++i)
+    {
+        problems += lines[i] == 0;
+    }
+    return problems;
+}
+
+static bool CheckLines(FILE* output)
+{
+    SoftwareRenderer renderer(CheckWidth, CheckHeight);
+    BenchRandom random(41);
+    int problems = 0;
+    int drawn = 0;
+
+    for (int i = 0; i < RandomLines; ++i)
+    {
+        // Mostly inside the frame, some reaching well outside it, a few far away
+        float reach = i % 10 == 0 ? 1e5f : (i % 3 == 0 ? 40.0f : 0.0f);
+        Vector2 start(random.Range(-reach, CheckWidth + reach), random.Range(-reach, CheckHeight + reach));
+        Vector2 end(random.Range(-reach, CheckWidth + reach), random.Range(-reach, CheckHeight + reach));
+        RenderLine(renderer, start, end);
+        problems += CheckLine(renderer, start, end);
+        drawn += renderer.GetStats().lines != 0;
+    }
+
+    // A horizontal line, through the middle of a row of pixels
+    RenderLine(renderer, Vector2(10.5f, 40.5f), Vector2(20.5f, 40.5f));
+    bool horizontal = CountSet(renderer) == 11;
+    for (uint32_t x = 10; x <= 20; ++x)
+    {
+        horizontal &= IsSet(renderer, x, 7);
+    }
+
+    // Nothing for lines wholly outside the frame, or with ends that aren't finite
+    int outside = 0;
+    Vector2 offFrame[][2] =
+    {
+        { Vector2(-10.0f, -10.0f), Vector2(-1.0f, 60.0f) },
+        { Vector2(70.0f, 10.0f), Vector2(1e30f, 20.0f) },
+        { Vector2(10.0f, 10.0f), Vector2(std::numeric_limits<float>::infinity(), 20.0f) },
+        { Vector2(std::numeric_limits<float>::quiet_NaN(), 10.0f), Vector2(20.0f, 20.0f) },
+    };
+    for (auto& line : offFrame)
+    {
+        RenderLine(renderer, line[0], line[1]);
+        outside += CountSet(renderer);
+    }
+
+    fprintf(output, "%d random lines on a %ux%u frame (%d of them visible): %d problems\n", RandomLines, CheckWidth,
+        CheckHeight, drawn, problems);
+    if (!horizontal)
+    {
+        fprintf(output, "  horizontal line drawn wrong\n");
+    }
+    if (outside)
+    {
+        fprintf(output, "  %d pixels set by lines outside the frame, or with non finite ends\n", outside);
+    }
+    return problems == 0 && horizontal && outside == 0;
+}
+
+// Frames the whole pile, as it starts out
+static void FrameScene(SoftwareRenderer& renderer, int bodyCount)
+{
+    float side = sqrtf((float)bodyCount);
+    float halfHeight = 0.6f * side + 2.0f;
+    renderer.SetViewport(Vector2(0.0f, 0.5f * side), Vector2(halfHeight * Width / Height, halfHeight));
+}
+
+// Renders the same frame repeatedly
+static bool TimeRender(FILE* output, int bodyCount)
+{
+    BenchPile scene;
+    CreateBenchScene(scene, bodyCount, 23, SettleSteps);
+    SoftwareRenderer renderer(Width, Height);
+    FrameScene(renderer, bodyCount);
+
+    double prepareMs = 0, rasterMs = 0;
+    std::vector<uint8_t> first;
+    bool same = true;
+    for (int i = 0; i < Frames; ++i)
+    {
+        scene.world->Draw(&renderer);
+        renderer.EndFrame();
+        renderer.Render();
+        prepareMs += renderer.GetStats().prepareMs;
+        rasterMs += renderer.GetStats().rasterMs;
+
+        const uint8_t* pixels = renderer.Pixels();
+        if (i == 0)
+        {
+            first.assign(pixels, pixels + Height * renderer.Stride());
+        }
+        else
+        {
+            same &= memcmp(first.data(), pixels, first.size()) == 0;
+        }
+    }
+
+    const SoftwareRenderStats& stats = renderer.GetStats();
+    double frameMs = (prepareMs + rasterMs) / Frames;
+    fprintf(output, "%6d bodies  %7llu lines  %8llu pixels  prepare %6.3f ms  raster %6.3f ms  %7.1f frames/s  %6.1f Mpixels/s\n",
+        bodyCount, (unsigned long long)stats.lines, (unsigned long long)stats.pixels, prepareMs / Frames, rasterMs / Frames,
+        1000.0 / frameMs, stats.pixels / (rasterMs / Frames) * 1e-3);
+    if (!same)
+    {
+        fprintf(output, "  the same frame rendered differently\n");
+    }
+    return same;
+}
+
+// Steps, draws, renders & captures a run of frames, as a headless run would
+static bool TimeCapturedRun(FILE* output, int bodyCount)
+{
+    BenchPile scene;
+    CreateBenchScene(scene, bodyCount, 23, SettleSteps);
+
+    FrameCaptureSettings settings;
+    settings.path = RawPath;
+    settings.format = ImageFormat::Raw;
+    settings.policy = CapturePolicy::Block;
+
+    CaptureStats stats;
+    double stepMs = 0;
+    int64_t start = GetProfileTicks();
+    {
+        FrameCapture capture(settings);
+        SoftwareRenderer renderer(Width, Height);
+        FrameScene(renderer, bodyCount);
+        renderer.SetCapture(&capture);
+
+        for (int i = 0; i < CaptureFrames; ++i)
+        {
+            int64_t stepStart = GetProfileTicks();
+            scene.world->Update(Dt);
+            stepMs += TicksToMilliseconds(GetProfileTicks() - stepStart);
+
+            scene.world->Draw(&renderer);
+            renderer.EndFrame();
+            renderer.Render();
+        }
+
+        capture.Flush();
+        stats = capture.GetStats();
+    }
+    double totalMs = TicksToMilliseconds(GetProfileTicks() - start);
+    remove(RawPath);
+
+    fprintf(output, "%6d bodies, %d frames stepped, drawn, rendered & captured (raw): %.1f frames/s (%.1f without stepping), %.1f MB written\n",
+        bodyCount, CaptureFrames, CaptureFrames * 1000.0 / totalMs, CaptureFrames * 1000.0 / (totalMs - stepMs),
+        stats.bytesWritten / 1e6);
+
+    if (stats.framesWritten != (uint64_t)CaptureFrames || stats.writeErrors != 0)
+    {
+        fprintf(output, "  %llu of %d frames written, %llu write errors\n", (unsigned long long)stats.framesWritten,
+            CaptureFrames, (unsigned long long)stats.writeErrors);
+        return false;
+    }
+    return true;
+}
+
+bool BenchSoftwareRender(FILE* output)
+{
+#if defined(SIMD_SCALAR)
+    fprintf(output, "line setup: scalar\n");
+#else
+    fprintf(output, "line setup: %d wide SIMD\n", Floatx8::Width);
+#endif
+
+    bool succeeded = CheckLines(output);
+
+    fprintf(output, "%ux%u frames:\n", Width, Height);
+    succeeded &= TimeRender(output, 1000);
+    succeeded &= TimeRender(output, 20000);
+    succeeded &= TimeCapturedRun(output, 1000);
+    return succeeded;
+}
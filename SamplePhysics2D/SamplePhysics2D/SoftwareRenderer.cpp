@@ -0,0 +1,225 @@
+#include "Precomp.h"
+#include "SoftwareRenderer.h"
+#include "FrameCapture.h"
+#include "Profiling.h"
+
+// Lines are clipped & set up this many at a time, one per lane
+typedef Floatx8 LineFloats;
+static const int BatchWidth = LineFloats::Width;
+
+// Shapes are expanded this many at a time, so that their outlines are still in
+// cache when they're drawn
+static const size_t ShapeChunk = 256;
+
+// Lines are stepped along in 16.16 fixed point. Clipped lines stay this far
+// inside the frame's edges, which is more than stepping the longest line
+// possible (across a MaxSize frame) can round off by, so no step lands outside.
+static const int FixedShift = 16;
+static const float FixedOne = 65536.0f;
+static const float EdgeMargin = 0.25f;
+
+// Lines with an end further than this from the frame (in pixels), or that
+// isn't finite, aren't drawn
+static const float CoordinateLimit = 1e15f;
+
+static const uint32_t ClearColor = 0xff000000u;
+
+// The unused lanes of a partly filled batch are set up too (then skipped),
+// so they're zeroed to begin with rather than left uninitialized
+struct SoftwareRenderer::LineBatch
+{
+    LineBatch() { memset(this, 0, sizeof(*this)); }
+
+    float x0[BatchWidth], y0[BatchWidth];
+    float x1[BatchWidth], y1[BatchWidth];
+    uint32_t colors[BatchWidth];
+    int count;
+};
+
+// Liang-Barsky clipping against one edge of the frame: narrows [t0, t1] (the
+// part of each line to draw) to the part on the inside of the edge. p is how
+// fast each line heads out through the edge, and q how far inside it it starts.
+static void ClipEdge(const LineFloats& p, const LineFloats& q, LineFloats& t0, LineFloats& t1, LineFloats::Mask& visible)
+{
+    LineFloats zero(0.0f);
+    LineFloats::Mask parallel = p == zero;
+    LineFloats t = q / Select(parallel, LineFloats(1.0f), p);
+
+    t0 = Select(p < zero, Max(t0, t), t0);
+    t1 = Select(p > zero, Min(t1, t), t1);
+    visible = visible & ~(parallel & (q < zero));
+}
+
+SoftwareRenderer::SoftwareRenderer(uint32_t width, uint32_t height)
+    : _width(width)
+    , _height(height)
+    , _pixels((size_t)width * height, ClearColor)
+    , _points(ShapeChunk * CircleOutlineVertices)
+    , _capture(nullptr)
+{
+    assert(width > 0 && height > 0 && width <= MaxSize && height <= MaxSize);
+    SetViewport(Vector2(), Vector2(20, 20));
+}
+
+void SoftwareRenderer::SetViewport(const Vector2& position, const Vector2& size)
+{
+    // As DebugRenderer's vertex shaders map the viewport to the window, with y up
+    _scale = Vector2(0.5f * _width / size.x, -0.5f * _height / size.y);
+    _offset = Vector2(0.5f * _width - position.x * _scale.x, 0.5f * _height - position.y * _scale.y);
+}
+
+inline void SoftwareRenderer::AddLine(LineBatch& batch, const Vector2& start, const Vector2& end, uint32_t color)
+{
+    int i = batch.count++;
+    batch.x0[i] = start.x;
+    batch.y0[i] = start.y;
+    batch.x1[i] = end.x;
+    batch.y1[i] = end.y;
+    batch.colors[i] = color;
+
+    if (batch.count == BatchWidth)
+    {
+        DrawBatch(batch);
+    }
+}
+
+void SoftwareRenderer::Render()
+{
+    int64_t start = GetProfileTicks();
+    const DrawList& frame = PrepareFrame();
+    int64_t prepared = GetProfileTicks();
+
+    _stats.lines = 0;
+    _stats.pixels = 0;
+    std::fill(_pixels.begin(), _pixels.end(), ClearColor);
+
+    // In the same order DebugRenderer draws them
+    DrawShapes(ShapeType::Circle, frame.Circles());
+    DrawShapes(ShapeType::Box, frame.Boxes());
+
+    LineBatch batch;
+    const std::vector<LineVertex>& vertices = frame.LineVertices();
+    for (size_t i = 0; i + 1 < vertices.size(); i += 2)
+    {
+        AddLine(batch, vertices[i].position, vertices[i + 1].position, vertices[i].color);
+    }
+    DrawBatch(batch);
+    int64_t rasterized = GetProfileTicks();
+
+    if (_capture)
+    {
+        _capture->Capture(Pixels(), _width, _height, Stride());
+    }
+    int64_t end = GetProfileTicks();
+
+    _stats.prepareMs = TicksToMilliseconds(prepared - start);
+    _stats.rasterMs = TicksToMilliseconds(rasterized - prepared);
+    _stats.captureMs = TicksToMilliseconds(end - rasterized);
+}
+
+void SoftwareRenderer::DrawShapes(ShapeType type, const std::vector<ShapeInstance>& shapes)
+{
+    int lines = OutlineVertices(type) / 2;
+
+    LineBatch batch;
+    for (size_t first = 0; first < shapes.size(); first += ShapeChunk)
+    {
+        size_t count = min(ShapeChunk, shapes.size() - first);
+        ExpandShapes(type, &shapes[first], count, _points.data());
+
+        const Vector2* points = _points.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t color = shapes[first + i].color;
+            for (int k = 0; k < lines; ++k, points += 2)
+            {
+                AddLine(batch, points[0], points[1], color);
+            }
+        }
+    }
+    DrawBatch(batch);
+}
+
+void SoftwareRenderer::DrawBatch(LineBatch& batch)
+{
+    if (batch.count == 0)
+    {
+        return;
+    }
+
+    // To pixels
+    LineFloats scaleX(_scale.x), scaleY(_scale.y);
+    LineFloats offsetX(_offset.x), offsetY(_offset.y);
+    LineFloats x0 = LineFloats::Load(batch.x0) * scaleX + offsetX;
+    LineFloats y0 = LineFloats::Load(batch.y0) * scaleY + offsetY;
+    LineFloats x1 = LineFloats::Load(batch.x1) * scaleX + offsetX;
+    LineFloats y1 = LineFloats::Load(batch.y1) * scaleY + offsetY;
+    LineFloats dx = x1 - x0;
+    LineFloats dy = y1 - y0;
+
+    LineFloats limit(CoordinateLimit);
+    LineFloats::Mask visible = (Abs(x0) <= limit) & (Abs(y0) <= limit) & (Abs(x1) <= limit) & (Abs(y1) <= limit);
+
+    // Clip to the frame, less the margin
+    LineFloats minX(EdgeMargin), minY(EdgeMargin);
+    LineFloats maxX(_width - EdgeMargin), maxY(_height - EdgeMargin);
+    LineFloats t0(0.0f), t1(1.0f);
+    ClipEdge(-dx, x0 - minX, t0, t1, visible);
+    ClipEdge(dx, maxX - x0, t0, t1, visible);
+    ClipEdge(-dy, y0 - minY, t0, t1, visible);
+    ClipEdge(dy, maxY - y0, t0, t1, visible);
+    visible = visible & (t0 <= t1);
+
+    // The clipped ends, clamped in case rounding left them just outside
+    LineFloats cx0 = Min(Max(x0 + t0 * dx, minX), maxX);
+    LineFloats cy0 = Min(Max(y0 + t0 * dy, minY), maxY);
+    LineFloats cx1 = Min(Max(x0 + t1 * dx, minX), maxX);
+    LineFloats cy1 = Min(Max(y0 + t1 * dy, minY), maxY);
+
+    // Steps of no more than a pixel along the longer axis, with both ends
+    // drawn. Adding & subtracting 2^23 rounds the length to a whole number.
+    LineFloats cdx = cx1 - cx0;
+    LineFloats cdy = cy1 - cy0;
+    LineFloats round(8388608.0f);
+    LineFloats intervals = ((Max(Abs(cdx), Abs(cdy)) + round) - round) + LineFloats(1.0f);
+    LineFloats fixedOne(FixedOne);
+    LineFloats stepX = cdx / intervals * fixedOne;
+    LineFloats stepY = cdy / intervals * fixedOne;
+    LineFloats samples = Select(visible, intervals + LineFloats(1.0f), LineFloats(0.0f));
+
+    float xs[BatchWidth], ys[BatchWidth], stepXs[BatchWidth], stepYs[BatchWidth], sampleCounts[BatchWidth];
+    (cx0 * fixedOne).Store(xs);
+    (cy0 * fixedOne).Store(ys);
+    stepX.Store(stepXs);
+    stepY.Store(stepYs);
+    samples.Store(sampleCounts);
+
+    // Then step along each line a pixel at a time
+    uint32_t* pixels = _pixels.data();
+    size_t width = _width;
+    for (int i = 0; i < batch.count; ++i)
+    {
+        int count = (int)sampleCounts[i];
+        if (count == 0)
+        {
+            continue;
+        }
+
+        int32_t x = (int32_t)xs[i];
+        int32_t y = (int32_t)ys[i];
+        int32_t sx = (int32_t)stepXs[i];
+        int32_t sy = (int32_t)stepYs[i];
+        uint32_t color = batch.colors[i];
+        for (int k = 0; k < count; ++k)
+        {
+            pixels[(size_t)(y >> FixedShift) * width + (x >> FixedShift)] = color;
+            x += sx;
+            y += sy;
+        }
+
+        ++_stats.lines;
+        _stats.pixels += count;
+    }
+
+    batch.count = 0;
+}
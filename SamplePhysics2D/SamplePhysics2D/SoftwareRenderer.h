@@ -0,0 +1,80 @@
+#pragma once
+
+#include "DebugDraw.h"
+
+// Timings & counters from the most recent SoftwareRenderer::Render
+struct SoftwareRenderStats
+{
+    SoftwareRenderStats() : prepareMs(0), rasterMs(0), captureMs(0), lines(0), pixels(0) {}
+
+    double prepareMs;   // merging the frame's lists (see PrepareFrame)
+    double rasterMs;    // clearing, expanding shapes & drawing lines
+    double captureMs;   // handing the frame to the capture
+    uint64_t lines;     // lines at least partly inside the frame
+    uint64_t pixels;    // pixels written, overdraw included
+};
+
+// Debug renderer that rasterizes on the CPU, into RGBA pixels in memory. It
+// needs no GPU or window, so it can render headless runs (on build servers,
+// for instance) to image files or video through a FrameCapture, or to compare
+// against reference images.
+//
+// It draws what DebugRenderer does: circles & boxes, then lines, 1 pixel wide
+// and without antialiasing, onto black. Lines are clipped to the frame & set
+// up 8 at a time with SIMD, then stepped across the frame in fixed point. A
+// line is drawn all in its start's color (where DebugRenderer blends from one
+// end's color to the other's). Frames are identical on every machine.
+class SoftwareRenderer : public DebugDraw
+{
+public:
+    // Frames are width x height pixels, and at most MaxSize in each direction
+    SoftwareRenderer(uint32_t width, uint32_t height);
+
+    static const uint32_t MaxSize = 8192;
+
+    void SetViewport(const Vector2& position, const Vector2& size) override;
+
+    // Renders the frame into Pixels(), and hands it to the capture, if there is one
+    void Render() override;
+
+    // Each frame is copied to the capture as it's rendered, and written out on
+    // capture's thread
+    void SetCapture(FrameCapture* capture) override { _capture = capture; }
+
+    uint32_t Width() const { return _width; }
+    uint32_t Height() const { return _height; }
+
+    // The last frame rendered: RGBA, 8 bits a channel (as Color::Packed packs
+    // them), rows Stride() bytes apart, top row first
+    const uint8_t* Pixels() const { return (const uint8_t*)_pixels.data(); }
+    size_t Stride() const { return _width * sizeof(uint32_t); }
+
+    const SoftwareRenderStats& GetStats() const { return _stats; }
+
+private:
+    struct LineBatch;
+
+    // Expands shapes into their outlines, a chunk of them at a time, and draws them
+    void DrawShapes(ShapeType type, const std::vector<ShapeInstance>& shapes);
+
+    // Appends a line to the batch, drawing the batch once it's full
+    void AddLine(LineBatch& batch, const Vector2& start, const Vector2& end, uint32_t color);
+
+    // Clips & sets up the batch's lines together, draws them, and empties it
+    void DrawBatch(LineBatch& batch);
+
+    uint32_t _width, _height;
+    std::vector<uint32_t> _pixels;
+
+    // World to pixel coordinates: pixel = world * _scale + _offset
+    Vector2 _scale;
+    Vector2 _offset;
+
+    std::vector<Vector2> _points;   // a chunk of expanded outlines
+    FrameCapture* _capture;
+    SoftwareRenderStats _stats;
+
+    // Prevent copy
+    SoftwareRenderer(const SoftwareRenderer&);
+    SoftwareRenderer& operator= (const SoftwareRenderer&);
+};
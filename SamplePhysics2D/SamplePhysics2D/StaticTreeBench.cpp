@@ -0,0 +1,125 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "Broadphase.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+// Builds a BodyTree (with the SAH) over a large field of static boxes, checks its queries
+// against brute force, and times a world stepping dynamic bodies over it.
+// Then removes a batch of the statics, one at a time, and checks the world's
+// queries no longer find them.
+
+static const int StaticCount = 20000;
+static const int DynamicCount = 200;
+static const int QueryCount = 10000;
+static const int Steps = 60;
+static const int RemoveCount = 1000;
+static const float Dt = 1.0f / 60.0f;
+
+bool BenchStaticTree(FILE* output)
+{
+    BenchRandom random(7);
+
+    // Uneven ground made of small, randomly rotated boxes
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    std::vector<RigidBody*> statics;
+    for (int i = 0; i < StaticCount; ++i)
+    {
+        RigidBody* body = new RigidBody(new BoxShape(random.Range(0.5f, 2.0f), random.Range(0.5f, 2.0f)), FLT_MAX);
+        body->Position() = Vector2(random.Range(-500.0f, 500.0f), random.Range(-20.0f, 0.0f));
+        body->Rotation() = random.Range(-1.0f, 1.0f);
+        bodies.push_back(std::unique_ptr<RigidBody>(body));
+        statics.push_back(body);
+    }
+
+    BodyTree tree;
+    int64_t start = GetProfileTicks();
+    tree.Build(statics, TreeBuild::SAH);
+    double buildMs = TicksToMilliseconds(GetProfileTicks() - start);
+
+    // Every body found by brute force must be found by the tree (the tree
+    // pads its bounds slightly, so may find a few more)
+    int mismatches = 0;
+    size_t found = 0;
+    std::vector<RigidBody*> results;
+    double queryMs = 0;
+    for (int i = 0; i < QueryCount; ++i)
+    {
+        Vector2 center(random.Range(-500.0f, 500.0f), random.Range(-25.0f, 5.0f));
+        Vector2 extents(random.Range(0.1f, 3.0f), random.Range(0.1f, 3.0f));
+        AABB box(center - extents, center + extents);
+
+        results.clear();
+        start = GetProfileTicks();
+        tree.Query(box, results);
+        queryMs += TicksToMilliseconds(GetProfileTicks() - start);
+        found += results.size();
+
+        for (auto& body : statics)
+        {
+            if (Overlaps(ComputeAABB(body), box) && std::find(std::begin(results), std::end(results), body) == std::end(results))
+            {
+                ++mismatches;
+            }
+        }
+    }
+
+    // Drop dynamic bodies onto the ground
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 10);
+    for (auto& body : bodies)
+    {
+        world.AddBody(body.get());
+    }
+    for (int i = 0; i < DynamicCount; ++i)
+    {
+        RigidBody* body = new RigidBody(new CircleShape(random.Range(0.3f, 0.6f)), 5.0f);
+        body->Position() = Vector2(random.Range(-500.0f, 500.0f), random.Range(2.0f, 10.0f));
+        bodies.push_back(std::unique_ptr<RigidBody>(body));
+        world.AddBody(body);
+    }
+
+    double stepMs = 0;
+    int pairsTested = 0;
+    for (int i = 0; i < Steps; ++i)
+    {
+        start = GetProfileTicks();
+        world.Update(Dt);
+        stepMs += TicksToMilliseconds(GetProfileTicks() - start);
+        pairsTested += world.GetStepStats().pairsTested;
+    }
+
+    // Every other static, from the start
+    start = GetProfileTicks();
+    for (int i = 0; i < RemoveCount; ++i)
+    {
+        world.RemoveBody(statics[i * 2]);
+    }
+    double removeMs = TicksToMilliseconds(GetProfileTicks() - start);
+
+    int removedFound = 0;
+    double firstQueryMs = 0;
+    for (int i = 0; i < RemoveCount; ++i)
+    {
+        results.clear();
+        start = GetProfileTicks();
+        world.QueryAABB(ComputeAABB(statics[i * 2]), results);
+        firstQueryMs += i == 0 ? TicksToMilliseconds(GetProfileTicks() - start) : 0.0;
+
+        removedFound += std::find(std::begin(results), std::end(results), statics[i * 2]) != std::end(results);
+        mismatches += std::find(std::begin(results), std::end(results), statics[i * 2 + 1]) == std::end(results) &&
+            Overlaps(ComputeAABB(statics[i * 2]), ComputeAABB(statics[i * 2 + 1]));
+    }
+
+    fprintf(output, "%d static bodies, %u nodes, built in %.2f ms\n", StaticCount, (uint32_t)tree.NodeCount(), buildMs);
+    fprintf(output, "Query        %8.3f us (%.1f bodies found on average)\n", queryMs * 1000.0 / QueryCount, (double)found / QueryCount);
+    fprintf(output, "Step         %8.3f ms with %d dynamic bodies (first step includes the build)\n", stepMs / Steps, DynamicCount);
+    fprintf(output, "Pairs tested %8d per step (vs %d testing every static)\n", pairsTested / Steps,
+        DynamicCount * (DynamicCount - 1) / 2 + DynamicCount * StaticCount);
+    fprintf(output, "RemoveBody   %8.3f us per static, %d in a row (first query after, with the rebuild, %.2f ms)\n",
+        removeMs * 1000.0 / RemoveCount, RemoveCount, firstQueryMs);
+    fprintf(output, "Mismatches against brute force: %d, removed statics found: %d\n", mismatches, removedFound);
+
+    return mismatches == 0 && removedFound == 0;
+}
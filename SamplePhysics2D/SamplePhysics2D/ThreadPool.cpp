@@ -0,0 +1,137 @@
+#include "Precomp.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+// The ThreadPool whose loop this thread is running part of (if any), and which
+// of its threads this is. Loops started from inside one of the same ThreadPool's
+// loops run inline, rather than waiting on the loop they're part of.
+static thread_local const ThreadPool* t_owner = nullptr;
+static thread_local int t_threadIndex = 0;
+
+ThreadPool::ThreadPool(int workerCount)
+    : _generation(0)
+    , _busyWorkers(0)
+    , _exiting(false)
+    , _fn(nullptr)
+    , _count(0)
+    , _grainSize(1)
+    , _nextChunk(0)
+{
+    if (workerCount < 0)
+    {
+        workerCount = max((int)std::thread::hardware_concurrency() - 1, 0);
+    }
+
+    for (int i = 0; i < workerCount; ++i)
+    {
+        _workers.push_back(std::thread([this, i]() { WorkerMain(i + 1); }));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _exiting = true;
+    }
+    _workReady.notify_all();
+
+    for (auto& worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+int ThreadPool::CurrentThreadIndex() const
+{
+    return t_owner == this ? t_threadIndex : 0;
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grainSize = max(grainSize, (size_t)1);
+
+    // Not worth waking anyone for a single chunk. Loops nested inside another
+    // can't wait for the pool, as it's busy running the outer loop.
+    if (_workers.empty() || count <= grainSize || t_owner == this)
+    {
+        for (size_t begin = 0; begin < count; begin += grainSize)
+        {
+            fn(begin, min(begin + grainSize, count));
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock(_submitLock);
+
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _fn = &fn;
+        _count = count;
+        _grainSize = grainSize;
+        _nextChunk = 0;
+        _busyWorkers = (int)_workers.size();
+        ++_generation;
+    }
+    _workReady.notify_all();
+
+    const ThreadPool* outerOwner = t_owner;
+    int outerThreadIndex = t_threadIndex;
+    t_owner = this;
+    t_threadIndex = 0;
+    RunChunks();
+    t_owner = outerOwner;
+    t_threadIndex = outerThreadIndex;
+
+    // Wait for the workers to finish their last chunks
+    std::unique_lock<std::mutex> lock(_lock);
+    _workDone.wait(lock, [this]() { return _busyWorkers == 0; });
+    _fn = nullptr;
+}
+
+void ThreadPool::RunChunks()
+{
+    size_t chunkCount = (_count + _grainSize - 1) / _grainSize;
+    for (size_t chunk = _nextChunk++; chunk < chunkCount; chunk = _nextChunk++)
+    {
+        size_t begin = chunk * _grainSize;
+        (*_fn)(begin, min(begin + _grainSize, _count));
+    }
+}
+
+void ThreadPool::WorkerMain(int index)
+{
+    Tracer::SetThreadName("Worker");
+    t_owner = this;
+    t_threadIndex = index;
+
+    uint64_t lastGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            _workReady.wait(lock, [this, lastGeneration]() { return _exiting || _generation != lastGeneration; });
+            if (_exiting)
+            {
+                return;
+            }
+            lastGeneration = _generation;
+        }
+
+        {
+            TRACE_SCOPE("ThreadPool::ParallelFor");
+            RunChunks();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            --_busyWorkers;
+        }
+        _workDone.notify_one();
+    }
+}
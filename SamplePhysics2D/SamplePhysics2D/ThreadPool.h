@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Executor.h"
+
+// A fixed set of worker threads for running loops in parallel. The calling
+// thread joins in with the work, rather than sitting idle while it waits.
+//
+// Only one loop runs at a time. If several threads submit loops at once, they
+// take turns. Loops started from inside one of the pool's running loops run on
+// the calling thread.
+class ThreadPool : public Executor
+{
+public:
+    // Creates workerCount worker threads. By default, one fewer than the
+    // number of hardware threads, so that with the caller every core is busy.
+    explicit ThreadPool(int workerCount = -1);
+    ~ThreadPool();
+
+    // Number of threads loops are spread across (the workers, plus the caller)
+    int ThreadCount() const override { return (int)_workers.size() + 1; }
+    int CurrentThreadIndex() const override;
+
+    // Splits [0, count) into chunks of grainSize (the last may be smaller),
+    // and calls fn(begin, end) for each, across all threads. Returns once
+    // every chunk is done.
+    void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& fn) override;
+
+private:
+    // index is the worker's thread index (the caller is 0)
+    void WorkerMain(int index);
+
+    // Runs chunks of the current loop until there are none left
+    void RunChunks();
+
+    std::vector<std::thread> _workers;
+
+    std::mutex _submitLock;             // held for the duration of a loop
+    std::mutex _lock;
+    std::condition_variable _workReady;
+    std::condition_variable _workDone;
+    uint64_t _generation;               // bumped for each new loop
+    int _busyWorkers;                   // workers yet to finish the current loop
+    bool _exiting;
+
+    // The current loop
+    const std::function<void(size_t, size_t)>* _fn;
+    size_t _count;
+    size_t _grainSize;
+    std::atomic<size_t> _nextChunk;
+
+    // Prevent copy
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator= (const ThreadPool&);
+};
@@ -0,0 +1,222 @@
+#include "Precomp.h"
+#include "Trace.h"
+
+static const uint32_t TraceBufferCapacity = 16384;   // must be a power of 2
+
+// Per thread ring of events. Only the owning thread writes to it, and it
+// publishes each event by advancing head. Readers snapshot head and copy
+// out the events behind it, throwing away any that the writer may have
+// lapped (or started overwriting) while they were copying.
+struct TraceBuffer
+{
+    TraceBuffer() : head(0), clearedAt(0), threadIndex(0), threadName(nullptr) {}
+
+    TraceEvent events[TraceBufferCapacity];
+    std::atomic<uint32_t> head;         // total number of events ever written
+    std::atomic<uint32_t> clearedAt;    // value of head at the last Clear
+    int threadIndex;                    // of the thread that owns (or last owned) it
+    const char* threadName;
+};
+
+// The calling thread's name, and its ring once it has recorded something.
+// The ring is handed back to the free list when the thread exits.
+struct TraceOwner
+{
+    TraceOwner() : buffer(nullptr), name(nullptr) {}
+    ~TraceOwner();
+
+    TraceBuffer* buffer;
+    const char* name;
+};
+
+static std::atomic<bool> s_enabled(false);
+static std::mutex s_buffersLock;
+static std::vector<std::unique_ptr<TraceBuffer>> s_buffers;    // every ring, owned or free
+static std::vector<TraceBuffer*> s_freeBuffers;                // rings of threads that have exited
+static int s_nextThreadIndex = 0;
+static thread_local TraceOwner t_owner;
+
+TraceOwner::~TraceOwner()
+{
+    if (buffer)
+    {
+        std::lock_guard<std::mutex> lock(s_buffersLock);
+        s_freeBuffers.push_back(buffer);
+    }
+}
+
+// Gives the calling thread a ring, reusing a free one if there is one. This
+// is the only place a lock is taken on the recording path, once per thread.
+static TraceBuffer* AcquireThreadBuffer()
+{
+    std::lock_guard<std::mutex> lock(s_buffersLock);
+
+    TraceBuffer* buffer;
+    if (!s_freeBuffers.empty())
+    {
+        // The exited thread's events are dropped, rather than being shown
+        // under this thread's name
+        buffer = s_freeBuffers.back();
+        s_freeBuffers.pop_back();
+        buffer->clearedAt.store(buffer->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    else
+    {
+        s_buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+        buffer = s_buffers.back().get();
+    }
+
+    buffer->threadIndex = s_nextThreadIndex++;
+    buffer->threadName = t_owner.name;
+    t_owner.buffer = buffer;
+    return buffer;
+}
+
+void Tracer::Enable(bool enable)
+{
+    s_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool Tracer::IsEnabled()
+{
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::SetThreadName(const char* name)
+{
+    t_owner.name = name;
+    if (t_owner.buffer)
+    {
+        std::lock_guard<std::mutex> lock(s_buffersLock);
+        t_owner.buffer->threadName = name;
+    }
+}
+
+void Tracer::Record(const char* name, int64_t begin, int64_t end)
+{
+    TraceBuffer* buffer = t_owner.buffer;
+    if (!buffer)
+    {
+        if (!IsEnabled())
+        {
+            return;
+        }
+        buffer = AcquireThreadBuffer();
+    }
+
+    uint32_t head = buffer->head.load(std::memory_order_relaxed);
+    TraceEvent& e = buffer->events[head & (TraceBufferCapacity - 1)];
+    e.name = name;
+    e.begin = begin;
+    e.end = end;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+size_t Tracer::ThreadBufferCount()
+{
+    std::lock_guard<std::mutex> lock(s_buffersLock);
+    return s_buffers.size();
+}
+
+void Tracer::Clear()
+{
+    std::lock_guard<std::mutex> lock(s_buffersLock);
+    for (auto& buffer : s_buffers)
+    {
+        buffer->clearedAt.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+// Event names are expected to be simple identifiers, but escape anything
+// that would break the JSON just in case.
+static void WriteJsonString(FILE* file, const char* s)
+{
+    fputc('"', file);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(*s >= ' ' ? *s : '?', file);
+    }
+    fputc('"', file);
+}
+
+bool Tracer::WriteChromeTrace(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_buffersLock);
+
+    // Snapshot all the buffers first, so we can rebase timestamps
+    // on the earliest event in the trace.
+    std::vector<std::vector<TraceEvent>> snapshots(s_buffers.size());
+    int64_t origin = INT64_MAX;
+
+    for (size_t i = 0; i < s_buffers.size(); ++i)
+    {
+        TraceBuffer* buffer = s_buffers[i].get();
+
+        uint32_t head = buffer->head.load(std::memory_order_acquire);
+        uint32_t available = min(head - buffer->clearedAt.load(std::memory_order_relaxed), TraceBufferCapacity);
+
+        std::vector<TraceEvent>& events = snapshots[i];
+        events.resize(available);
+        for (uint32_t j = 0; j < available; ++j)
+        {
+            events[j] = buffer->events[(head - available + j) & (TraceBufferCapacity - 1)];
+        }
+
+        // The writer may have wrapped around onto the oldest entries while we
+        // copied, and may be part way through writing one more. Throw away every
+        // entry copied from a slot it could have touched, torn ones included:
+        // the slots of the lapped events it published since, and the next one.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t lapped = buffer->head.load(std::memory_order_relaxed) - head;
+        uint32_t free = TraceBufferCapacity - available;
+        uint32_t touched = lapped + 1 > free ? min(lapped + 1 - free, available) : 0;
+        events.erase(events.begin(), events.begin() + touched);
+
+        for (auto& e : events)
+        {
+            origin = min(origin, e.begin);
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    for (size_t i = 0; i < s_buffers.size(); ++i)
+    {
+        if (s_buffers[i]->threadName)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                first ? "" : ",\n", s_buffers[i]->threadIndex);
+            WriteJsonString(file, s_buffers[i]->threadName);
+            fprintf(file, "}}");
+            first = false;
+        }
+
+        for (auto& e : snapshots[i])
+        {
+            fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+            WriteJsonString(file, e.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                s_buffers[i]->threadIndex,
+                TicksToMilliseconds(e.begin - origin) * 1000.0,
+                TicksToMilliseconds(e.end - e.begin) * 1000.0);
+            first = false;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+
+    bool succeeded = (ferror(file) == 0);
+    fclose(file);
+    return succeeded;
+}
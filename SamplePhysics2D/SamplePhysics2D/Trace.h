@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Profiling.h"
+
+// Set PHYSICS_TRACING to 0 (in the project's preprocessor definitions) to
+// compile all of the trace events out of the physics code.
+#ifndef PHYSICS_TRACING
+#define PHYSICS_TRACING 1
+#endif
+
+// A single timed region of work on one thread. The name must be a string
+// literal (or otherwise outlive the tracer), since only the pointer is stored.
+struct TraceEvent
+{
+    const char* name;
+    int64_t     begin;      // performance counter ticks
+    int64_t     end;
+};
+
+// Collects timeline events from any number of threads. Each thread records
+// into its own fixed size ring buffer, so recording never takes a lock or
+// allocates (after the first event on a thread). When a ring fills up, the
+// oldest events are overwritten.
+//
+// A thread only gets a ring when it first records while tracing is enabled.
+// When it exits, its ring goes on a free list. Its events are still written
+// out until another thread takes that ring over.
+//
+// The collected timeline can be written out as Chrome trace event JSON, which
+// can be loaded in chrome://tracing or https://ui.perfetto.dev.
+class Tracer
+{
+public:
+    // Recording is off by default. Toggling is cheap & can be done at any time
+    static void Enable(bool enable);
+    static bool IsEnabled();
+
+    // Optionally name the calling thread in the trace output. The name must
+    // outlive the tracer. Cheap, and never allocates.
+    static void SetThreadName(const char* name);
+
+    // Record a completed event on the calling thread
+    static void Record(const char* name, int64_t begin, int64_t end);
+
+    // Discard everything recorded so far
+    static void Clear();
+
+    // Rings allocated so far, whether owned by a thread or free
+    static size_t ThreadBufferCount();
+
+    // Write out all recorded events as Chrome trace JSON. Can be called
+    // while other threads are still recording. Returns false if the file
+    // could not be written.
+    static bool WriteChromeTrace(const char* path);
+
+private:
+    Tracer();
+};
+
+// Records an event covering the lifetime of the object
+class ScopedTraceEvent
+{
+public:
+    ScopedTraceEvent(const char* name)
+        : _name(name), _begin(Tracer::IsEnabled() ? GetProfileTicks() : 0)
+    {}
+
+    ~ScopedTraceEvent()
+    {
+        if (_begin != 0)
+        {
+            Tracer::Record(_name, _begin, GetProfileTicks());
+        }
+    }
+
+private:
+    const char* _name;
+    int64_t _begin;
+
+    // Prevent copy
+    ScopedTraceEvent(const ScopedTraceEvent&);
+    ScopedTraceEvent& operator= (const ScopedTraceEvent&);
+};
+
+#if PHYSICS_TRACING
+// Records the enclosing scope as a trace event with the given name
+#define TRACE_SCOPE(name) ScopedTraceEvent PROFILE_CONCAT(_traceEvent, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
@@ -0,0 +1,362 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "JobSystem.h"
+#include "PhysicsWorld.h"
+#include "RigidBody.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <string>
+
+// Checks that naming threads never allocates a ring (creating & destroying
+// many thread pools with tracing off), and that threads' rings are recycled
+// once they exit (the same, with tracing on).
+//
+// Then steps a pile on a JobSystem with tracing on, writes the trace out as
+// Chrome JSON, reads it back and checks that it parses, reporting the events
+// recorded on each thread. Every frame must show up as one PhysicsWorld::Update
+// on the main thread, and every worker must have recorded something. The file
+// is deleted again afterwards.
+
+static const int PoolCount = 50;
+static const int PoolThreads = 4;
+static const int BodyCount = 500;
+static const int Frames = 10;
+static const int Threads = 4;
+static const float Dt = 1.0f / 60.0f;
+
+static const char TracePath[] = "bench_trace.json";
+
+// Just enough JSON to check the trace is well formed & read its events
+struct JsonValue
+{
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    JsonValue() : type(Null), number(0) {}
+
+    // The member with the given name, or null if there isn't one
+    const JsonValue* Find(const char* name) const
+    {
+        for (auto& member : members)
+        {
+            if (member.first == name)
+            {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+
+    Type type;
+    double number;
+    std::string string;
+    std::vector<JsonValue> elements;
+    std::vector<std::pair<std::string, JsonValue>> members;
+};
+
+static void SkipSpace(const char*& p)
+{
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+    {
+        ++p;
+    }
+}
+
+static bool ParseString(const char*& p, std::string& out)
+{
+    if (*p++ != '"')
+    {
+        return false;
+    }
+    for (; *p != '"'; ++p)
+    {
+        if (*p == '\0' || (unsigned char)*p < ' ')
+        {
+            return false;
+        }
+        if (*p == '\\')
+        {
+            ++p;
+            if (!strchr("\"\\/bfnrt", *p) || *p == '\0')
+            {
+                return false;
+            }
+        }
+        out += *p;
+    }
+    ++p;
+    return true;
+}
+
+static bool ParseValue(const char*& p, JsonValue& value)
+{
+    SkipSpace(p);
+    if (*p == '{')
+    {
+        value.type = JsonValue::Object;
+        SkipSpace(++p);
+        if (*p == '}')
+        {
+            ++p;
+            return true;
+        }
+        for (;;)
+        {
+            value.members.push_back(std::make_pair(std::string(), JsonValue()));
+            SkipSpace(p);
+            if (!ParseString(p, value.members.back().first))
+            {
+                return false;
+            }
+            SkipSpace(p);
+            if (*p++ != ':' || !ParseValue(p, value.members.back().second))
+            {
+                return false;
+            }
+            SkipSpace(p);
+            if (*p == '}')
+            {
+                ++p;
+                return true;
+            }
+            if (*p++ != ',')
+            {
+                return false;
+            }
+        }
+    }
+    if (*p == '[')
+    {
+        value.type = JsonValue::Array;
+        SkipSpace(++p);
+        if (*p == ']')
+        {
+            ++p;
+            return true;
+        }
+        for (;;)
+        {
+            value.elements.push_back(JsonValue());
+            if (!ParseValue(p, value.elements.back()))
+            {
+                return false;
+            }
+            SkipSpace(p);
+            if (*p == ']')
+            {
+                ++p;
+                return true;
+            }
+            if (*p++ != ',')
+            {
+                return false;
+            }
+        }
+    }
+    if (*p == '"')
+    {
+        value.type = JsonValue::String;
+        return ParseString(p, value.string);
+    }
+    if (strncmp(p, "true", 4) == 0 || strncmp(p, "null", 4) == 0)
+    {
+        value.type = (*p == 't') ? JsonValue::Bool : JsonValue::Null;
+        p += 4;
+        return true;
+    }
+    if (strncmp(p, "false", 5) == 0)
+    {
+        value.type = JsonValue::Bool;
+        p += 5;
+        return true;
+    }
+
+    char* end;
+    value.type = JsonValue::Number;
+    value.number = strtod(p, &end);
+    if (end == p)
+    {
+        return false;
+    }
+    p = end;
+    return true;
+}
+
+static bool ReadFile(const char* path, std::string& contents)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    char buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        contents.append(buffer, read);
+    }
+    fclose(file);
+    return true;
+}
+
+// Creates & destroys PoolCount pools (and job systems), running a loop on
+// each. Returns the number of rings allocated while doing so.
+static size_t CyclePools()
+{
+    size_t before = Tracer::ThreadBufferCount();
+    for (int i = 0; i < PoolCount; ++i)
+    {
+        {
+            ThreadPool pool(PoolThreads - 1);
+            pool.ParallelFor(PoolThreads * 16, 1, [](size_t, size_t) {});
+        }
+        {
+            JobSystem jobs(PoolThreads);
+            jobs.ParallelFor(PoolThreads * 16, 1, [](size_t, size_t) {});
+        }
+    }
+    return Tracer::ThreadBufferCount() - before;
+}
+
+// The events recorded on one thread of the trace
+struct ThreadEvents
+{
+    ThreadEvents() : name("(unnamed)"), events(0), updates(0) {}
+
+    std::string name;
+    int events;
+    int updates;    // PhysicsWorld::Update events
+};
+
+bool BenchTrace(FILE* output)
+{
+    bool succeeded = true;
+    bool wasEnabled = Tracer::IsEnabled();
+    Tracer::SetThreadName("Main");
+
+    Tracer::Enable(false);
+    size_t disabledRings = CyclePools();
+    Tracer::Enable(true);
+    size_t enabledRings = CyclePools();
+
+    // Only one pool is alive at a time, so its workers' rings & this thread's
+    size_t maxRings = PoolThreads;
+    fprintf(output, "%d thread pools & job systems of %d threads: %d rings allocated with tracing off, %d with it on (at most %d allowed)\n",
+        PoolCount, PoolThreads, (int)disabledRings, (int)enabledRings, (int)maxRings);
+    if (disabledRings != 0 || enabledRings > maxRings)
+    {
+        fprintf(output, "  rings aren't being recycled\n");
+        succeeded = false;
+    }
+
+    // Trace some frames
+    {
+        std::vector<std::unique_ptr<RigidBody>> bodies;
+        PhysicsWorld world(Vector2(0.0f, -20.0f), 10);
+        CreateBenchScene(&world, bodies, BodyCount, 31);
+        world.CreateJobSystem(Threads);
+
+        Tracer::Clear();
+        for (int i = 0; i < Frames; ++i)
+        {
+            world.Update(Dt);
+        }
+    }
+    bool written = Tracer::WriteChromeTrace(TracePath);
+    Tracer::Enable(wasEnabled);
+
+    std::string contents;
+    if (!written || !ReadFile(TracePath, contents))
+    {
+        fprintf(output, "  couldn't write & read back %s\n", TracePath);
+        remove(TracePath);
+        return false;
+    }
+    remove(TracePath);
+
+    JsonValue root;
+    const char* p = contents.c_str();
+    bool parsed = ParseValue(p, root);
+    SkipSpace(p);
+    const JsonValue* events = root.Find("traceEvents");
+    if (!parsed || *p != '\0' || !events || events->type != JsonValue::Array)
+    {
+        fprintf(output, "  the trace isn't valid JSON (%d bytes)\n", (int)contents.size());
+        return false;
+    }
+
+    std::map<int, ThreadEvents> threads;
+    int malformed = 0;
+    for (auto& e : events->elements)
+    {
+        const JsonValue* phase = e.Find("ph");
+        const JsonValue* tid = e.Find("tid");
+        const JsonValue* name = e.Find("name");
+        if (!phase || !tid || !name || tid->type != JsonValue::Number)
+        {
+            ++malformed;
+            continue;
+        }
+
+        ThreadEvents& thread = threads[(int)tid->number];
+        if (phase->string == "M")
+        {
+            const JsonValue* args = e.Find("args");
+            const JsonValue* threadName = args ? args->Find("name") : nullptr;
+            if (threadName)
+            {
+                thread.name = threadName->string;
+            }
+        }
+        else if (phase->string == "X" && e.Find("ts") && e.Find("dur"))
+        {
+            ++thread.events;
+            thread.updates += name->string == "PhysicsWorld::Update";
+        }
+        else
+        {
+            ++malformed;
+        }
+    }
+
+    fprintf(output, "%d bodies, %d frames on %d threads: %d bytes of JSON, %d events\n", BodyCount, Frames, Threads,
+        (int)contents.size(), (int)events->elements.size());
+
+    int mainUpdates = 0;
+    int workers = 0;
+    for (auto& entry : threads)
+    {
+        const ThreadEvents& thread = entry.second;
+        if (thread.events == 0)
+        {
+            continue;
+        }
+        fprintf(output, "  thread %3d %-12s %5d events\n", entry.first, thread.name.c_str(), thread.events);
+
+        if (thread.name == "Main")
+        {
+            mainUpdates += thread.updates;
+        }
+        else if (thread.name == "Job Worker")
+        {
+            ++workers;
+        }
+    }
+
+    if (malformed != 0)
+    {
+        fprintf(output, "  %d malformed events\n", malformed);
+        succeeded = false;
+    }
+    if (mainUpdates != Frames)
+    {
+        fprintf(output, "  %d PhysicsWorld::Update events on the main thread, expected %d\n", mainUpdates, Frames);
+        succeeded = false;
+    }
+    if (workers != Threads - 1)
+    {
+        fprintf(output, "  %d job workers recorded events, expected %d\n", workers, Threads - 1);
+        succeeded = false;
+    }
+    return succeeded;
+}
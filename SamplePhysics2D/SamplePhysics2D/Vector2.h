@@ -1,34 +1,36 @@
 #pragma once
 
-struct Vector2
+// 2D vector, on any of the scalar types in Scalar.h. The engine uses the float
+// version, Vector2.
+//
+// Trivially copyable (the compiler generates copies & assignment), so arrays
+// of these can be memcpy'd, and loops over them vectorized.
+template <class S>
+struct Vector2T
 {
-    Vector2() : x(0), y(0) {}
-    Vector2(int x, int y) : x((float)x), y((float)y) {}
-    Vector2(float x, float y) : x(x), y(y) {}
-    Vector2(const Vector2& other) : x(other.x), y(other.y) {}
+    typedef S Scalar;
 
-    // Negate
-    Vector2 operator- ()
-    {
-        return Vector2(-x, -y);
-    }
+    MATH_CONSTEXPR Vector2T() : x(0), y(0) {}
+    MATH_CONSTEXPR Vector2T(S x, S y) : x(x), y(y) {}
 
-    // Assign
-    Vector2& operator= (const Vector2& other)
+    // From ints, or from float constants for a Vector2T<double> or <Fixed>
+    template <class T>
+    MATH_CONSTEXPR Vector2T(T x, T y) : x(S(x)), y(S(y)) {}
+
+    // Negate
+    MATH_CONSTEXPR Vector2T operator- () const
     {
-        x = other.x;
-        y = other.y;
-        return *this;
+        return Vector2T(-x, -y);
     }
 
-    Vector2& operator+= (const Vector2& other)
+    Vector2T& operator+= (const Vector2T& other)
     {
         x += other.x;
         y += other.y;
         return *this;
     }
 
-    Vector2& operator-= (const Vector2& other)
+    Vector2T& operator-= (const Vector2T& other)
     {
         x -= other.x;
         y -= other.y;
@@ -36,80 +38,145 @@ struct Vector2
     }
 
     // Lengths
-    float LengthSq() const
+    MATH_CONSTEXPR S LengthSq() const
     {
         return x * x + y * y;
     }
 
-    float Length() const
+    S Length() const
     {
-        return sqrtf(LengthSq());
+        return Sqrt(LengthSq());
     }
 
-    // Normalization
+    // Normalization. The vector mustn't be zero length (use NormalizedOrZero
+    // if it might be).
     void Normalize()
     {
-        float invLen = Length();
-        assert(invLen != 0);
-        invLen = 1.0f / invLen;
+        S lenSq = LengthSq();
+        assert(lenSq != S(0));
+        S invLen = InvSqrt(lenSq);
         x *= invLen;
         y *= invLen;
     }
 
-    Vector2 Normalized() const
+    Vector2T Normalized() const
     {
-        Vector2 n(*this);
+        Vector2T n(*this);
         n.Normalize();
         return n;
     }
 
-    float x, y;
+    // Normalized, or zero if the vector is too short to normalize (for
+    // floats, under about 1e-19 long). Doesn't branch.
+    Vector2T NormalizedOrZero() const
+    {
+        S lenSq = LengthSq();
+        S invLen = InvSqrt(lenSq >= ScalarTraits<S>::Tiny() ? lenSq : S(1));
+        invLen = lenSq >= ScalarTraits<S>::Tiny() ? invLen : S(0);
+        return Vector2T(x * invLen, y * invLen);
+    }
+
+    S x, y;
 };
 
-inline Vector2 operator+ (const Vector2& a, const Vector2& b)
+typedef Vector2T<float> Vector2;
+
+// Fixed point vectors find their lengths with the squares kept in 64 bits
+// (see FixedLength). Squared in Q16.16, vectors shorter than about 0.004
+// would have no length at all.
+template <>
+inline Fixed Vector2T<Fixed>::Length() const
 {
-    return Vector2(a.x + b.x, a.y + b.y);
+    return FixedLength(x, y);
 }
 
-inline Vector2 operator- (const Vector2& a, const Vector2& b)
+template <>
+inline void Vector2T<Fixed>::Normalize()
 {
-    return Vector2(a.x - b.x, a.y - b.y);
+    assert(x != Fixed(0) || y != Fixed(0));
+    FixedNormalizeOrZero(x, y);
 }
 
-inline Vector2 operator* (float s, const Vector2& a)
+template <>
+inline Vector2T<Fixed> Vector2T<Fixed>::NormalizedOrZero() const
 {
-    return Vector2(a.x * s, a.y * s);
+    Vector2T n(*this);
+    FixedNormalizeOrZero(n.x, n.y);
+    return n;
 }
 
-inline Vector2 operator* (const Vector2& a, float s)
+// The scalar arguments below aren't used to deduce S, so that (for instance)
+// an int or double constant can scale a Vector2
+
+template <class S>
+inline MATH_CONSTEXPR Vector2T<S> operator+ (const Vector2T<S>& a, const Vector2T<S>& b)
 {
-    return Vector2(a.x * s, a.y * s);
+    return Vector2T<S>(a.x + b.x, a.y + b.y);
 }
 
-inline Vector2 operator/ (const Vector2& a, float s)
+template <class S>
+inline MATH_CONSTEXPR Vector2T<S> operator- (const Vector2T<S>& a, const Vector2T<S>& b)
 {
-    return Vector2(a.x / s, a.y / s);
+    return Vector2T<S>(a.x - b.x, a.y - b.y);
 }
 
-inline float Dot(const Vector2& a, const Vector2& b)
+template <class S>
+inline MATH_CONSTEXPR Vector2T<S> operator* (typename Vector2T<S>::Scalar s, const Vector2T<S>& a)
+{
+    return Vector2T<S>(a.x * s, a.y * s);
+}
+
+template <class S>
+inline MATH_CONSTEXPR Vector2T<S> operator* (const Vector2T<S>& a, typename Vector2T<S>::Scalar s)
+{
+    return Vector2T<S>(a.x * s, a.y * s);
+}
+
+template <class S>
+inline MATH_CONSTEXPR Vector2T<S> operator/ (const Vector2T<S>& a, typename Vector2T<S>::Scalar s)
+{
+    return Vector2T<S>(a.x / s, a.y / s);
+}
+
+template <class S>
+inline MATH_CONSTEXPR S Dot(const Vector2T<S>& a, const Vector2T<S>& b)
 {
     return a.x * b.x + a.y * b.y;
 }
 
 // Finds the length of the resulting vector from crossing the 2D vectors
-inline float Cross(const Vector2& a, const Vector2& b)
+template <class S>
+inline MATH_CONSTEXPR S Cross(const Vector2T<S>& a, const Vector2T<S>& b)
 {
     return a.x * b.y - a.y * b.x;
 }
 
 // 2D Cross (perp) product with a given length
-inline Vector2 Cross(const Vector2& a, float s)
+template <class S>
+inline MATH_CONSTEXPR Vector2T<S> Cross(const Vector2T<S>& a, typename Vector2T<S>::Scalar s)
 {
-    return Vector2(s * a.y, -s * a.x);
+    return Vector2T<S>(s * a.y, -s * a.x);
 }
 
 // 2D Cross (perp) product with a given length
-inline Vector2 Cross(float s, const Vector2& a)
+template <class S>
+inline MATH_CONSTEXPR Vector2T<S> Cross(typename Vector2T<S>::Scalar s, const Vector2T<S>& a)
 {
-    return Vector2(-s * a.y, s * a.x);
+    return Vector2T<S>(-s * a.y, s * a.x);
 }
+
+static_assert(std::is_trivially_copyable<Vector2>::value, "Vector2 must stay trivially copyable");
+static_assert(std::is_standard_layout<Vector2>::value, "Vector2 must stay standard layout");
+static_assert(sizeof(Vector2) == 2 * sizeof(float), "Vector2 must be just its two floats");
+static_assert(std::is_trivially_copyable<Vector2T<Fixed>>::value, "Vector2T<Fixed> must stay trivially copyable");
+
+#ifdef MATH_HAS_CONSTEXPR
+static_assert(Vector2(1.0f, 2.0f).LengthSq() == 5.0f, "LengthSq");
+static_assert(Dot(Vector2(1.0f, 2.0f), Vector2(3.0f, 4.0f)) == 11.0f, "Dot");
+static_assert(Cross(Vector2(1.0f, 2.0f), Vector2(3.0f, 4.0f)) == -2.0f, "Cross (vector, vector)");
+static_assert(Cross(Vector2(1.0f, 2.0f), 2.0f).x == 4.0f && Cross(Vector2(1.0f, 2.0f), 2.0f).y == -2.0f, "Cross (vector, float)");
+static_assert(Cross(2.0f, Vector2(1.0f, 2.0f)).x == -4.0f && Cross(2.0f, Vector2(1.0f, 2.0f)).y == 2.0f, "Cross (float, vector)");
+static_assert((Vector2(1, 2) + Vector2(3, 4) - Vector2(1, 1)).y == 5.0f, "operator+ / -");
+static_assert((2.0f * -Vector2(1, 2) / 4.0f).x == -0.5f, "operator* / negate");
+static_assert(Dot(Vector2T<double>(1.5f, 2.0f), Vector2T<double>(2, 4)) == 11.0, "Dot (double)");
+#endif
@@ -0,0 +1,169 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+
+// Compares Vector2 against a copy of how it used to be declared (with its
+// own copy constructor & assignment, which made it non-trivially copyable),
+// over the same integration loops the world runs, and over copying whole
+// arrays of them (as snapshots do). Results must match exactly; only the
+// code the compiler generates for them differs.
+//
+// Then reports how long the world's own integration stages take on a pile.
+
+static const int Count = 100000;
+static const int Repeats = 50;
+static const float Dt = 1.0f / 60.0f;
+
+// Vector2 as it was: user provided copy constructor & assignment
+struct LegacyVector2
+{
+    LegacyVector2() : x(0), y(0) {}
+    LegacyVector2(float x, float y) : x(x), y(y) {}
+    LegacyVector2(const LegacyVector2& other) : x(other.x), y(other.y) {}
+
+    LegacyVector2& operator= (const LegacyVector2& other)
+    {
+        x = other.x;
+        y = other.y;
+        return *this;
+    }
+
+    LegacyVector2& operator+= (const LegacyVector2& other)
+    {
+        x += other.x;
+        y += other.y;
+        return *this;
+    }
+
+    float x, y;
+};
+
+inline LegacyVector2 operator+ (const LegacyVector2& a, const LegacyVector2& b)
+{
+    return LegacyVector2(a.x + b.x, a.y + b.y);
+}
+
+inline LegacyVector2 operator* (float s, const LegacyVector2& a)
+{
+    return LegacyVector2(a.x * s, a.y * s);
+}
+
+static_assert(!std::is_trivially_copyable<LegacyVector2>::value, "LegacyVector2 should be what Vector2 was");
+
+template <class V>
+struct IntegrationArrays
+{
+    std::vector<V> position, velocity, force;
+    std::vector<float> invMass;
+};
+
+template <class V>
+static IntegrationArrays<V> CreateArrays()
+{
+    BenchRandom random(31);
+    IntegrationArrays<V> arrays;
+    for (int i = 0; i < Count; ++i)
+    {
+        arrays.position.push_back(V(random.Range(-50.0f, 50.0f), random.Range(0.0f, 50.0f)));
+        arrays.velocity.push_back(V(random.Range(-5.0f, 5.0f), random.Range(-5.0f, 5.0f)));
+        arrays.force.push_back(V(random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f)));
+        arrays.invMass.push_back(random.Range(0.1f, 1.0f));
+    }
+    return arrays;
+}
+
+// The arithmetic of IntegrateForces & IntegrateVelocities, over arrays
+template <class V>
+static void Integrate(IntegrationArrays<V>& arrays)
+{
+    V gravity(0.0f, -20.0f);
+    V* position = arrays.position.data();
+    V* velocity = arrays.velocity.data();
+    V* force = arrays.force.data();
+    const float* invMass = arrays.invMass.data();
+
+    for (int i = 0; i < Count; ++i)
+    {
+        velocity[i] += Dt * (gravity + invMass[i] * force[i]);
+    }
+    for (int i = 0; i < Count; ++i)
+    {
+        position[i] += Dt * velocity[i];
+        force[i] = V(0.0f, 0.0f);
+    }
+}
+
+struct TypeResult
+{
+    double integrateNs;     // per body
+    double copyUs;          // per array copy
+    std::vector<float> final;
+};
+
+template <class V>
+static TypeResult Run()
+{
+    TypeResult result;
+    IntegrationArrays<V> arrays = CreateArrays<V>();
+
+    int64_t start = GetProfileTicks();
+    for (int i = 0; i < Repeats; ++i)
+    {
+        Integrate(arrays);
+    }
+    result.integrateNs = TicksToMilliseconds(GetProfileTicks() - start) * 1e6 / ((double)Repeats * Count);
+
+    // Copying into an existing array, as a snapshot buffer would be
+    std::vector<V> copy(Count);
+    start = GetProfileTicks();
+    for (int i = 0; i < Repeats; ++i)
+    {
+        std::copy(arrays.position.begin(), arrays.position.end(), copy.begin());
+        arrays.position[i].x += copy[Count - 1 - i].y;
+    }
+    result.copyUs = TicksToMilliseconds(GetProfileTicks() - start) * 1e3 / Repeats;
+
+    for (auto& v : arrays.position)
+    {
+        result.final.push_back(v.x);
+        result.final.push_back(v.y);
+    }
+    return result;
+}
+
+bool BenchVector2(FILE* output)
+{
+    TypeResult legacy = Run<LegacyVector2>();
+    TypeResult current = Run<Vector2>();
+
+    fprintf(output, "-- %d bodies, %d steps --\n", Count, Repeats);
+    fprintf(output, "%-36s %6.3f ns/body  copy %8.1f us\n", "user provided copies (as it was)", legacy.integrateNs, legacy.copyUs);
+    fprintf(output, "%-36s %6.3f ns/body  copy %8.1f us  (%.2fx, %.2fx)\n", "trivially copyable", current.integrateNs, current.copyUs,
+        legacy.integrateNs / current.integrateNs, legacy.copyUs / current.copyUs);
+
+    bool succeeded = true;
+    if (memcmp(legacy.final.data(), current.final.data(), legacy.final.size() * sizeof(float)) != 0)
+    {
+        fprintf(output, "  results differ\n");
+        succeeded = false;
+    }
+
+    // The world's own integration stages
+    PhysicsWorld world(Vector2(0.0f, -20.0f), 20);
+    std::vector<std::unique_ptr<RigidBody>> bodies;
+    CreateBenchScene(&world, bodies, 1000, 3);
+
+    double forcesMs = 0, velocitiesMs = 0;
+    for (int i = 0; i < Repeats; ++i)
+    {
+        world.Update(Dt);
+        forcesMs += world.GetStepStats().integrateForcesMs;
+        velocitiesMs += world.GetStepStats().integrateVelocitiesMs;
+    }
+    fprintf(output, "-- world, 1000 bodies --\nintegrate forces %6.3f ms/step, integrate velocities %6.3f ms/step\n",
+        forcesMs / Repeats, velocitiesMs / Repeats);
+
+    return succeeded;
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "SimdFloat.h"
+
+// Vector2s & rotations (Matrix2s built from an angle) 4 or 8 at a time, one
+// per lane, for porting the solver & narrowphase to work on several pairs at
+// once. They mirror Vector2 & Matrix2, and round the same way in every lane,
+// so a kernel written with them matches the scalar one bit for bit.
+//
+// They're stored as structures of arrays: Load & Store go to separate arrays
+// of x's & y's (or cosines & sines).
+
+template <class F>
+struct Vec2xN
+{
+    typedef F Float;
+    typedef typename F::Mask Mask;
+    static const int Width = F::Width;
+
+    Vec2xN() {}
+    Vec2xN(const Float& x, const Float& y) : x(x), y(y) {}
+
+    // v in every lane
+    explicit Vec2xN(const Vector2& v) : x(v.x), y(v.y) {}
+
+    // Width vectors, from xs & ys (which needn't be aligned)
+    static Vec2xN Load(const float* xs, const float* ys)
+    {
+        return Vec2xN(Float::Load(xs), Float::Load(ys));
+    }
+
+    // The first count vectors (up to Width), the rest of the lanes zero
+    static Vec2xN Load(const float* xs, const float* ys, int count)
+    {
+        return Vec2xN(Float::Load(xs, count), Float::Load(ys, count));
+    }
+
+    void Store(float* xs, float* ys) const
+    {
+        x.Store(xs);
+        y.Store(ys);
+    }
+
+    void Store(float* xs, float* ys, int count) const
+    {
+        x.Store(xs, count);
+        y.Store(ys, count);
+    }
+
+    // Width vectors, to an array of Vector2s
+    void Store(Vector2* vs) const
+    {
+        StoreInterleaved(x, y, &vs[0].x);
+    }
+
+    Vector2 Lane(int i) const
+    {
+        return Vector2(x.Lane(i), y.Lane(i));
+    }
+
+    // Negate
+    Vec2xN operator- () const
+    {
+        return Vec2xN(-x, -y);
+    }
+
+    Vec2xN& operator+= (const Vec2xN& other)
+    {
+        x = x + other.x;
+        y = y + other.y;
+        return *this;
+    }
+
+    Vec2xN& operator-= (const Vec2xN& other)
+    {
+        x = x - other.x;
+        y = y - other.y;
+        return *this;
+    }
+
+    // Lengths
+    Float LengthSq() const
+    {
+        return x * x + y * y;
+    }
+
+    Float Length() const
+    {
+        return Sqrt(LengthSq());
+    }
+
+    // Normalization. Like Vector2's, every lane must have a non-zero length
+    // (zero lanes come out as NaNs), so mask those out with Select.
+    void Normalize()
+    {
+        Float invLen = InvSqrt(LengthSq());
+        x = x * invLen;
+        y = y * invLen;
+    }
+
+    Vec2xN Normalized() const
+    {
+        Vec2xN n(*this);
+        n.Normalize();
+        return n;
+    }
+
+    // Normalized, with lanes too short to normalize left zero
+    Vec2xN NormalizedOrZero() const
+    {
+        Float lenSq = LengthSq();
+        Mask normalizable = lenSq >= Float(FLT_MIN);
+        Float invLen = Select(normalizable, InvSqrt(Select(normalizable, lenSq, Float(1.0f))), Float(0.0f));
+        return Vec2xN(x * invLen, y * invLen);
+    }
+
+    Float x, y;
+};
+
+template <class F>
+inline Vec2xN<F> operator+ (const Vec2xN<F>& a, const Vec2xN<F>& b)
+{
+    return Vec2xN<F>(a.x + b.x, a.y + b.y);
+}
+
+template <class F>
+inline Vec2xN<F> operator- (const Vec2xN<F>& a, const Vec2xN<F>& b)
+{
+    return Vec2xN<F>(a.x - b.x, a.y - b.y);
+}
+
+template <class F>
+inline Vec2xN<F> operator* (const typename Vec2xN<F>::Float& s, const Vec2xN<F>& a)
+{
+    return Vec2xN<F>(a.x * s, a.y * s);
+}
+
+template <class F>
+inline Vec2xN<F> operator* (const Vec2xN<F>& a, const typename Vec2xN<F>::Float& s)
+{
+    return Vec2xN<F>(a.x * s, a.y * s);
+}
+
+template <class F>
+inline Vec2xN<F> operator/ (const Vec2xN<F>& a, const typename Vec2xN<F>::Float& s)
+{
+    return Vec2xN<F>(a.x / s, a.y / s);
+}
+
+template <class F>
+inline F Dot(const Vec2xN<F>& a, const Vec2xN<F>& b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+// Finds the length of the resulting vector from crossing the 2D vectors
+template <class F>
+inline F Cross(const Vec2xN<F>& a, const Vec2xN<F>& b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+// 2D Cross (perp) product with a given length
+template <class F>
+inline Vec2xN<F> Cross(const Vec2xN<F>& a, const typename Vec2xN<F>::Float& s)
+{
+    return Vec2xN<F>(s * a.y, -s * a.x);
+}
+
+// 2D Cross (perp) product with a given length
+template <class F>
+inline Vec2xN<F> Cross(const typename Vec2xN<F>::Float& s, const Vec2xN<F>& a)
+{
+    return Vec2xN<F>(-s * a.y, s * a.x);
+}
+
+// a in the lanes where mask is set, b in the others
+template <class F>
+inline Vec2xN<F> Select(const typename F::Mask& mask, const Vec2xN<F>& a, const Vec2xN<F>& b)
+{
+    return Vec2xN<F>(Select(mask, a.x, b.x), Select(mask, a.y, b.y));
+}
+
+// Rotations, as the cosine & sine of the angle: the same as a Matrix2 built
+// from that angle
+template <class F>
+struct Rot2xN
+{
+    typedef F Float;
+    static const int Width = F::Width;
+
+    Rot2xN() {}
+    Rot2xN(const Float& c, const Float& s) : c(c), s(s) {}
+
+    // m (which must be a rotation) in every lane
+    explicit Rot2xN(const Matrix2& m) : c(m.col1.x), s(m.col1.y) {}
+
+    // Rotations by Width angles. There are no vector instructions for cos
+    // & sin, so they're found a lane at a time, the same as Matrix2 does.
+    static Rot2xN FromAngles(const float* angles)
+    {
+        float cs[Width], ss[Width];
+        for (int i = 0; i < Width; ++i)
+        {
+            cs[i] = cosf(angles[i]);
+            ss[i] = sinf(angles[i]);
+        }
+        return Load(cs, ss);
+    }
+
+    static Rot2xN Load(const float* cs, const float* ss)
+    {
+        return Rot2xN(Float::Load(cs), Float::Load(ss));
+    }
+
+    static Rot2xN Load(const float* cs, const float* ss, int count)
+    {
+        return Rot2xN(Float::Load(cs, count), Float::Load(ss, count));
+    }
+
+    void Store(float* cs, float* ss) const
+    {
+        c.Store(cs);
+        s.Store(ss);
+    }
+
+    void Store(float* cs, float* ss, int count) const
+    {
+        c.Store(cs, count);
+        s.Store(ss, count);
+    }
+
+    Matrix2 Lane(int i) const
+    {
+        float laneC = c.Lane(i);
+        float laneS = s.Lane(i);
+        return Matrix2(Vector2(laneC, laneS), Vector2(-laneS, laneC));
+    }
+
+    // The inverse rotation
+    Rot2xN Transposed() const
+    {
+        return Rot2xN(c, -s);
+    }
+
+    Float c, s;
+};
+
+template <class F>
+inline Vec2xN<F> operator* (const Rot2xN<F>& R, const Vec2xN<F>& v)
+{
+    return Vec2xN<F>(R.c * v.x - R.s * v.y, R.s * v.x + R.c * v.y);
+}
+
+template <class F>
+inline Rot2xN<F> operator* (const Rot2xN<F>& A, const Rot2xN<F>& B)
+{
+    return Rot2xN<F>(A.c * B.c - A.s * B.s, A.s * B.c + A.c * B.s);
+}
+
+template <class F>
+inline Rot2xN<F> Select(const typename F::Mask& mask, const Rot2xN<F>& a, const Rot2xN<F>& b)
+{
+    return Rot2xN<F>(Select(mask, a.c, b.c), Select(mask, a.s, b.s));
+}
+
+typedef Vec2xN<Floatx4> Vec2x4;
+typedef Vec2xN<Floatx8> Vec2x8;
+typedef Rot2xN<Floatx4> Rot2x4;
+typedef Rot2xN<Floatx8> Rot2x8;
+
+// Replaces each of the count vectors in xs & ys (as in Vector2::
+// NormalizedOrZero) with its normalized self, or zero if too short to
+// normalize, as many at a time as the instruction set allows.
+inline void NormalizeOrZero(float* xs, float* ys, size_t count)
+{
+    size_t i = 0;
+    for (; i + Vec2x8::Width <= count; i += Vec2x8::Width)
+    {
+        Vec2x8::Load(xs + i, ys + i).NormalizedOrZero().Store(xs + i, ys + i);
+    }
+
+    if (i < count)
+    {
+        int left = (int)(count - i);
+        Vec2x8::Load(xs + i, ys + i, left).NormalizedOrZero().Store(xs + i, ys + i, left);
+    }
+}
@@ -0,0 +1,132 @@
+#include "Precomp.h"
+#include "WorldBatch.h"
+#include "PhysicsWorld.h"
+#include "RigidBody.h"
+#include "Executor.h"
+#include "Trace.h"
+
+WorldBatch::WorldBatch(size_t worldCount, const std::vector<RigidBody*>& prototype,
+    const Vector2& gravity, int maxIterations, Executor* pool)
+    : _pool(pool)
+    , _bodiesPerWorld(prototype.size())
+    , _bodies(nullptr)
+    , _bodyCount(0)
+{
+    size_t total = worldCount * _bodiesPerWorld;
+    _bodies = (RigidBody*)::operator new(max(total, (size_t)1) * sizeof(RigidBody));
+
+    for (size_t w = 0; w < worldCount; ++w)
+    {
+        for (auto& source : prototype)
+        {
+            RigidBody::MassProperties massProperties = { source->Mass(), source->InvMass(), source->I(), source->InvI() };
+            RigidBody* body = new (&_bodies[_bodyCount++]) RigidBody(const_cast<Shape*>(source->GetShape()), massProperties);
+            if (source->IsKinematic())
+            {
+                body->MakeKinematic();
+            }
+            body->Position() = source->Position();
+            body->Rotation() = source->Rotation();
+            body->LinearVelocity() = source->LinearVelocity();
+            body->AngularVelocity() = source->AngularVelocity();
+        }
+
+        _worlds.push_back(std::unique_ptr<PhysicsWorld>(new PhysicsWorld(gravity, maxIterations)));
+        _worlds.back()->AddBodies(&_bodies[w * _bodiesPerWorld], _bodiesPerWorld);
+    }
+
+    if (!_worlds.empty())
+    {
+        _worlds[0]->SaveState(_initialState);
+    }
+
+    _forceX.resize(total);
+    _forceY.resize(total);
+    _torque.resize(total);
+    _positionX.resize(total);
+    _positionY.resize(total);
+    _rotation.resize(total);
+    _velocityX.resize(total);
+    _velocityY.resize(total);
+    _angularVelocity.resize(total);
+
+    for (size_t w = 0; w < worldCount; ++w)
+    {
+        Observe(w);
+    }
+}
+
+WorldBatch::~WorldBatch()
+{
+    // Worlds refer to the bodies, so go first
+    _worlds.clear();
+
+    for (size_t i = 0; i < _bodyCount; ++i)
+    {
+        _bodies[i].~RigidBody();
+    }
+    ::operator delete(_bodies);
+}
+
+void WorldBatch::Step(float dt)
+{
+    TRACE_SCOPE("WorldBatch::Step");
+
+    // Worlds are small, so hand them out a few at a time
+    static const size_t WorldsPerChunk = 4;
+
+    if (_pool)
+    {
+        _pool->ParallelFor(_worlds.size(), WorldsPerChunk, [this, dt](size_t first, size_t last)
+        {
+            StepWorlds(first, last, dt);
+        });
+    }
+    else
+    {
+        StepWorlds(0, _worlds.size(), dt);
+    }
+}
+
+void WorldBatch::StepWorlds(size_t first, size_t last, float dt)
+{
+    for (size_t w = first; w < last; ++w)
+    {
+        size_t base = w * _bodiesPerWorld;
+        for (size_t b = 0; b < _bodiesPerWorld; ++b)
+        {
+            size_t i = base + b;
+            RigidBody& body = _bodies[i];
+            body.Force() += Vector2(_forceX[i], _forceY[i]);
+            body.Torque() += _torque[i];
+            _forceX[i] = 0.0f;
+            _forceY[i] = 0.0f;
+            _torque[i] = 0.0f;
+        }
+
+        _worlds[w]->Update(dt);
+        Observe(w);
+    }
+}
+
+void WorldBatch::Reset(size_t world)
+{
+    _worlds[world]->LoadState(_initialState.data(), _initialState.size());
+    Observe(world);
+}
+
+void WorldBatch::Observe(size_t world)
+{
+    size_t base = world * _bodiesPerWorld;
+    for (size_t b = 0; b < _bodiesPerWorld; ++b)
+    {
+        size_t i = base + b;
+        const RigidBody& body = _bodies[i];
+        _positionX[i] = body.Position().x;
+        _positionY[i] = body.Position().y;
+        _rotation[i] = body.Rotation();
+        _velocityX[i] = body.LinearVelocity().x;
+        _velocityY[i] = body.LinearVelocity().y;
+        _angularVelocity[i] = body.AngularVelocity();
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+class PhysicsWorld;
+class Executor;
+
+// A parallel batch of many small, independent worlds, all holding copies of
+// the same scene, with structure of arrays inputs & outputs (for instance,
+// for reinforcement learning rollouts).
+//
+// All of the worlds' bodies are created in one contiguous block, world after
+// world, and share the prototype's shapes rather than each having their own.
+// Worlds are stepped in parallel across a thread pool (or any Executor).
+//
+// Inputs and outputs go through flat buffers laid out one array per component
+// (structure of arrays), indexed by world * BodiesPerWorld() + body, where
+// body is the index of the body in the prototype:
+//  - actions (forces & torques) are applied to the bodies at the start of
+//    each Step, then cleared
+//  - observations (positions, rotations & velocities) are filled in at the
+//    end of each Step, and by Reset
+//
+// Only those buffers are structure of arrays. The simulation state itself
+// stays in RigidBody objects (one block of them for the whole batch), and each
+// world is stepped by its own PhysicsWorld::Update: worlds are batched across
+// threads, not across SIMD lanes. Stepping every world's bodies together out
+// of shared SoA arrays would take a second solver & narrowphase written for
+// that layout, since PhysicsWorld's work on RigidBody pointers through their
+// pairs, and the two would have to be kept bit identical to each other.
+class WorldBatch
+{
+public:
+    // Creates worldCount worlds, each with a copy of the prototype bodies (in
+    // the same order, with the same shapes, mass properties, kinematic flags,
+    // positions, rotations & velocities). The prototype's shapes must outlive
+    // the batch. pool may be null, to step every world on the calling thread.
+    WorldBatch(size_t worldCount, const std::vector<RigidBody*>& prototype,
+        const Vector2& gravity, int maxIterations, Executor* pool);
+    ~WorldBatch();
+
+    size_t WorldCount() const { return _worlds.size(); }
+    size_t BodiesPerWorld() const { return _bodiesPerWorld; }
+
+    PhysicsWorld* World(size_t index) { return _worlds[index].get(); }
+
+    // Applies the actions, steps every world forward by dt, and gathers the observations
+    void Step(float dt);
+
+    // Puts a world back to its initial state
+    void Reset(size_t world);
+
+    // Actions
+    float* ForceX() { return _forceX.data(); }
+    float* ForceY() { return _forceY.data(); }
+    float* Torque() { return _torque.data(); }
+
+    // Observations
+    const float* PositionX() const { return _positionX.data(); }
+    const float* PositionY() const { return _positionY.data(); }
+    const float* Rotation() const { return _rotation.data(); }
+    const float* VelocityX() const { return _velocityX.data(); }
+    const float* VelocityY() const { return _velocityY.data(); }
+    const float* AngularVelocity() const { return _angularVelocity.data(); }
+
+private:
+    // Steps worlds [first, last)
+    void StepWorlds(size_t first, size_t last, float dt);
+
+    // Copies the state of a world's bodies into the observation buffers
+    void Observe(size_t world);
+
+    Executor* _pool;
+    size_t _bodiesPerWorld;
+    std::vector<std::unique_ptr<PhysicsWorld>> _worlds;
+    RigidBody* _bodies;     // raw block, bodies constructed in place
+    size_t _bodyCount;
+
+    // Snapshot (PhysicsWorld::SaveState) of a freshly created world
+    std::vector<uint8_t> _initialState;
+
+    std::vector<float> _forceX, _forceY, _torque;
+    std::vector<float> _positionX, _positionY, _rotation;
+    std::vector<float> _velocityX, _velocityY, _angularVelocity;
+
+    // Prevent copy
+    WorldBatch(const WorldBatch&);
+    WorldBatch& operator= (const WorldBatch&);
+};
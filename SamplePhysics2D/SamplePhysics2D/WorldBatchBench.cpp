@@ -0,0 +1,116 @@
+#include "Precomp.h"
+#include "Benchmarks.h"
+#include "PhysicsWorld.h"
+#include "Profiling.h"
+#include "RigidBody.h"
+#include "SampleScene.h"
+#include "ThreadPool.h"
+#include "WorldBatch.h"
+
+// Steps a batch of small worlds (each holding the sample's scene), driving
+// one body in each with random actions, on increasing numbers of threads.
+// Reports world steps per second and the scaling over one thread, and checks
+// that batched worlds match a world stepped on its own with the same actions.
+
+static const int WorldCount = 1024;
+static const int Steps = 120;
+static const float Dt = 1.0f / 60.0f;
+
+// Force applied to the controlled body of a world on a given step
+static Vector2 Action(size_t world, int step)
+{
+    BenchRandom random((uint32_t)(world * 7919 + step * 104729 + 1));
+    return Vector2(random.Range(-100.0f, 100.0f), random.Range(-100.0f, 300.0f));
+}
+
+bool BenchWorldBatch(FILE* output)
+{
+    std::vector<std::unique_ptr<RigidBody>> prototypeBodies;
+    CreateSampleScene(prototypeBodies);
+    std::vector<RigidBody*> prototype;
+    for (auto& body : prototypeBodies)
+    {
+        prototype.push_back(body.get());
+    }
+
+    // One thread, then doubling up to every hardware thread
+    std::vector<int> threadCounts;
+    int hardwareThreads = max((int)std::thread::hardware_concurrency(), 1);
+    for (int threads = 1; threads < hardwareThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    fprintf(output, "%d worlds of %u bodies, %d steps\n", WorldCount, (uint32_t)prototype.size(), Steps);
+
+    bool succeeded = true;
+    double singleThreadRate = 0;
+    for (auto& threads : threadCounts)
+    {
+        ThreadPool pool(threads - 1);
+        WorldBatch batch(WorldCount, prototype, Vector2(0.0f, -20.0f), 100, &pool);
+
+        int64_t start = GetProfileTicks();
+        for (int step = 0; step < Steps; ++step)
+        {
+            for (size_t w = 0; w < batch.WorldCount(); ++w)
+            {
+                Vector2 force = Action(w, step);
+                batch.ForceX()[w * batch.BodiesPerWorld()] = force.x;
+                batch.ForceY()[w * batch.BodiesPerWorld()] = force.y;
+            }
+            batch.Step(Dt);
+        }
+        double seconds = TicksToMilliseconds(GetProfileTicks() - start) / 1000.0;
+
+        double rate = WorldCount * Steps / seconds;
+        if (threads == 1)
+        {
+            singleThreadRate = rate;
+        }
+        fprintf(output, "%2d threads %12.0f world steps/s (%.2fx)\n", threads, rate, rate / singleThreadRate);
+
+        // A world stepped on its own, with the same actions, must match exactly
+        static const size_t CheckedWorld = WorldCount / 3;
+        std::vector<std::unique_ptr<RigidBody>> soloBodies;
+        CreateSampleScene(soloBodies);
+        PhysicsWorld solo(Vector2(0.0f, -20.0f), 100);
+        for (auto& body : soloBodies)
+        {
+            solo.AddBody(body.get());
+        }
+        for (int step = 0; step < Steps; ++step)
+        {
+            soloBodies[0]->Force() += Action(CheckedWorld, step);
+            solo.Update(Dt);
+        }
+
+        size_t observed = CheckedWorld * batch.BodiesPerWorld();
+        if (solo.ComputeStateHash() != batch.World(CheckedWorld)->ComputeStateHash() ||
+            batch.PositionX()[observed] != soloBodies[0]->Position().x ||
+            batch.VelocityY()[observed] != soloBodies[0]->LinearVelocity().y)
+        {
+            fprintf(output, "Batched world diverged from one stepped on its own\n");
+            succeeded = false;
+        }
+
+        // And resetting must take it back to the start
+        std::vector<std::unique_ptr<RigidBody>> freshBodies;
+        CreateSampleScene(freshBodies);
+        PhysicsWorld fresh(Vector2(0.0f, -20.0f), 100);
+        for (auto& body : freshBodies)
+        {
+            fresh.AddBody(body.get());
+        }
+        batch.Reset(CheckedWorld);
+        if (fresh.ComputeStateHash() != batch.World(CheckedWorld)->ComputeStateHash() ||
+            batch.PositionY()[observed] != freshBodies[0]->Position().y)
+        {
+            fprintf(output, "Reset world doesn't match a fresh one\n");
+            succeeded = false;
+        }
+    }
+
+    return succeeded;
+}
@@ -0,0 +1,86 @@
+#include "Precomp.h"
+#include "WorldStages.h"
+#include "RigidBody.h"
+#include "RigidBodyPair.h"
+
+template <class S>
+void IntegrateForces(RigidBodyT<S>* const* bodies, size_t count, const Vector2T<S>& gravity, S dt)
+{
+    // Dampening stands in for friction (we'll add friction simulation later),
+    // and velocities below the clamp threshold are zeroed
+    const S DampeningTerm = S(0.001f);
+    const S ClampThreshold = S(0.01f);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        RigidBodyT<S>* body = bodies[i];
+
+        body->LinearVelocity() += dt * (gravity + body->InvMass() * body->Force());
+        body->AngularVelocity() += dt * body->InvI() * body->Torque();
+
+        // A body at rest (no gravity, or held by forces) has no direction to dampen in
+        body->LinearVelocity() += -body->LinearVelocity().NormalizedOrZero() * DampeningTerm;
+        body->AngularVelocity() += (body->AngularVelocity() > S(0)) ? -DampeningTerm : DampeningTerm;
+
+        if (body->LinearVelocity().LengthSq() < ClampThreshold)
+        {
+            body->LinearVelocity() = Vector2T<S>(0, 0);
+        }
+        if (Abs(body->AngularVelocity()) < ClampThreshold)
+        {
+            body->AngularVelocity() = S(0);
+        }
+    }
+}
+
+template <class S>
+void PreSolvePairs(RigidBodyPairT<S>* pairs, size_t count, S invDt)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        pairs[i].PreSolve(invDt);
+    }
+}
+
+template <class S>
+void SolvePairs(RigidBodyPairT<S>* pairs, size_t count, int iterations)
+{
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (size_t k = 0; k < count; ++k)
+        {
+            pairs[k].Solve();
+        }
+    }
+}
+
+template <class S>
+void IntegrateVelocities(RigidBodyT<S>* const* bodies, size_t count, S dt)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        RigidBodyT<S>* body = bodies[i];
+
+        body->Position() += dt * body->LinearVelocity();
+        body->Rotation() += dt * body->AngularVelocity();
+
+        body->Force() = Vector2T<S>(0, 0);
+        body->Torque() = S(0);
+    }
+}
+
+template void IntegrateForces(RigidBodyT<float>* const* bodies, size_t count, const Vector2T<float>& gravity, float dt);
+template void IntegrateForces(RigidBodyT<double>* const* bodies, size_t count, const Vector2T<double>& gravity, double dt);
+template void IntegrateForces(RigidBodyT<Fixed>* const* bodies, size_t count, const Vector2T<Fixed>& gravity, Fixed dt);
+
+template void PreSolvePairs(RigidBodyPairT<float>* pairs, size_t count, float invDt);
+template void PreSolvePairs(RigidBodyPairT<double>* pairs, size_t count, double invDt);
+template void PreSolvePairs(RigidBodyPairT<Fixed>* pairs, size_t count, Fixed invDt);
+
+template void SolvePairs(RigidBodyPairT<float>* pairs, size_t count, int iterations);
+template void SolvePairs(RigidBodyPairT<double>* pairs, size_t count, int iterations);
+template void SolvePairs(RigidBodyPairT<Fixed>* pairs, size_t count, int iterations);
+
+template void IntegrateVelocities(RigidBodyT<float>* const* bodies, size_t count, float dt);
+template void IntegrateVelocities(RigidBodyT<double>* const* bodies, size_t count, double dt);
+template void IntegrateVelocities(RigidBodyT<Fixed>* const* bodies, size_t count, Fixed dt);
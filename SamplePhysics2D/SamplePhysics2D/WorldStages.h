@@ -0,0 +1,22 @@
+#pragma once
+
+// The stages of a step that PhysicsWorld & ScalarWorld share, so that both
+// run exactly the same math (on float, bit for bit). Each works on a range of
+// bodies or pairs, so that PhysicsWorld can split them across its executor.
+
+// Applies gravity & each body's forces to its velocities, then dampens them
+template <class S>
+void IntegrateForces(RigidBodyT<S>* const* bodies, size_t count, const Vector2T<S>& gravity, S dt);
+
+// Does all one time init for the pairs
+template <class S>
+void PreSolvePairs(RigidBodyPairT<S>* pairs, size_t count, S invDt);
+
+// Runs the solver's iterations over the pairs, visiting them in order each time
+template <class S>
+void SolvePairs(RigidBodyPairT<S>* pairs, size_t count, int iterations);
+
+// Integrates the bodies' velocities to obtain their new positions & rotations,
+// and clears their forces in preparation for the next step
+template <class S>
+void IntegrateVelocities(RigidBodyT<S>* const* bodies, size_t count, S dt);